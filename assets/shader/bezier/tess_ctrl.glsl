@@ -0,0 +1,54 @@
+#version 400 core
+// One invocation per output control point, patches smaller than
+// 32 control points leave the tail of the output patch unused.
+layout (vertices = 32) out;
+
+in vec3 ctrl_pos[];
+out vec3 tc_pos[];
+
+uniform int n_us;
+uniform int n_vs;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 viewport_size;
+uniform float pixels_per_segment;
+
+vec2 to_screen(vec3 p) {
+    vec4 clip = projection * view * model * vec4(p, 1.0f);
+    return clip.xy / max(clip.w, 1e-4f) * 0.5f * viewport_size;
+}
+
+// Length of the boundary control polygon in pixels, divided into segments.
+// Neighbour patches share the boundary, so they agree on the level and no crack appears.
+float edge_level(int first, int stride, int count) {
+    float len = 0.0f;
+    vec2 prev = to_screen(ctrl_pos[first]);
+    for (int k = 1; k < count; ++k) {
+        vec2 curr = to_screen(ctrl_pos[first + k * stride]);
+        len += distance(prev, curr);
+        prev = curr;
+    }
+    return clamp(len / pixels_per_segment, 1.0f, float(gl_MaxTessGenLevel));
+}
+
+void main() {
+    if (gl_InvocationID < gl_PatchVerticesIn)
+        tc_pos[gl_InvocationID] = ctrl_pos[gl_InvocationID];
+    else
+        tc_pos[gl_InvocationID] = vec3(0.0f);
+
+    if (gl_InvocationID == 0) {
+        // control point (i, j) is stored at i * n_vs + j, i along u.
+        float u0 = edge_level(0, 1, n_vs);                  // u = 0
+        float v0 = edge_level(0, n_vs, n_us);               // v = 0
+        float u1 = edge_level((n_us - 1) * n_vs, 1, n_vs);  // u = 1
+        float v1 = edge_level(n_vs - 1, n_vs, n_us);        // v = 1
+        gl_TessLevelOuter[0] = u0;
+        gl_TessLevelOuter[1] = v0;
+        gl_TessLevelOuter[2] = u1;
+        gl_TessLevelOuter[3] = v1;
+        gl_TessLevelInner[0] = max(v0, v1);
+        gl_TessLevelInner[1] = max(u0, u1);
+    }
+}
@@ -0,0 +1,71 @@
+#version 400 core
+layout (quads, fractional_even_spacing, ccw) in;
+
+#define MAX_ORDER 32
+
+in vec3 tc_pos[];
+
+out vec3 frag_pos;
+out vec3 frag_normal;
+
+uniform int n_us;
+uniform int n_vs;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// Bernstein basis of degree (order - 1) and its derivative at t,
+// raised one degree at a time so no pow() or binomial is needed.
+void bernstein(int order, float t, out float B[MAX_ORDER], out float dB[MAX_ORDER]) {
+    float s = 1.0f - t;
+    int n = order - 1;
+    B[0] = 1.0f;
+    for (int i = 1; i < order; ++i)
+        B[i] = 0.0f;
+    for (int d = 1; d < n; ++d) {
+        for (int i = d; i > 0; --i)
+            B[i] = s * B[i] + t * B[i - 1];
+        B[0] = s * B[0];
+    }
+    // derivative of degree n basis from degree n - 1 basis.
+    for (int i = 0; i < order; ++i) {
+        float lo = i > 0 ? B[i - 1] : 0.0f;
+        float hi = i < n ? B[i] : 0.0f;
+        dB[i] = float(n) * (lo - hi);
+    }
+    if (n > 0) {
+        for (int i = n; i > 0; --i)
+            B[i] = s * B[i] + t * B[i - 1];
+        B[0] = s * B[0];
+    }
+}
+
+void main() {
+    float Bu[MAX_ORDER], dBu[MAX_ORDER];
+    float Bv[MAX_ORDER], dBv[MAX_ORDER];
+    bernstein(n_us, gl_TessCoord.x, Bu, dBu);
+    bernstein(n_vs, gl_TessCoord.y, Bv, dBv);
+
+    vec3 p = vec3(0.0f);
+    vec3 dpdu = vec3(0.0f);
+    vec3 dpdv = vec3(0.0f);
+    for (int i = 0; i < n_us; ++i) {
+        vec3 row = vec3(0.0f);
+        vec3 drow = vec3(0.0f);
+        for (int j = 0; j < n_vs; ++j) {
+            vec3 c = tc_pos[i * n_vs + j];
+            row += Bv[j] * c;
+            drow += dBv[j] * c;
+        }
+        p += Bu[i] * row;
+        dpdu += dBu[i] * row;
+        dpdv += Bu[i] * drow;
+    }
+    vec3 normal = cross(dpdu, dpdv);
+    if (dot(normal, normal) > 0.0f)
+        normal = normalize(normal);
+
+    frag_pos = vec3(model * vec4(p, 1.0f)); // use world coordinate to compute lighting.
+    frag_normal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * view * vec4(frag_pos, 1.0f);
+}
@@ -0,0 +1,8 @@
+#version 400 core
+layout (location = 0) in vec3 pos;
+
+out vec3 ctrl_pos;
+
+void main() {
+    ctrl_pos = pos; // control points stay in model coordinate until evaluated.
+}
@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 noraml;
+layout (location = 2) in vec2 tex_coord;
+/* per-instance attributes */
+layout (location = 3) in mat4 model;
+layout (location = 7) in mat3 normal_matrix;
+layout (location = 10) in vec3 Ka;
+layout (location = 11) in vec3 Kd;
+layout (location = 12) in vec3 Ks;
+layout (location = 13) in float highlight_decay;
+
+out vec3 frag_pos;
+out vec3 frag_normal;
+out vec2 frag_tex_coord;
+flat out vec3 frag_Ka;
+flat out vec3 frag_Kd;
+flat out vec3 frag_Ks;
+flat out float frag_highlight_decay;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+    frag_pos = vec3(model * vec4(pos, 1.0f)); // use world coordinate to compute lighting.
+    frag_normal = normal_matrix * noraml;
+    frag_tex_coord = tex_coord;
+    frag_Ka = Ka;
+    frag_Kd = Kd;
+    frag_Ks = Ks;
+    frag_highlight_decay = highlight_decay;
+    gl_Position = projection * view * vec4(frag_pos, 1.0f);
+}
@@ -0,0 +1,60 @@
+#version 330 core
+out vec4 frag_color;
+
+struct Material {
+    vec3 Ka; // ambient coeff. without a color map.
+    vec3 Kd; // diffusion coeff. without a color map.
+    sampler2D Kd_map; // color, texture unit 0.
+    bool use_Kd_map;
+    sampler2D normal_map; // tangent space normals, texture unit 1.
+    bool use_normal_map;
+    vec3 Ks; // specular coeff.
+    float highlight_decay; // control the size of highlight.
+};
+
+struct PointLight {
+    vec3 pos;
+    vec3 Ia;
+    vec3 Id;
+    vec3 Is;
+};
+
+in vec3 frag_pos;
+in vec3 frag_normal;
+in vec2 frag_tex_coord;
+in vec4 frag_tangent;
+
+uniform vec3 view_pos;
+uniform Material material;
+uniform PointLight light;
+
+void main() {
+    vec3 norm = normalize(frag_normal);
+    if (material.use_normal_map) {
+        // MikkTSpace: the bitangent is rebuilt per pixel from the
+        // interpolated, unnormalized normal and tangent.
+        vec3 bitangent = frag_tangent.w * cross(frag_normal, frag_tangent.xyz);
+        vec3 n = texture(material.normal_map, frag_tex_coord).xyz * 2.0f - 1.0f;
+        norm = normalize(n.x * frag_tangent.xyz + n.y * bitangent + n.z * frag_normal);
+    }
+    vec3 Ka = material.Ka;
+    vec3 Kd = material.Kd;
+    if (material.use_Kd_map) {
+        Ka = vec3(texture(material.Kd_map, frag_tex_coord));
+        Kd = Ka;
+    }
+    // ambient
+    vec3 La = Ka * light.Ia;
+    // diffuse
+    vec3 light_dir = normalize(light.pos - frag_pos);
+    float diff_coef = max(dot(norm, light_dir), 0.0f);
+    vec3 Ld = diff_coef * Kd * light.Id;
+    // specular
+    vec3 view_dir = normalize(view_pos - frag_pos);
+    vec3 half_vec = normalize(light_dir + view_dir);
+    float spec_coef = pow(max(dot(half_vec, norm), 0.0f), material.highlight_decay); 
+    vec3 Ls = spec_coef * material.Ks * light.Is;
+
+    vec3 L = La + Ld + Ls;
+    frag_color = vec4(L, 1.0f);
+}
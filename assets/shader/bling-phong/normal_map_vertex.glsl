@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 tex_coord;
+layout (location = 14) in vec4 tangent; // xyz tangent, w handedness, see TriMesh::tangents_.
+
+out vec3 frag_pos;
+out vec3 frag_normal;
+out vec2 frag_tex_coord;
+out vec4 frag_tangent;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+    frag_pos = vec3(model * vec4(pos, 1.0f)); // use world coordinate to compute lighting.
+    frag_normal = mat3(transpose(inverse(model))) * normal;
+    // tangents lie in the surface, they transform like positions.
+    frag_tangent = vec4(mat3(model) * tangent.xyz, tangent.w);
+    frag_tex_coord = tex_coord;
+    gl_Position = projection * view * vec4(frag_pos, 1.0f);
+}
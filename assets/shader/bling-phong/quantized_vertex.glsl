@@ -0,0 +1,38 @@
+#version 330 core
+/* Vertices packed by cgcl::VertexFormat, decoded here. */
+layout (location = 0) in vec4 pos;
+layout (location = 1) in vec3 noraml;
+
+out vec3 frag_pos;
+out vec3 frag_normal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+/* Set by TriMesh::updateUniforms. */
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+uniform int normal_encoding; // 0 float, 1 octahedral in noraml.xy, 2 octahedral 8-bit in pos.w.
+
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = position_offset + position_scale * pos.xyz;
+    vec3 normal = noraml;
+    if (normal_encoding == 1) {
+        normal = oct_decode(noraml.xy);
+    } else if (normal_encoding == 2) {
+        uint bits = uint(pos.w * 65535.0 + 0.5);
+        normal = oct_decode(vec2(float(bits & 0xffu), float(bits >> 8)) / 255.0 * 2.0 - 1.0);
+    }
+    frag_pos = vec3(model * vec4(position, 1.0f)); // use world coordinate to compute lighting.
+    frag_normal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * view * vec4(frag_pos, 1.0f);
+}
@@ -0,0 +1,123 @@
+#ifndef CGCL_ACCEL_BVH_H
+#define CGCL_ACCEL_BVH_H
+
+#include "cgcl/math/Bounds.h"
+#include "cgcl/mesh/TriMesh.h"
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cgcl {
+
+
+struct Ray {
+    glm::vec3 origin_;
+    glm::vec3 direction_; // need not be normalized, t is in its unit.
+    float t_min_ = 0.0f;
+    float t_max_ = FLT_MAX;
+};
+
+struct RayHit {
+    static constexpr uint32_t no_hit = UINT32_MAX;
+
+    float t_ = FLT_MAX;
+    float u_ = 0.0f, v_ = 0.0f; // barycentric weights of the 2nd and 3rd vertex.
+    uint32_t triangle_ = no_hit; // triangle index in the mesh.
+
+    bool hit() const { return triangle_ != no_hit; }
+};
+
+/// \brief Rays traced together through the binary tree, as structure of
+/// arrays so every node and triangle is tested against all lanes at
+/// once. Coherent rays, as from a camera or toward a point light, visit
+/// nearly the same nodes. A lane with t_max_ < t_min_ is inactive.
+struct RayPacket {
+    static constexpr int size = 8;
+
+    float origin_x_[size], origin_y_[size], origin_z_[size];
+    float direction_x_[size], direction_y_[size], direction_z_[size];
+    float t_min_[size];
+    float t_max_[size];
+
+    void set(int lane, const Ray &ray);
+    void disable(int lane) { t_min_[lane] = 0.0f; t_max_[lane] = -1.0f; }
+};
+
+/// \brief Binary node, 32 bytes, so two siblings share a cache line.
+/// Siblings are adjacent, the right child follows the left one.
+struct BVHNode {
+    glm::vec3 min_;
+    uint32_t left_first_; // left child of inner node, first triangle of leaf.
+    glm::vec3 max_;
+    uint32_t count_;      // triangles in leaf, 0 for inner node.
+
+    bool leaf() const { return count_ > 0; }
+};
+
+/// \brief Node of width children, child bounds as structure of arrays
+/// so a ray is tested against all of them at once. An empty lane has
+/// inverted bounds and never hits. The 8-wide node holds one AVX
+/// register of bounds per plane and is 256 bytes, 4 cache lines.
+template <int width>
+struct BVHWideNodeN {
+    float min_x_[width], min_y_[width], min_z_[width];
+    float max_x_[width], max_y_[width], max_z_[width];
+    uint32_t child_[width]; // wide node of inner lane, first triangle of leaf lane.
+    uint32_t count_[width]; // triangles of leaf lane, 0 for inner or empty lane.
+};
+using BVHWideNode = BVHWideNodeN<4>;
+using BVHWideNode8 = BVHWideNodeN<8>;
+
+/// \brief Triangle stored for Moller-Trumbore intersection.
+struct BVHTriangle {
+    glm::vec3 v0_, e1_, e2_; // v0, v1 - v0, v2 - v0.
+};
+
+/// \brief Bounding volume hierarchy over the triangles of a mesh,
+/// built top-down with binned SAH, subtrees built in parallel.
+class BVH {
+public:
+    static constexpr unsigned int n_bins = 16;
+    static constexpr unsigned int max_leaf_size = 4;
+
+    static std::unique_ptr<BVH> from_mesh(const TriMesh &mesh);
+    static std::unique_ptr<BVH> from_triangles(std::vector<BVHTriangle> &&triangles);
+
+    /// \brief Closest hit within [t_min_, t_max_], return whether any.
+    bool intersect(const Ray &ray, RayHit &hit) const;
+    /// \brief Whether anything is hit within [t_min_, t_max_],
+    /// stops at the first hit, for shadow and occlusion rays.
+    bool occluded(const Ray &ray) const;
+    /// \brief Closest hit of every active lane, hits of inactive lanes
+    /// are left as they are.
+    void intersect(const RayPacket &packet, RayHit hits[RayPacket::size]) const;
+    /// \brief Whether each lane hits anything, false for inactive lanes.
+    void occluded(const RayPacket &packet, bool occluded[RayPacket::size]) const;
+    /// \brief Append mesh indices of triangles whose bounds overlap box.
+    void overlap(const AABB &box, std::vector<uint32_t> &triangles) const;
+
+    /// \brief Collapse the binary tree into 4-wide nodes for intersectWide().
+    void buildWide();
+    bool intersectWide(const Ray &ray, RayHit &hit) const;
+    /// \brief Collapse the binary tree into 8-wide nodes for intersectWide8().
+    /// Half the levels of the 4-wide tree, so fewer cache misses on large
+    /// meshes, the slab tests are vectorized over 8 lanes.
+    void buildWide8();
+    bool intersectWide8(const Ray &ray, RayHit &hit) const;
+
+    AABB bounds() const;
+    size_t n_triangles() const { return triangles_.size(); }
+
+    std::vector<BVHNode> nodes_;             // root at 0.
+    std::vector<BVHTriangle> triangles_;     // in leaf order.
+    std::vector<uint32_t> triangle_ids_;     // leaf order to mesh triangle index.
+    std::vector<BVHWideNode> wide_nodes_;    // root at 0, empty until buildWide().
+    std::vector<BVHWideNode8> wide8_nodes_;  // root at 0, empty until buildWide8().
+};
+
+} // end namespace cgcl
+
+#endif // CGCL_ACCEL_BVH_H
@@ -1,15 +1,16 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 
 namespace cgcl {
 
 
-inline int choose_nk(int n, int k) {
-    if (k == 0) return 1;
-    if (k > n / 2) return choose_nk(n, n - k); 
+constexpr int choose_nk(int n, int k) {
+    if (k < 0 || k > n) return 0;
+    if (k > n / 2) k = n - k;
 
-    long long res = 1; 
+    long long res = 1;
 
     for (int i = 1; i <= k; ++i)
     {
@@ -21,7 +22,125 @@ inline int choose_nk(int n, int k) {
 }
 
 inline float bernstein_poly(int n, int i, float u) {
-    return choose_nk(n, i) * powf(u, i) * powf(1 - u, n - i); 
-} 
+    return choose_nk(n, i) * powf(u, i) * powf(1 - u, n - i);
+}
+
+
+/// \brief Pascal triangle up to degree N, built at compile time.
+/// Entries are stored as exact integers and read as float.
+template <int N>
+struct BinomialTable {
+    static_assert(N <= 34, "Binomials of degree N overflow uint32_t");
+    constexpr BinomialTable() : c() {
+        for (int n = 0; n <= N; ++n) {
+            c[n][0] = c[n][n] = 1;
+            for (int k = 1; k < n; ++k)
+                c[n][k] = c[n - 1][k - 1] + c[n - 1][k];
+        }
+    }
+    constexpr float operator()(int n, int k) const { return float(c[n][k]); }
+    uint32_t c[N + 1][N + 1];
+};
+
+/* Degree 31 covers the largest patch drawn as GL_PATCHES. As float the
+ * binomials are exact up to degree 27, from C(28, 12) on they are
+ * rounded, off by less than one part in 2^24.
+ */
+constexpr int binomial_table_degree = 31;
+inline constexpr BinomialTable<binomial_table_degree> binomial_table{};
+
+/// \brief All N + 1 Bernstein basis of degree N at u.
+/// The loops have compile-time trip counts and fully unroll.
+template <int N>
+inline void bernstein_basis(float u, float (&B)[N + 1]) {
+    static_assert(N >= 0 && N <= binomial_table_degree, "Unsupported Bernstein degree");
+    float s = 1.0f - u;
+    float up[N + 1], sp[N + 1];
+    up[0] = sp[0] = 1.0f;
+    for (int k = 1; k <= N; ++k) {
+        up[k] = up[k - 1] * u;
+        sp[k] = sp[k - 1] * s;
+    }
+    for (int i = 0; i <= N; ++i)
+        B[i] = binomial_table(N, i) * up[i] * sp[N - i];
+}
+
+/// \brief Cubic case, the common one for Bezier patches.
+template <>
+inline void bernstein_basis<3>(float u, float (&B)[4]) {
+    float s = 1.0f - u;
+    float u2 = u * u, s2 = s * s;
+    B[0] = s2 * s;
+    B[1] = 3.0f * u * s2;
+    B[2] = 3.0f * u2 * s;
+    B[3] = u2 * u;
+}
+
+/// \brief Bernstein basis of runtime degree n at u, B holds n + 1 floats.
+/// Raise the degree one at a time, so no pow() or binomial is needed.
+inline void bernstein_basis(int n, float u, float *B) {
+    float s = 1.0f - u;
+    B[0] = 1.0f;
+    for (int d = 1; d <= n; ++d) {
+        B[d] = u * B[d - 1];
+        for (int i = d - 1; i > 0; --i)
+            B[i] = s * B[i] + u * B[i - 1];
+        B[0] = s * B[0];
+    }
+}
+
+/* Multiply-adds below are written plainly, the compiler contracts them
+ * into FMA when the target has it (e.g. -mfma), std::fma would be a
+ * library call otherwise.
+ */
+
+/// \brief Evaluate a degree N Bezier curve by de Casteljau algorithm,
+/// T is float or a glm vector.
+template <int N, typename T>
+inline T de_casteljau(const T (&P)[N + 1], float u) {
+    T tmp[N + 1];
+    for (int i = 0; i <= N; ++i)
+        tmp[i] = P[i];
+    for (int k = 1; k <= N; ++k)
+        for (int i = 0; i <= N - k; ++i)
+            tmp[i] = tmp[i] + (tmp[i + 1] - tmp[i]) * u;
+    return tmp[0];
+}
+
+template <>
+inline float de_casteljau<3, float>(const float (&P)[4], float u) {
+    float a = P[0] + u * (P[1] - P[0]);
+    float b = P[1] + u * (P[2] - P[1]);
+    float c = P[2] + u * (P[3] - P[2]);
+    a = a + u * (b - a);
+    b = b + u * (c - b);
+    return a + u * (b - a);
+}
 
-}
\ No newline at end of file
+/// \brief Bernstein basis of degree N for W parameters at once,
+/// B is stored basis major, B[i * W + lane].
+/// The loop over lanes is the vectorized one, the degree loops inside
+/// it have compile-time trip counts and unroll, so the intermediates of
+/// W of 8 or 16 lanes stay in AVX / AVX-512 registers.
+template <int N, int W>
+inline void bernstein_basis_batch(const float *u, float *B) {
+    static_assert(N >= 0 && N <= binomial_table_degree, "Unsupported Bernstein degree");
+#pragma omp simd
+    for (int lane = 0; lane < W; ++lane) {
+        float b[N + 1];
+        bernstein_basis<N>(u[lane], b);
+        for (int i = 0; i <= N; ++i)
+            B[i * W + lane] = b[i];
+    }
+}
+
+/// \brief Evaluate one degree N Bezier curve at W parameters at once,
+/// vectorized over lanes as above.
+template <int N, int W>
+inline void de_casteljau_batch(const float (&P)[N + 1], const float *u, float *out) {
+#pragma omp simd
+    for (int lane = 0; lane < W; ++lane)
+        out[lane] = de_casteljau<N>(P, u[lane]);
+}
+
+}
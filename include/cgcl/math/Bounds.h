@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace cgcl {
+
+
+/// \brief Axis aligned bounding box, empty when min_ > max_.
+struct AABB {
+    glm::vec3 min_ = glm::vec3(FLT_MAX);
+    glm::vec3 max_ = glm::vec3(-FLT_MAX);
+
+    bool empty() const { return min_.x > max_.x; }
+    glm::vec3 center() const { return (min_ + max_) * 0.5f; }
+    glm::vec3 extent() const { return max_ - min_; }
+    float surfaceArea() const {
+        glm::vec3 d = extent();
+        return empty() ? 0.0f : 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    void expand(const glm::vec3 &p) {
+        min_ = glm::min(min_, p);
+        max_ = glm::max(max_, p);
+    }
+    void expand(const AABB &box) {
+        min_ = glm::min(min_, box.min_);
+        max_ = glm::max(max_, box.max_);
+    }
+
+    /// \brief Box around the transformed box, by Arvo's method.
+    AABB transform(const glm::mat4 &m) const {
+        if (empty()) return *this;
+        AABB box;
+        box.min_ = box.max_ = glm::vec3(m[3]);
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                float a = m[j][i] * min_[j], b = m[j][i] * max_[j];
+                box.min_[i] += std::min(a, b);
+                box.max_[i] += std::max(a, b);
+            }
+        }
+        return box;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center_ = glm::vec3(0.0f);
+    float radius_ = -1.0f; // negative for empty.
+
+    bool empty() const { return radius_ < 0.0f; }
+
+    /// \brief Sphere around the transformed sphere, the radius is
+    /// scaled by the largest axis scale of m.
+    BoundingSphere transform(const glm::mat4 &m) const {
+        float scale2 = std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                                 glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+                                 glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))});
+        return {glm::vec3(m * glm::vec4(center_, 1.0f)), radius_ * std::sqrt(scale2)};
+    }
+};
+
+} // end namespace cgcl
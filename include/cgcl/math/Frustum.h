@@ -0,0 +1,50 @@
+#pragma once
+
+#include "cgcl/math/Bounds.h"
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Bounding spheres as structure of arrays, the layout
+/// tested 8 at a time by Frustum::cull.
+struct BoundingSphereSoA {
+    std::vector<float> x_, y_, z_, radius_;
+
+    size_t size() const { return x_.size(); }
+    void clear() { x_.clear(); y_.clear(); z_.clear(); radius_.clear(); }
+    void push_back(const BoundingSphere &sphere) {
+        x_.push_back(sphere.center_.x);
+        y_.push_back(sphere.center_.y);
+        z_.push_back(sphere.center_.z);
+        radius_.push_back(sphere.radius_);
+    }
+};
+
+/// \brief Six planes of a view frustum, normals pointing inside,
+/// ax + by + cz + d >= 0 for points inside.
+class Frustum {
+public:
+    enum Plane { LEFT = 0, RIGHT, BOTTOM, TOP, NEAR, FAR };
+
+    Frustum() = default;
+    /// \brief Planes of clip space -w <= x, y, z <= w pulled back
+    /// by view_projection (Gribb and Hartmann), in world space.
+    static Frustum from_matrix(const glm::mat4 &view_projection);
+
+    /// \brief Conservative, a sphere outside of no plane counts as visible.
+    bool intersects(const BoundingSphere &sphere) const;
+    bool intersects(const AABB &box) const;
+
+    /// \brief Test every sphere, visible[i] is 1 if sphere i may be visible,
+    /// 0 otherwise. Eight spheres per iteration with AVX2, and
+    /// multithreaded for large sets. Return the number of visible spheres.
+    size_t cull(const BoundingSphereSoA &spheres, uint8_t *visible) const;
+
+    glm::vec4 planes_[6];
+};
+
+} // end namespace cgcl
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "cgcl/mesh/Mesh.h"
+#include "cgcl/surface/Bezier.h"
+#include "cgcl/platform/OpenGL/GLShader.h"
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Bezier patches tessellated on GPU.
+/// Control points are uploaded as GL_PATCHES and evaluated by the
+/// tessellation shaders in assets/shader/bezier, the tessellation
+/// level of each edge follows its size on screen. Requires OpenGL 4.0.
+class BezierPatchMesh : public Mesh {
+public:
+    /* Output patch size of the tessellation control shader,
+     * also the minimum GL_MAX_PATCH_VERTICES guaranteed by OpenGL.
+     */
+    static constexpr unsigned int max_patch_vertices = 32;
+
+    BezierPatchMesh() = default;
+    /// \brief Patches with more than max_patch_vertices control points can not
+    /// be drawn as GL_PATCHES, and the shaders evaluate polynomial patches only.
+    /// Such patches are appended to oversized (if given) for CPU tessellation
+    /// with TriMesh::from_bezier_patches.
+    static std::unique_ptr<BezierPatchMesh> from_bezier_patches(
+        const std::vector<BezierSurface> &patches,
+        std::vector<BezierSurface> *oversized = nullptr);
+
+    /// \brief Program used by render(), it should be built from the
+    /// bezier tessellation shaders.
+    void bindShader(GLShader *shader) { shader_ = shader; }
+    /// \brief Screen-space target of tessellation, in pixels per segment.
+    void updateTessellation(const glm::vec2 &viewport_size, float pixels_per_segment = 8.0f);
+
+    virtual void render() override;
+    virtual unsigned int vertexArray() const override { return VAO; }
+    virtual void draw() override;
+    virtual void initGL() override;
+    void finishGL();
+
+    /* Patches of the same size are stored together,
+     * as GL_PATCH_VERTICES is fixed in one draw.
+     */
+    struct PatchGroup {
+        unsigned int n_us, n_vs;
+        unsigned int first; // first control point
+        unsigned int count; // number of control points
+    };
+    std::vector<glm::vec3> ctrl_pts_;
+    std::vector<PatchGroup> groups_;
+private:
+    GLShader *shader_ = nullptr;
+    unsigned int VAO, VBO;
+};
+
+} // end namespace cgcl
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Half-edge adjacency of a triangle list in flat int32 arrays.
+/// Half-edge h = 3 * t + k runs from corner k to corner (k + 1) % 3 of
+/// triangle t, so its triangle, next and previous half-edge and its
+/// origin indices[h] need no storage, only twins do.
+struct HalfEdgeMesh {
+    static constexpr int32_t border = -1;      // twin of an edge with one triangle.
+    static constexpr int32_t non_manifold = -2; // twin of an edge with more than two
+                                                // triangles, inconsistent winding, or
+                                                // both ends at one vertex.
+    /* Opposite half-edge, or border, or non_manifold. */
+    std::vector<int32_t> twins_;
+    /* One half-edge leaving every vertex, -1 if the vertex is not used.
+     * A border half-edge if the vertex has one, so that walking around
+     * the vertex from it covers the whole fan.
+     */
+    std::vector<int32_t> vertex_half_edges_;
+    size_t n_border_edges_ = 0;
+    size_t n_non_manifold_edges_ = 0;
+
+    /// \brief Twins are found by sorting the half-edges by their lower
+    /// then higher vertex, with a parallel counting sort on the lower
+    /// one and small sorts per vertex, instead of a hash map of edges.
+    static HalfEdgeMesh build(const unsigned int *indices, size_t n_indices, size_t n_vertices);
+
+    static int32_t next(int32_t h) { return h % 3 == 2 ? h - 2 : h + 1; }
+    static int32_t prev(int32_t h) { return h % 3 == 0 ? h + 2 : h - 1; }
+    static int32_t face(int32_t h) { return h / 3; }
+
+    bool isBorder(int32_t h) const { return twins_[h] == border; }
+    bool isManifold() const { return n_non_manifold_edges_ == 0; }
+    bool isClosed() const { return n_border_edges_ == 0 && isManifold(); }
+    bool isBorderVertex(int32_t v) const {
+        return vertex_half_edges_[v] >= 0 && isBorder(vertex_half_edges_[v]);
+    }
+
+    /// \brief Call f(h) for the half-edges leaving v, turning from
+    /// triangle to triangle across shared edges. Stops at a border or
+    /// non-manifold edge, so a non-manifold fan is visited in part.
+    template <typename F>
+    void forEachOutgoing(int32_t v, F f) const {
+        const int32_t start = vertex_half_edges_[v];
+        if (start < 0) return;
+        int32_t h = start;
+        do {
+            f(h);
+            h = twins_[prev(h)];
+        } while (h >= 0 && h != start);
+    }
+};
+
+} // end namespace cgcl
@@ -0,0 +1,47 @@
+#pragma once
+#include "cgcl/mesh/TriMesh.h"
+#include "cgcl/mesh/PhongMaterial.h"
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Per-instance attributes, read by 
+/// shader/bling-phong/instanced_vertex.glsl from location 3.
+struct InstanceData {
+    glm::mat4 model_;
+    glm::mat3 normal_matrix_; // transpose(inverse(model)), computed on CPU once per instance.
+    glm::vec3 Ka_;
+    glm::vec3 Kd_;
+    glm::vec3 Ks_;
+    float decay_;
+
+    static InstanceData make(const glm::mat4 &model, const PhongMaterial &material);
+    /// \brief Point attributes 3 ~ 13 of the bound vertex array to the
+    /// bound GL_ARRAY_BUFFER of InstanceData, advancing once per instance.
+    static void setAttributes();
+};
+
+
+/// \brief One triangular mesh drawn many times in one
+/// glDrawElementsInstanced, each instance with its own
+/// model matrix and Bling-Phong material.
+class InstancedTriMesh : public TriMesh {
+public:
+    using TriMesh::TriMesh;
+
+    std::vector<InstanceData> instances_;
+
+    virtual void initGL() override;
+    /// \brief Upload instances_, call it after instances_ changed.
+    void updateInstances();
+    virtual void draw() override;
+    void finishGL();
+private:
+    unsigned int instance_VBO_;
+    size_t instance_capacity_ = 0;
+};
+
+} // end namespace cgcl
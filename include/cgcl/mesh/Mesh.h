@@ -3,10 +3,24 @@
 
 namespace cgcl {
 
+class GLShader;
+
 class Mesh {
 public:
+    virtual ~Mesh() = default;
     virtual void initGL();
     virtual void render();
+    /// \brief Vertex array object bound by render(), 0 if none.
+    virtual unsigned int vertexArray() const;
+    /// \brief render() without binding and unbinding the vertex array,
+    /// for callers that sort draws and bind it only when it changes.
+    virtual void draw();
+    /// \brief Set uniforms the mesh needs from the bound shader before it
+    /// is drawn, such as how to decode its vertices. None by default.
+    virtual void updateUniforms(GLShader &shader) const;
+    /// \brief draw() with the materials the mesh carries, set on the
+    /// bound shader between its ranges. Same as draw() by default.
+    virtual void drawMaterials(GLShader &shader);
 };
 
 } // end namespace 
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+
+/* Lossless codecs for the index and vertex buffers of a mesh, built
+ * for decode speed. Both streams are cut into blocks that decode
+ * independently and in parallel, straight into the destination, which
+ * may be a mapped GL buffer; TriMesh::from_compressed decodes into its
+ * CPU arrays, uploaded by initGL() as for any mesh. Decoding checks
+ * that every block stays within the stream and, for indices, that they
+ * are below the vertex count, and fails with CHECK on corrupt input.
+ *
+ * On one core MeshCodecBench decodes indices at ~2 GB/s in the default
+ * build, which picks the SSSE3 decoder at run time on x86, and ~3.8
+ * GB/s with CGCL_ENABLE_AVX2. Vertices decode at ~1 ~ 1.5 GB/s either
+ * way, the planes are only auto-vectorized, short of the several GB/s
+ * of a hand written SIMD decoder.
+ */
+
+/// \brief Indices as zigzag deltas to the previous index in stream
+/// VByte layout (Lemire et al.): 2-bit lengths for 4 values per control
+/// byte, then 1 ~ 4 data bytes each. Run TriMesh::optimize first so
+/// deltas are small. Decoded 4 at a time by one shuffle with SSSE3,
+/// every index is checked to be below n_vertices.
+std::vector<uint8_t> encode_index_buffer(const unsigned int *indices, size_t n_indices);
+void decode_index_buffer(const uint8_t *data, size_t size, unsigned int *indices, size_t n_indices,
+                         size_t n_vertices);
+/// \brief Fewest bytes a stream of n_indices can take, check stream
+/// sizes against it before allocating for counts read from a file.
+size_t min_index_buffer_size(size_t n_indices);
+
+/// \brief Vertices of stride bytes (a multiple of 4) as zigzag deltas
+/// of every 32-bit word to the same word of the previous vertex, split
+/// into byte planes and bit-packed in groups of 16 at 0, 2, 4 or 8 bits.
+/// Exact for floats, and smaller for quantized VertexFormat data.
+std::vector<uint8_t> encode_vertex_buffer(const void *vertices, size_t n_vertices, size_t stride);
+void decode_vertex_buffer(const uint8_t *data, size_t size, void *vertices, size_t n_vertices, size_t stride);
+/// \brief Fewest bytes a stream of n_vertices can take, at most 64 times
+/// less than the vertices when all of them are equal.
+size_t min_vertex_buffer_size(size_t n_vertices, size_t stride);
+
+} // end namespace cgcl
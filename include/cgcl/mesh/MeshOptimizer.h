@@ -0,0 +1,53 @@
+#pragma once
+#include "cgcl/mesh/TriMesh.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Post-transform vertex cache efficiency of an index buffer,
+/// simulated with a FIFO cache.
+struct VertexCacheStats {
+    size_t n_transformed = 0; // cache misses, vertices shaded.
+    size_t n_triangles = 0;
+    size_t n_vertices = 0;    // distinct vertices referenced.
+
+    /// \brief Average cache miss ratio, transformed vertices per triangle,
+    /// 3 at worst, about 0.5 at best for a regular grid.
+    float acmr() const { return n_triangles ? float(n_transformed) / n_triangles : 0.0f; }
+    /// \brief Average transform to vertex ratio, 1 is optimal.
+    float atvr() const { return n_vertices ? float(n_transformed) / n_vertices : 0.0f; }
+};
+
+/* All passes below work on triangle lists of indices smaller than
+ * n_vertices and run in time linear in the number of indices.
+ */
+
+VertexCacheStats analyze_vertex_cache(const unsigned int *indices, size_t n_indices,
+                                      size_t n_vertices, unsigned int cache_size = 16);
+
+/// \brief Reorder triangles for the vertex cache by Tipsify (Sander,
+/// Nehab and Barczak 2007). If clusters is given, it receives the first
+/// index of every run of triangles that starts after a jump, for
+/// optimize_overdraw.
+void optimize_vertex_cache(unsigned int *indices, size_t n_indices, size_t n_vertices,
+                           unsigned int cache_size = 16, std::vector<unsigned int> *clusters = nullptr);
+
+/// \brief Reorder the clusters found by optimize_vertex_cache, drawing
+/// those facing away from the mesh center first so that they occlude the
+/// rest. Clusters are split further where that costs at most threshold
+/// times their ACMR. Triangle order inside a cluster is kept.
+void optimize_overdraw(unsigned int *indices, size_t n_indices, const Vertex *vertices,
+                       size_t n_vertices, const std::vector<unsigned int> &clusters,
+                       unsigned int cache_size = 16, float threshold = 1.05f);
+
+/// \brief Reorder vertices by first use in indices and remap indices,
+/// so vertex fetch streams through memory. Unreferenced vertices are
+/// moved to the end. If remap is given it receives the new position of
+/// every old vertex, so per vertex attributes can follow.
+void optimize_vertex_fetch(std::vector<Vertex> &vertices, unsigned int *indices, size_t n_indices,
+                           std::vector<unsigned int> *remap = nullptr);
+
+} // end namespace cgcl
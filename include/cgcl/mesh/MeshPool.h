@@ -0,0 +1,72 @@
+#pragma once
+#include "cgcl/mesh/Mesh.h"
+#include "cgcl/mesh/TriMesh.h"
+#include "cgcl/mesh/InstancedTriMesh.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Layout of one command in GL_DRAW_INDIRECT_BUFFER.
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+};
+
+/// \brief Static meshes packed into one vertex and one index buffer,
+/// a frame of draws is submitted in one glMultiDrawElementsIndirect.
+///
+/// Every draw carries an InstanceData, fetched through base_instance,
+/// so it is drawn with shader/bling-phong/instanced_vertex.glsl.
+/// The number of GL calls does not depend on the number of draws.
+/// Requires OpenGL 4.3, or 4.2 with one call per command.
+class MeshPool : public Mesh {
+public:
+    /// \brief Index range of one mesh in the pool.
+    struct Entry {
+        uint32_t first_index;
+        uint32_t index_count;
+        int32_t base_vertex;
+    };
+
+    MeshPool() = default;
+    /// \brief Copy a mesh into the pool before initGL(), return the id of its
+    /// first entry. Each sub-mesh (offsets_ and counts_) gets its own entry
+    /// with consecutive ids, a mesh without sub-mesh gets one.
+    unsigned int add(const TriMesh &mesh);
+    size_t n_entries() const { return entries_.size(); }
+
+    /// \brief Start a new frame of draws.
+    void clearDraws();
+    /// \brief Draw count consecutive entries from first_entry once, all
+    /// with the same instance. Consecutive draws of one entry share a command.
+    void addDraw(unsigned int first_entry, const InstanceData &instance, unsigned int count = 1);
+    size_t n_draws() const { return instances_.size(); }
+    size_t n_commands() const { return commands_.size(); }
+    /// \brief Upload commands and instances, call it after the draws
+    /// of a frame are added.
+    void updateDraws();
+
+    virtual void initGL() override;
+    virtual void render() override;
+    virtual unsigned int vertexArray() const override { return VAO; }
+    virtual void draw() override;
+    void finishGL();
+
+    std::vector<Vertex> vertices_;
+    std::vector<unsigned int> indices_;
+    std::vector<Entry> entries_;
+private:
+    std::vector<DrawElementsIndirectCommand> commands_;
+    std::vector<InstanceData> instances_;
+    size_t command_capacity_ = 0, instance_capacity_ = 0;
+    bool need_rendering_ = false;
+    unsigned int VAO, VBO, EBO, instance_VBO_, indirect_buffer_;
+};
+
+} // end namespace cgcl
@@ -0,0 +1,61 @@
+#pragma once
+#include "cgcl/mesh/TriMesh.h"
+#include "cgcl/math/Bounds.h"
+#include "cgcl/math/Frustum.h"
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief A cluster of consecutive triangles of a TriMesh.
+struct Meshlet {
+    uint32_t vertex_offset;   // first entry in MeshletSet::vertices_.
+    uint32_t triangle_offset; // first triangle, in MeshletSet::triangles_ and in the mesh.
+    uint8_t vertex_count;
+    uint8_t triangle_count;
+};
+
+/// \brief Culling bounds of a meshlet, in model space.
+/// All triangles face away from a camera at c when
+/// dot(normalize(cone_apex_ - c), cone_axis_) >= cone_cutoff_.
+struct MeshletBounds {
+    BoundingSphere sphere_;
+    glm::vec3 cone_apex_;
+    glm::vec3 cone_axis_;
+    float cone_cutoff_; // above 1 when the normals spread too much for a cone.
+};
+
+/// \brief Meshlets of a TriMesh, at most max_vertices vertices and
+/// max_triangles triangles each. Meshlets take triangles in index order
+/// and never cross a sub-mesh, so meshlet k covers the triangles
+/// [triangle_offset, triangle_offset + triangle_count) of the mesh and
+/// visible meshlets draw straight from its index buffer. Run
+/// TriMesh::optimize first for fuller meshlets.
+struct MeshletSet {
+    static constexpr unsigned int max_vertices = 64;
+    static constexpr unsigned int max_triangles = 124;
+
+    std::vector<Meshlet> meshlets_;
+    std::vector<MeshletBounds> bounds_;
+    std::vector<uint32_t> vertices_; // mesh vertex of each meshlet vertex.
+    std::vector<uint8_t> triangles_; // 3 meshlet local vertices per triangle.
+    BoundingSphereSoA spheres_;      // bounds_ spheres for Frustum::cull.
+
+    /// \brief Built in parallel over fixed chunks of triangles, the
+    /// result does not depend on the number of threads.
+    static MeshletSet build(const TriMesh &mesh);
+
+    /// \brief Frustum and backface cone culling. Visible meshlets are written
+    /// to ranges as index ranges of the mesh, adjacent ones merged, ready for
+    /// TriMesh::drawRanges. Exact for any affine model matrix, cones are
+    /// skipped when it mirrors. Return the number of visible triangles.
+    size_t cull(const glm::mat4 &view_projection, const glm::mat4 &model, const glm::vec3 &eye,
+                std::vector<IndexRange> &ranges) const;
+
+    size_t size() const { return meshlets_.size(); }
+};
+
+} // end namespace cgcl
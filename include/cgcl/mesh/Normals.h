@@ -0,0 +1,43 @@
+#pragma once
+#include "cgcl/mesh/TriMesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief How the triangles around a vertex contribute to its normal.
+enum class NormalWeighting {
+    Area,  // by triangle area, large triangles dominate.
+    Angle, // by the corner angle at the vertex (Thurmer and Wuthrich 1998),
+           // the same however the surface is triangulated.
+};
+
+/// \brief Generate vertex normals of a triangle list from its positions.
+/// A corner averages the smooth shaded triangles around its vertex that
+/// bend at most crease_angle (radians) away from its own triangle, a flat
+/// shaded corner takes the normal of its triangle. Vertices whose corners
+/// end up with different normals are split, the copies are appended to
+/// vertices and indices are remapped. The result does not depend on the
+/// number of threads.
+/// \param smooth per triangle, 0 for flat shaded, nullptr if all smooth.
+/// \return the number of vertices appended.
+size_t generate_normals(std::vector<Vertex> &vertices, unsigned int *indices, size_t n_indices,
+                        const uint8_t *smooth = nullptr, float crease_angle = 3.14159265f,
+                        NormalWeighting weighting = NormalWeighting::Angle);
+
+/// \brief Generate per vertex tangents for normal mapping, compatible
+/// with MikkTSpace: a corner contributes the texture u direction of its
+/// triangle projected to the vertex normal and weighted by the corner
+/// angle, and the triangles around a vertex are averaged apart by uv
+/// orientation. tangents[v].w is the handedness, the bitangent is
+/// w * cross(normal, tangent). Vertices used by triangles of both
+/// orientations, at mirrored uv seams, are split as in generate_normals.
+/// Normals must be set first.
+/// \return the number of vertices appended.
+size_t generate_tangents(std::vector<Vertex> &vertices, unsigned int *indices, size_t n_indices,
+                         std::vector<glm::vec4> &tangents);
+
+} // end namespace cgcl
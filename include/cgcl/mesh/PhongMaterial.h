@@ -16,8 +16,8 @@ public:
     PhongMaterial(const glm::vec3 &Ka, const glm::vec3 &Kd, const glm::vec3 &Ks,
                  float decay = 16.0f)
         : Ka_(Ka), Kd_(Kd), Ks_(Ks), decay_(decay) {} 
-    void updateBareMaterial(GLShader &shader);
-    void updateLightingMapMaterial(GLShader &shader, unsigned int texture_group_id);
+    void updateBareMaterial(GLShader &shader) const;
+    void updateLightingMapMaterial(GLShader &shader, unsigned int texture_group_id) const;
 
     glm::vec3 Ka_;
     glm::vec3 Kd_;
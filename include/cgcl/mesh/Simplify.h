@@ -0,0 +1,44 @@
+#pragma once
+#include "cgcl/mesh/TriMesh.h"
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <memory>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Simplify a triangle list by quadric error metric half-edge
+/// collapses (Garland and Heckbert 1997), cheapest first from a heap
+/// with lazy updates. Vertices are never moved or created, so the
+/// result indexes the same vertex buffer.
+///
+/// Vertices at one position with different normal or uv (seams) and
+/// open boundaries only collapse along the seam or boundary, corners of
+/// either and tips of seams ending inside the mesh are kept. Collapses that flip a triangle are rejected.
+/// Stops at target_index_count or when the next collapse would cost more
+/// than max_error. Returns the error reached, as a distance in model space.
+float simplify(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+               size_t target_index_count, float max_error = FLT_MAX);
+
+
+/// \brief Levels of detail of a mesh, finest first, each a compact
+/// vertex cache optimized TriMesh.
+struct LODChain {
+    std::vector<std::unique_ptr<TriMesh>> levels_;
+    std::vector<float> errors_; // model space error of each level, 0 for the first.
+
+    /// \brief Simplify each level from the previous one down to ratios
+    /// of the triangles of mesh. The first level is mesh itself.
+    static LODChain build(const TriMesh &mesh,
+                          const std::vector<float> &ratios = {0.5f, 0.25f, 0.125f, 0.0625f, 0.03125f});
+
+    /// \brief Coarsest level whose error, projected at the near side of
+    /// the bounding sphere, stays below pixel_error pixels.
+    unsigned int select(const glm::mat4 &model, const glm::vec3 &eye, const glm::mat4 &projection,
+                        float viewport_height, float pixel_error = 1.0f) const;
+    size_t size() const { return levels_.size(); }
+};
+
+} // end namespace cgcl
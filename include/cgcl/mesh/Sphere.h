@@ -0,0 +1,34 @@
+#pragma once
+#include "cgcl/mesh/TriMesh.h"
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Triangulated unit sphere centered at origin,
+/// scale and move it by the model matrix.
+/// Normals equal positions, triangles are counter-clockwise seen
+/// from outside. All generators write into buffers sized up front
+/// and fill them in parallel.
+struct SphereGeometry {
+    std::vector<Vertex> vertices_;
+    std::vector<unsigned int> indices_;
+
+    /// \brief Latitude-longitude grid with poles, the seam column is
+    /// duplicated so texture coordinates run from 0 to 1.
+    /// Triangles crowd at poles.
+    static SphereGeometry uv_sphere(unsigned int n_longitude, unsigned int n_latitude);
+    /// \brief Icosahedron with every edge split into n_segments,
+    /// projected to the sphere. Nearly uniform triangles.
+    static SphereGeometry ico_sphere(unsigned int n_segments);
+    /// \brief Cube with every face split into n_segments x n_segments
+    /// quads, projected to the sphere by the spherified cube mapping.
+    /// Texture coordinates cover [0, 1] on each face.
+    static SphereGeometry cube_sphere(unsigned int n_segments);
+
+    size_t n_triangles() const { return indices_.size() / 3; }
+};
+
+} // end namespace cgcl
@@ -0,0 +1,80 @@
+#pragma once
+#include "cgcl/mesh/TriMesh.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Sparse matrix in CSR form, row i gives vertex i of a level as
+/// a weighted sum of vertices of the level before.
+struct StencilTable {
+    std::vector<uint32_t> offsets_; // n_rows + 1
+    std::vector<uint32_t> sources_;
+    std::vector<float> weights_;
+
+    size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+
+    /// \brief dst[i] = sum of weights_ * src[sources_] over row i, rows
+    /// in parallel. Works for any attribute with + and * float.
+    template <typename T>
+    void apply(const T *src, T *dst) const {
+        const long n_rows = size();
+#pragma omp parallel for schedule(static)
+        for (long i = 0; i < n_rows; ++i) {
+            T sum = T(0);
+            for (uint32_t k = offsets_[i]; k < offsets_[i + 1]; ++k)
+                sum += weights_[k] * src[sources_[k]];
+            dst[i] = sum;
+        }
+    }
+};
+
+enum class SubdivisionScheme {
+    CatmullClark, // any polygons, quads after the first level.
+    Loop,         // triangles only.
+};
+
+/// \brief Refinement of a polygon control cage. The topology of every
+/// level and its stencils are computed once, then a deformed cage is
+/// evaluated by a sparse matrix-vector product per level, without
+/// touching the topology again.
+/// Borders follow the cubic B-spline curve rule, vertices with more
+/// than two border edges stay in place.
+class Subdivision {
+public:
+    SubdivisionScheme scheme_;
+    size_t n_cage_vertices_ = 0;
+    /* Level k + 1 from level k, the first from the cage. */
+    std::vector<StencilTable> stencils_;
+    /* Triangles of the finest level, quads split in two. */
+    std::vector<unsigned int> indices_;
+
+    /// \brief Subdivide polygons given by their sizes and vertex indices
+    /// levels times, by Loop if all are triangles and by Catmull-Clark
+    /// otherwise.
+    static Subdivision build(const std::vector<unsigned int> &face_sizes,
+                             const std::vector<unsigned int> &face_vertices,
+                             size_t n_vertices, unsigned int levels);
+    /// \brief Cage of all faces of an OBJ file welded by position index,
+    /// whatever their uv or normal, and its positions in cage.
+    static Subdivision from_obj(const std::string &filename, unsigned int levels,
+                                std::vector<glm::vec3> &cage);
+
+    size_t n_vertices() const { return stencils_.empty() ? n_cage_vertices_ : stencils_.back().size(); }
+
+    /// \brief Positions of the finest level from positions of the cage.
+    void evaluate(const glm::vec3 *cage, std::vector<glm::vec3> &refined) const;
+    /// \brief Mesh of the finest level, with smooth normals.
+    std::unique_ptr<TriMesh> toMesh(const std::vector<glm::vec3> &cage) const;
+    /// \brief Move a mesh made by toMesh() to a deformed cage,
+    /// positions, normals and bounds are recomputed.
+    void update(TriMesh &mesh, const std::vector<glm::vec3> &cage) const;
+};
+
+} // end namespace cgcl
@@ -1,8 +1,15 @@
 #pragma once
 #include "cgcl/mesh/Mesh.h"
+#include "cgcl/mesh/Texture.h"
+#include "cgcl/mesh/VertexFormat.h"
+#include "cgcl/math/Bounds.h"
 #include "cgcl/surface/Bezier.h"
+#include "cgcl/surface/BezierPatchSet.h"
+#include "cgcl/surface/NURBS.h"
+#include "cgcl/surface/WavefrontOBJ.h"
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -16,35 +23,117 @@ struct Vertex {
     glm::vec2 texture_coords_;
 };
 
+/// \brief Range of global_indices_, drawn by TriMesh::drawRanges.
+struct IndexRange {
+    uint32_t first_index;
+    uint32_t count;
+};
+
 
 /// \brief Triangular mesh.
 class TriMesh : public Mesh {
 public:
     TriMesh() = delete;
+    /// \brief Load an OBJ file and its MTL libraries. Faces are bucketed
+    /// into one sub-mesh per (object, material), grouped by material.
+    /// Normals are generated if the file lacks some, see Normals.h.
     static std::unique_ptr<Mesh> from_obj(const std::string &filename);
     static std::unique_ptr<Mesh> from_bezier(const BezierSurface &bezier);
+    /// \brief Tessellate a batch of Bezier patches in parallel into one mesh.
+    /// Every patch becomes a sub-mesh, whose index range is recorded
+    /// in offsets_ and counts_, so the whole batch is drawn at once.
+    static std::unique_ptr<Mesh> from_bezier_patches(const std::vector<BezierSurface> &patches);
+    static std::unique_ptr<Mesh> from_bezier_patches(const BezierPatchSet &patches);
+    /// \brief Split into Bezier patches and tessellate them as above.
+    static std::unique_ptr<Mesh> from_nurbs(const NURBSSurface &nurbs);
+    /// \brief Load a mesh written by saveCompressed, its streams are
+    /// decoded straight into global_vertices_ and global_indices_.
+    static std::unique_ptr<Mesh> from_compressed(const std::string &filename);
     /* A mesh may contain multiple sub-mesh and its own
      * vertex, index, uv and material, texture.
      */
     std::vector<Vertex> global_vertices_;
     std::vector<unsigned int> global_indices_;
 
-    // support one sub-mesh only.
-    // std::vector<unsigned int> offsets_;
-    // std::vector<unsigned int> counts_;
+    /* Index range of each sub-mesh in global_indices_,
+     * a mesh without sub-mesh leaves them empty.
+     */
+    std::vector<unsigned int> offsets_;
+    std::vector<unsigned int> counts_;
+
+    /* Materials of an OBJ mesh and the index of each sub-mesh's material
+     * in it, -1 for faces before any usemtl. Sub-meshes of one material
+     * are adjacent, so drawMaterials() draws a material as one range.
+     */
+    std::vector<MTLMaterial> materials_;
+    std::vector<int> sub_mesh_materials_;
+
+    /* Tangent and handedness of every vertex for normal maps, empty
+     * unless generateTangents() was called. Uploaded at location 14.
+     */
+    std::vector<glm::vec4> tangents_;
+
+    /* Bounds of all vertices in model space, for culling. */
+    AABB bounds_;
+    BoundingSphere bounding_sphere_;
+
+    /* Layout uploaded by initGL(), positions are quantized to bounds_.
+     * A packed format is drawn with shader/bling-phong/quantized_vertex.glsl.
+     */
+    VertexFormat vertex_format_;
 
     TriMesh(const std::vector<Vertex> &vertex, const std::vector<unsigned int> &indices)
-        : global_vertices_(vertex), global_indices_(indices) {}
+        : global_vertices_(vertex), global_indices_(indices) { computeBounds(); }
     TriMesh(std::vector<Vertex> &&vertex, std::vector<unsigned int> &&indices)
-        : global_vertices_(vertex), global_indices_(indices) {}
+        : global_vertices_(std::move(vertex)), global_indices_(std::move(indices)) { computeBounds(); }
+
+    /// \brief Recompute bounds_ and bounding_sphere_, call it after
+    /// vertex positions changed. Done by the constructors.
+    void computeBounds();
+    /// \brief Reorder the triangles of every sub-mesh for the vertex cache
+    /// and overdraw, then the vertices by first use, see MeshOptimizer.h.
+    /// With log_stats, ACMR and ATVR before and after are logged, which
+    /// costs two more passes. from_obj and the Bezier tessellators call
+    /// it quietly.
+    void optimize(unsigned int cache_size = 16, bool log_stats = false);
+    /// \brief Generate tangents_ from normals and texture coordinates,
+    /// see Normals.h. from_obj calls it when a material has a normal map,
+    /// optimize() moves them along with the vertices.
+    void generateTangents();
+    /// \brief Write vertices, indices, tangents, sub-mesh ranges and
+    /// materials, the buffers losslessly compressed by MeshCodec.h, call
+    /// optimize() first for a smaller file.
+    void saveCompressed(const std::string &filename) const;
+
+    /// \brief Program whose material uniforms render() sets, if bound
+    /// render() draws one range per material as drawMaterials().
+    void bindShader(GLShader *shader) { shader_ = shader; }
 
     virtual void render() override;
+    virtual unsigned int vertexArray() const override { return VAO; }
+    virtual void draw() override;
+    /// \brief Draw only ranges of global_indices_ in one glMultiDrawElements,
+    /// the vertex array must be bound as for draw().
+    void drawRanges(const std::vector<IndexRange> &ranges);
+    /// \brief Decoding parameters of vertex_format_ for the quantized shader.
+    virtual void updateUniforms(GLShader &shader) const override;
+    /// \brief One glDrawElements per material, setting all of its
+    /// Bling-Phong uniforms and binding its color and normal maps first.
+    /// RenderQueue calls it for draws submitted without a material.
+    virtual void drawMaterials(GLShader &shader) override;
 
     virtual void initGL() override;
     void finishGL();
-private:
+protected:
     bool need_rendering_ = false;
     unsigned int VAO, VBO, EBO;
+    unsigned int tangent_VBO_ = 0;
+    GLShader *shader_ = nullptr;
+    /* Color and normal texture of each of materials_, nullptr if none.
+     * Loaded by initGL().
+     */
+    std::vector<std::shared_ptr<Texture>> textures_;
+    std::vector<std::shared_ptr<Texture>> normal_maps_;
 };
 
 } // end namespace cgcl
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include "cgcl/math/Bounds.h"
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+struct Vertex;
+
+
+/// \brief GPU layout of TriMesh vertices, attribute locations 0 ~ 2
+/// as in Vertex. Anything but full() is decoded by
+/// shader/bling-phong/quantized_vertex.glsl.
+///
+/// position_16_: 4 x unorm16 relative to the mesh AABB, 8 bytes.
+/// normal_: float 12 bytes, octahedral 2 x snorm16 4 bytes, or
+///          octahedral 2 x 8 bits, kept in the spare 4th position
+///          component with position_16_, else 4 bytes.
+/// uv_half_: 2 x half float, 4 bytes.
+struct VertexFormat {
+    enum class Normal : uint8_t { Float, Oct16, Oct8 };
+
+    bool position_16_ = false;
+    Normal normal_ = Normal::Float;
+    bool uv_half_ = false;
+
+    /// \brief Same layout as Vertex, 32 bytes.
+    static VertexFormat full() { return {}; }
+    /// \brief 16 bytes, normals within 0.01 degree.
+    static VertexFormat compact() { return {true, Normal::Oct16, true}; }
+    /// \brief 12 bytes, normals within about 1 degree.
+    static VertexFormat smallest() { return {true, Normal::Oct8, true}; }
+
+    bool isFull() const { return !position_16_ && normal_ == Normal::Float && !uv_half_; }
+    unsigned int stride() const { return uvOffset() + (uv_half_ ? 4 : 8); }
+    unsigned int normalOffset() const { return position_16_ ? 8 : 12; }
+    unsigned int uvOffset() const;
+    /// \brief Value of the normal_encoding uniform of the decoding shader.
+    int normalEncoding() const;
+
+    /// \brief Pack vertices into stride() bytes each, positions relative
+    /// to bounds, which must contain them.
+    std::vector<uint8_t> encode(const std::vector<Vertex> &vertices, const AABB &bounds) const;
+    /// \brief Unpack vertex i as the shader does, for testing.
+    Vertex decode(const uint8_t *data, size_t i, const AABB &bounds) const;
+    /// \brief Point attributes 0 ~ 2 of the bound vertex array to the
+    /// bound GL_ARRAY_BUFFER holding encoded vertices.
+    void setAttributes() const;
+};
+
+/* Octahedral mapping of unit vectors to [-1, 1]^2 and back. */
+glm::vec2 oct_encode(const glm::vec3 &n);
+glm::vec3 oct_decode(const glm::vec2 &e);
+
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+
+} // end namespace cgcl
@@ -4,19 +4,28 @@
 
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <unordered_map>
 
 namespace cgcl {
 
 class GLShader {
 public:
     GLShader(const std::string &vertex_src, const std::string &frag_src);
+    /// \brief Program with tessellation control and evaluation stages,
+    /// requires OpenGL 4.0.
+    GLShader(const std::string &vertex_src, const std::string &tess_ctrl_src,
+             const std::string &tess_eval_src, const std::string &frag_src);
     ~GLShader();
 
     void Bind() const;
     void UnBind() const;
+    /// \brief OpenGL program name.
+    uint32_t id() const { return render_id_; }
 
     void updateUniformInt(const std::string &name, const int);
     void updateUniformFloat(const std::string &name, const float);
+    void updateUniformFloat2(const std::string &name, const glm::vec2 &vec);
     void updateUniformFloat3(const std::string &name, const glm::vec3 &vec);
     void updateUniformFloat3v(const std::string &name, unsigned count, const float *value);
     void updateUniformFloat4(const std::string &name, const glm::vec4 &vec);
@@ -25,7 +34,10 @@ public:
 private:
     void compile(const char *source);
     void createProgram();
+    /// \brief Uniform location, queried from the driver once per name.
+    int uniformLocation(const std::string &name);
     uint32_t render_id_;
+    std::unordered_map<std::string, int> uniform_locations_;
 };
 
 } // end namespace cgcl
\ No newline at end of file
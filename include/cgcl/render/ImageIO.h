@@ -0,0 +1,45 @@
+#ifndef CGCL_RENDER_IMAGEIO_H
+#define CGCL_RENDER_IMAGEIO_H
+
+#include "cgcl/render/SoftwareRasterizer.h"
+
+#include <cstddef>
+#include <string>
+
+namespace cgcl {
+
+
+/// \brief Binary PPM (P6), RGB 8 bits.
+void write_ppm(const std::string &filename, const Framebuffer &image);
+/// \brief PNG, RGB 8 bits, unfiltered in stored deflate blocks. Files
+/// are as large as PPM, but any PNG reader takes them and no zlib is
+/// needed.
+void write_png(const std::string &filename, const Framebuffer &image);
+/// \brief PNG or PPM by the extension of filename.
+void write_image(const std::string &filename, const Framebuffer &image);
+/// \brief Any format stb_image reads, depth left at 1.
+Framebuffer read_image(const std::string &filename);
+
+/// \brief Perceptual difference of an image against a reference.
+struct ImageDifference {
+    size_t n_pixels = 0;
+    size_t n_different = 0;  // pixels above the threshold.
+    float max_delta_e = 0.0f;
+    float mean_delta_e = 0.0f;
+
+    float differentFraction() const { return n_pixels ? float(n_different) / n_pixels : 0.0f; }
+};
+
+/// \brief Compare colors in CIELAB, where a Delta E of about 2.3 is
+/// just noticeable. A pixel matches if some reference pixel in its 3x3
+/// neighborhood is within threshold, so edges moved by a pixel, as by
+/// another rounding of vertex positions, do not count. Images of
+/// different sizes differ everywhere.
+/// \param difference if not nullptr, a gray copy of the reference with
+/// the different pixels in red.
+ImageDifference compare_images(const Framebuffer &image, const Framebuffer &reference,
+                               float threshold = 2.3f, Framebuffer *difference = nullptr);
+
+} // end namespace cgcl
+
+#endif // CGCL_RENDER_IMAGEIO_H
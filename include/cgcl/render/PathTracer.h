@@ -0,0 +1,106 @@
+#ifndef CGCL_RENDER_PATHTRACER_H
+#define CGCL_RENDER_PATHTRACER_H
+
+#include "cgcl/accel/BVH.h"
+#include "cgcl/mesh/TriMesh.h"
+#include "cgcl/render/SoftwareRasterizer.h"
+#include "cgcl/surface/WavefrontOBJ.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Work done by the last PathTracer::render().
+struct PathTracerStats {
+    unsigned int n_samples = 0;  // per pixel accumulated since the last reset.
+    size_t n_camera_rays = 0;    // traced in packets.
+    size_t n_bounce_rays = 0;
+    size_t n_shadow_rays = 0;
+    double ms = 0.0;
+
+    size_t rays() const { return n_camera_rays + n_bounce_rays + n_shadow_rays; }
+    double raysPerSecond() const { return ms > 0.0 ? rays() / (ms * 1e-3) : 0.0; }
+};
+
+/// \brief Offline renderer of an OBJ scene by path tracing over a BVH,
+/// lit by the point light of the preview and a uniform environment.
+///
+/// At every hit the light is sampled with a shadow ray and shaded with
+/// the Blinn-Phong terms of frag.glsl, so a still matches the preview
+/// plus shadows, then the path continues by one MTL lobe:
+///  - through the surface with probability 1 - d, refracted by Ni or
+///    reflected by Fresnel;
+///  - otherwise diffuse by Kd or glossy around the mirror direction by
+///    Ks with exponent Ns, chosen by their weights.
+/// Paths end by Russian roulette after 3 bounces, or at max_depth.
+///
+/// The image is split in tile_size^2 tiles rendered by all threads.
+/// Camera rays of 4x2 pixels are traced as one RayPacket, then their
+/// shadow rays toward the light, the bounces go one by one through the
+/// wide BVH. Samples are accumulated until reset(), which the setters
+/// call. Every pixel and sample has its own random sequence, so the
+/// image does not depend on the number of threads.
+class PathTracer {
+public:
+    static constexpr int tile_size = 16;
+    static constexpr int max_depth = 8;
+
+    PathTracer(int width, int height);
+
+    /// \brief Build the BVH over mesh and take its materials, faces
+    /// before any usemtl take the MTL defaults. The mesh must live as
+    /// long as the tracer.
+    void setScene(const TriMesh &mesh);
+    /// \brief Rays go from the near to the far plane of projection.
+    void setCamera(const glm::mat4 &view, const glm::mat4 &projection);
+    void setLight(const PointLight &light);
+    /// \brief Radiance of rays escaping the scene.
+    void setEnvironment(const glm::vec3 &radiance);
+    /// \brief Drop the accumulated samples.
+    void reset();
+
+    /// \brief Add n_samples per pixel, then resolve their mean into
+    /// framebuffer_.
+    const PathTracerStats &render(unsigned int n_samples);
+    /// \brief Add passes of one sample per pixel while the next one is
+    /// expected to end within budget_ms, at least one.
+    const PathTracerStats &renderFor(double budget_ms);
+
+    unsigned int n_samples() const { return n_samples_; }
+    const PathTracerStats &stats() const { return stats_; }
+
+    Framebuffer framebuffer_;
+
+private:
+    struct Tile;
+    struct Path;
+
+    void renderTile(const Tile &tile, unsigned int first_sample, unsigned int n_samples, PathTracerStats &stats);
+    /// \brief Shade the hit of path.ray and scatter it. Return whether
+    /// the path goes on, shadow is set if direct light is to be tested.
+    bool scatter(Path &path, const RayHit &hit, Ray &shadow, glm::vec3 &direct) const;
+    Ray cameraRay(float x, float y) const;
+
+    const TriMesh *mesh_ = nullptr;
+    std::unique_ptr<BVH> bvh_;
+    std::vector<MTLMaterial> materials_;       // MTL defaults, then those of the mesh.
+    std::vector<uint32_t> triangle_materials_;
+    float epsilon_ = 1e-4f;                    // offset of secondary ray origins.
+
+    glm::mat4 inverse_view_projection_ = glm::mat4(1.0f);
+    PointLight light_;
+    glm::vec3 environment_ = glm::vec3(0.0f);
+
+    std::vector<glm::vec3> accumulation_;      // sum of samples of every pixel.
+    unsigned int n_samples_ = 0;
+    PathTracerStats stats_;
+};
+
+} // end namespace cgcl
+
+#endif // CGCL_RENDER_PATHTRACER_H
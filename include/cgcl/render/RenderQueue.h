@@ -0,0 +1,85 @@
+#ifndef CGCL_RENDER_RENDERQUEUE_H
+#define CGCL_RENDER_RENDERQUEUE_H
+
+#include "cgcl/mesh/Mesh.h"
+#include "cgcl/mesh/PhongMaterial.h"
+#include "cgcl/mesh/Texture.h"
+#include "cgcl/platform/OpenGL/GLShader.h"
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief One draw of a mesh, with everything needed to issue it.
+struct DrawPacket {
+    uint64_t key;
+    GLShader *shader;
+    Mesh *mesh;
+    PhongMaterial *material; // nullptr if the mesh carries its own material.
+    const Texture *texture;  // nullptr for untextured draws.
+    glm::mat4 model;
+};
+
+/// \brief GL state changes issued by one RenderQueue::flush().
+struct RenderStats {
+    unsigned int draw_calls = 0;
+    unsigned int program_changes = 0;
+    unsigned int texture_changes = 0;
+    unsigned int material_changes = 0;
+    unsigned int vertex_array_changes = 0;
+
+    unsigned int stateChanges() const {
+        return program_changes + texture_changes + material_changes + vertex_array_changes;
+    }
+};
+
+/// \brief Collects the draws of a frame and issues them sorted by a 64-bit key,
+///     layer(4) | program(12) | texture(16) | material(16) | vertex array(16)
+/// from the most significant bit. Draws sharing a program, texture and so on
+/// end up next to each other, and flush() only touches the GL state that
+/// differs from the previous draw.
+///
+/// Fields hold ids given in the order first submitted within a frame, not
+/// GL names or addresses, so they bound the distinct objects of one frame
+/// whatever names the driver hands out. The ids are forgotten by flush().
+class RenderQueue {
+public:
+    RenderQueue() = default;
+
+    /// \brief Camera uniforms "view", "projection" and "view_pos",
+    /// uploaded once per program in each flush().
+    void setCamera(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &view_pos);
+    /// \brief Queue a draw. Layers are drawn in ascending order whatever
+    /// the other keys are, e.g. opaque in layer 0 before transparent.
+    void submit(GLShader *shader, Mesh *mesh, PhongMaterial *material, const glm::mat4 &model,
+                const Texture *texture = nullptr, unsigned int layer = 0);
+    /// \brief Sort and issue all queued draws, then empty the queue.
+    /// GL state touched by the queue is assumed unknown on entry.
+    const RenderStats &flush();
+
+    size_t size() const { return packets_.size(); }
+    /// \brief Statistics of the last flush().
+    const RenderStats &stats() const { return stats_; }
+
+    static uint64_t makeKey(unsigned int layer, unsigned int program, unsigned int texture,
+                            unsigned int material, unsigned int vertex_array);
+
+private:
+    std::vector<DrawPacket> packets_;
+    std::vector<std::pair<uint64_t, uint32_t>> order_; // (key, packet), sorted.
+    /* Ids of the frame, 0 is kept for none. */
+    std::unordered_map<unsigned int, unsigned int> program_ids_, texture_ids_, vertex_array_ids_;
+    std::unordered_map<const PhongMaterial *, unsigned int> material_ids_;
+    glm::mat4 view_ = glm::mat4(1.0f), projection_ = glm::mat4(1.0f);
+    glm::vec3 view_pos_ = glm::vec3(0.0f);
+    RenderStats stats_;
+};
+
+} // end namespace cgcl
+
+#endif // CGCL_RENDER_RENDERQUEUE_H
@@ -0,0 +1,125 @@
+#ifndef CGCL_RENDER_SOFTWARERASTERIZER_H
+#define CGCL_RENDER_SOFTWARERASTERIZER_H
+
+#include "cgcl/mesh/InstancedTriMesh.h"
+#include "cgcl/mesh/PhongMaterial.h"
+#include "cgcl/mesh/TriMesh.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+struct RasterTriangle;
+
+/// \brief Point light of shader/bling-phong/frag.glsl, the defaults
+/// are those of the SolarSystem demo.
+struct PointLight {
+    glm::vec3 pos_ = glm::vec3(0.0f, 0.0f, 5.0f);
+    glm::vec3 Ia_ = glm::vec3(0.2f);
+    glm::vec3 Id_ = glm::vec3(0.5f);
+    glm::vec3 Is_ = glm::vec3(1.0f);
+};
+
+/// \brief Color and depth of an image in memory, row 0 at the top.
+struct Framebuffer {
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<uint32_t> color_; // RGBA8, red in the lowest byte.
+    std::vector<float> depth_;    // window depth in [0, 1], 1 where nothing was drawn.
+
+    Framebuffer() = default;
+    Framebuffer(int width, int height)
+        : width_(width), height_(height), color_(size_t(width) * height, 0),
+          depth_(size_t(width) * height, 1.0f) {}
+
+    uint32_t pixel(int x, int y) const { return color_[size_t(y) * width_ + x]; }
+    glm::vec3 color(int x, int y) const {
+        const uint32_t c = pixel(x, y);
+        return glm::vec3(c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff) / 255.0f;
+    }
+};
+
+/// \brief Work done by one SoftwareRasterizer::flush().
+struct RasterStats {
+    size_t n_triangles = 0;        // submitted.
+    size_t n_clipped = 0;          // crossing the near, far or guard band planes.
+    size_t n_culled = 0;           // outside, degenerate or between pixel centers.
+    size_t n_bin_entries = 0;      // (triangle, tile) pairs.
+    size_t n_blocks_occluded = 0;  // blocks skipped by the hierarchical Z test.
+    size_t n_fragments = 0;        // pixels passing the depth test.
+    size_t n_pixels_shaded = 0;
+};
+
+/// \brief Headless renderer of TriMesh with the Bling-Phong lighting of
+/// shader/bling-phong/frag.glsl, for machines without a GPU.
+///
+/// Draws are queued by submit() and rendered by flush() in three
+/// parallel passes:
+///  1. vertices are transformed, triangles clipped against the near and
+///     far planes and a guard band, snapped to 1/16 pixel and set up;
+///  2. triangles are binned to tile_size^2 tiles by a counting sort that
+///     keeps the submission order in every bin;
+///  3. every tile is rendered by one thread in local depth and triangle
+///     id buffers. Edge functions are evaluated on 8 pixels at once,
+///     blocks of block_size^2 pixels behind their farthest depth are
+///     skipped (hierarchical Z), and every visible pixel is shaded once
+///     after all triangles of the tile are rasterized.
+/// Coverage follows the top-left rule, the depth test is GL_LESS and both
+/// faces are drawn, as the GL path does. Textures are not sampled, a
+/// material colors its faces by Kd. The image does not depend on the
+/// number of threads.
+class SoftwareRasterizer {
+public:
+    static constexpr int tile_size = 64;
+    static constexpr int block_size = 8;
+    static constexpr int subpixel_bits = 4;
+
+    /// \brief width and height at most 4096 pixels.
+    SoftwareRasterizer(int width, int height);
+    ~SoftwareRasterizer();
+
+    void setCamera(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &view_pos);
+    void setLight(const PointLight &light) { light_ = light; }
+    void setClearColor(const glm::vec3 &color) { clear_color_ = color; }
+
+    /// \brief Queue a draw of all triangles of mesh. With a nullptr
+    /// material, the mesh's own materials color its sub-meshes. The mesh
+    /// must live until flush().
+    void submit(const TriMesh &mesh, const glm::mat4 &model, const PhongMaterial *material = nullptr);
+    /// \brief Queue every instance with its own model matrix and material.
+    void submit(const InstancedTriMesh &mesh);
+    /// \brief Clear framebuffer_, render all queued draws into it, then
+    /// empty the queue.
+    const RasterStats &flush();
+
+    size_t size() const { return draws_.size(); }
+    /// \brief Statistics of the last flush().
+    const RasterStats &stats() const { return stats_; }
+
+    Framebuffer framebuffer_;
+
+private:
+    struct Draw {
+        const TriMesh *mesh;
+        glm::mat4 model;
+        uint32_t material; // in materials_, or the first of the mesh's own.
+        bool own_materials;
+    };
+
+    std::vector<Draw> draws_;
+    std::vector<PhongMaterial> materials_;
+    glm::mat4 view_ = glm::mat4(1.0f), projection_ = glm::mat4(1.0f);
+    glm::vec3 view_pos_ = glm::vec3(0.0f);
+    PointLight light_;
+    glm::vec3 clear_color_ = glm::vec3(0.0f);
+    RasterStats stats_;
+    /* Set up triangles of the last flush() in chunks, see the .cpp. */
+    std::vector<std::vector<RasterTriangle>> triangle_chunks_;
+};
+
+} // end namespace cgcl
+
+#endif // CGCL_RENDER_SOFTWARERASTERIZER_H
@@ -0,0 +1,69 @@
+#ifndef CGCL_SCENE_SCENEGRAPH_H
+#define CGCL_SCENE_SCENEGRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Transform hierarchy stored as flat arrays, one entry per node.
+///
+/// A parent is always added before its children, so node ids are in
+/// topological order. Before an update the arrays are laid out breadth
+/// first, each level is a contiguous range sorted by parent. A level
+/// only reads world matrices of the previous one, so it is one parallel
+/// loop streaming through memory. Only nodes whose local matrix changed,
+/// and their descendants, are recomputed.
+class SceneGraph {
+public:
+    using NodeId = uint32_t;
+    static constexpr NodeId no_parent = UINT32_MAX;
+
+    SceneGraph() = default;
+    void reserve(size_t n_nodes);
+
+    /// \brief Append a node under parent, return its id.
+    NodeId addNode(NodeId parent = no_parent, const glm::mat4 &local = glm::mat4(1.0f));
+    /// \brief Replace local transform (relative to parent) and mark the node dirty.
+    void setLocal(NodeId node, const glm::mat4 &local);
+    /// \brief Replace local transform of every node, locals[node] for node
+    /// in [0, size()), in parallel. Cheaper than setLocal one by one,
+    /// as slots are written in memory order.
+    void setLocals(const glm::mat4 *locals);
+
+    /// \brief Recompute world matrix of dirty nodes and their descendants.
+    void updateWorld();
+
+    size_t size() const { return slot_of_.size(); }
+    NodeId parent(NodeId node) const { return parents_[node]; }
+    const glm::mat4 &local(NodeId node) const { return locals_[slot_of_[node]]; }
+    /// \brief World matrix as of the last updateWorld().
+    const glm::mat4 &world(NodeId node) const { return worlds_[slot_of_[node]]; }
+
+private:
+    void rebuildLevels();
+
+    /* Indexed by NodeId. */
+    std::vector<NodeId> parents_;
+    std::vector<uint32_t> slot_of_;
+    std::vector<NodeId> node_of_; // indexed by slot.
+
+    /* Structure of arrays indexed by slot, breadth first after
+     * rebuildLevels(), nodes added since then are appended.
+     * Level d takes slots [level_offsets_[d], level_offsets_[d + 1]).
+     */
+    std::vector<uint32_t> parent_slots_;
+    std::vector<glm::mat4> locals_;
+    std::vector<glm::mat4> worlds_;
+    std::vector<uint8_t> dirty_;
+    std::vector<size_t> level_offsets_;
+    bool levels_changed_ = false;
+    bool any_dirty_ = false;
+};
+
+} // end namespace cgcl
+
+#endif // CGCL_SCENE_SCENEGRAPH_H
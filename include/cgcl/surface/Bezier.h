@@ -12,13 +12,23 @@ public:
     BezierSurface(unsigned int n_us, unsigned int n_vs, 
                  const std::vector<glm::vec3> &ctrl_pts)
         : n_us(n_us), n_vs(n_vs), ctrl_pts_(ctrl_pts) {}
-    [[deprecated("The rendering of Bezier surface largely rely on fixed function pipeline now.")]]
+    /// \brief Rational Bezier surface, one weight per control point.
+    BezierSurface(unsigned int n_us, unsigned int n_vs, 
+                 const std::vector<glm::vec3> &ctrl_pts, const std::vector<float> &weights)
+        : n_us(n_us), n_vs(n_vs), ctrl_pts_(ctrl_pts), weights_(weights) {}
+    [[deprecated("The rendering of Bezier surface largely rely on fixed function pipeline now, "
+                 "use BezierPatchMesh for tessellation on GPU.")]]
     void render();
     void init();
     glm::vec3 getPoint(float u, float v) const;
+    /// \brief Evaluate a patch stored outside BezierSurface,
+    /// weights is nullptr for polynomial patch.
+    static glm::vec3 evaluate(unsigned int n_us, unsigned int n_vs, const glm::vec3 *ctrl_pts,
+                              const float *weights, float u, float v);
 
     unsigned int n_us, n_vs;
     std::vector<glm::vec3> ctrl_pts_; // v major ctrl 
+    std::vector<float> weights_; // empty for polynomial surface.
 };
 
 } // end namespace 
@@ -0,0 +1,76 @@
+#ifndef CGCL_SURFACE_BEZIERPATCHSET_H
+#define CGCL_SURFACE_BEZIERPATCHSET_H
+
+#include "cgcl/surface/Bezier.h"
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cgcl {
+
+
+struct BezierPatchRecord {
+    uint32_t n_us;
+    uint32_t n_vs;
+    uint32_t first; // first control point in the set.
+};
+
+/// \brief Header of binary patch file, followed by n_patches
+/// BezierPatchRecord and n_ctrl_pts glm::vec3, all little endian.
+/// Every section is 4-byte aligned so the file is used in place.
+struct BezierPatchFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t n_patches;
+    uint64_t n_ctrl_pts;
+};
+
+/// \brief A set of polynomial Bezier patches whose control points
+/// sit in one contiguous array.
+///
+/// The text format is the one of car.txt:
+///     n_patches
+///     n_us n_vs   followed by n_us * n_vs "x y z" of each patch.
+/// Binary files are memory-mapped instead of read.
+class BezierPatchSet {
+public:
+    static constexpr char binary_magic[4] = {'C', 'G', 'B', 'P'};
+    static constexpr uint32_t binary_version = 1;
+
+    BezierPatchSet() = default;
+    BezierPatchSet(const BezierPatchSet &) = delete;
+    BezierPatchSet &operator=(const BezierPatchSet &) = delete;
+    ~BezierPatchSet();
+
+    /// \brief Load text or binary file by its magic number.
+    static std::unique_ptr<BezierPatchSet> from_file(const std::string &filename);
+    static std::unique_ptr<BezierPatchSet> from_text(const std::string &filename);
+    static std::unique_ptr<BezierPatchSet> from_binary(const std::string &filename);
+    void save_binary(const std::string &filename) const;
+
+    size_t size() const { return n_patches_; }
+    size_t total_ctrl_pts() const { return n_ctrl_pts_; }
+    const BezierPatchRecord &patch(size_t i) const { return patches_[i]; }
+    const glm::vec3 *ctrl_pts(size_t i) const { return ctrl_pts_ + patches_[i].first; }
+    BezierSurface toBezierSurface(size_t i) const;
+    std::vector<BezierSurface> toBezierSurfaces() const;
+
+private:
+    /* Either point into the owned vectors or into the mapped file. */
+    const BezierPatchRecord *patches_ = nullptr;
+    const glm::vec3 *ctrl_pts_ = nullptr;
+    size_t n_patches_ = 0;
+    size_t n_ctrl_pts_ = 0;
+
+    std::vector<BezierPatchRecord> owned_patches_;
+    std::vector<glm::vec3> owned_ctrl_pts_;
+    void *mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+};
+
+} // end namespace cgcl
+
+#endif // CGCL_SURFACE_BEZIERPATCHSET_H
@@ -0,0 +1,64 @@
+#ifndef CGCL_SURFACE_NURBS_H
+#define CGCL_SURFACE_NURBS_H
+
+#include "cgcl/surface/Bezier.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace cgcl {
+
+
+/// \brief Last knot span found in each direction.
+/// Nearby parameters usually fall in the same span, so the
+/// binary search over knots is skipped. One cache per thread.
+struct KnotSpanCache {
+    int span_u = -1;
+    int span_v = -1;
+};
+
+/// \brief Non-uniform rational B-spline surface with clamped knot vectors.
+/// A B-spline surface is the special case without weights.
+class NURBSSurface {
+public:
+    /* Degree 31 matches the largest Bezier degree evaluated
+     * by the fixed-size basis of BasicFunction.h.
+     */
+    static constexpr unsigned int max_degree = 31;
+
+    NURBSSurface() = delete;
+    NURBSSurface(unsigned int degree_u, unsigned int degree_v,
+                 const std::vector<float> &knots_u, const std::vector<float> &knots_v,
+                 const std::vector<glm::vec3> &ctrl_pts,
+                 const std::vector<float> &weights = {});
+
+    /// \brief Number of control points along u and v.
+    unsigned int n_us() const { return knots_u_.size() - degree_u - 1; }
+    unsigned int n_vs() const { return knots_v_.size() - degree_v - 1; }
+    /// \brief Parameter domain [u_min, u_max] x [v_min, v_max].
+    float u_min() const { return knots_u_[degree_u]; }
+    float u_max() const { return knots_u_[n_us()]; }
+    float v_min() const { return knots_v_[degree_v]; }
+    float v_max() const { return knots_v_[n_vs()]; }
+
+    /// \brief Cox-de Boor evaluation over the non-zero basis only.
+    glm::vec3 getPoint(float u, float v) const;
+    glm::vec3 getPoint(float u, float v, KnotSpanCache &cache) const;
+    /// \brief Evaluate a nu x nv grid uniformly spread over the domain,
+    /// out[i * nv + j] with i along u. Basis of every grid column and row
+    /// is computed once and rows are evaluated in parallel.
+    void evaluateGrid(unsigned int nu, unsigned int nv, glm::vec3 *out) const;
+
+    /// \brief Split into (rational) Bezier patches by knot insertion,
+    /// every knot span pair becomes one patch in row major order of spans.
+    std::vector<BezierSurface> toBezierPatches() const;
+
+    unsigned int degree_u, degree_v;
+    std::vector<float> knots_u_;
+    std::vector<float> knots_v_;
+    std::vector<glm::vec3> ctrl_pts_; // ctrl (i, j) at i * n_vs() + j, i along u.
+    std::vector<float> weights_; // empty for non-rational B-spline surface.
+};
+
+} // end namespace cgcl
+
+#endif // CGCL_SURFACE_NURBS_H
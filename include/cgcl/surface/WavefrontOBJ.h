@@ -1,6 +1,7 @@
 #ifndef CGCL_SURFACE_WAVEFRONTOBJ_H
 #define CGCL_SURFACE_WAVEFRONTOBJ_H
 
+#include <climits>
 #include <cstddef>
 #include <glm/glm.hpp>
 
@@ -41,6 +42,8 @@ struct PolyElem {
     int start_index_ = 0;
     int corner_count_ = 0; 
     bool shaded_smooth_ = false;
+    /* Index into Geometry::material_order_, -1 before any usemtl. */
+    int material_index_ = -1;
 };
 
 struct Geometry {
@@ -74,8 +77,11 @@ private:
     void geom_add_vertex(GlobalVertices &global_vertices);
     void geom_add_vertex_normal(GlobalVertices &global_vertices);
     void geom_add_uv_vertex(GlobalVertices &global_vertices);
-    void geom_add_polygon(Geometry *geom, GlobalVertices &global_vertices, const bool shaded_smooth);
+    void geom_add_polygon(Geometry *geom, GlobalVertices &global_vertices, const bool shaded_smooth,
+                          const int material_index);
     void geom_add_name(Geometry *geom);
+    /// \brief Index of the material in geom->material_order_, added if new.
+    int geom_use_material(Geometry *geom, const std::string &material_name);
     bool geom_update_smooth();
 
     std::vector<std::string> mtl_libraries_;
@@ -109,10 +115,10 @@ struct MTLTexMap {
 
 struct MTLMaterial {
     std::string name_;
-    glm::vec3 Ka_; // ambient color of material
-    glm::vec3 Kd_; // diffuse color of material
-    glm::vec3 Ks_; // specular color of material
-    float Ns_; // specular expoent, range between 0 and 1000
+    glm::vec3 Ka_ = glm::vec3(0.0f); // ambient color of material
+    glm::vec3 Kd_ = glm::vec3(0.8f); // diffuse color of material
+    glm::vec3 Ks_ = glm::vec3(0.0f); // specular color of material
+    float Ns_ = 16.0f; // specular expoent, range between 0 and 1000
     float Ni_ = 1.0f; // refraction, range from 0.001 and 10, 1.0 means no refraction
     float d = 1.0f; // transparent
     MTLTexMap tex_map_[int(MTLTexMapType::Count)];
@@ -125,6 +131,7 @@ public:
     void parse(std::map<std::string, std::unique_ptr<MTLMaterial>> &materials);
 private:
     void parseTextureMap(MTLMaterial *material);
+    void skipLine();
 
     std::string mtl_file_path_;
     std::string mtl_dir_path_;
@@ -0,0 +1,698 @@
+#include "cgcl/accel/BVH.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+using namespace cgcl;
+
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode is expected to be 32 bytes");
+static_assert(offsetof(BVHNode, max_) == 4 * sizeof(float), "slab() reads max_ 4 floats after min_");
+
+/* Subtrees larger than this are built as separate tasks. */
+static constexpr uint32_t task_threshold = 4096;
+/* Nodes deeper than max_sah_depth are split at the median, which halves
+ * them, so with fewer than 2^31 triangles no leaf is deeper than 63 and
+ * a traversal stack of max_stack_depth never overflows. Traversal does
+ * not check the stack, that would cost a compare per pushed node.
+ */
+static constexpr uint32_t max_sah_depth = 32;
+static constexpr int max_stack_depth = 64;
+static_assert(max_sah_depth + 31 < max_stack_depth, "BVH may be deeper than the traversal stack");
+
+namespace {
+
+/// \brief Per triangle data used during build only.
+struct BuildContext {
+    std::vector<AABB> bounds;
+    std::vector<glm::vec3> centroids;
+    std::vector<uint32_t> ids;
+    std::vector<BVHNode> *nodes;
+    std::atomic<uint32_t> n_nodes;
+};
+
+struct Bin {
+    AABB bounds;
+    uint32_t count = 0;
+};
+
+} // end anonymous namespace
+
+static void set_bounds(BVHNode &node, const AABB &box) {
+    node.min_ = box.min_;
+    node.max_ = box.max_;
+}
+
+/// \brief Split at the median centroid along the longest axis.
+static uint32_t median_split(BuildContext &ctx, const AABB &centroid_box, uint32_t begin, uint32_t end) {
+    const glm::vec3 extent = centroid_box.extent();
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+    const uint32_t mid = begin + (end - begin) / 2;
+    std::nth_element(ctx.ids.begin() + begin, ctx.ids.begin() + mid, ctx.ids.begin() + end,
+                     [&](uint32_t a, uint32_t b) { return ctx.centroids[a][axis] < ctx.centroids[b][axis]; });
+    return mid;
+}
+
+/// \brief Split at the bin boundary of least SAH cost.
+static uint32_t sah_split(BuildContext &ctx, const AABB &centroid_box, uint32_t begin, uint32_t end) {
+    const uint32_t count = end - begin;
+    /* Bin centroids along every axis in one pass. */
+    Bin bins[3][BVH::n_bins];
+    glm::vec3 extent = centroid_box.extent();
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; ++axis)
+        scale[axis] = extent[axis] > 0.0f ? BVH::n_bins / extent[axis] : 0.0f;
+    for (uint32_t i = begin; i < end; ++i) {
+        const uint32_t id = ctx.ids[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            int b = int((ctx.centroids[id][axis] - centroid_box.min_[axis]) * scale[axis]);
+            b = std::min(b, int(BVH::n_bins) - 1);
+            bins[axis][b].bounds.expand(ctx.bounds[id]);
+            bins[axis][b].count++;
+        }
+    }
+
+    /* SAH cost of splitting after bin k is A_left * N_left + A_right * N_right,
+     * swept from the right to get suffix areas, then from the left.
+     */
+    float best_cost = FLT_MAX;
+    int best_axis = -1, best_split = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (extent[axis] <= 0.0f) continue;
+        float right_cost[BVH::n_bins];
+        AABB right;
+        uint32_t right_count = 0;
+        for (int k = BVH::n_bins - 1; k > 0; --k) {
+            right.expand(bins[axis][k].bounds);
+            right_count += bins[axis][k].count;
+            right_cost[k] = right.surfaceArea() * right_count;
+        }
+        AABB left;
+        uint32_t left_count = 0;
+        for (int k = 0; k < int(BVH::n_bins) - 1; ++k) {
+            left.expand(bins[axis][k].bounds);
+            left_count += bins[axis][k].count;
+            float cost = left.surfaceArea() * left_count + right_cost[k + 1];
+            if (left_count > 0 && left_count < count && cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = k;
+            }
+        }
+    }
+
+    /* All centroids coincide, split in the middle. */
+    if (best_axis < 0) return begin + count / 2;
+    const int axis = best_axis;
+    const float min_c = centroid_box.min_[axis], s = scale[axis];
+    auto it = std::partition(ctx.ids.begin() + begin, ctx.ids.begin() + end, [&](uint32_t id) {
+        int b = std::min(int((ctx.centroids[id][axis] - min_c) * s), int(BVH::n_bins) - 1);
+        return b <= best_split;
+    });
+    return it - ctx.ids.begin();
+}
+
+static void build_node(BuildContext &ctx, uint32_t node_index, uint32_t begin, uint32_t end, uint32_t depth) {
+    BVHNode &node = (*ctx.nodes)[node_index];
+    AABB box, centroid_box;
+    for (uint32_t i = begin; i < end; ++i) {
+        box.expand(ctx.bounds[ctx.ids[i]]);
+        centroid_box.expand(ctx.centroids[ctx.ids[i]]);
+    }
+    set_bounds(node, box);
+    const uint32_t count = end - begin;
+    if (count <= BVH::max_leaf_size) {
+        node.left_first_ = begin;
+        node.count_ = count;
+        return;
+    }
+    const uint32_t mid = depth < max_sah_depth ? sah_split(ctx, centroid_box, begin, end)
+                                               : median_split(ctx, centroid_box, begin, end);
+
+    const uint32_t left = ctx.n_nodes.fetch_add(2);
+    node.left_first_ = left;
+    node.count_ = 0;
+    if (count > task_threshold) {
+#pragma omp task default(shared) firstprivate(left, begin, mid, depth)
+        build_node(ctx, left, begin, mid, depth + 1);
+        build_node(ctx, left + 1, mid, end, depth + 1);
+#pragma omp taskwait
+    } else {
+        build_node(ctx, left, begin, mid, depth + 1);
+        build_node(ctx, left + 1, mid, end, depth + 1);
+    }
+}
+
+std::unique_ptr<BVH> BVH::from_mesh(const TriMesh &mesh) {
+    const auto &vertices = mesh.global_vertices_;
+    const auto &indices = mesh.global_indices_;
+    const long n_triangles = indices.size() / 3;
+    std::vector<BVHTriangle> triangles(n_triangles);
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < n_triangles; ++k) {
+        const glm::vec3 &v0 = vertices[indices[3 * k]].position_;
+        triangles[k].v0_ = v0;
+        triangles[k].e1_ = vertices[indices[3 * k + 1]].position_ - v0;
+        triangles[k].e2_ = vertices[indices[3 * k + 2]].position_ - v0;
+    }
+    return from_triangles(std::move(triangles));
+}
+
+std::unique_ptr<BVH> BVH::from_triangles(std::vector<BVHTriangle> &&triangles) {
+    const long n_triangles = triangles.size();
+    CHECK_LT(n_triangles, long(UINT32_MAX / 2)) << "Too many triangles for BVH";
+    auto bvh = std::make_unique<BVH>();
+
+    BuildContext ctx;
+    ctx.bounds.resize(n_triangles);
+    ctx.centroids.resize(n_triangles);
+    ctx.ids.resize(n_triangles);
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < n_triangles; ++k) {
+        const BVHTriangle &tri = triangles[k];
+        AABB box;
+        box.expand(tri.v0_);
+        box.expand(tri.v0_ + tri.e1_);
+        box.expand(tri.v0_ + tri.e2_);
+        ctx.bounds[k] = box;
+        ctx.centroids[k] = box.center();
+        ctx.ids[k] = k;
+    }
+
+    /* A binary tree with n leaves has at most 2n - 1 nodes. Node 1 is
+     * left unused, so every sibling pair starts at an even index.
+     */
+    bvh->nodes_.resize(std::max<long>(2 * n_triangles, 2));
+    ctx.nodes = &bvh->nodes_;
+    ctx.n_nodes = 2;
+    if (n_triangles == 0) {
+        set_bounds(bvh->nodes_[0], AABB());
+        bvh->nodes_[0].left_first_ = 0;
+        bvh->nodes_[0].count_ = 0;
+        bvh->nodes_.resize(1);
+        return bvh;
+    }
+#pragma omp parallel
+#pragma omp single
+    build_node(ctx, 0, 0, n_triangles, 0);
+    bvh->nodes_.resize(ctx.n_nodes);
+
+    /* Store triangles in leaf order, so a leaf reads them contiguously. */
+    bvh->triangles_.resize(n_triangles);
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < n_triangles; ++k)
+        bvh->triangles_[k] = triangles[ctx.ids[k]];
+    bvh->triangle_ids_ = std::move(ctx.ids);
+    return bvh;
+}
+
+AABB BVH::bounds() const {
+    AABB box;
+    if (!nodes_.empty() && (nodes_[0].count_ > 0 || nodes_.size() > 1)) {
+        box.min_ = nodes_[0].min_;
+        box.max_ = nodes_[0].max_;
+    }
+    return box;
+}
+
+/// \brief Reciprocal of a direction component, finite for 0. An
+/// infinity would give 0 * inf = NaN in the slab test when the ray
+/// starts on a box face parallel to it, and the box would be missed.
+static inline float inverse_direction(float d) {
+    return 1.0f / (std::fabs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+}
+
+/// \brief Ray with reciprocal direction, shared by the slab tests.
+/// The sign of the direction tells which plane of each slab the ray
+/// enters, so slab tests need no min and max of the two planes.
+struct PreparedRay {
+    glm::vec3 origin, direction, inv_direction;
+    float t_min;
+    bool negative_x, negative_y, negative_z;
+    explicit PreparedRay(const Ray &ray)
+        : origin(ray.origin_), direction(ray.direction_),
+          inv_direction(inverse_direction(ray.direction_.x), inverse_direction(ray.direction_.y),
+                        inverse_direction(ray.direction_.z)),
+          t_min(ray.t_min_), negative_x(inv_direction.x < 0.0f), negative_y(inv_direction.y < 0.0f),
+          negative_z(inv_direction.z < 0.0f) {}
+};
+
+/// \brief Entry distance of the ray into the node, FLT_MAX if it
+/// misses the node within [t_min, t_max]. Planes are picked by offset
+/// from min_, 0 for min_ and 4 for max_.
+static inline float slab(const PreparedRay &ray, const BVHNode &node, float t_max) {
+    const float *box = &node.min_.x;
+    const int near_x = 4 * ray.negative_x, near_y = 1 + 4 * ray.negative_y, near_z = 2 + 4 * ray.negative_z;
+    const float tx0 = (box[near_x] - ray.origin.x) * ray.inv_direction.x;
+    const float tx1 = (box[near_x ^ 4] - ray.origin.x) * ray.inv_direction.x;
+    const float ty0 = (box[near_y] - ray.origin.y) * ray.inv_direction.y;
+    const float ty1 = (box[near_y ^ 4] - ray.origin.y) * ray.inv_direction.y;
+    const float tz0 = (box[near_z] - ray.origin.z) * ray.inv_direction.z;
+    const float tz1 = (box[near_z ^ 4] - ray.origin.z) * ray.inv_direction.z;
+    const float t_enter = std::max(std::max(tx0, ty0), std::max(tz0, ray.t_min));
+    const float t_exit = std::min(std::min(tx1, ty1), std::min(tz1, t_max));
+    return t_enter <= t_exit ? t_enter : FLT_MAX;
+}
+
+/// \brief Moller-Trumbore, update t, u and v if closer than t. Written
+/// out per component, the products are independent and pipeline.
+static inline bool intersect_triangle(const PreparedRay &ray, const BVHTriangle &tri, float &t, float &u, float &v) {
+    const glm::vec3 &d = ray.direction, &e1 = tri.e1_, &e2 = tri.e2_;
+    const float px = d.y * e2.z - d.z * e2.y;
+    const float py = d.z * e2.x - d.x * e2.z;
+    const float pz = d.x * e2.y - d.y * e2.x;
+    const float det = e1.x * px + e1.y * py + e1.z * pz;
+    if (std::fabs(det) < 1e-12f) return false;
+    const float inv_det = 1.0f / det;
+    const float sx = ray.origin.x - tri.v0_.x, sy = ray.origin.y - tri.v0_.y, sz = ray.origin.z - tri.v0_.z;
+    const float bu = (sx * px + sy * py + sz * pz) * inv_det;
+    if (bu < 0.0f || bu > 1.0f) return false;
+    const float qx = sy * e1.z - sz * e1.y;
+    const float qy = sz * e1.x - sx * e1.z;
+    const float qz = sx * e1.y - sy * e1.x;
+    const float bv = (d.x * qx + d.y * qy + d.z * qz) * inv_det;
+    if (bv < 0.0f || bu + bv > 1.0f) return false;
+    const float bt = (e2.x * qx + e2.y * qy + e2.z * qz) * inv_det;
+    if (bt < ray.t_min || bt >= t) return false;
+    t = bt;
+    u = bu;
+    v = bv;
+    return true;
+}
+
+/// \brief Depth first traversal, nearer child first. With any_hit
+/// it returns at the first hit found.
+template <bool any_hit>
+static bool traverse(const BVH &bvh, const Ray &ray, RayHit &hit) {
+    if (bvh.triangles_.empty()) return false;
+    const PreparedRay prepared(ray);
+    float t_max = std::min(ray.t_max_, hit.t_);
+    uint32_t hit_index = RayHit::no_hit;
+    float u = 0.0f, v = 0.0f;
+
+    const BVHNode *nodes = bvh.nodes_.data();
+    if (slab(prepared, nodes[0], t_max) == FLT_MAX) return false;
+    uint32_t stack[max_stack_depth];
+    int top = 0;
+    uint32_t current = 0;
+    while (true) {
+        const BVHNode &node = nodes[current];
+        if (node.leaf()) {
+            for (uint32_t k = node.left_first_; k < node.left_first_ + node.count_; ++k) {
+                if (intersect_triangle(prepared, bvh.triangles_[k], t_max, u, v)) {
+                    hit_index = k;
+                    if (any_hit) return true;
+                }
+            }
+        } else {
+            const uint32_t left = node.left_first_;
+            float t_left = slab(prepared, nodes[left], t_max);
+            float t_right = slab(prepared, nodes[left + 1], t_max);
+            if (t_left != FLT_MAX || t_right != FLT_MAX) {
+                uint32_t near = left, far = left + 1;
+                if (t_right < t_left) {
+                    std::swap(near, far);
+                    std::swap(t_left, t_right);
+                }
+                if (t_right != FLT_MAX) stack[top++] = far;
+                current = near;
+                continue;
+            }
+        }
+        if (top == 0) break;
+        current = stack[--top];
+    }
+
+    if (hit_index == RayHit::no_hit) return false;
+    hit.t_ = t_max;
+    hit.u_ = u;
+    hit.v_ = v;
+    hit.triangle_ = bvh.triangle_ids_[hit_index];
+    return true;
+}
+
+bool BVH::intersect(const Ray &ray, RayHit &hit) const {
+    return traverse<false>(*this, ray, hit);
+}
+
+bool BVH::occluded(const Ray &ray) const {
+    RayHit hit;
+    return traverse<true>(*this, ray, hit);
+}
+
+void RayPacket::set(int lane, const Ray &ray) {
+    origin_x_[lane] = ray.origin_.x;
+    origin_y_[lane] = ray.origin_.y;
+    origin_z_[lane] = ray.origin_.z;
+    direction_x_[lane] = ray.direction_.x;
+    direction_y_[lane] = ray.direction_.y;
+    direction_z_[lane] = ray.direction_.z;
+    t_min_[lane] = ray.t_min_;
+    t_max_[lane] = ray.t_max_;
+}
+
+/// \brief Reciprocal directions of a packet, shared by its slab tests.
+struct PreparedPacket {
+    const RayPacket &rays;
+    float inv_x[RayPacket::size], inv_y[RayPacket::size], inv_z[RayPacket::size];
+
+    explicit PreparedPacket(const RayPacket &packet) : rays(packet) {
+        for (int k = 0; k < RayPacket::size; ++k) {
+            inv_x[k] = inverse_direction(packet.direction_x_[k]);
+            inv_y[k] = inverse_direction(packet.direction_y_[k]);
+            inv_z[k] = inverse_direction(packet.direction_z_[k]);
+        }
+    }
+};
+
+/// \brief Nearest entry of the lanes hitting the node within their
+/// [t_min_, t], FLT_MAX if none does.
+static inline float packet_slab(const PreparedPacket &packet, const BVHNode &node, const float *t) {
+    const RayPacket &rays = packet.rays;
+    float t_enter = FLT_MAX;
+#pragma omp simd reduction(min : t_enter)
+    for (int k = 0; k < RayPacket::size; ++k) {
+        float tx0 = (node.min_.x - rays.origin_x_[k]) * packet.inv_x[k];
+        float tx1 = (node.max_.x - rays.origin_x_[k]) * packet.inv_x[k];
+        float ty0 = (node.min_.y - rays.origin_y_[k]) * packet.inv_y[k];
+        float ty1 = (node.max_.y - rays.origin_y_[k]) * packet.inv_y[k];
+        float tz0 = (node.min_.z - rays.origin_z_[k]) * packet.inv_z[k];
+        float tz1 = (node.max_.z - rays.origin_z_[k]) * packet.inv_z[k];
+        float near = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)),
+                              std::max(std::min(tz0, tz1), rays.t_min_[k]));
+        float far = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)),
+                             std::min(std::max(tz0, tz1), t[k]));
+        t_enter = std::min(t_enter, near <= far ? near : FLT_MAX);
+    }
+    return t_enter;
+}
+
+/// \brief Depth first traversal of all lanes together, as traverse()
+/// does for one ray. A node is entered if any active lane hits it, the
+/// child some lane enters first is visited first. With any_hit a lane
+/// is retired at its first hit and the traversal ends when all are.
+template <bool any_hit>
+static void traverse_packet(const BVH &bvh, const RayPacket &packet, uint32_t ids[RayPacket::size],
+                            float t[RayPacket::size], float u[RayPacket::size], float v[RayPacket::size]) {
+    constexpr int n = RayPacket::size;
+    const PreparedPacket prepared(packet);
+    const BVHNode *nodes = bvh.nodes_.data();
+    if (packet_slab(prepared, nodes[0], t) == FLT_MAX) return;
+    uint32_t stack[max_stack_depth];
+    int top = 0;
+    uint32_t current = 0;
+    while (true) {
+        const BVHNode &node = nodes[current];
+        if (node.leaf()) {
+            int alive = 0;
+            for (uint32_t i = node.left_first_; i < node.left_first_ + node.count_; ++i) {
+                const BVHTriangle &tri = bvh.triangles_[i];
+                alive = 0;
+#pragma omp simd reduction(| : alive)
+                for (int k = 0; k < n; ++k) {
+                    /* Moller-Trumbore as intersect_triangle, without branches. */
+                    const float dx = packet.direction_x_[k], dy = packet.direction_y_[k], dz = packet.direction_z_[k];
+                    const float px = dy * tri.e2_.z - dz * tri.e2_.y;
+                    const float py = dz * tri.e2_.x - dx * tri.e2_.z;
+                    const float pz = dx * tri.e2_.y - dy * tri.e2_.x;
+                    const float det = tri.e1_.x * px + tri.e1_.y * py + tri.e1_.z * pz;
+                    const float inv_det = 1.0f / det;
+                    const float sx = packet.origin_x_[k] - tri.v0_.x;
+                    const float sy = packet.origin_y_[k] - tri.v0_.y;
+                    const float sz = packet.origin_z_[k] - tri.v0_.z;
+                    const float bu = (sx * px + sy * py + sz * pz) * inv_det;
+                    const float qx = sy * tri.e1_.z - sz * tri.e1_.y;
+                    const float qy = sz * tri.e1_.x - sx * tri.e1_.z;
+                    const float qz = sx * tri.e1_.y - sy * tri.e1_.x;
+                    const float bv = (dx * qx + dy * qy + dz * qz) * inv_det;
+                    const float bt = (tri.e2_.x * qx + tri.e2_.y * qy + tri.e2_.z * qz) * inv_det;
+                    const bool hit = std::fabs(det) >= 1e-12f && bu >= 0.0f && bu <= 1.0f && bv >= 0.0f &&
+                                     bu + bv <= 1.0f && bt >= packet.t_min_[k] && bt < t[k];
+                    ids[k] = hit ? i : ids[k];
+                    u[k] = hit ? bu : u[k];
+                    v[k] = hit ? bv : v[k];
+                    /* A retired lane gets t below t_min and misses everything after. */
+                    t[k] = hit ? (any_hit ? -FLT_MAX : bt) : t[k];
+                    alive |= t[k] >= packet.t_min_[k];
+                }
+            }
+            if (any_hit && !alive) return;
+        } else {
+            const uint32_t left = node.left_first_;
+            float t_left = packet_slab(prepared, nodes[left], t);
+            float t_right = packet_slab(prepared, nodes[left + 1], t);
+            if (t_left != FLT_MAX || t_right != FLT_MAX) {
+                uint32_t near = left, far = left + 1;
+                if (t_right < t_left) {
+                    std::swap(near, far);
+                    std::swap(t_left, t_right);
+                }
+                if (t_right != FLT_MAX) stack[top++] = far;
+                current = near;
+                continue;
+            }
+        }
+        if (top == 0) break;
+        current = stack[--top];
+    }
+}
+
+void BVH::intersect(const RayPacket &packet, RayHit hits[RayPacket::size]) const {
+    if (triangles_.empty()) return;
+    uint32_t ids[RayPacket::size];
+    float t[RayPacket::size], u[RayPacket::size], v[RayPacket::size];
+    for (int k = 0; k < RayPacket::size; ++k) {
+        ids[k] = RayHit::no_hit;
+        t[k] = std::min(packet.t_max_[k], hits[k].t_);
+        u[k] = v[k] = 0.0f;
+    }
+    traverse_packet<false>(*this, packet, ids, t, u, v);
+    for (int k = 0; k < RayPacket::size; ++k) {
+        if (ids[k] == RayHit::no_hit) continue;
+        hits[k].t_ = t[k];
+        hits[k].u_ = u[k];
+        hits[k].v_ = v[k];
+        hits[k].triangle_ = triangle_ids_[ids[k]];
+    }
+}
+
+void BVH::occluded(const RayPacket &packet, bool occluded[RayPacket::size]) const {
+    uint32_t ids[RayPacket::size];
+    float t[RayPacket::size], u[RayPacket::size], v[RayPacket::size];
+    for (int k = 0; k < RayPacket::size; ++k) {
+        ids[k] = RayHit::no_hit;
+        t[k] = packet.t_max_[k];
+    }
+    if (!triangles_.empty()) traverse_packet<true>(*this, packet, ids, t, u, v);
+    for (int k = 0; k < RayPacket::size; ++k)
+        occluded[k] = ids[k] != RayHit::no_hit;
+}
+
+static bool overlaps(const AABB &a, const glm::vec3 &min, const glm::vec3 &max) {
+    return a.min_.x <= max.x && a.max_.x >= min.x &&
+           a.min_.y <= max.y && a.max_.y >= min.y &&
+           a.min_.z <= max.z && a.max_.z >= min.z;
+}
+
+void BVH::overlap(const AABB &box, std::vector<uint32_t> &triangles) const {
+    if (triangles_.empty() || !overlaps(box, nodes_[0].min_, nodes_[0].max_)) return;
+    uint32_t stack[max_stack_depth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVHNode &node = nodes_[stack[--top]];
+        if (node.leaf()) {
+            for (uint32_t k = node.left_first_; k < node.left_first_ + node.count_; ++k) {
+                const BVHTriangle &tri = triangles_[k];
+                AABB tri_box;
+                tri_box.expand(tri.v0_);
+                tri_box.expand(tri.v0_ + tri.e1_);
+                tri_box.expand(tri.v0_ + tri.e2_);
+                if (overlaps(box, tri_box.min_, tri_box.max_))
+                    triangles.push_back(triangle_ids_[k]);
+            }
+            continue;
+        }
+        for (uint32_t child = node.left_first_; child < node.left_first_ + 2; ++child) {
+            if (overlaps(box, nodes_[child].min_, nodes_[child].max_)) {
+                CHECK_LT(top, max_stack_depth) << "BVH deeper than the traversal stack";
+                stack[top++] = child;
+            }
+        }
+    }
+}
+
+static float node_area(const BVHNode &node) {
+    glm::vec3 d = node.max_ - node.min_;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+/// \brief Empty lane k of a wide node, inverted bounds never hit.
+template <int width>
+static void clear_lane(BVHWideNodeN<width> &w, int k) {
+    w.min_x_[k] = w.min_y_[k] = w.min_z_[k] = FLT_MAX;
+    w.max_x_[k] = w.max_y_[k] = w.max_z_[k] = -FLT_MAX;
+    w.child_[k] = UINT32_MAX;
+    w.count_[k] = 0;
+}
+
+/// \brief Bounds of binary node in lane k of a wide node.
+template <int width>
+static void set_lane(BVHWideNodeN<width> &w, int k, const BVHNode &node) {
+    w.min_x_[k] = node.min_.x; w.min_y_[k] = node.min_.y; w.min_z_[k] = node.min_.z;
+    w.max_x_[k] = node.max_.x; w.max_y_[k] = node.max_.y; w.max_z_[k] = node.max_.z;
+    w.count_[k] = node.count_;
+    w.child_[k] = node.leaf() ? node.left_first_ : 0;
+}
+
+/// \brief Wide node from binary node, its children are opened
+/// (largest area first) until width remain or all are leaves.
+template <int width>
+static uint32_t collapse(const BVH &bvh, std::vector<BVHWideNodeN<width>> &wide, uint32_t binary) {
+    uint32_t lanes[width] = {bvh.nodes_[binary].left_first_, bvh.nodes_[binary].left_first_ + 1};
+    int n_lanes = 2;
+    while (n_lanes < width) {
+        int open = -1;
+        float open_area = -1.0f;
+        for (int k = 0; k < n_lanes; ++k) {
+            const BVHNode &node = bvh.nodes_[lanes[k]];
+            if (!node.leaf() && node_area(node) > open_area) {
+                open = k;
+                open_area = node_area(node);
+            }
+        }
+        if (open < 0) break;
+        uint32_t left = bvh.nodes_[lanes[open]].left_first_;
+        lanes[open] = left;
+        lanes[n_lanes++] = left + 1;
+    }
+
+    const uint32_t index = wide.size();
+    wide.emplace_back();
+    for (int k = 0; k < width; ++k) {
+        if (k < n_lanes)
+            set_lane(wide[index], k, bvh.nodes_[lanes[k]]);
+        else
+            clear_lane(wide[index], k);
+    }
+    /* wide may reallocate while collapsing children, index again after. */
+    for (int k = 0; k < n_lanes; ++k) {
+        if (!bvh.nodes_[lanes[k]].leaf()) {
+            uint32_t child = collapse(bvh, wide, lanes[k]);
+            wide[index].child_[k] = child;
+        }
+    }
+    return index;
+}
+
+template <int width>
+static void build_wide(const BVH &bvh, std::vector<BVHWideNodeN<width>> &wide) {
+    wide.clear();
+    if (bvh.triangles_.empty()) return;
+    wide.reserve(bvh.nodes_.size() / (width - 1) + 1);
+    if (bvh.nodes_[0].leaf()) {
+        /* A single leaf, put it in lane 0 of the root. */
+        BVHWideNodeN<width> w;
+        for (int k = 1; k < width; ++k)
+            clear_lane(w, k);
+        set_lane(w, 0, bvh.nodes_[0]);
+        wide.push_back(w);
+        return;
+    }
+    collapse(bvh, wide, 0);
+}
+
+void BVH::buildWide() {
+    build_wide(*this, wide_nodes_);
+}
+
+void BVH::buildWide8() {
+    build_wide(*this, wide8_nodes_);
+}
+
+/// \brief Closest hit through a wide tree. Leaf lanes are intersected
+/// right away, inner lanes are pushed farthest first. The wide tree is
+/// no deeper than the binary one and every level leaves at most
+/// width - 1 lanes on the stack, so the stack is not checked either.
+template <int width>
+static bool traverse_wide(const BVH &bvh, const std::vector<BVHWideNodeN<width>> &wide,
+                          const Ray &ray, RayHit &hit) {
+    if (bvh.triangles_.empty()) return false;
+    const PreparedRay prepared(ray);
+    float t_max = std::min(ray.t_max_, hit.t_);
+    uint32_t hit_index = RayHit::no_hit;
+    float u = 0.0f, v = 0.0f;
+
+    uint32_t stack[max_stack_depth * (width - 1) + 1];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVHWideNodeN<width> &node = wide[stack[--top]];
+        /* The slab tests of all lanes in lockstep, the loop is vectorized. */
+        float t_enter[width];
+        bool lane_hit[width];
+#pragma omp simd
+        for (int k = 0; k < width; ++k) {
+            float tx0 = (node.min_x_[k] - prepared.origin.x) * prepared.inv_direction.x;
+            float tx1 = (node.max_x_[k] - prepared.origin.x) * prepared.inv_direction.x;
+            float ty0 = (node.min_y_[k] - prepared.origin.y) * prepared.inv_direction.y;
+            float ty1 = (node.max_y_[k] - prepared.origin.y) * prepared.inv_direction.y;
+            float tz0 = (node.min_z_[k] - prepared.origin.z) * prepared.inv_direction.z;
+            float tz1 = (node.max_z_[k] - prepared.origin.z) * prepared.inv_direction.z;
+            float near = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)),
+                                  std::max(std::min(tz0, tz1), prepared.t_min));
+            float far = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)),
+                                 std::min(std::max(tz0, tz1), t_max));
+            t_enter[k] = near;
+            lane_hit[k] = near <= far;
+        }
+
+        /* Leaves right away, inner children pushed farthest first. */
+        uint32_t inner[width];
+        float inner_t[width];
+        int n_inner = 0;
+        for (int k = 0; k < width; ++k) {
+            /* A closer hit in an earlier leaf lane may rule the lane out. */
+            if (!lane_hit[k] || t_enter[k] > t_max) continue;
+            if (node.count_[k] > 0) {
+                for (uint32_t i = node.child_[k]; i < node.child_[k] + node.count_[k]; ++i) {
+                    if (intersect_triangle(prepared, bvh.triangles_[i], t_max, u, v))
+                        hit_index = i;
+                }
+            } else if (node.child_[k] != UINT32_MAX) {
+                int j = n_inner++;
+                for (; j > 0 && inner_t[j - 1] < t_enter[k]; --j) {
+                    inner[j] = inner[j - 1];
+                    inner_t[j] = inner_t[j - 1];
+                }
+                inner[j] = node.child_[k];
+                inner_t[j] = t_enter[k];
+            }
+        }
+        for (int k = 0; k < n_inner; ++k) {
+            if (inner_t[k] <= t_max)
+                stack[top++] = inner[k];
+        }
+    }
+
+    if (hit_index == RayHit::no_hit) return false;
+    hit.t_ = t_max;
+    hit.u_ = u;
+    hit.v_ = v;
+    hit.triangle_ = bvh.triangle_ids_[hit_index];
+    return true;
+}
+
+bool BVH::intersectWide(const Ray &ray, RayHit &hit) const {
+    CHECK(!wide_nodes_.empty() || triangles_.empty()) << "Call buildWide() before intersectWide()";
+    return traverse_wide(*this, wide_nodes_, ray, hit);
+}
+
+bool BVH::intersectWide8(const Ray &ray, RayHit &hit) const {
+    CHECK(!wide8_nodes_.empty() || triangles_.empty()) << "Call buildWide8() before intersectWide8()";
+    return traverse_wide(*this, wide8_nodes_, ray, hit);
+}
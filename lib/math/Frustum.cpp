@@ -0,0 +1,98 @@
+#include "cgcl/math/Frustum.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace cgcl;
+
+
+Frustum Frustum::from_matrix(const glm::mat4 &m) {
+    /* Row i of m is (m[0][i], m[1][i], m[2][i], m[3][i]). */
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i)
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    Frustum frustum;
+    frustum.planes_[LEFT] = row[3] + row[0];
+    frustum.planes_[RIGHT] = row[3] - row[0];
+    frustum.planes_[BOTTOM] = row[3] + row[1];
+    frustum.planes_[TOP] = row[3] - row[1];
+    frustum.planes_[NEAR] = row[3] + row[2];
+    frustum.planes_[FAR] = row[3] - row[2];
+    /* Normalize, so plane distance is in world units as the radius. */
+    for (auto &plane : frustum.planes_)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const {
+    for (const auto &plane : planes_) {
+        if (glm::dot(glm::vec3(plane), sphere.center_) + plane.w < -sphere.radius_)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const AABB &box) const {
+    for (const auto &plane : planes_) {
+        /* corner furthest along the plane normal. */
+        glm::vec3 p(plane.x >= 0.0f ? box.max_.x : box.min_.x,
+                    plane.y >= 0.0f ? box.max_.y : box.min_.y,
+                    plane.z >= 0.0f ? box.max_.z : box.min_.z);
+        if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+/// \brief Scalar test of spheres [begin, end), same arithmetic as the SIMD one.
+static size_t cull_scalar(const glm::vec4 *planes, const BoundingSphereSoA &spheres,
+                          size_t begin, size_t end, uint8_t *visible) {
+    size_t n_visible = 0;
+    for (size_t i = begin; i < end; ++i) {
+        bool inside = true;
+        for (int k = 0; k < 6; ++k) {
+            float d = planes[k].x * spheres.x_[i] + planes[k].y * spheres.y_[i] +
+                      planes[k].z * spheres.z_[i] + planes[k].w;
+            inside &= d >= -spheres.radius_[i];
+        }
+        visible[i] = inside;
+        n_visible += inside;
+    }
+    return n_visible;
+}
+
+size_t Frustum::cull(const BoundingSphereSoA &spheres, uint8_t *visible) const {
+    const long n = spheres.size();
+    constexpr long block = 8;
+    const long n_blocks = n / block;
+    size_t n_visible = 0;
+
+#pragma omp parallel for schedule(static) reduction(+ : n_visible) if (n > 65536)
+    for (long b = 0; b < n_blocks; ++b) {
+        const long i = b * block;
+#ifdef __AVX2__
+        const __m256 x = _mm256_loadu_ps(&spheres.x_[i]);
+        const __m256 y = _mm256_loadu_ps(&spheres.y_[i]);
+        const __m256 z = _mm256_loadu_ps(&spheres.z_[i]);
+        const __m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius_[i]));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int k = 0; k < 6; ++k) {
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes_[k].x), x),
+                                     _mm256_mul_ps(_mm256_set1_ps(planes_[k].y), y));
+            d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(planes_[k].z), z));
+            d = _mm256_add_ps(d, _mm256_set1_ps(planes_[k].w));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GE_OQ));
+        }
+        const int mask = _mm256_movemask_ps(inside);
+        for (int j = 0; j < block; ++j)
+            visible[i + j] = (mask >> j) & 1;
+        n_visible += __builtin_popcount(mask);
+#else
+        n_visible += cull_scalar(planes_, spheres, i, i + block, visible);
+#endif
+    }
+    n_visible += cull_scalar(planes_, spheres, n_blocks * block, n, visible);
+    return n_visible;
+}
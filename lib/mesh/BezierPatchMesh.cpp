@@ -0,0 +1,91 @@
+#include "cgcl/mesh/BezierPatchMesh.h"
+#include "cgcl/utils/logging.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+using namespace cgcl;
+
+
+std::unique_ptr<BezierPatchMesh>
+BezierPatchMesh::from_bezier_patches(const std::vector<BezierSurface> &patches,
+                                     std::vector<BezierSurface> *oversized) {
+    /* Bucket patches by size, each bucket becomes one draw. */
+    std::map<std::pair<unsigned int, unsigned int>, std::vector<const BezierSurface *>> buckets;
+    size_t n_skipped = 0;
+    for (const auto &patch : patches) {
+        if (patch.n_us * patch.n_vs > max_patch_vertices || !patch.weights_.empty()) {
+            if (oversized != nullptr)
+                oversized->push_back(patch);
+            n_skipped++;
+            continue;
+        }
+        buckets[{patch.n_us, patch.n_vs}].push_back(&patch);
+    }
+    if (n_skipped)
+        LOG(WARNING) << n_skipped << " patches are rational or exceed " << max_patch_vertices
+                     << " control points, left to CPU tessellation";
+
+    auto mesh = std::make_unique<BezierPatchMesh>();
+    for (const auto &[size, bucket] : buckets) {
+        PatchGroup group;
+        group.n_us = size.first;
+        group.n_vs = size.second;
+        group.first = mesh->ctrl_pts_.size();
+        group.count = bucket.size() * group.n_us * group.n_vs;
+        for (const auto *patch : bucket)
+            mesh->ctrl_pts_.insert(mesh->ctrl_pts_.end(),
+                                   patch->ctrl_pts_.begin(), patch->ctrl_pts_.end());
+        mesh->groups_.push_back(group);
+    }
+    return mesh;
+}
+
+void BezierPatchMesh::initGL() {
+    LOG(INFO) << "BezierPatchMesh Init: ";
+    LOG(INFO) << "Total Control Points: " << ctrl_pts_.size();
+    LOG(INFO) << "Total Patch Groups: " << groups_.size();
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, ctrl_pts_.size() * sizeof(glm::vec3),
+                 ctrl_pts_.data(), GL_STATIC_DRAW);
+    /* set control point position */
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+
+    glBindVertexArray(0);
+}
+
+void BezierPatchMesh::updateTessellation(const glm::vec2 &viewport_size, float pixels_per_segment) {
+    CHECK(shader_ != nullptr) << "BezierPatchMesh needs a tessellation shader";
+    shader_->updateUniformFloat2("viewport_size", viewport_size);
+    shader_->updateUniformFloat("pixels_per_segment", pixels_per_segment);
+}
+
+void BezierPatchMesh::render() {
+    glBindVertexArray(VAO);
+    draw();
+    glBindVertexArray(0);
+}
+
+void BezierPatchMesh::draw() {
+    CHECK(shader_ != nullptr) << "BezierPatchMesh needs a tessellation shader";
+    for (const auto &group : groups_) {
+        shader_->updateUniformInt("n_us", group.n_us);
+        shader_->updateUniformInt("n_vs", group.n_vs);
+        glPatchParameteri(GL_PATCH_VERTICES, group.n_us * group.n_vs);
+        glDrawArrays(GL_PATCHES, group.first, group.count);
+    }
+}
+
+void BezierPatchMesh::finishGL() {
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+}
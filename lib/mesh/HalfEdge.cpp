@@ -0,0 +1,95 @@
+#include "cgcl/mesh/HalfEdge.h"
+#include "cgcl/utils/logging.h"
+#include "MeshAdjacency.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+using namespace cgcl;
+
+
+HalfEdgeMesh HalfEdgeMesh::build(const unsigned int *indices, size_t n_indices, size_t n_vertices) {
+    CHECK_EQ(n_indices % 3, 0u) << "Not a triangle list";
+    CHECK_LT(n_indices, size_t(INT32_MAX)) << "Too many half-edges for int32";
+    const long n = n_indices;
+    auto lower = [&](long h) { return std::min(indices[h], indices[next(h)]); };
+    auto upper = [&](long h) { return std::max(indices[h], indices[next(h)]); };
+
+    /* Counting sort of the half-edges by their lower vertex. */
+    std::vector<uint32_t> offsets(n_vertices + 1, 0);
+#pragma omp parallel for schedule(static)
+    for (long h = 0; h < n; ++h) {
+#pragma omp atomic
+        offsets[lower(h) + 1]++;
+    }
+    prefix_sum(offsets.data(), offsets.size());
+    /* Bucket entries are (higher vertex, half-edge), so sorting a
+     * bucket brings the half-edges of one edge together in a fixed order.
+     */
+    std::vector<uint64_t> sorted(n);
+    {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+#pragma omp parallel for schedule(static)
+        for (long h = 0; h < n; ++h) {
+            uint32_t slot;
+#pragma omp atomic capture
+            slot = cursor[lower(h)]++;
+            sorted[slot] = uint64_t(upper(h)) << 32 | uint64_t(h);
+        }
+    }
+
+    HalfEdgeMesh mesh;
+    mesh.twins_.resize(n);
+    const long n_v = n_vertices;
+    size_t n_border = 0, n_non_manifold = 0;
+#pragma omp parallel for schedule(dynamic, 4096) reduction(+ : n_border, n_non_manifold)
+    for (long a = 0; a < n_v; ++a) {
+        uint64_t *bucket = sorted.data() + offsets[a], *end = sorted.data() + offsets[a + 1];
+        std::sort(bucket, end);
+        while (bucket != end) {
+            uint64_t *run = bucket;
+            while (run != end && (*run >> 32) == (*bucket >> 32))
+                ++run;
+            const int32_t h0 = int32_t(*bucket), count = run - bucket;
+            const bool degenerate = (*bucket >> 32) == uint64_t(a);
+            if (count == 1 && !degenerate) {
+                mesh.twins_[h0] = border;
+                n_border++;
+            } else if (count == 2 && !degenerate &&
+                       indices[h0] != indices[int32_t(bucket[1])]) {
+                mesh.twins_[h0] = int32_t(bucket[1]);
+                mesh.twins_[int32_t(bucket[1])] = h0;
+            } else {
+                for (uint64_t *e = bucket; e != run; ++e)
+                    mesh.twins_[int32_t(*e)] = non_manifold;
+                n_non_manifold++;
+            }
+            bucket = run;
+        }
+    }
+    mesh.n_border_edges_ = n_border;
+    mesh.n_non_manifold_edges_ = n_non_manifold;
+
+    /* Smallest leaving half-edge of every vertex, border ones first,
+     * by an atomic minimum on (not border, half-edge).
+     */
+    std::unique_ptr<std::atomic<uint32_t>[]> first(new std::atomic<uint32_t>[n_vertices]);
+#pragma omp parallel for schedule(static)
+    for (long v = 0; v < n_v; ++v)
+        first[v].store(UINT32_MAX, std::memory_order_relaxed);
+#pragma omp parallel for schedule(static)
+    for (long h = 0; h < n; ++h) {
+        const uint32_t key = uint32_t(mesh.twins_[h] != border) << 31 | uint32_t(h);
+        std::atomic<uint32_t> &slot = first[indices[h]];
+        uint32_t current = slot.load(std::memory_order_relaxed);
+        while (key < current && !slot.compare_exchange_weak(current, key, std::memory_order_relaxed));
+    }
+    mesh.vertex_half_edges_.resize(n_vertices);
+#pragma omp parallel for schedule(static)
+    for (long v = 0; v < n_v; ++v) {
+        const uint32_t key = first[v].load(std::memory_order_relaxed);
+        mesh.vertex_half_edges_[v] = key == UINT32_MAX ? -1 : int32_t(key & INT32_MAX);
+    }
+    return mesh;
+}
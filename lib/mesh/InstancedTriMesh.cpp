@@ -0,0 +1,93 @@
+#include "cgcl/mesh/InstancedTriMesh.h"
+#include "cgcl/utils/logging.h"
+
+#include <glad/glad.h>
+
+using namespace cgcl;
+
+
+InstanceData InstanceData::make(const glm::mat4 &model, const PhongMaterial &material) {
+    InstanceData instance;
+    instance.model_ = model;
+    instance.normal_matrix_ = glm::mat3(glm::transpose(glm::inverse(model)));
+    instance.Ka_ = material.Ka_;
+    instance.Kd_ = material.Kd_;
+    instance.Ks_ = material.Ks_;
+    instance.decay_ = material.decay_;
+    return instance;
+}
+
+void InstanceData::setAttributes() {
+    /* mat4 model takes location 3 ~ 6, one column each. */
+    for (int i = 0; i < 4; ++i) {
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void *)(offsetof(InstanceData, model_) + i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + i, 1);
+    }
+    /* mat3 normal matrix takes location 7 ~ 9. */
+    for (int i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(7 + i);
+        glVertexAttribPointer(7 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void *)(offsetof(InstanceData, normal_matrix_) + i * sizeof(glm::vec3)));
+        glVertexAttribDivisor(7 + i, 1);
+    }
+    /* set material Ka, Kd, Ks and highlight decay */
+    glEnableVertexAttribArray(10);
+    glVertexAttribPointer(10, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, Ka_));
+    glVertexAttribDivisor(10, 1);
+    glEnableVertexAttribArray(11);
+    glVertexAttribPointer(11, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, Kd_));
+    glVertexAttribDivisor(11, 1);
+    glEnableVertexAttribArray(12);
+    glVertexAttribPointer(12, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, Ks_));
+    glVertexAttribDivisor(12, 1);
+    glEnableVertexAttribArray(13);
+    glVertexAttribPointer(13, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, decay_));
+    glVertexAttribDivisor(13, 1);
+}
+
+void InstancedTriMesh::initGL() {
+    TriMesh::initGL();
+    LOG(INFO) << "Total Instances: " << instances_.size();
+
+    glGenBuffers(1, &instance_VBO_);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_VBO_);
+    instance_capacity_ = instances_.size();
+    glBufferData(GL_ARRAY_BUFFER, instance_capacity_ * sizeof(InstanceData),
+                 instances_.data(), GL_DYNAMIC_DRAW);
+
+    InstanceData::setAttributes();
+
+    /* Unbind VAO */
+    glBindVertexArray(0);
+}
+
+void InstancedTriMesh::updateInstances() {
+    glBindBuffer(GL_ARRAY_BUFFER, instance_VBO_);
+    if (instances_.size() > instance_capacity_) {
+        instance_capacity_ = instances_.size();
+        glBufferData(GL_ARRAY_BUFFER, instance_capacity_ * sizeof(InstanceData),
+                     instances_.data(), GL_DYNAMIC_DRAW);
+    } else {
+        /* Orphan the old storage, so the driver does not wait for
+         * the draw of last frame still reading it.
+         */
+        glBufferData(GL_ARRAY_BUFFER, instance_capacity_ * sizeof(InstanceData),
+                     nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances_.size() * sizeof(InstanceData),
+                        instances_.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstancedTriMesh::draw() {
+    glDrawElementsInstanced(GL_TRIANGLES, global_indices_.size(), GL_UNSIGNED_INT, 0,
+                            instances_.size());
+}
+
+void InstancedTriMesh::finishGL() {
+    glDeleteBuffers(1, &instance_VBO_);
+    TriMesh::finishGL();
+}
@@ -10,4 +10,16 @@ void Mesh::render() {
     cgcl_unreachable("Not Implemented render()");
 }
 
+unsigned int Mesh::vertexArray() const {
+    return 0;
+}
+
+void Mesh::draw() {
+    render();
+}
 
+void Mesh::updateUniforms(GLShader &) const {}
+
+void Mesh::drawMaterials(GLShader &) {
+    draw();
+}
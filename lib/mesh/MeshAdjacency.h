@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/* Connectivity helpers shared by the mesh processing sources,
+ * not part of the installed headers.
+ */
+
+namespace cgcl {
+
+
+/// \brief Inclusive prefix sum in place, in blocks scanned in parallel.
+template <typename T>
+inline void prefix_sum(T *values, size_t n) {
+    constexpr long n_blocks = 64;
+    const size_t block = (n + n_blocks - 1) / n_blocks;
+    T totals[n_blocks + 1] = {0};
+#pragma omp parallel for schedule(static) if (n > 65536)
+    for (long b = 0; b < n_blocks; ++b) {
+        const size_t begin = std::min(n, b * block), end = std::min(n, begin + block);
+        for (size_t i = begin + 1; i < end; ++i)
+            values[i] += values[i - 1];
+        totals[b + 1] = end > begin ? values[end - 1] : 0;
+    }
+    for (long b = 0; b < n_blocks; ++b)
+        totals[b + 1] += totals[b];
+#pragma omp parallel for schedule(static) if (n > 65536)
+    for (long b = 1; b < n_blocks; ++b) {
+        const size_t begin = std::min(n, b * block), end = std::min(n, begin + block);
+        for (size_t i = begin; i < end; ++i)
+            values[i] += totals[b];
+    }
+}
+
+/// \brief Corners around every vertex in CSR form, corner 3 * t + k is
+/// corner k of triangle t. Filled by atomic counters, then each list is
+/// sorted so sums over it run in a fixed order.
+struct VertexCorners {
+    std::vector<unsigned int> offsets_;
+    std::vector<unsigned int> corners_;
+
+    VertexCorners(const unsigned int *indices, size_t n_indices, size_t n_vertices)
+        : offsets_(n_vertices + 1, 0), corners_(n_indices) {
+        const long n = n_indices;
+#pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; ++i) {
+#pragma omp atomic
+            offsets_[indices[i] + 1]++;
+        }
+        prefix_sum(offsets_.data(), offsets_.size());
+        std::vector<unsigned int> cursor(offsets_.begin(), offsets_.end() - 1);
+#pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; ++i) {
+            unsigned int slot;
+#pragma omp atomic capture
+            slot = cursor[indices[i]]++;
+            corners_[slot] = i;
+        }
+        const long n_v = n_vertices;
+#pragma omp parallel for schedule(dynamic, 4096)
+        for (long v = 0; v < n_v; ++v)
+            std::sort(corners_.begin() + offsets_[v], corners_.begin() + offsets_[v + 1]);
+    }
+    unsigned int count(unsigned int v) const { return offsets_[v + 1] - offsets_[v]; }
+};
+
+} // end namespace cgcl
@@ -0,0 +1,377 @@
+#include "cgcl/mesh/MeshCodec.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+/* The SSSE3 decoder is built on any x86 target and picked at run time,
+ * so default builds get it without -mssse3.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define CGCL_MESHCODEC_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+using namespace cgcl;
+
+
+/* Values per independently decoded block. */
+static constexpr size_t index_block = 1 << 14;
+static constexpr size_t vertex_block = 1 << 13;
+/* Streams end with this many spare bytes, so 16-byte loads near
+ * the end stay in bounds.
+ */
+static constexpr size_t tail_padding = 16;
+
+static inline uint32_t zigzag(int32_t v) { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+static inline int32_t unzigzag(uint32_t v) { return int32_t(v >> 1) ^ -int32_t(v & 1); }
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t v) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &v, 4);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+/// \brief Block table: the number of blocks, then n_blocks + 1 byte
+/// offsets from the start of the stream. Block b spans offsets b to
+/// b + 1, checked to be in order and within the stream.
+static size_t read_block_table(const uint8_t *data, size_t size, size_t n_blocks) {
+    CHECK_LE(n_blocks, size / 4) << "Truncated mesh stream";
+    const size_t table_end = 4 + 4 * (n_blocks + 1);
+    CHECK_GE(size, table_end + tail_padding) << "Truncated mesh stream";
+    CHECK_EQ(get_u32(data), n_blocks) << "Mesh stream does not match the buffer size";
+    size_t previous = table_end;
+    for (size_t b = 0; b <= n_blocks; ++b) {
+        const size_t offset = get_u32(data + 4 + 4 * b);
+        CHECK(offset >= previous && offset <= size - tail_padding) << "Corrupt mesh stream";
+        previous = offset;
+    }
+    return table_end;
+}
+
+// ---------------------------------------------------------------------------
+// Index buffer
+// ---------------------------------------------------------------------------
+
+static inline unsigned int byte_length(uint32_t v) {
+    return v < (1u << 8) ? 1 : v < (1u << 16) ? 2 : v < (1u << 24) ? 3 : 4;
+}
+
+std::vector<uint8_t> cgcl::encode_index_buffer(const unsigned int *indices, size_t n_indices) {
+    const size_t n_blocks = (n_indices + index_block - 1) / index_block;
+    std::vector<uint8_t> out;
+    put_u32(out, n_blocks);
+    const size_t table = out.size();
+    out.resize(table + 4 * (n_blocks + 1));
+
+    for (size_t b = 0; b < n_blocks; ++b) {
+        uint32_t offset = out.size();
+        std::memcpy(&out[table + 4 * b], &offset, 4);
+        const size_t begin = b * index_block, end = std::min(n_indices, begin + index_block);
+        const size_t n = end - begin;
+        /* Control bytes first, data bytes after. */
+        size_t control = out.size();
+        out.resize(control + (n + 3) / 4, 0);
+        uint32_t previous = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t value = zigzag(int32_t(indices[begin + i] - previous));
+            previous = indices[begin + i];
+            unsigned int length = byte_length(value);
+            out[control + i / 4] |= (length - 1) << (2 * (i % 4));
+            uint8_t bytes[4];
+            std::memcpy(bytes, &value, 4);
+            out.insert(out.end(), bytes, bytes + length);
+        }
+    }
+    uint32_t end = out.size();
+    std::memcpy(&out[table + 4 * n_blocks], &end, 4);
+    out.resize(out.size() + tail_padding, 0);
+    return out;
+}
+
+#ifdef CGCL_MESHCODEC_SSSE3
+/// \brief pshufb masks spreading the data bytes of 4 values to 4 lanes,
+/// and the data bytes used, for each control byte.
+struct StreamVByteTables {
+    alignas(16) uint8_t shuffle[256][16];
+    uint8_t length[256];
+
+    StreamVByteTables() {
+        for (int c = 0; c < 256; ++c) {
+            int byte = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                int n = ((c >> (2 * lane)) & 3) + 1;
+                for (int k = 0; k < 4; ++k)
+                    shuffle[c][4 * lane + k] = k < n ? byte + k : 0x80;
+                byte += n;
+            }
+            length[c] = byte;
+        }
+    }
+};
+static const StreamVByteTables svb_tables;
+#endif
+
+/// \brief Values i to n of a block one by one, data at value i.
+static void decode_index_scalar(const uint8_t *control, const uint8_t *data, unsigned int *out, size_t i, size_t n,
+                                uint32_t previous) {
+    for (; i < n; ++i) {
+        unsigned int length = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        uint32_t value = 0;
+        std::memcpy(&value, data, length);
+        data += length;
+        previous += uint32_t(unzigzag(value));
+        out[i] = previous;
+    }
+}
+
+#ifdef CGCL_MESHCODEC_SSSE3
+__attribute__((target("ssse3")))
+static void decode_index_block_ssse3(const uint8_t *control, const uint8_t *data, unsigned int *out, size_t n) {
+    size_t i = 0;
+    __m128i carry = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    for (; i + 4 <= n; i += 4) {
+        const uint8_t c = control[i / 4];
+        __m128i bytes = _mm_loadu_si128((const __m128i *)data);
+        __m128i v = _mm_shuffle_epi8(bytes, _mm_load_si128((const __m128i *)svb_tables.shuffle[c]));
+        data += svb_tables.length[c];
+        /* Undo zigzag, then an inclusive prefix sum across the 4 lanes. */
+        v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        _mm_storeu_si128((__m128i *)(out + i), v);
+        carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    decode_index_scalar(control, data, out, i, n, uint32_t(_mm_cvtsi128_si32(carry)));
+}
+#endif
+
+static void decode_index_block(const uint8_t *control, const uint8_t *data, unsigned int *out, size_t n) {
+#ifdef CGCL_MESHCODEC_SSSE3
+    static const bool has_ssse3 = [] {
+        __builtin_cpu_init();
+        return bool(__builtin_cpu_supports("ssse3"));
+    }();
+    if (has_ssse3) {
+        decode_index_block_ssse3(control, data, out, n);
+        return;
+    }
+#endif
+    decode_index_scalar(control, data, out, 0, n, 0);
+}
+
+/// \brief Data bytes of the 4 indices of every control byte.
+struct ControlLengths {
+    uint8_t sum[256];
+
+    ControlLengths() {
+        for (int c = 0; c < 256; ++c)
+            sum[c] = (c & 3) + ((c >> 2) & 3) + ((c >> 4) & 3) + ((c >> 6) & 3) + 4;
+    }
+};
+static const ControlLengths control_lengths;
+
+/// \brief Data bytes of the n indices of a block, from its control bytes.
+static size_t index_data_length(const uint8_t *control, size_t n) {
+    size_t length = 0;
+    for (size_t k = 0; k < n / 4; ++k)
+        length += control_lengths.sum[control[k]];
+    for (size_t i = n / 4 * 4; i < n; ++i)
+        length += ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    return length;
+}
+
+size_t cgcl::min_index_buffer_size(size_t n_indices) {
+    /* A control byte for 4 indices and at least a data byte each. */
+    return n_indices + (n_indices + 3) / 4 + tail_padding;
+}
+
+void cgcl::decode_index_buffer(const uint8_t *data, size_t size, unsigned int *indices, size_t n_indices,
+                               size_t n_vertices) {
+    CHECK_GE(size, min_index_buffer_size(n_indices)) << "Truncated index stream";
+    const size_t n_blocks = (n_indices + index_block - 1) / index_block;
+    read_block_table(data, size, n_blocks);
+#pragma omp parallel for schedule(dynamic, 1) if (n_blocks > 1)
+    for (long b = 0; b < long(n_blocks); ++b) {
+        const size_t begin = b * index_block, n = std::min(n_indices, begin + index_block) - begin;
+        const size_t block_begin = get_u32(data + 4 + 4 * b), block_size = get_u32(data + 8 + 4 * b) - block_begin;
+        const uint8_t *control = data + block_begin;
+        CHECK_LE((n + 3) / 4, block_size) << "Corrupt index stream";
+        CHECK_LE((n + 3) / 4 + index_data_length(control, n), block_size) << "Corrupt index stream";
+        unsigned int *out = indices + begin;
+        decode_index_block(control, control + (n + 3) / 4, out, n);
+        unsigned int max_index = 0;
+#pragma omp simd reduction(max : max_index)
+        for (size_t i = 0; i < n; ++i)
+            max_index = std::max(max_index, out[i]);
+        CHECK_LT(max_index, n_vertices) << "Index out of range in index stream";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Vertex buffer
+// ---------------------------------------------------------------------------
+
+/* Bits per value of a group for each 2-bit selector. */
+static const unsigned int group_bits[4] = {0, 2, 4, 8};
+
+/// \brief Bit-pack one byte plane of n values in groups of 16.
+static void encode_plane(const uint8_t *plane, size_t n, std::vector<uint8_t> &out) {
+    const size_t n_groups = (n + 15) / 16;
+    size_t header = out.size();
+    out.resize(header + (n_groups + 3) / 4, 0);
+    for (size_t g = 0; g < n_groups; ++g) {
+        uint8_t group[16] = {0};
+        std::memcpy(group, plane + 16 * g, std::min<size_t>(16, n - 16 * g));
+        uint8_t max = *std::max_element(group, group + 16);
+        unsigned int selector = max == 0 ? 0 : max < 4 ? 1 : max < 16 ? 2 : 3;
+        out[header + g / 4] |= selector << (2 * (g % 4));
+        const unsigned int bits = group_bits[selector];
+        if (bits == 0) continue;
+        const unsigned int per_byte = 8 / bits;
+        for (int k = 0; k < 16; k += per_byte) {
+            uint8_t packed = 0;
+            for (unsigned int j = 0; j < per_byte; ++j)
+                packed |= group[k + j] << (bits * j);
+            out.push_back(packed);
+        }
+    }
+}
+
+/// \brief Bytes taken by a plane of n values, header included, at most
+/// size if it fits in size bytes from in, more otherwise.
+static size_t plane_length(const uint8_t *in, size_t size, size_t n) {
+    const size_t n_groups = (n + 15) / 16, n_header = (n_groups + 3) / 4;
+    if (n_header > size) return n_header;
+    /* A group of b bits per value takes 2 * b bytes. */
+    size_t length = 0;
+    for (size_t g = 0; g < n_groups; ++g)
+        length += 2 * group_bits[(in[g / 4] >> (2 * (g % 4))) & 3];
+    return n_header + length;
+}
+
+/// \brief Inverse of encode_plane, return the end of the plane.
+static const uint8_t *decode_plane(const uint8_t *in, size_t n, uint8_t *plane) {
+    const size_t n_groups = (n + 15) / 16;
+    const uint8_t *header = in;
+    in += (n_groups + 3) / 4;
+    for (size_t g = 0; g < n_groups; ++g) {
+        uint8_t *group = plane + 16 * g;
+        switch ((header[g / 4] >> (2 * (g % 4))) & 3) {
+        case 0:
+            std::memset(group, 0, 16);
+            break;
+        case 1:
+#pragma omp simd
+            for (int k = 0; k < 16; ++k)
+                group[k] = (in[k / 4] >> (2 * (k % 4))) & 3;
+            in += 4;
+            break;
+        case 2:
+#pragma omp simd
+            for (int k = 0; k < 16; ++k)
+                group[k] = (in[k / 2] >> (4 * (k % 2))) & 15;
+            in += 8;
+            break;
+        default:
+            std::memcpy(group, in, 16);
+            in += 16;
+            break;
+        }
+    }
+    return in;
+}
+
+std::vector<uint8_t> cgcl::encode_vertex_buffer(const void *vertices, size_t n_vertices, size_t stride) {
+    CHECK_EQ(stride % 4, 0u) << "Vertex stride must be a multiple of 4";
+    const size_t n_words = stride / 4;
+    const size_t n_blocks = (n_vertices + vertex_block - 1) / vertex_block;
+    const uint8_t *bytes = static_cast<const uint8_t *>(vertices);
+    std::vector<uint8_t> out;
+    put_u32(out, n_blocks);
+    const size_t table = out.size();
+    out.resize(table + 4 * (n_blocks + 1));
+
+    std::vector<uint8_t> planes(4 * vertex_block);
+    for (size_t b = 0; b < n_blocks; ++b) {
+        uint32_t offset = out.size();
+        std::memcpy(&out[table + 4 * b], &offset, 4);
+        const size_t begin = b * vertex_block, n = std::min(n_vertices, begin + vertex_block) - begin;
+        for (size_t w = 0; w < n_words; ++w) {
+            uint32_t previous = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t word = get_u32(bytes + (begin + i) * stride + 4 * w);
+                uint32_t delta = zigzag(int32_t(word - previous));
+                previous = word;
+                for (int p = 0; p < 4; ++p)
+                    planes[p * vertex_block + i] = delta >> (8 * p);
+            }
+            for (int p = 0; p < 4; ++p)
+                encode_plane(&planes[p * vertex_block], n, out);
+        }
+    }
+    uint32_t end = out.size();
+    std::memcpy(&out[table + 4 * n_blocks], &end, 4);
+    out.resize(out.size() + tail_padding, 0);
+    return out;
+}
+
+size_t cgcl::min_vertex_buffer_size(size_t n_vertices, size_t stride) {
+    /* Every byte plane has a selector byte per 64 values, even when all
+     * its groups are 0.
+     */
+    return stride * ((n_vertices + 63) / 64) + tail_padding;
+}
+
+void cgcl::decode_vertex_buffer(const uint8_t *data, size_t size, void *vertices, size_t n_vertices, size_t stride) {
+    CHECK_EQ(stride % 4, 0u) << "Vertex stride must be a multiple of 4";
+    CHECK_GE(size, min_vertex_buffer_size(n_vertices, stride)) << "Truncated vertex stream";
+    const size_t n_words = stride / 4;
+    const size_t n_blocks = (n_vertices + vertex_block - 1) / vertex_block;
+    read_block_table(data, size, n_blocks);
+    uint8_t *bytes = static_cast<uint8_t *>(vertices);
+
+#pragma omp parallel if (n_blocks > 1)
+    {
+        /* Groups are decoded whole, planes have room for the last one. */
+        const size_t plane_size = vertex_block + 16;
+        std::vector<uint8_t> planes(4 * plane_size);
+        std::vector<uint32_t> words(vertex_block);
+#pragma omp for schedule(dynamic, 1)
+        for (long b = 0; b < long(n_blocks); ++b) {
+            const size_t begin = b * vertex_block, n = std::min(n_vertices, begin + vertex_block) - begin;
+            const uint8_t *in = data + get_u32(data + 4 + 4 * b);
+            const uint8_t *block_end = data + get_u32(data + 8 + 4 * b);
+            const uint8_t *plane[4];
+            for (int p = 0; p < 4; ++p)
+                plane[p] = &planes[p * plane_size];
+            for (size_t w = 0; w < n_words; ++w) {
+                for (int p = 0; p < 4; ++p) {
+                    CHECK_LE(plane_length(in, block_end - in, n), size_t(block_end - in)) << "Corrupt vertex stream";
+                    in = decode_plane(in, n, &planes[p * plane_size]);
+                }
+                /* Gather planes and undo zigzag, this vectorizes. */
+#pragma omp simd
+                for (size_t i = 0; i < n; ++i) {
+                    uint32_t v = plane[0][i] | uint32_t(plane[1][i]) << 8 |
+                                 uint32_t(plane[2][i]) << 16 | uint32_t(plane[3][i]) << 24;
+                    words[i] = uint32_t(unzigzag(v));
+                }
+                uint32_t previous = 0;
+                uint8_t *out = bytes + begin * stride + 4 * w;
+                for (size_t i = 0; i < n; ++i) {
+                    previous += words[i];
+                    std::memcpy(out + i * stride, &previous, 4);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,231 @@
+#include "cgcl/mesh/MeshOptimizer.h"
+#include "cgcl/utils/logging.h"
+#include "MeshAdjacency.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace cgcl;
+
+
+/// \brief FIFO cache by time stamps, a vertex is cached when at most
+/// cache_size misses happened since it was loaded.
+struct FIFOCache {
+    std::vector<unsigned int> time_;
+    unsigned int now_;
+    unsigned int size_;
+
+    FIFOCache(size_t n_vertices, unsigned int cache_size)
+        : time_(n_vertices, 0), now_(cache_size + 1), size_(cache_size) {}
+
+    bool cached(unsigned int v) const { return now_ - time_[v] <= size_; }
+    /// \brief Returns 1 on a miss.
+    unsigned int access(unsigned int v) {
+        if (cached(v)) return 0;
+        time_[v] = now_++;
+        return 1;
+    }
+    void flush() { now_ += size_ + 1; }
+};
+
+VertexCacheStats cgcl::analyze_vertex_cache(const unsigned int *indices, size_t n_indices,
+                                            size_t n_vertices, unsigned int cache_size) {
+    CHECK_EQ(n_indices % 3, 0u) << "Not a triangle list";
+    VertexCacheStats stats;
+    stats.n_triangles = n_indices / 3;
+    FIFOCache cache(n_vertices, cache_size);
+    std::vector<bool> used(n_vertices, false);
+    for (size_t i = 0; i < n_indices; ++i) {
+        unsigned int v = indices[i];
+        stats.n_transformed += cache.access(v);
+        if (!used[v]) {
+            used[v] = true;
+            stats.n_vertices++;
+        }
+    }
+    return stats;
+}
+
+void cgcl::optimize_vertex_cache(unsigned int *indices, size_t n_indices, size_t n_vertices,
+                                 unsigned int cache_size, std::vector<unsigned int> *clusters) {
+    CHECK_EQ(n_indices % 3, 0u) << "Not a triangle list";
+    if (clusters) clusters->clear();
+    if (n_indices == 0) return;
+    const size_t n_triangles = n_indices / 3;
+    const VertexCorners adjacency(indices, n_indices, n_vertices);
+
+    std::vector<unsigned int> live(n_vertices);
+    for (size_t v = 0; v < n_vertices; ++v)
+        live[v] = adjacency.count(v);
+    std::vector<unsigned int> time(n_vertices, 0);
+    std::vector<bool> emitted(n_triangles, false);
+    std::vector<unsigned int> dead_end;
+    dead_end.reserve(n_indices);
+    std::vector<unsigned int> output;
+    output.reserve(n_indices);
+    std::vector<unsigned int> candidates;
+
+    const int k = cache_size;
+    unsigned int now = cache_size + 1;
+    size_t cursor = 0;
+    long fan = 0;
+    while (cursor < n_vertices && live[cursor] == 0) ++cursor;
+    fan = cursor;
+    if (clusters) clusters->push_back(0);
+    while (fan >= 0) {
+        /* Emit every remaining triangle around the fanning vertex. */
+        candidates.clear();
+        for (unsigned int a = adjacency.offsets_[fan]; a < adjacency.offsets_[fan + 1]; ++a) {
+            unsigned int t = adjacency.corners_[a] / 3;
+            if (emitted[t]) continue;
+            emitted[t] = true;
+            for (int c = 0; c < 3; ++c) {
+                unsigned int v = indices[3 * t + c];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (now - time[v] > cache_size) time[v] = now++;
+            }
+        }
+
+        /* Next fanning vertex is the candidate that stays longest in the
+         * cache after its own triangles are emitted.
+         */
+        long next = -1;
+        int best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) continue;
+            int priority = 0;
+            int age = now - time[v];
+            if (age + 2 * int(live[v]) <= k) priority = age;
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+        if (next < 0) {
+            /* Dead end, try recently used vertices, then scan in order. */
+            while (!dead_end.empty()) {
+                unsigned int v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                    break;
+                }
+            }
+            if (next < 0) {
+                while (cursor < n_vertices && live[cursor] == 0) ++cursor;
+                if (cursor < n_vertices) next = cursor;
+            }
+            if (next >= 0 && clusters) clusters->push_back(output.size());
+        }
+        fan = next;
+    }
+    CHECK_EQ(output.size(), n_indices);
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void cgcl::optimize_overdraw(unsigned int *indices, size_t n_indices, const Vertex *vertices,
+                             size_t n_vertices, const std::vector<unsigned int> &clusters,
+                             unsigned int cache_size, float threshold) {
+    if (n_indices == 0 || clusters.empty()) return;
+
+    /* Split hard clusters where the ACMR so far drops to
+     * the cluster ACMR times threshold, flushing the cache there.
+     */
+    std::vector<unsigned int> starts;
+    FIFOCache cache(n_vertices, cache_size);
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        const size_t begin = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : n_indices;
+        unsigned int misses = 0;
+        cache.flush();
+        for (size_t i = begin; i < end; ++i)
+            misses += cache.access(indices[i]);
+        const float limit = float(misses) / ((end - begin) / 3) * threshold;
+
+        cache.flush();
+        size_t start = begin;
+        misses = 0;
+        starts.push_back(begin);
+        for (size_t i = begin; i < end; i += 3) {
+            misses += cache.access(indices[i]) + cache.access(indices[i + 1]) + cache.access(indices[i + 2]);
+            if (i + 3 < end && float(misses) / ((i + 3 - start) / 3) <= limit) {
+                start = i + 3;
+                starts.push_back(start);
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    /* Area weighted centroid and normal of every cluster. */
+    const size_t n_clusters = starts.size();
+    starts.push_back(n_indices);
+    std::vector<glm::vec3> centroids(n_clusters), normals(n_clusters);
+    std::vector<float> areas(n_clusters);
+    glm::vec3 mesh_center(0.0f);
+    float mesh_area = 0.0f;
+#pragma omp parallel for schedule(dynamic, 64) reduction(+ : mesh_area)
+    for (long c = 0; c < long(n_clusters); ++c) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t i = starts[c]; i < starts[c + 1]; i += 3) {
+            const glm::vec3 &p0 = vertices[indices[i]].position_;
+            const glm::vec3 &p1 = vertices[indices[i + 1]].position_;
+            const glm::vec3 &p2 = vertices[indices[i + 2]].position_;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        centroids[c] = area > 0.0f ? centroid / area : vertices[indices[starts[c]]].position_;
+        normals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f);
+        areas[c] = area;
+        mesh_area += area;
+    }
+    for (size_t c = 0; c < n_clusters; ++c)
+        mesh_center += centroids[c] * (mesh_area > 0.0f ? areas[c] / mesh_area : 1.0f / n_clusters);
+
+    /* Outer clusters first, they are likely to occlude the inner ones. */
+    std::vector<float> sort_key(n_clusters);
+    for (size_t c = 0; c < n_clusters; ++c)
+        sort_key[c] = glm::dot(centroids[c] - mesh_center, normals[c]);
+    std::vector<unsigned int> order(n_clusters);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](unsigned int a, unsigned int b) { return sort_key[a] > sort_key[b]; });
+
+    std::vector<unsigned int> output(n_indices);
+    size_t written = 0;
+    for (unsigned int c : order) {
+        std::copy(indices + starts[c], indices + starts[c + 1], output.begin() + written);
+        written += starts[c + 1] - starts[c];
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void cgcl::optimize_vertex_fetch(std::vector<Vertex> &vertices, unsigned int *indices, size_t n_indices,
+                                 std::vector<unsigned int> *remap_out) {
+    const size_t n_vertices = vertices.size();
+    constexpr unsigned int unused = UINT_MAX;
+    std::vector<unsigned int> remap(n_vertices, unused);
+    unsigned int next = 0;
+    for (size_t i = 0; i < n_indices; ++i) {
+        unsigned int &slot = remap[indices[i]];
+        if (slot == unused) slot = next++;
+        indices[i] = slot;
+    }
+    for (size_t v = 0; v < n_vertices; ++v) {
+        if (remap[v] == unused) remap[v] = next++;
+    }
+
+    std::vector<Vertex> reordered(n_vertices);
+#pragma omp parallel for schedule(static)
+    for (long v = 0; v < long(n_vertices); ++v)
+        reordered[remap[v]] = vertices[v];
+    vertices = std::move(reordered);
+    if (remap_out) *remap_out = std::move(remap);
+}
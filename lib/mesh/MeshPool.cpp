@@ -0,0 +1,137 @@
+#include "cgcl/mesh/MeshPool.h"
+#include "cgcl/utils/logging.h"
+
+#include <glad/glad.h>
+
+using namespace cgcl;
+
+
+unsigned int MeshPool::add(const TriMesh &mesh) {
+    CHECK(!need_rendering_) << "Add meshes to the pool before initGL()";
+    const unsigned int id = entries_.size();
+    const uint32_t index_base = indices_.size();
+    const int32_t base_vertex = vertices_.size();
+    vertices_.insert(vertices_.end(), mesh.global_vertices_.begin(), mesh.global_vertices_.end());
+    indices_.insert(indices_.end(), mesh.global_indices_.begin(), mesh.global_indices_.end());
+    if (mesh.offsets_.empty()) {
+        entries_.push_back({index_base, uint32_t(mesh.global_indices_.size()), base_vertex});
+    } else {
+        for (size_t k = 0; k < mesh.offsets_.size(); ++k)
+            entries_.push_back({index_base + mesh.offsets_[k], mesh.counts_[k], base_vertex});
+    }
+    return id;
+}
+
+void MeshPool::clearDraws() {
+    commands_.clear();
+    instances_.clear();
+}
+
+void MeshPool::addDraw(unsigned int first_entry, const InstanceData &instance, unsigned int count) {
+    CHECK_LE(first_entry + count, entries_.size()) << "Entry out of range";
+    const uint32_t instance_index = instances_.size();
+    instances_.push_back(instance);
+    if (count == 1 && !commands_.empty()) {
+        const Entry &range = entries_[first_entry];
+        auto &last = commands_.back();
+        if (last.first_index == range.first_index && last.count == range.index_count &&
+            last.base_vertex == range.base_vertex &&
+            last.base_instance + last.instance_count == instance_index) {
+            last.instance_count++;
+            return;
+        }
+    }
+    for (unsigned int k = first_entry; k < first_entry + count; ++k) {
+        const Entry &range = entries_[k];
+        commands_.push_back({range.index_count, 1, range.first_index, range.base_vertex, instance_index});
+    }
+}
+
+/// \brief Upload data to buffer, growing it when needed and
+/// orphaning the old storage otherwise.
+static void upload(GLenum target, unsigned int buffer, size_t &capacity, const void *data, size_t size) {
+    glBindBuffer(target, buffer);
+    if (size > capacity) {
+        capacity = size;
+        glBufferData(target, capacity, data, GL_DYNAMIC_DRAW);
+    } else {
+        glBufferData(target, capacity, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(target, 0, size, data);
+    }
+    glBindBuffer(target, 0);
+}
+
+void MeshPool::updateDraws() {
+    upload(GL_ARRAY_BUFFER, instance_VBO_, instance_capacity_,
+           instances_.data(), instances_.size() * sizeof(InstanceData));
+    upload(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_, command_capacity_,
+           commands_.data(), commands_.size() * sizeof(DrawElementsIndirectCommand));
+}
+
+void MeshPool::initGL() {
+    CHECK(GLAD_GL_VERSION_4_2) << "MeshPool requires OpenGL 4.2";
+    LOG(INFO) << "MeshPool Init: ";
+    LOG(INFO) << "Total Vertex: " << vertices_.size();
+    LOG(INFO) << "Total Indices: " << indices_.size();
+    LOG(INFO) << "Total Entries: " << entries_.size();
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenBuffers(1, &instance_VBO_);
+    glGenBuffers(1, &indirect_buffer_);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), vertices_.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned int),
+                 indices_.data(), GL_STATIC_DRAW);
+
+    /* Same vertex layout as TriMesh. */
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal_));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texture_coords_));
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_VBO_);
+    InstanceData::setAttributes();
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    need_rendering_ = true;
+}
+
+void MeshPool::render() {
+    glBindVertexArray(VAO);
+    draw();
+    glBindVertexArray(0);
+}
+
+void MeshPool::draw() {
+    if (commands_.empty()) return;
+    if (GLAD_GL_VERSION_4_3) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                    commands_.size(), sizeof(DrawElementsIndirectCommand));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return;
+    }
+    for (const auto &command : commands_) {
+        glDrawElementsInstancedBaseVertexBaseInstance(
+            GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+            (void *)(size_t(command.first_index) * sizeof(unsigned int)),
+            command.instance_count, command.base_vertex, command.base_instance);
+    }
+}
+
+void MeshPool::finishGL() {
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &instance_VBO_);
+    glDeleteBuffers(1, &indirect_buffer_);
+    glDeleteVertexArrays(1, &VAO);
+    need_rendering_ = false;
+}
@@ -0,0 +1,231 @@
+#include "cgcl/mesh/Meshlet.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cgcl;
+
+
+/* Triangles per build task, a chunk boundary always starts a meshlet,
+ * so the chunks and not the threads decide the result.
+ */
+static constexpr uint32_t chunk_triangles = 1 << 14;
+/* Normals spread wider than acos of this give no cone. */
+static constexpr float min_cone_spread = 0.1f;
+
+namespace {
+
+struct Chunk {
+    uint32_t first_triangle, n_triangles;
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles;
+};
+
+} // end anonymous namespace
+
+/// \brief Greedy scan, a meshlet is closed when the next triangle
+/// would exceed either limit.
+static void build_chunk(const unsigned int *indices, Chunk &chunk) {
+    Meshlet current{0, chunk.first_triangle, 0, 0};
+    uint32_t local[MeshletSet::max_vertices];
+    auto close = [&]() {
+        if (current.triangle_count == 0) return;
+        chunk.meshlets.push_back(current);
+        current.vertex_offset = chunk.vertices.size();
+        current.triangle_offset += current.triangle_count;
+        current.vertex_count = current.triangle_count = 0;
+    };
+    for (uint32_t t = chunk.first_triangle; t < chunk.first_triangle + chunk.n_triangles; ++t) {
+        unsigned int n_new = 0;
+        for (int c = 0; c < 3; ++c) {
+            unsigned int v = indices[3 * t + c];
+            bool known = std::find(local, local + current.vertex_count, v) != local + current.vertex_count;
+            /* A vertex repeated inside the triangle counts once. */
+            for (int d = 0; d < c; ++d)
+                known |= indices[3 * t + d] == v;
+            n_new += !known;
+        }
+        if (current.vertex_count + n_new > MeshletSet::max_vertices ||
+            current.triangle_count + 1u > MeshletSet::max_triangles) {
+            close();
+        }
+        for (int c = 0; c < 3; ++c) {
+            unsigned int v = indices[3 * t + c];
+            int s = std::find(local, local + current.vertex_count, v) - local;
+            if (s == current.vertex_count) {
+                local[current.vertex_count++] = v;
+                chunk.vertices.push_back(v);
+            }
+            chunk.triangles.push_back(s);
+        }
+        current.triangle_count++;
+    }
+    close();
+}
+
+static MeshletBounds compute_bounds(const TriMesh &mesh, const Meshlet &meshlet) {
+    const auto &indices = mesh.global_indices_;
+    const auto &vertices = mesh.global_vertices_;
+    MeshletBounds bounds;
+
+    /* Sphere centered at the box, as TriMesh::computeBounds. */
+    AABB box;
+    for (uint32_t t = meshlet.triangle_offset; t < meshlet.triangle_offset + meshlet.triangle_count; ++t)
+        for (int c = 0; c < 3; ++c)
+            box.expand(vertices[indices[3 * t + c]].position_);
+    const glm::vec3 center = box.center();
+    float radius2 = 0.0f;
+    for (uint32_t t = meshlet.triangle_offset; t < meshlet.triangle_offset + meshlet.triangle_count; ++t) {
+        for (int c = 0; c < 3; ++c) {
+            glm::vec3 d = vertices[indices[3 * t + c]].position_ - center;
+            radius2 = std::max(radius2, glm::dot(d, d));
+        }
+    }
+    bounds.sphere_.center_ = center;
+    bounds.sphere_.radius_ = std::sqrt(radius2);
+
+    /* Cone axis is the mean of unit face normals. */
+    glm::vec3 normals[MeshletSet::max_triangles];
+    glm::vec3 axis(0.0f);
+    int n_normals = 0;
+    for (uint32_t t = meshlet.triangle_offset; t < meshlet.triangle_offset + meshlet.triangle_count; ++t) {
+        const glm::vec3 &p0 = vertices[indices[3 * t]].position_;
+        glm::vec3 n = glm::cross(vertices[indices[3 * t + 1]].position_ - p0,
+                                 vertices[indices[3 * t + 2]].position_ - p0);
+        float length = glm::length(n);
+        if (length == 0.0f) continue;
+        normals[n_normals++] = n / length;
+        axis += n / length;
+    }
+    bounds.cone_axis_ = glm::vec3(0.0f, 0.0f, 1.0f);
+    bounds.cone_apex_ = center;
+    bounds.cone_cutoff_ = 2.0f;
+    if (n_normals == 0 || glm::length(axis) == 0.0f) return bounds;
+    axis = glm::normalize(axis);
+    float min_dot = 1.0f;
+    for (int k = 0; k < n_normals; ++k)
+        min_dot = std::min(min_dot, glm::dot(axis, normals[k]));
+    if (min_dot <= min_cone_spread) return bounds;
+
+    /* Move the apex back along the axis until it is behind every
+     * triangle plane, then a camera outside the cone sees only backs.
+     */
+    float max_t = 0.0f;
+    int k = 0;
+    for (uint32_t t = meshlet.triangle_offset; t < meshlet.triangle_offset + meshlet.triangle_count; ++t) {
+        const glm::vec3 &p0 = vertices[indices[3 * t]].position_;
+        glm::vec3 n = glm::cross(vertices[indices[3 * t + 1]].position_ - p0,
+                                 vertices[indices[3 * t + 2]].position_ - p0);
+        if (glm::length(n) == 0.0f) continue;
+        const glm::vec3 &unit = normals[k++];
+        float along = glm::dot(center - p0, unit) / glm::dot(axis, unit);
+        max_t = std::max(max_t, along);
+    }
+    bounds.cone_apex_ = center - axis * max_t;
+    bounds.cone_axis_ = axis;
+    bounds.cone_cutoff_ = std::sqrt(1.0f - min_dot * min_dot);
+    return bounds;
+}
+
+MeshletSet MeshletSet::build(const TriMesh &mesh) {
+    const uint32_t n_triangles = mesh.global_indices_.size() / 3;
+    /* Cut chunks at sub-mesh starts and every chunk_triangles. */
+    std::vector<uint32_t> starts;
+    if (mesh.offsets_.empty()) {
+        starts.push_back(0);
+    } else {
+        for (size_t k = 0; k < mesh.offsets_.size(); ++k)
+            if (mesh.counts_[k] > 0) starts.push_back(mesh.offsets_[k] / 3);
+    }
+    std::vector<Chunk> chunks;
+    for (size_t k = 0; k < starts.size(); ++k) {
+        uint32_t end = k + 1 < starts.size() ? starts[k + 1] : n_triangles;
+        for (uint32_t first = starts[k]; first < end; first += chunk_triangles) {
+            Chunk chunk;
+            chunk.first_triangle = first;
+            chunk.n_triangles = std::min(chunk_triangles, end - first);
+            chunks.push_back(std::move(chunk));
+        }
+    }
+
+    const long n_chunks = chunks.size();
+#pragma omp parallel for schedule(dynamic, 1)
+    for (long k = 0; k < n_chunks; ++k)
+        build_chunk(mesh.global_indices_.data(), chunks[k]);
+
+    /* Concatenate in chunk order, shifting vertex offsets. */
+    MeshletSet set;
+    std::vector<size_t> meshlet_offsets(n_chunks + 1, 0), vertex_offsets(n_chunks + 1, 0);
+    for (long k = 0; k < n_chunks; ++k) {
+        meshlet_offsets[k + 1] = meshlet_offsets[k] + chunks[k].meshlets.size();
+        vertex_offsets[k + 1] = vertex_offsets[k] + chunks[k].vertices.size();
+    }
+    CHECK_LT(vertex_offsets[n_chunks], size_t(UINT32_MAX)) << "Too many meshlet vertices";
+    set.meshlets_.resize(meshlet_offsets[n_chunks]);
+    set.vertices_.resize(vertex_offsets[n_chunks]);
+    set.triangles_.resize(size_t(n_triangles) * 3);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (long k = 0; k < n_chunks; ++k) {
+        const Chunk &chunk = chunks[k];
+        for (size_t m = 0; m < chunk.meshlets.size(); ++m) {
+            Meshlet meshlet = chunk.meshlets[m];
+            meshlet.vertex_offset += vertex_offsets[k];
+            set.meshlets_[meshlet_offsets[k] + m] = meshlet;
+        }
+        std::copy(chunk.vertices.begin(), chunk.vertices.end(), set.vertices_.begin() + vertex_offsets[k]);
+        std::copy(chunk.triangles.begin(), chunk.triangles.end(),
+                  set.triangles_.begin() + size_t(chunk.first_triangle) * 3);
+    }
+
+    const long n_meshlets = set.meshlets_.size();
+    set.bounds_.resize(n_meshlets);
+#pragma omp parallel for schedule(static)
+    for (long m = 0; m < n_meshlets; ++m)
+        set.bounds_[m] = compute_bounds(mesh, set.meshlets_[m]);
+    for (const auto &bounds : set.bounds_)
+        set.spheres_.push_back(bounds.sphere_);
+    return set;
+}
+
+size_t MeshletSet::cull(const glm::mat4 &view_projection, const glm::mat4 &model, const glm::vec3 &eye,
+                        std::vector<IndexRange> &ranges) const {
+    ranges.clear();
+    const long n_meshlets = meshlets_.size();
+    if (n_meshlets == 0) return 0;
+
+    /* Cull in model space, the frustum and the eye are pulled back
+     * instead of moving every meshlet.
+     */
+    Frustum frustum = Frustum::from_matrix(view_projection * model);
+    std::vector<uint8_t> visible(n_meshlets);
+    frustum.cull(spheres_, visible.data());
+
+    const bool mirrored = glm::determinant(glm::mat3(model)) < 0.0f;
+    if (!mirrored) {
+        const glm::vec3 local_eye = glm::vec3(glm::inverse(model) * glm::vec4(eye, 1.0f));
+#pragma omp parallel for schedule(static) if (n_meshlets > 4096)
+        for (long m = 0; m < n_meshlets; ++m) {
+            if (!visible[m]) continue;
+            const MeshletBounds &bounds = bounds_[m];
+            glm::vec3 d = bounds.cone_apex_ - local_eye;
+            float length = glm::length(d);
+            if (length > 0.0f && glm::dot(d, bounds.cone_axis_) >= bounds.cone_cutoff_ * length)
+                visible[m] = 0;
+        }
+    }
+
+    size_t n_visible = 0;
+    for (long m = 0; m < n_meshlets; ++m) {
+        if (!visible[m]) continue;
+        const Meshlet &meshlet = meshlets_[m];
+        const uint32_t first = meshlet.triangle_offset * 3, count = meshlet.triangle_count * 3u;
+        if (!ranges.empty() && ranges.back().first_index + ranges.back().count == first)
+            ranges.back().count += count;
+        else
+            ranges.push_back({first, count});
+        n_visible += meshlet.triangle_count;
+    }
+    return n_visible;
+}
@@ -0,0 +1,266 @@
+#include "cgcl/mesh/Normals.h"
+#include "cgcl/utils/logging.h"
+#include "MeshAdjacency.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cgcl;
+
+
+static glm::vec3 safe_normalize(const glm::vec3 &v) {
+    float length = glm::length(v);
+    return length > 0.0f ? v / length : glm::vec3(0.0f);
+}
+
+/// \brief Per vertex normal groups, the triangle data they read.
+struct NormalContext {
+    const Vertex *vertices;
+    const unsigned int *indices;
+    const glm::vec3 *face_normals; // unnormalized, twice the area long.
+    const uint8_t *smooth;
+    float cos_crease;
+    NormalWeighting weighting;
+
+    bool smoothAt(unsigned int t) const { return smooth == nullptr || smooth[t] != 0; }
+
+    /// \brief Contribution of corner c to the normal of its vertex.
+    glm::vec3 weight(unsigned int c) const {
+        const unsigned int t = c / 3;
+        if (weighting == NormalWeighting::Area)
+            return face_normals[t];
+        const glm::vec3 &p = vertices[indices[c]].position_;
+        const glm::vec3 e1 = vertices[indices[3 * t + (c + 1) % 3]].position_ - p;
+        const glm::vec3 e2 = vertices[indices[3 * t + (c + 2) % 3]].position_ - p;
+        const float angle = std::atan2(glm::length(glm::cross(e1, e2)), glm::dot(e1, e2));
+        return safe_normalize(face_normals[t]) * angle;
+    }
+
+    /// \brief Normals of the distinct groups of corners around a vertex,
+    /// group[k] receives the group of corners[k].
+    void groups(const unsigned int *corners, unsigned int n, std::vector<glm::vec3> &normals,
+                std::vector<glm::vec3> &scratch, uint16_t *group) const {
+        normals.clear();
+        scratch.resize(n);
+        bool all_smooth = true;
+        glm::vec3 sum(0.0f);
+        for (unsigned int k = 0; k < n; ++k) {
+            scratch[k] = weight(corners[k]);
+            sum += scratch[k];
+            all_smooth = all_smooth && smoothAt(corners[k] / 3);
+        }
+        if (all_smooth && cos_crease <= -1.0f) {
+            /* No crease, every corner shares one normal. */
+            normals.push_back(safe_normalize(sum));
+            std::fill(group, group + n, 0);
+            return;
+        }
+        for (unsigned int k = 0; k < n; ++k) {
+            const unsigned int t = corners[k] / 3;
+            const glm::vec3 face = safe_normalize(face_normals[t]);
+            glm::vec3 normal = face;
+            if (smoothAt(t)) {
+                glm::vec3 corner_sum(0.0f);
+                for (unsigned int j = 0; j < n; ++j) {
+                    const unsigned int s = corners[j] / 3;
+                    if (smoothAt(s) && glm::dot(face, safe_normalize(face_normals[s])) >= cos_crease)
+                        corner_sum += scratch[j];
+                }
+                normal = safe_normalize(corner_sum);
+            }
+            unsigned int g = 0;
+            while (g < normals.size() && glm::dot(normals[g], normal) < 0.9999f)
+                ++g;
+            if (g == normals.size())
+                normals.push_back(normal);
+            group[k] = g;
+        }
+    }
+};
+
+size_t cgcl::generate_normals(std::vector<Vertex> &vertices, unsigned int *indices, size_t n_indices,
+                              const uint8_t *smooth, float crease_angle, NormalWeighting weighting) {
+    CHECK_EQ(n_indices % 3, 0u) << "Not a triangle list";
+    const long n_triangles = n_indices / 3;
+    const long n_vertices = vertices.size();
+
+    std::vector<glm::vec3> face_normals(n_triangles);
+#pragma omp parallel for schedule(static)
+    for (long t = 0; t < n_triangles; ++t) {
+        const glm::vec3 &p0 = vertices[indices[3 * t]].position_;
+        face_normals[t] = glm::cross(vertices[indices[3 * t + 1]].position_ - p0,
+                                     vertices[indices[3 * t + 2]].position_ - p0);
+    }
+
+    /* Each vertex gathers from its own corners, nothing is scattered
+     * to shared memory, so threads never write the same normal.
+     */
+    const VertexCorners around(indices, n_indices, n_vertices);
+    const NormalContext context = {vertices.data(), indices, face_normals.data(), smooth,
+                                   crease_angle >= 3.14159f ? -1.0f : std::cos(crease_angle), weighting};
+    std::vector<uint16_t> corner_group(around.corners_.size());
+    std::vector<unsigned int> n_extra(n_vertices + 1, 0);
+#pragma omp parallel
+    {
+        std::vector<glm::vec3> normals, scratch;
+#pragma omp for schedule(dynamic, 4096)
+        for (long v = 0; v < n_vertices; ++v) {
+            const unsigned int begin = around.offsets_[v], n = around.offsets_[v + 1] - begin;
+            if (n == 0) continue;
+            context.groups(&around.corners_[begin], n, normals, scratch, &corner_group[begin]);
+            CHECK_LE(normals.size(), 65536u) << "Too many normals at one vertex";
+            vertices[v].normal_ = normals[0];
+            n_extra[v + 1] = normals.size() - 1;
+        }
+    }
+    prefix_sum(n_extra.data(), n_extra.size());
+    const size_t n_added = n_extra[n_vertices];
+    if (n_added == 0)
+        return 0;
+
+    /* Split vertices: group 0 keeps the vertex, the others get copies
+     * at n_vertices + n_extra[v] onward, in vertex order. Their normals
+     * are computed again before any index changes.
+     */
+    std::vector<glm::vec3> extra_normals(n_added);
+#pragma omp parallel
+    {
+        std::vector<glm::vec3> normals, scratch;
+        std::vector<uint16_t> group;
+#pragma omp for schedule(dynamic, 4096)
+        for (long v = 0; v < n_vertices; ++v) {
+            if (n_extra[v + 1] == n_extra[v]) continue;
+            const unsigned int begin = around.offsets_[v], n = around.offsets_[v + 1] - begin;
+            group.resize(n);
+            context.groups(&around.corners_[begin], n, normals, scratch, group.data());
+            std::copy(normals.begin() + 1, normals.end(), extra_normals.begin() + n_extra[v]);
+        }
+    }
+
+    vertices.resize(n_vertices + n_added);
+#pragma omp parallel for schedule(dynamic, 4096)
+    for (long v = 0; v < n_vertices; ++v) {
+        const unsigned int first = n_extra[v], n_copies = n_extra[v + 1] - first;
+        if (n_copies == 0) continue;
+        for (unsigned int g = 0; g < n_copies; ++g) {
+            vertices[n_vertices + first + g] = vertices[v];
+            vertices[n_vertices + first + g].normal_ = extra_normals[first + g];
+        }
+        for (unsigned int k = around.offsets_[v]; k < around.offsets_[v + 1]; ++k) {
+            if (corner_group[k] > 0)
+                indices[around.corners_[k]] = n_vertices + first + corner_group[k] - 1;
+        }
+    }
+    return n_added;
+}
+
+/// \brief Normalized v, or a unit vector perpendicular to normal if v
+/// is zero, as for triangles whose texture coordinates are degenerate.
+static glm::vec3 tangent_or_any(const glm::vec3 &v, const glm::vec3 &normal) {
+    if (glm::dot(v, v) > 0.0f)
+        return glm::normalize(v);
+    const glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return safe_normalize(glm::cross(normal, axis));
+}
+
+/// \brief Sums of the corner tangents around a vertex, one per uv
+/// orientation. Orientation 0 is the one of the first corner, and it
+/// stays with the vertex.
+static int tangent_groups(const unsigned int *corners, unsigned int n, const Vertex *vertices,
+                          const unsigned int *indices, const glm::vec3 *face_tangents,
+                          const uint8_t *flipped, glm::vec3 sums[2]) {
+    sums[0] = sums[1] = glm::vec3(0.0f);
+    const uint8_t first = flipped[corners[0] / 3];
+    int n_groups = 1;
+    for (unsigned int k = 0; k < n; ++k) {
+        const unsigned int c = corners[k], t = c / 3;
+        const glm::vec3 &normal = vertices[indices[c]].normal_;
+        const glm::vec3 &p = vertices[indices[c]].position_;
+        /* Edges and tangent projected to the tangent plane of the vertex. */
+        glm::vec3 e1 = vertices[indices[3 * t + (c + 1) % 3]].position_ - p;
+        glm::vec3 e2 = vertices[indices[3 * t + (c + 2) % 3]].position_ - p;
+        e1 = safe_normalize(e1 - normal * glm::dot(normal, e1));
+        e2 = safe_normalize(e2 - normal * glm::dot(normal, e2));
+        const float angle = std::acos(std::clamp(glm::dot(e1, e2), -1.0f, 1.0f));
+        const glm::vec3 &face = face_tangents[t];
+        const int group = flipped[t] != first;
+        sums[group] += safe_normalize(face - normal * glm::dot(normal, face)) * angle;
+        n_groups = std::max(n_groups, group + 1);
+    }
+    return n_groups;
+}
+
+size_t cgcl::generate_tangents(std::vector<Vertex> &vertices, unsigned int *indices, size_t n_indices,
+                               std::vector<glm::vec4> &tangents) {
+    CHECK_EQ(n_indices % 3, 0u) << "Not a triangle list";
+    const long n_triangles = n_indices / 3;
+    const long n_vertices = vertices.size();
+
+    /* Direction of increasing u on every triangle, and whether its
+     * uv winding is mirrored.
+     */
+    std::vector<glm::vec3> face_tangents(n_triangles);
+    std::vector<uint8_t> flipped(n_triangles);
+#pragma omp parallel for schedule(static)
+    for (long t = 0; t < n_triangles; ++t) {
+        const Vertex &v0 = vertices[indices[3 * t]];
+        const Vertex &v1 = vertices[indices[3 * t + 1]];
+        const Vertex &v2 = vertices[indices[3 * t + 2]];
+        const glm::vec3 e1 = v1.position_ - v0.position_, e2 = v2.position_ - v0.position_;
+        const glm::vec2 d1 = v1.texture_coords_ - v0.texture_coords_, d2 = v2.texture_coords_ - v0.texture_coords_;
+        const float signed_area = d1.x * d2.y - d2.x * d1.y;
+        const float sign = signed_area < 0.0f ? -1.0f : 1.0f;
+        face_tangents[t] = sign * safe_normalize(d2.y * e1 - d1.y * e2);
+        flipped[t] = signed_area < 0.0f;
+    }
+
+    const VertexCorners around(indices, n_indices, n_vertices);
+    tangents.assign(n_vertices, glm::vec4(0.0f));
+    std::vector<unsigned int> n_extra(n_vertices + 1, 0);
+#pragma omp parallel for schedule(dynamic, 4096)
+    for (long v = 0; v < n_vertices; ++v) {
+        const unsigned int begin = around.offsets_[v], n = around.offsets_[v + 1] - begin;
+        if (n == 0) continue;
+        glm::vec3 sums[2];
+        const unsigned int *corners = &around.corners_[begin];
+        n_extra[v + 1] = tangent_groups(corners, n, vertices.data(), indices, face_tangents.data(),
+                                        flipped.data(), sums) - 1;
+        const float handedness = flipped[corners[0] / 3] ? -1.0f : 1.0f;
+        tangents[v] = glm::vec4(tangent_or_any(sums[0], vertices[v].normal_), handedness);
+    }
+    prefix_sum(n_extra.data(), n_extra.size());
+    const size_t n_added = n_extra[n_vertices];
+    if (n_added == 0)
+        return 0;
+
+    /* The mirrored corners of a vertex move to its copy at
+     * n_vertices + n_extra[v]. Tangents of the copies are taken
+     * before any index changes.
+     */
+    std::vector<glm::vec4> extra_tangents(n_added);
+#pragma omp parallel for schedule(dynamic, 4096)
+    for (long v = 0; v < n_vertices; ++v) {
+        if (n_extra[v + 1] == n_extra[v]) continue;
+        const unsigned int begin = around.offsets_[v], n = around.offsets_[v + 1] - begin;
+        glm::vec3 sums[2];
+        tangent_groups(&around.corners_[begin], n, vertices.data(), indices, face_tangents.data(),
+                       flipped.data(), sums);
+        extra_tangents[n_extra[v]] = glm::vec4(tangent_or_any(sums[1], vertices[v].normal_), -tangents[v].w);
+    }
+
+    vertices.resize(n_vertices + n_added);
+    tangents.resize(n_vertices + n_added);
+#pragma omp parallel for schedule(dynamic, 4096)
+    for (long v = 0; v < n_vertices; ++v) {
+        if (n_extra[v + 1] == n_extra[v]) continue;
+        const unsigned int copy = n_vertices + n_extra[v];
+        vertices[copy] = vertices[v];
+        tangents[copy] = extra_tangents[n_extra[v]];
+        const uint8_t first = flipped[around.corners_[around.offsets_[v]] / 3];
+        for (unsigned int k = around.offsets_[v]; k < around.offsets_[v + 1]; ++k) {
+            if (flipped[around.corners_[k] / 3] != first)
+                indices[around.corners_[k]] = copy;
+        }
+    }
+    return n_added;
+}
@@ -2,7 +2,7 @@
 
 using namespace cgcl;
 
-void PhongMaterial::updateBareMaterial(GLShader &shader) {
+void PhongMaterial::updateBareMaterial(GLShader &shader) const {
     shader.updateUniformFloat3("material.Ka", Ka_);
     shader.updateUniformFloat3("material.Kd", Kd_);
     shader.updateUniformFloat3("material.Ks", Ks_);
@@ -11,7 +11,7 @@ void PhongMaterial::updateBareMaterial(GLShader &shader) {
 }
 
 
-void PhongMaterial::updateLightingMapMaterial(GLShader &shader, unsigned int texture_group_id) {
+void PhongMaterial::updateLightingMapMaterial(GLShader &shader, unsigned int texture_group_id) const {
     shader.updateUniformInt("material.diffuse", texture_group_id);
     shader.updateUniformFloat3("material.Ks", Ks_);
     shader.updateUniformFloat("material.highlight_decay", decay_);
@@ -0,0 +1,464 @@
+#include "cgcl/mesh/Simplify.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+using namespace cgcl;
+
+
+/* Boundary and seam planes weigh this much more than surface planes. */
+static constexpr float boundary_weight = 10.0f;
+/* A collapse may turn a triangle normal by at most acos of this. */
+static constexpr float min_normal_cos = 0.25f;
+
+/// \brief Symmetric 4x4 quadric of weighted squared distances to planes.
+/// In double, the error of a fine mesh is far below the float
+/// rounding of its terms.
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double w = 0;
+
+    static Quadric plane(const glm::vec3 &normal, double d, double weight) {
+        const double n[3] = {normal.x, normal.y, normal.z};
+        Quadric q;
+        q.a00 = weight * n[0] * n[0]; q.a01 = weight * n[0] * n[1]; q.a02 = weight * n[0] * n[2];
+        q.a11 = weight * n[1] * n[1]; q.a12 = weight * n[1] * n[2]; q.a22 = weight * n[2] * n[2];
+        q.b0 = weight * n[0] * d; q.b1 = weight * n[1] * d; q.b2 = weight * n[2] * d;
+        q.c = weight * d * d;
+        q.w = weight;
+        return q;
+    }
+    Quadric &operator+=(const Quadric &q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c; w += q.w;
+        return *this;
+    }
+    /// \brief Mean squared distance of p to the planes.
+    float error(const glm::vec3 &point) const {
+        const double x = point.x, y = point.y, z = point.z;
+        double e = a00 * x * x + a11 * y * y + a22 * z * z
+                 + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                 + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return w > 0.0 ? float(std::fabs(e) / w) : 0.0f;
+    }
+};
+
+namespace {
+
+/// \brief How a position may collapse.
+enum class Kind : uint8_t {
+    Manifold, // one vertex, interior, collapses onto any neighbor.
+    Border,   // one vertex on an open boundary, collapses along it.
+    Seam,     // two vertices on a seam, collapses along the seam.
+    Locked,
+};
+
+/// \brief Triangles on an edge from one position, and the vertices
+/// of its two ends in the first of them.
+struct EdgeUse {
+    unsigned int n_triangles = 0;
+    unsigned int vp = 0, vq = 0;
+    bool seam = false; // another triangle has other vertices at the ends.
+};
+
+struct Collapse {
+    float cost;
+    unsigned int from, to;
+    unsigned int version;
+    bool operator<(const Collapse &other) const { return cost > other.cost; }
+};
+
+struct PositionKey {
+    float x, y, z;
+    bool operator==(const PositionKey &o) const {
+        return std::memcmp(this, &o, sizeof(PositionKey)) == 0;
+    }
+};
+
+struct PositionHash {
+    size_t operator()(const PositionKey &k) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &k, sizeof(bits));
+        return (size_t(bits[0]) * 73856093u) ^ (size_t(bits[1]) * 19349663u) ^ (size_t(bits[2]) * 83492791u);
+    }
+};
+
+/// \brief Mesh state during simplification. Collapses move positions,
+/// every vertex (wedge) of the collapsed position is remapped to one of
+/// the target position.
+class Simplifier {
+public:
+    Simplifier(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+        : vertices_(vertices), indices_(indices) {
+        const size_t n_vertices = vertices.size(), n_triangles = indices.size() / 3;
+
+        /* Weld vertices by position. */
+        std::unordered_map<PositionKey, unsigned int, PositionHash> welded;
+        welded.reserve(n_vertices);
+        position_of_.resize(n_vertices);
+        for (size_t v = 0; v < n_vertices; ++v) {
+            const glm::vec3 &p = vertices[v].position_;
+            auto it = welded.emplace(PositionKey{p.x, p.y, p.z}, unsigned(points_.size())).first;
+            if (it->second == points_.size()) points_.push_back(p);
+            position_of_[v] = it->second;
+        }
+
+        const size_t n_positions = points_.size();
+        triangles_of_.resize(n_positions);
+        quadrics_.resize(n_positions);
+        version_.assign(n_positions, 0);
+        alive_.assign(n_positions, true);
+        alive_triangles_.assign(n_triangles, true);
+        n_alive_ = n_triangles;
+        for (size_t t = 0; t < n_triangles; ++t) {
+            for (int c = 0; c < 3; ++c)
+                triangles_of_[position_of_[indices[3 * t + c]]].push_back(t);
+            glm::vec3 n = glm::cross(point(t, 1) - point(t, 0), point(t, 2) - point(t, 0));
+            float area = glm::length(n);
+            if (area == 0.0f) continue;
+            n /= area;
+            Quadric q = Quadric::plane(n, -double(glm::dot(n, point(t, 0))), area);
+            for (int c = 0; c < 3; ++c)
+                quadrics_[position_of_[indices[3 * t + c]]] += q;
+        }
+        classify();
+    }
+
+    float run(size_t target_index_count, float max_error) {
+        const size_t n_positions = points_.size();
+        for (size_t p = 0; p < n_positions; ++p) {
+            neighbors(p, push_ring_);
+            push(p, push_ring_);
+        }
+        const float max_cost = max_error < FLT_MAX ? max_error * max_error : FLT_MAX;
+        float reached = 0.0f;
+        while (!heap_.empty() && n_alive_ * 3 > target_index_count) {
+            Collapse top = heap_.top();
+            heap_.pop();
+            if (!alive_[top.from] || !alive_[top.to] || top.version != version_[top.from]) continue;
+            if (top.cost > max_cost) break;
+            collapse(top.from, top.to);
+            reached = std::max(reached, top.cost);
+        }
+
+        size_t n_indices = 0;
+        for (size_t t = 0; t < alive_triangles_.size(); ++t) {
+            if (!alive_triangles_[t]) continue;
+            for (int c = 0; c < 3; ++c)
+                indices_[n_indices++] = indices_[3 * t + c];
+        }
+        indices_.resize(n_indices);
+        return std::sqrt(reached);
+    }
+
+private:
+    const std::vector<Vertex> &vertices_;
+    std::vector<unsigned int> &indices_;
+    std::vector<unsigned int> position_of_; // of vertex.
+    std::vector<glm::vec3> points_;         // of position.
+    std::vector<std::vector<unsigned int>> triangles_of_;
+    std::vector<Quadric> quadrics_;
+    std::vector<Kind> kind_;
+    std::vector<unsigned int> version_;
+    std::vector<bool> alive_, alive_triangles_;
+    size_t n_alive_;
+    std::priority_queue<Collapse> heap_;
+    std::vector<unsigned int> push_ring_, collapse_ring_; // scratch of neighbors().
+    std::vector<EdgeUse> edge_uses_;                       // scratch of classify().
+
+    const glm::vec3 &point(size_t t, int c) const { return points_[position_of_[indices_[3 * t + c]]]; }
+
+    /// \brief Corner of position p in triangle t, -1 if none.
+    int corner(size_t t, unsigned int p) const {
+        for (int c = 0; c < 3; ++c)
+            if (position_of_[indices_[3 * t + c]] == p) return c;
+        return -1;
+    }
+
+    /// \brief Triangles on edge (p, q), and whether they disagree
+    /// on the vertices of p or q, which makes the edge a seam.
+    void edge(unsigned int p, unsigned int q, int &n_triangles, bool &seam) const {
+        n_triangles = 0;
+        seam = false;
+        unsigned int vp = 0, vq = 0;
+        for (unsigned int t : triangles_of_[p]) {
+            if (!alive_triangles_[t]) continue;
+            int cq = corner(t, q);
+            if (cq < 0) continue;
+            unsigned int wp = indices_[3 * t + corner(t, p)], wq = indices_[3 * t + cq];
+            if (n_triangles++ == 0) {
+                vp = wp;
+                vq = wq;
+            } else if (wp != vp || wq != vq) {
+                seam = true;
+            }
+        }
+    }
+
+    /// \brief Positions sharing a live triangle with p, each once, in
+    /// increasing order. The caller owns ring, so it grows to the largest
+    /// degree once and calls may nest with different rings.
+    void neighbors(unsigned int p, std::vector<unsigned int> &ring) const {
+        ring.clear();
+        for (unsigned int t : triangles_of_[p]) {
+            if (!alive_triangles_[t]) continue;
+            for (int c = 0; c < 3; ++c) {
+                unsigned int q = position_of_[indices_[3 * t + c]];
+                if (q != p) ring.push_back(q);
+            }
+        }
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+    }
+
+    /// \brief Kind of p from its live triangles. Every edge of p is
+    /// counted in one pass over them, as edge() would for each.
+    Kind classify(unsigned int p, std::vector<unsigned int> &ring, std::vector<EdgeUse> &uses) const {
+        unsigned int wedges[3];
+        int n_wedges = 0;
+        for (unsigned int t : triangles_of_[p]) {
+            if (!alive_triangles_[t]) continue;
+            unsigned int v = indices_[3 * t + corner(t, p)];
+            if (std::find(wedges, wedges + n_wedges, v) != wedges + n_wedges) continue;
+            if (n_wedges == 3) {
+                n_wedges++;
+                break;
+            }
+            wedges[n_wedges++] = v;
+        }
+        neighbors(p, ring);
+        uses.assign(ring.size(), EdgeUse());
+        for (unsigned int t : triangles_of_[p]) {
+            if (!alive_triangles_[t]) continue;
+            const int cp = corner(t, p);
+            const unsigned int wp = indices_[3 * t + cp];
+            for (int k = 1; k < 3; ++k) {
+                const unsigned int wq = indices_[3 * t + (cp + k) % 3], q = position_of_[wq];
+                if (q == p) continue;
+                EdgeUse &use = uses[std::lower_bound(ring.begin(), ring.end(), q) - ring.begin()];
+                if (use.n_triangles++ == 0) {
+                    use.vp = wp;
+                    use.vq = wq;
+                } else if (wp != use.vp || wq != use.vq) {
+                    use.seam = true;
+                }
+            }
+        }
+        int n_border = 0, n_seam = 0;
+        for (const EdgeUse &use : uses) {
+            if (use.n_triangles > 2) return Kind::Locked;
+            n_border += use.n_triangles == 1;
+            n_seam += use.seam;
+        }
+        /* One vertex with a seam edge is the tip of a cut, remapping all of
+         * its triangles to one vertex of q would tear the other side.
+         */
+        if (n_wedges == 1 && n_border == 0 && n_seam == 0) return Kind::Manifold;
+        if (n_wedges == 1 && n_border == 2 && n_seam == 0) return Kind::Border;
+        if (n_wedges == 2 && n_border == 0 && n_seam == 2) return Kind::Seam;
+        return Kind::Locked;
+    }
+
+    void classify() {
+        const size_t n_positions = points_.size();
+        kind_.assign(n_positions, Kind::Locked);
+#pragma omp parallel
+        {
+            std::vector<unsigned int> ring;
+            std::vector<EdgeUse> uses;
+#pragma omp for schedule(dynamic, 1024)
+            for (long p = 0; p < long(n_positions); ++p)
+                kind_[p] = classify(p, ring, uses);
+        }
+        /* Boundaries and seams keep their shape through added planes
+         * perpendicular to the surface along their edges.
+         */
+        for (size_t t = 0; t < alive_triangles_.size(); ++t) {
+            glm::vec3 n = glm::cross(point(t, 1) - point(t, 0), point(t, 2) - point(t, 0));
+            if (glm::length(n) == 0.0f) continue;
+            n = glm::normalize(n);
+            for (int c = 0; c < 3; ++c) {
+                unsigned int p = position_of_[indices_[3 * t + c]];
+                unsigned int q = position_of_[indices_[3 * t + (c + 1) % 3]];
+                int n_triangles;
+                bool seam;
+                edge(p, q, n_triangles, seam);
+                if (n_triangles != 1 && !seam) continue;
+                glm::vec3 e = points_[q] - points_[p];
+                float length = glm::length(e);
+                if (length == 0.0f) continue;
+                glm::vec3 m = glm::normalize(glm::cross(e, n));
+                /* A seam edge is seen from both sides, halve it. */
+                float weight = boundary_weight * length * length * (seam ? 0.5f : 1.0f);
+                Quadric q_edge = Quadric::plane(m, -glm::dot(m, points_[p]), weight);
+                quadrics_[p] += q_edge;
+                quadrics_[q] += q_edge;
+            }
+        }
+    }
+
+    bool allowed(unsigned int p, unsigned int q) const {
+        if (kind_[p] == Kind::Locked) return false;
+        if (kind_[p] == Kind::Manifold) return true;
+        int n_triangles;
+        bool seam;
+        edge(p, q, n_triangles, seam);
+        if (kind_[p] == Kind::Border) return n_triangles == 1;
+        return seam;
+    }
+
+    /// \brief Triangles around p that survive the collapse keep their
+    /// orientation and do not degenerate.
+    bool flips(unsigned int p, unsigned int q) const {
+        const glm::vec3 &target = points_[q];
+        for (unsigned int t : triangles_of_[p]) {
+            if (!alive_triangles_[t] || corner(t, q) >= 0) continue;
+            int c = corner(t, p);
+            glm::vec3 a = point(t, 0), b = point(t, 1), d = point(t, 2);
+            glm::vec3 before = glm::cross(b - a, d - a);
+            (c == 0 ? a : c == 1 ? b : d) = target;
+            glm::vec3 after = glm::cross(b - a, d - a);
+            float len_before = glm::length(before), len_after = glm::length(after);
+            if (len_after == 0.0f) return true;
+            if (glm::dot(before, after) < min_normal_cos * len_before * len_after) return true;
+        }
+        return false;
+    }
+
+    /// \brief Queue the cheapest allowed collapse of p onto its ring.
+    void push(unsigned int p, const std::vector<unsigned int> &ring) {
+        if (!alive_[p] || kind_[p] == Kind::Locked) return;
+        float best = FLT_MAX;
+        long best_q = -1;
+        for (unsigned int q : ring) {
+            if (!allowed(p, q)) continue;
+            Quadric sum = quadrics_[p];
+            sum += quadrics_[q];
+            float cost = sum.error(points_[q]);
+            if (cost < best && !flips(p, q)) {
+                best = cost;
+                best_q = q;
+            }
+        }
+        if (best_q >= 0)
+            heap_.push({best, p, unsigned(best_q), version_[p]});
+    }
+
+    void collapse(unsigned int p, unsigned int q) {
+        /* Vertex of q taking over each vertex of p, from the triangles
+         * on the edge. A manifold p has one, a seam p two.
+         */
+        unsigned int from[2], to[2];
+        int n_map = 0;
+        for (unsigned int t : triangles_of_[p]) {
+            if (!alive_triangles_[t]) continue;
+            int cq = corner(t, q);
+            if (cq < 0) continue;
+            unsigned int wp = indices_[3 * t + corner(t, p)];
+            if (std::find(from, from + n_map, wp) != from + n_map) continue;
+            if (n_map == 2) continue;
+            from[n_map] = wp;
+            to[n_map++] = indices_[3 * t + cq];
+        }
+
+        for (unsigned int t : triangles_of_[p]) {
+            if (!alive_triangles_[t]) continue;
+            if (corner(t, q) >= 0) {
+                alive_triangles_[t] = false;
+                n_alive_--;
+                continue;
+            }
+            unsigned int &v = indices_[3 * t + corner(t, p)];
+            int k = std::find(from, from + n_map, v) - from;
+            /* A vertex of p not on the edge moves to the first vertex of q. */
+            v = to[k < n_map ? k : 0];
+            position_of_[v] = q;
+            triangles_of_[q].push_back(t);
+        }
+        alive_[p] = false;
+        triangles_of_[p].clear();
+        triangles_of_[p].shrink_to_fit();
+        auto &around_q = triangles_of_[q];
+        around_q.erase(std::remove_if(around_q.begin(), around_q.end(),
+                                      [&](unsigned int t) { return !alive_triangles_[t]; }),
+                       around_q.end());
+        quadrics_[q] += quadrics_[p];
+
+        /* The ring of q changed, so may the kinds of q and its neighbors,
+         * a collapse of each depends on its own kind only.
+         */
+        neighbors(q, collapse_ring_);
+        collapse_ring_.push_back(q);
+        for (unsigned int r : collapse_ring_) {
+            kind_[r] = classify(r, push_ring_, edge_uses_);
+            version_[r]++;
+            push(r, push_ring_);
+        }
+    }
+};
+
+} // end anonymous namespace
+
+float cgcl::simplify(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                     size_t target_index_count, float max_error) {
+    CHECK_EQ(indices.size() % 3, 0u) << "Not a triangle list";
+    if (indices.size() <= target_index_count) return 0.0f;
+    Simplifier simplifier(vertices, indices);
+    return simplifier.run(target_index_count, max_error);
+}
+
+LODChain LODChain::build(const TriMesh &mesh, const std::vector<float> &ratios) {
+    LODChain chain;
+    chain.levels_.push_back(std::make_unique<TriMesh>(mesh.global_vertices_, mesh.global_indices_));
+    chain.errors_.push_back(0.0f);
+
+    std::vector<unsigned int> indices = mesh.global_indices_;
+    float error = 0.0f;
+    for (float ratio : ratios) {
+        size_t target = size_t(mesh.global_indices_.size() / 3 * ratio) * 3;
+        if (target >= indices.size()) continue;
+        /* Errors add up as each level starts from the previous one. */
+        error += simplify(mesh.global_vertices_, indices, target);
+        if (indices.size() == chain.levels_.back()->global_indices_.size()) break;
+
+        /* Keep only the vertices this level uses. */
+        std::vector<unsigned int> remap(mesh.global_vertices_.size(), UINT_MAX);
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> level_indices(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            unsigned int &slot = remap[indices[i]];
+            if (slot == UINT_MAX) {
+                slot = vertices.size();
+                vertices.push_back(mesh.global_vertices_[indices[i]]);
+            }
+            level_indices[i] = slot;
+        }
+        auto level = std::make_unique<TriMesh>(std::move(vertices), std::move(level_indices));
+        level->optimize();
+        chain.levels_.push_back(std::move(level));
+        chain.errors_.push_back(error);
+    }
+    return chain;
+}
+
+unsigned int LODChain::select(const glm::mat4 &model, const glm::vec3 &eye, const glm::mat4 &projection,
+                              float viewport_height, float pixel_error) const {
+    CHECK(!levels_.empty()) << "Empty LOD chain";
+    const BoundingSphere &local = levels_[0]->bounding_sphere_;
+    BoundingSphere world = local.transform(model);
+    float scale = local.radius_ > 0.0f ? world.radius_ / local.radius_ : 1.0f;
+    float distance = glm::length(world.center_ - eye) - world.radius_;
+    if (distance <= 0.0f) return 0;
+    /* Pixels per world unit at that distance. */
+    float pixels = projection[1][1] * 0.5f * viewport_height / distance;
+    unsigned int level = 0;
+    for (unsigned int k = 1; k < levels_.size(); ++k) {
+        if (errors_[k] * scale * pixels <= pixel_error) level = k;
+    }
+    return level;
+}
@@ -0,0 +1,231 @@
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/utils/logging.h"
+
+#include <cmath>
+
+using namespace cgcl;
+
+
+static const double PI = std::acos(-1.0);
+
+/// \brief Texture coordinate of a point on the unit sphere, the
+/// same (theta / 2pi, phi / pi) convention as uv_sphere.
+static glm::vec2 spherical_uv(const glm::vec3 &p) {
+    double theta = std::atan2(-double(p.z), double(p.x));
+    if (theta < 0.0) theta += 2 * PI;
+    double phi = std::acos(std::min(1.0, std::max(-1.0, double(p.y))));
+    return glm::vec2(theta / (2 * PI), phi / PI);
+}
+
+SphereGeometry SphereGeometry::uv_sphere(unsigned int n_longitude, unsigned int n_latitude) {
+    CHECK_GE(n_longitude, 3) << "Too few longitude segments";
+    CHECK_GE(n_latitude, 2) << "Too few latitude segments";
+    const int n_cols = n_longitude + 1, n_rows = n_latitude + 1;
+
+    /* Trigonometry depends on the row or the column only, tabulate it once,
+     * so the grid below is plain multiplies and vectorizes.
+     */
+    std::vector<float> sin_theta(n_cols), cos_theta(n_cols);
+    std::vector<float> sin_phi(n_rows), cos_phi(n_rows);
+    for (int i = 0; i < n_cols; ++i) {
+        double theta = 2 * PI * i / n_longitude;
+        sin_theta[i] = std::sin(theta);
+        cos_theta[i] = std::cos(theta);
+    }
+    for (int j = 0; j < n_rows; ++j) {
+        double phi = PI * j / n_latitude;
+        sin_phi[j] = std::sin(phi);
+        cos_phi[j] = std::cos(phi);
+    }
+    /* Make the seam and the poles exact, so they coincide. */
+    sin_theta[n_longitude] = sin_theta[0];
+    cos_theta[n_longitude] = cos_theta[0];
+    sin_phi[0] = sin_phi[n_latitude] = 0.0f;
+    cos_phi[0] = 1.0f;
+    cos_phi[n_latitude] = -1.0f;
+
+    SphereGeometry sphere;
+    /* One triangle per quad next to each pole, two elsewhere. */
+    const size_t n_triangles = size_t(n_longitude) * (2 * n_latitude - 2);
+    sphere.vertices_.resize(size_t(n_cols) * n_rows);
+    sphere.indices_.resize(n_triangles * 3);
+    Vertex *vertex = sphere.vertices_.data();
+    unsigned int *indices = sphere.indices_.data();
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < n_rows; ++j) {
+        Vertex *row = vertex + size_t(j) * n_cols;
+        const float s = sin_phi[j], c = cos_phi[j];
+        const float v = float(j) / n_latitude;
+#pragma omp simd
+        for (int i = 0; i < n_cols; ++i) {
+            row[i].position_ = glm::vec3(s * cos_theta[i], c, -s * sin_theta[i]);
+            row[i].normal_ = row[i].position_;
+            row[i].texture_coords_ = glm::vec2(float(i) / n_longitude, v);
+        }
+    }
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < int(n_latitude); ++j) {
+        /* Row 0 holds n_longitude triangles, every later row 2 * n_longitude. */
+        unsigned int *tri = indices + (j == 0 ? 0 : size_t(2 * j - 1) * n_longitude * 3);
+        for (int i = 0; i < int(n_longitude); ++i) {
+            unsigned int p = j * n_cols + i;
+            unsigned int below = p + n_cols;
+            if (j != 0) {
+                *tri++ = p;
+                *tri++ = below;
+                *tri++ = p + 1;
+            }
+            if (j != n_latitude - 1) {
+                *tri++ = p + 1;
+                *tri++ = below;
+                *tri++ = below + 1;
+            }
+        }
+    }
+    return sphere;
+}
+
+SphereGeometry SphereGeometry::ico_sphere(unsigned int n_segments) {
+    CHECK_GE(n_segments, 1) << "Too few segments";
+    const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    const glm::vec3 corners[12] = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+        {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+        {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}
+    };
+    static const int faces[20][3] = {
+        {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+        {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+        {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+        {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
+    };
+
+    /* Every face is a triangular grid of its own. Row r holds
+     * n - r + 1 vertices and 2 * (n - r) - 1 triangles.
+     */
+    const int n = n_segments;
+    const size_t face_vertices = size_t(n + 1) * (n + 2) / 2;
+    const size_t face_triangles = size_t(n) * n;
+    SphereGeometry sphere;
+    sphere.vertices_.resize(20 * face_vertices);
+    sphere.indices_.resize(20 * face_triangles * 3);
+    Vertex *vertex = sphere.vertices_.data();
+    unsigned int *indices = sphere.indices_.data();
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int f = 0; f < 20; ++f) {
+        for (int r = 0; r <= n; ++r) {
+            /* Sum the corners in the order of their index, a point on an
+             * edge shared by two faces then comes out bit-identical from
+             * both, and the sphere has no cracks.
+             */
+            int order[3] = {faces[f][0], faces[f][1], faces[f][2]};
+            int slot[3] = {0, 1, 2};
+            for (int a = 0; a < 2; ++a)
+                for (int b = 0; b < 2 - a; ++b)
+                    if (order[b] > order[b + 1]) {
+                        std::swap(order[b], order[b + 1]);
+                        std::swap(slot[b], slot[b + 1]);
+                    }
+
+            const size_t row_begin = size_t(r) * (n + 1) - size_t(r) * (r - 1) / 2;
+            const unsigned int base = f * face_vertices;
+            Vertex *row = vertex + base + row_begin;
+            for (int c = 0; c <= n - r; ++c) {
+                const int weight[3] = {n - r - c, c, r};
+                glm::vec3 p(0.0f);
+                for (int k = 0; k < 3; ++k)
+                    p += float(weight[slot[k]]) * corners[order[k]];
+                p = glm::normalize(p);
+                row[c].position_ = p;
+                row[c].normal_ = p;
+                row[c].texture_coords_ = spherical_uv(p);
+            }
+            if (r == n) continue;
+
+            const unsigned int next_begin = base + row_begin + (n - r + 1);
+            unsigned int *tri = indices + (f * face_triangles + size_t(r) * (2 * n - r)) * 3;
+            for (int c = 0; c < n - r; ++c) {
+                unsigned int p = base + row_begin + c;
+                unsigned int q = next_begin + c;
+                *tri++ = p;
+                *tri++ = p + 1;
+                *tri++ = q;
+                if (c + 1 < n - r) {
+                    *tri++ = p + 1;
+                    *tri++ = q + 1;
+                    *tri++ = q;
+                }
+            }
+        }
+    }
+    return sphere;
+}
+
+/// \brief Spherified cube mapping, spreads the vertices more evenly
+/// than normalizing the cube point. Symmetric in its coordinates,
+/// so edges shared by two faces map to the same point.
+static glm::vec3 cube_to_sphere(const glm::vec3 &p) {
+    const float x2 = p.x * p.x, y2 = p.y * p.y, z2 = p.z * p.z;
+    return glm::vec3(
+        p.x * std::sqrt(1.0f - y2 / 2.0f - z2 / 2.0f + y2 * z2 / 3.0f),
+        p.y * std::sqrt(1.0f - z2 / 2.0f - x2 / 2.0f + z2 * x2 / 3.0f),
+        p.z * std::sqrt(1.0f - x2 / 2.0f - y2 / 2.0f + x2 * y2 / 3.0f)
+    );
+}
+
+SphereGeometry SphereGeometry::cube_sphere(unsigned int n_segments) {
+    CHECK_GE(n_segments, 1) << "Too few segments";
+    /* normal, u and v axis of each face, with cross(u, v) == normal. */
+    static const glm::vec3 axes[6][3] = {
+        {{ 1, 0, 0}, {0, 0, -1}, {0, 1, 0}},
+        {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{0, 1, 0}, {1, 0, 0}, {0, 0, -1}},
+        {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},
+        {{0, 0, -1}, {-1, 0, 0}, {0, 1, 0}}
+    };
+    const int n = n_segments, n_side = n + 1;
+    const size_t face_vertices = size_t(n_side) * n_side;
+    const size_t face_indices = size_t(n) * n * 6;
+    SphereGeometry sphere;
+    sphere.vertices_.resize(6 * face_vertices);
+    sphere.indices_.resize(6 * face_indices);
+    Vertex *vertex = sphere.vertices_.data();
+    unsigned int *indices = sphere.indices_.data();
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int f = 0; f < 6; ++f) {
+        for (int j = 0; j < n_side; ++j) {
+            const glm::vec3 &normal = axes[f][0], &u_axis = axes[f][1], &v_axis = axes[f][2];
+            /* (2j - n) / n is exact in sign, so -coord(j) == coord(n - j)
+             * and faces agree on their shared edges.
+             */
+            const float v = float(2 * j - n) / n;
+            const unsigned int base = f * face_vertices + j * n_side;
+            for (int i = 0; i < n_side; ++i) {
+                const float u = float(2 * i - n) / n;
+                glm::vec3 p = cube_to_sphere(normal + u * u_axis + v * v_axis);
+                vertex[base + i].position_ = p;
+                vertex[base + i].normal_ = p;
+                vertex[base + i].texture_coords_ = glm::vec2(float(i) / n, float(j) / n);
+            }
+            if (j == n) continue;
+
+            unsigned int *tri = indices + f * face_indices + size_t(j) * n * 6;
+            for (int i = 0; i < n; ++i) {
+                unsigned int p = base + i;
+                unsigned int q = p + n_side;
+                *tri++ = p;
+                *tri++ = p + 1;
+                *tri++ = q + 1;
+                *tri++ = p;
+                *tri++ = q + 1;
+                *tri++ = q;
+            }
+        }
+    }
+    return sphere;
+}
@@ -0,0 +1,377 @@
+#include "cgcl/mesh/Subdivision.h"
+#include "cgcl/mesh/Normals.h"
+#include "cgcl/surface/WavefrontOBJ.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+using namespace cgcl;
+
+
+/// \brief Polygons of one level with their edges, and the edges and
+/// faces around every vertex in CSR form.
+struct PolyTopology {
+    size_t n_vertices;
+    std::vector<uint32_t> face_offsets;  // n_faces + 1
+    std::vector<uint32_t> face_vertices; // corner c of a face is face_vertices[c]
+    std::vector<uint32_t> corner_faces;
+    /* Edge of corner c, from its vertex to the next one of the face. */
+    std::vector<uint32_t> corner_edges;
+    std::vector<uint32_t> edge_vertices; // two per edge
+    std::vector<uint32_t> edge_n_faces;
+    std::vector<int32_t> edge_corners;   // first two corners on the edge, -1 if none
+    std::vector<uint32_t> vertex_edge_offsets, vertex_edges;
+    std::vector<uint32_t> vertex_face_offsets, vertex_faces;
+
+    size_t nFaces() const { return face_offsets.size() - 1; }
+    size_t nEdges() const { return edge_n_faces.size(); }
+    uint32_t faceSize(uint32_t f) const { return face_offsets[f + 1] - face_offsets[f]; }
+    uint32_t nextCorner(uint32_t c) const {
+        const uint32_t f = corner_faces[c];
+        return c + 1 == face_offsets[f + 1] ? face_offsets[f] : c + 1;
+    }
+    uint32_t prevCorner(uint32_t c) const {
+        const uint32_t f = corner_faces[c];
+        return c == face_offsets[f] ? face_offsets[f + 1] - 1 : c - 1;
+    }
+    uint32_t otherEnd(uint32_t e, uint32_t v) const {
+        return edge_vertices[2 * e] == v ? edge_vertices[2 * e + 1] : edge_vertices[2 * e];
+    }
+    bool isBorder(uint32_t e) const { return edge_n_faces[e] == 1; }
+
+    /// \brief Find the edges by sorting the corners by their edge.
+    void build() {
+        const size_t n_corners = face_vertices.size(), n_faces = nFaces();
+        corner_faces.resize(n_corners);
+        for (size_t f = 0; f < n_faces; ++f)
+            std::fill(corner_faces.begin() + face_offsets[f], corner_faces.begin() + face_offsets[f + 1], f);
+
+        std::vector<std::pair<uint64_t, uint32_t>> keys(n_corners);
+#pragma omp parallel for schedule(static)
+        for (long c = 0; c < long(n_corners); ++c) {
+            const uint32_t a = face_vertices[c], b = face_vertices[nextCorner(c)];
+            keys[c] = {uint64_t(std::min(a, b)) << 32 | std::max(a, b), uint32_t(c)};
+        }
+        std::sort(keys.begin(), keys.end());
+
+        corner_edges.resize(n_corners);
+        edge_vertices.clear();
+        edge_n_faces.clear();
+        edge_corners.clear();
+        for (size_t k = 0; k < n_corners; ++k) {
+            if (k == 0 || keys[k].first != keys[k - 1].first) {
+                edge_vertices.push_back(uint32_t(keys[k].first >> 32));
+                edge_vertices.push_back(uint32_t(keys[k].first));
+                edge_n_faces.push_back(0);
+                edge_corners.push_back(-1);
+                edge_corners.push_back(-1);
+            }
+            const uint32_t e = edge_n_faces.size() - 1;
+            if (edge_n_faces[e] < 2)
+                edge_corners[2 * e + edge_n_faces[e]] = keys[k].second;
+            edge_n_faces[e]++;
+            corner_edges[keys[k].second] = e;
+        }
+
+        /* Edges and faces around vertices, by counting. */
+        const size_t n_edges = nEdges();
+        vertex_edge_offsets.assign(n_vertices + 1, 0);
+        for (uint32_t v : edge_vertices)
+            vertex_edge_offsets[v + 1]++;
+        std::partial_sum(vertex_edge_offsets.begin(), vertex_edge_offsets.end(), vertex_edge_offsets.begin());
+        vertex_edges.resize(edge_vertices.size());
+        std::vector<uint32_t> cursor(vertex_edge_offsets.begin(), vertex_edge_offsets.end() - 1);
+        for (size_t e = 0; e < n_edges; ++e) {
+            vertex_edges[cursor[edge_vertices[2 * e]]++] = e;
+            vertex_edges[cursor[edge_vertices[2 * e + 1]]++] = e;
+        }
+
+        vertex_face_offsets.assign(n_vertices + 1, 0);
+        for (uint32_t v : face_vertices)
+            vertex_face_offsets[v + 1]++;
+        std::partial_sum(vertex_face_offsets.begin(), vertex_face_offsets.end(), vertex_face_offsets.begin());
+        vertex_faces.resize(n_corners);
+        cursor.assign(vertex_face_offsets.begin(), vertex_face_offsets.end() - 1);
+        for (size_t c = 0; c < n_corners; ++c)
+            vertex_faces[cursor[face_vertices[c]]++] = corner_faces[c];
+    }
+};
+
+/// \brief Weights of one stencil row, sources may repeat until merged.
+struct StencilRow {
+    std::vector<std::pair<uint32_t, float>> entries;
+
+    void clear() { entries.clear(); }
+    void add(uint32_t source, float weight) { entries.emplace_back(source, weight); }
+    void addFace(const PolyTopology &level, uint32_t f, float weight) {
+        const float w = weight / level.faceSize(f);
+        for (uint32_t c = level.face_offsets[f]; c < level.face_offsets[f + 1]; ++c)
+            add(level.face_vertices[c], w);
+    }
+    /// \brief Sort by source and sum repeated ones.
+    void merge() {
+        std::sort(entries.begin(), entries.end());
+        size_t n = 0;
+        for (size_t k = 0; k < entries.size(); ++k) {
+            if (n > 0 && entries[n - 1].first == entries[k].first)
+                entries[n - 1].second += entries[k].second;
+            else
+                entries[n++] = entries[k];
+        }
+        entries.resize(n);
+    }
+};
+
+/// \brief Border neighbors of a vertex, false unless it has exactly two.
+static bool border_neighbors(const PolyTopology &level, uint32_t v, uint32_t neighbors[2]) {
+    int n_border = 0;
+    for (uint32_t k = level.vertex_edge_offsets[v]; k < level.vertex_edge_offsets[v + 1]; ++k) {
+        const uint32_t e = level.vertex_edges[k];
+        if (level.edge_n_faces[e] == 2) continue;
+        if (n_border == 2) return false;
+        neighbors[n_border++] = level.otherEnd(e, v);
+    }
+    return n_border == 2;
+}
+
+/// \brief Catmull-Clark or Loop row of vertex point v.
+static void vertex_row(const PolyTopology &level, SubdivisionScheme scheme, uint32_t v, StencilRow &row) {
+    const uint32_t e_begin = level.vertex_edge_offsets[v], e_end = level.vertex_edge_offsets[v + 1];
+    const uint32_t n = e_end - e_begin;
+    const uint32_t n_faces = level.vertex_face_offsets[v + 1] - level.vertex_face_offsets[v];
+    bool interior = n > 0 && n == n_faces;
+    for (uint32_t k = e_begin; k < e_end && interior; ++k)
+        interior = level.edge_n_faces[level.vertex_edges[k]] == 2;
+
+    uint32_t neighbors[2];
+    if (interior && scheme == SubdivisionScheme::CatmullClark) {
+        /* (F + 2R + (n - 3) P) / n, F and R the averages of the face
+         * points and edge midpoints around.
+         */
+        const float inv_n2 = 1.0f / (float(n) * n);
+        row.add(v, float(n - 3) / n);
+        for (uint32_t k = e_begin; k < e_end; ++k) {
+            row.add(v, inv_n2);
+            row.add(level.otherEnd(level.vertex_edges[k], v), inv_n2);
+        }
+        for (uint32_t k = level.vertex_face_offsets[v]; k < level.vertex_face_offsets[v + 1]; ++k)
+            row.addFace(level, level.vertex_faces[k], inv_n2);
+    } else if (interior) {
+        /* Warren's weights. */
+        const float beta = n == 3 ? 3.0f / 16.0f : 3.0f / (8.0f * n);
+        row.add(v, 1.0f - n * beta);
+        for (uint32_t k = e_begin; k < e_end; ++k)
+            row.add(level.otherEnd(level.vertex_edges[k], v), beta);
+    } else if (border_neighbors(level, v, neighbors)) {
+        row.add(v, 0.75f);
+        row.add(neighbors[0], 0.125f);
+        row.add(neighbors[1], 0.125f);
+    } else {
+        /* corners of non-manifold fans stay */
+        row.add(v, 1.0f);
+    }
+}
+
+/// \brief Catmull-Clark or Loop row of edge point e.
+static void edge_row(const PolyTopology &level, SubdivisionScheme scheme, uint32_t e, StencilRow &row) {
+    const uint32_t a = level.edge_vertices[2 * e], b = level.edge_vertices[2 * e + 1];
+    if (level.edge_n_faces[e] != 2) {
+        row.add(a, 0.5f);
+        row.add(b, 0.5f);
+        return;
+    }
+    if (scheme == SubdivisionScheme::CatmullClark) {
+        row.add(a, 0.25f);
+        row.add(b, 0.25f);
+        row.addFace(level, level.corner_faces[level.edge_corners[2 * e]], 0.25f);
+        row.addFace(level, level.corner_faces[level.edge_corners[2 * e + 1]], 0.25f);
+    } else {
+        row.add(a, 0.375f);
+        row.add(b, 0.375f);
+        for (int s = 0; s < 2; ++s) {
+            const uint32_t opposite = level.prevCorner(level.edge_corners[2 * e + s]);
+            row.add(level.face_vertices[opposite], 0.125f);
+        }
+    }
+}
+
+/// \brief Stencils of the next level, vertex points first, then edge
+/// points, then Catmull-Clark face points. Rows are built in parallel.
+static StencilTable level_stencils(const PolyTopology &level, SubdivisionScheme scheme) {
+    const size_t n_v = level.n_vertices, n_e = level.nEdges();
+    const size_t n_rows = n_v + n_e + (scheme == SubdivisionScheme::CatmullClark ? level.nFaces() : 0);
+    std::vector<StencilRow> rows(n_rows);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (long i = 0; i < long(n_rows); ++i) {
+        if (size_t(i) < n_v)
+            vertex_row(level, scheme, i, rows[i]);
+        else if (size_t(i) < n_v + n_e)
+            edge_row(level, scheme, i - n_v, rows[i]);
+        else
+            rows[i].addFace(level, i - n_v - n_e, 1.0f);
+        rows[i].merge();
+    }
+
+    StencilTable table;
+    table.offsets_.resize(n_rows + 1, 0);
+    for (size_t i = 0; i < n_rows; ++i)
+        table.offsets_[i + 1] = table.offsets_[i] + rows[i].entries.size();
+    table.sources_.resize(table.offsets_[n_rows]);
+    table.weights_.resize(table.offsets_[n_rows]);
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < long(n_rows); ++i) {
+        uint32_t k = table.offsets_[i];
+        for (const auto &entry : rows[i].entries) {
+            table.sources_[k] = entry.first;
+            table.weights_[k++] = entry.second;
+        }
+    }
+    return table;
+}
+
+/// \brief Faces of the next level, numbered as in level_stencils.
+static PolyTopology refine_topology(const PolyTopology &level, SubdivisionScheme scheme) {
+    PolyTopology next;
+    const uint32_t n_v = level.n_vertices, n_e = level.nEdges();
+    const size_t n_corners = level.face_vertices.size();
+    if (scheme == SubdivisionScheme::CatmullClark) {
+        /* A quad per corner: vertex, edge after, face, edge before. */
+        next.n_vertices = n_v + n_e + level.nFaces();
+        next.face_offsets.resize(n_corners + 1);
+        next.face_vertices.resize(4 * n_corners);
+#pragma omp parallel for schedule(static)
+        for (long c = 0; c < long(n_corners); ++c) {
+            uint32_t *quad = &next.face_vertices[4 * c];
+            quad[0] = level.face_vertices[c];
+            quad[1] = n_v + level.corner_edges[c];
+            quad[2] = n_v + n_e + level.corner_faces[c];
+            quad[3] = n_v + level.corner_edges[level.prevCorner(c)];
+            next.face_offsets[c + 1] = 4 * (c + 1);
+        }
+    } else {
+        /* Four triangles per triangle, the corners then the middle one. */
+        const size_t n_faces = level.nFaces();
+        next.n_vertices = n_v + n_e;
+        next.face_offsets.resize(4 * n_faces + 1);
+        next.face_vertices.resize(12 * n_faces);
+#pragma omp parallel for schedule(static)
+        for (long f = 0; f < long(n_faces); ++f) {
+            const uint32_t c = level.face_offsets[f];
+            const uint32_t v[3] = {level.face_vertices[c], level.face_vertices[c + 1], level.face_vertices[c + 2]};
+            const uint32_t e[3] = {n_v + level.corner_edges[c], n_v + level.corner_edges[c + 1],
+                                   n_v + level.corner_edges[c + 2]};
+            const uint32_t triangles[12] = {v[0], e[0], e[2], e[0], v[1], e[1],
+                                            e[2], e[1], v[2], e[0], e[1], e[2]};
+            std::copy(triangles, triangles + 12, &next.face_vertices[12 * f]);
+            for (int k = 0; k < 4; ++k)
+                next.face_offsets[4 * f + k + 1] = 12 * f + 3 * (k + 1);
+        }
+    }
+    next.build();
+    return next;
+}
+
+Subdivision Subdivision::build(const std::vector<unsigned int> &face_sizes,
+                               const std::vector<unsigned int> &face_vertices,
+                               size_t n_vertices, unsigned int levels) {
+    PolyTopology level;
+    level.n_vertices = n_vertices;
+    level.face_offsets.resize(face_sizes.size() + 1, 0);
+    bool triangles = true;
+    for (size_t f = 0; f < face_sizes.size(); ++f) {
+        CHECK_GE(face_sizes[f], 3u) << "Face " << f << " is not a polygon";
+        level.face_offsets[f + 1] = level.face_offsets[f] + face_sizes[f];
+        triangles = triangles && face_sizes[f] == 3;
+    }
+    CHECK_EQ(level.face_offsets.back(), face_vertices.size()) << "Face sizes do not match vertices";
+    level.face_vertices.assign(face_vertices.begin(), face_vertices.end());
+    level.build();
+
+    Subdivision subdivision;
+    subdivision.scheme_ = triangles ? SubdivisionScheme::Loop : SubdivisionScheme::CatmullClark;
+    subdivision.n_cage_vertices_ = n_vertices;
+    for (unsigned int l = 0; l < levels; ++l) {
+        subdivision.stencils_.push_back(level_stencils(level, subdivision.scheme_));
+        level = refine_topology(level, subdivision.scheme_);
+        LOG(INFO) << "Subdivision level " << l + 1 << ": " << level.n_vertices << " vertices, "
+                  << level.nFaces() << " faces";
+    }
+
+    /* Fan every face of the finest level into triangles. */
+    auto &indices = subdivision.indices_;
+    for (size_t f = 0; f < level.nFaces(); ++f) {
+        const uint32_t first = level.face_offsets[f];
+        for (uint32_t c = first + 1; c + 1 < level.face_offsets[f + 1]; ++c) {
+            indices.push_back(level.face_vertices[first]);
+            indices.push_back(level.face_vertices[c]);
+            indices.push_back(level.face_vertices[c + 1]);
+        }
+    }
+    return subdivision;
+}
+
+Subdivision Subdivision::from_obj(const std::string &filename, unsigned int levels,
+                                  std::vector<glm::vec3> &cage) {
+    std::vector<std::unique_ptr<Geometry>> geometry;
+    GlobalVertices global_vertices;
+    OBJParser parser(filename);
+    parser.parse(geometry, global_vertices);
+
+    std::vector<unsigned int> face_sizes, face_vertices;
+    for (const auto &geom : geometry) {
+        for (const auto &face : geom->face_elements_) {
+            if (face.corner_count_ < 3) continue;
+            face_sizes.push_back(face.corner_count_);
+            for (int k = 0; k < face.corner_count_; ++k)
+                face_vertices.push_back(geom->face_corners_[face.start_index_ + k].vert_index);
+        }
+    }
+    cage = std::move(global_vertices.vertices);
+    return build(face_sizes, face_vertices, cage.size(), levels);
+}
+
+void Subdivision::evaluate(const glm::vec3 *cage, std::vector<glm::vec3> &refined) const {
+    if (stencils_.empty()) {
+        refined.assign(cage, cage + n_cage_vertices_);
+        return;
+    }
+    /* Ping-pong between two buffers, the last level lands in refined. */
+    std::vector<glm::vec3> scratch;
+    const glm::vec3 *src = cage;
+    for (size_t l = 0; l < stencils_.size(); ++l) {
+        std::vector<glm::vec3> &dst = (stencils_.size() - l) % 2 == 1 ? refined : scratch;
+        dst.resize(stencils_[l].size());
+        stencils_[l].apply(src, dst.data());
+        src = dst.data();
+    }
+}
+
+std::unique_ptr<TriMesh> Subdivision::toMesh(const std::vector<glm::vec3> &cage) const {
+    CHECK_EQ(cage.size(), n_cage_vertices_) << "Cage does not match the subdivision";
+    std::vector<glm::vec3> positions;
+    evaluate(cage.data(), positions);
+    std::vector<Vertex> vertices(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+        vertices[i].position_ = positions[i];
+    std::vector<unsigned int> indices = indices_;
+    /* Smooth everywhere, so no vertex is split and update() can
+     * write positions in the same order.
+     */
+    generate_normals(vertices, indices.data(), indices.size());
+    return std::make_unique<TriMesh>(std::move(vertices), std::move(indices));
+}
+
+void Subdivision::update(TriMesh &mesh, const std::vector<glm::vec3> &cage) const {
+    CHECK_EQ(cage.size(), n_cage_vertices_) << "Cage does not match the subdivision";
+    CHECK_EQ(mesh.global_vertices_.size(), n_vertices()) << "Mesh was not made by this subdivision";
+    std::vector<glm::vec3> positions;
+    evaluate(cage.data(), positions);
+    const long n = positions.size();
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; ++i)
+        mesh.global_vertices_[i].position_ = positions[i];
+    generate_normals(mesh.global_vertices_, mesh.global_indices_.data(), mesh.global_indices_.size());
+    mesh.computeBounds();
+}
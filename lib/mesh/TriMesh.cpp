@@ -1,15 +1,31 @@
 #include "cgcl/mesh/TriMesh.h"
+#include "cgcl/mesh/MeshOptimizer.h"
+#include "cgcl/mesh/MeshCodec.h"
+#include "cgcl/mesh/Normals.h"
 #include "cgcl/surface/WavefrontOBJ.h"
 
 #include <glm/gtx/string_cast.hpp>
 #include "cgcl/utils/logging.h"
+#include "cgcl/utils/Loader.h"
+#include "cgcl/platform/OpenGL/GLShader.h"
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+
 using namespace cgcl;
 
 
 
+/* Smooth shaded faces of an OBJ without normals are still split
+ * where they meet at a sharper angle, in radians.
+ */
+static constexpr float obj_crease_angle = 1.0471976f;
+
 std::unique_ptr<Mesh> 
 TriMesh::from_obj(const std::string &filename) {
     std::vector<std::unique_ptr<Geometry>> geometry;
@@ -18,77 +34,466 @@ TriMesh::from_obj(const std::string &filename) {
     OBJParser parser(filename);
     parser.parse(geometry, global_vertices);
 
-    size_t n_vertices = global_vertices.vertices.size();
-    /* Change Wavefront OBJ to mesh,
-     * take the average of multiple normal vector as the
-     * normal of vectex. 
+    std::map<std::string, std::unique_ptr<MTLMaterial>> library;
+    for (const auto &mtl_library : parser.get_mtl_libraries())
+        MTLParser(mtl_library, filename).parse(library);
+
+    /* Materials of the mesh in the order first used, and for every
+     * geometry the mesh material of each of its material indices.
      */
+    std::vector<MTLMaterial> materials;
+    std::map<std::string, int> material_ids;
+    std::vector<std::vector<int>> geom_materials(geometry.size());
+    for (size_t g = 0; g < geometry.size(); ++g) {
+        for (const auto &name : geometry[g]->material_order_) {
+            auto it = material_ids.find(name);
+            if (it == material_ids.end()) {
+                auto found = library.find(name);
+                if (found == library.end())
+                    LOG(WARNING) << "Material " << name << " not found in MTL libraries";
+                it = material_ids.emplace(name, materials.size()).first;
+                materials.push_back(found == library.end() ? MTLMaterial() : *found->second);
+                materials.back().name_ = name;
+            }
+            geom_materials[g].push_back(it->second);
+        }
+    }
 
-    std::vector<Vertex> vertex(n_vertices);
-    std::vector<unsigned int> indices;
-    for (int i = 0; i < n_vertices; ++i) {
-        vertex[i].position_ = global_vertices.vertices[i];
+    /* One sub-mesh per (material, geometry) with faces, sorted by material
+     * so all ranges of a material are adjacent. Polygons are fans of triangles.
+     */
+    using SubMeshKey = std::pair<int, int>;
+    std::map<SubMeshKey, unsigned int> sub_mesh_counts;
+    auto key_of = [&](size_t g, const PolyElem &face) {
+        return SubMeshKey(face.material_index_ < 0 ? -1 : geom_materials[g][face.material_index_], int(g));
+    };
+    for (size_t g = 0; g < geometry.size(); ++g) {
+        for (const auto &face : geometry[g]->face_elements_) {
+            if (face.corner_count_ >= 3)
+                sub_mesh_counts[key_of(g, face)] += (face.corner_count_ - 2) * 3;
+        }
+    }
+    std::map<SubMeshKey, unsigned int> cursors;
+    std::vector<unsigned int> offsets, counts;
+    std::vector<int> sub_mesh_materials;
+    unsigned int n_indices = 0;
+    for (const auto &[key, count] : sub_mesh_counts) {
+        cursors[key] = n_indices;
+        offsets.push_back(n_indices);
+        counts.push_back(count);
+        sub_mesh_materials.push_back(key.first);
+        n_indices += count;
     }
 
-    for (const auto &geom: geometry) {
+    /* Normals of the file are used only if every corner has one,
+     * otherwise all are generated from the faces and smoothing groups.
+     */
+    bool file_normals = !global_vertices.vertex_normals.empty();
+    for (const auto &geom : geometry) {
+        for (const auto &corner : geom->face_corners_)
+            file_normals = file_normals && corner.vertex_normal_index >= 0;
+    }
+
+    /* A vertex per distinct (position, uv, normal) of the corners,
+     * so uv and normal seams split the vertices sharing a position.
+     */
+    struct CornerHash {
+        size_t operator()(const PolyCorner &c) const {
+            return (size_t(c.vert_index) * 73856093u) ^ (size_t(c.uv_vert_index + 1) * 19349663u) ^
+                   (size_t(c.vertex_normal_index + 1) * 83492791u);
+        }
+    };
+    struct CornerEqual {
+        bool operator()(const PolyCorner &a, const PolyCorner &b) const {
+            return a.vert_index == b.vert_index && a.uv_vert_index == b.uv_vert_index &&
+                   a.vertex_normal_index == b.vertex_normal_index;
+        }
+    };
+    std::unordered_map<PolyCorner, unsigned int, CornerHash, CornerEqual> corner_vertex;
+    std::vector<Vertex> vertex;
+    vertex.reserve(global_vertices.vertices.size());
+    auto vertex_of = [&](PolyCorner corner) {
+        if (!file_normals)
+            corner.vertex_normal_index = -1;
+        auto [it, inserted] = corner_vertex.emplace(corner, vertex.size());
+        if (inserted) {
+            Vertex v{global_vertices.vertices[corner.vert_index], glm::vec3(0.0f), glm::vec2(0.0f)};
+            if (corner.vertex_normal_index >= 0)
+                v.normal_ = glm::normalize(global_vertices.vertex_normals[corner.vertex_normal_index]);
+            if (corner.uv_vert_index >= 0)
+                v.texture_coords_ = global_vertices.uv_vertices[corner.uv_vert_index];
+            vertex.push_back(v);
+        }
+        return it->second;
+    };
+
+    std::vector<unsigned int> indices(n_indices);
+    std::vector<uint8_t> smooth(n_indices / 3);
+    for (size_t g = 0; g < geometry.size(); ++g) {
+        const auto &geom = geometry[g];
         for (const auto &face : geom->face_elements_) {
-            for (int n_corners = 0; n_corners < face.corner_count_; ++n_corners) {
-                const auto &corner = geom->face_corners_[face.start_index_ + n_corners];
-                int normal_index = corner.vertex_normal_index;
-                int vertex_index = corner.vert_index;
-                /* unormalized normal vector */
-                vertex[vertex_index].normal_ += global_vertices.vertex_normals[normal_index];
-                indices.push_back(vertex_index);
+            if (face.corner_count_ < 3) continue;
+            unsigned int &cursor = cursors[key_of(g, face)];
+            const PolyCorner *corners = &geom->face_corners_[face.start_index_];
+            const unsigned int first = vertex_of(corners[0]);
+            unsigned int previous = vertex_of(corners[1]);
+            for (int k = 2; k < face.corner_count_; ++k) {
+                const unsigned int next = vertex_of(corners[k]);
+                smooth[cursor / 3] = face.shaded_smooth_;
+                indices[cursor++] = first;
+                indices[cursor++] = previous;
+                indices[cursor++] = next;
+                previous = next;
             }
         }
     }
+    if (!file_normals)
+        generate_normals(vertex, indices.data(), indices.size(), smooth.data(), obj_crease_angle);
+    LOG(INFO) << "OBJ mesh: " << vertex.size() << " vertices, " << offsets.size()
+              << " sub-meshes of " << materials.size() << " materials";
 
     auto mesh = std::make_unique<TriMesh>(std::move(vertex), std::move(indices));
+    mesh->offsets_ = std::move(offsets);
+    mesh->counts_ = std::move(counts);
+    mesh->materials_ = std::move(materials);
+    mesh->sub_mesh_materials_ = std::move(sub_mesh_materials);
+    /* Tangents first: the vertices they split at uv mirrors then go
+     * through the cache and fetch reordering with the rest. */
+    for (const auto &material : mesh->materials_) {
+        if (material.tex_map_[int(MTLTexMapType::Normal)].isValid()) {
+            mesh->generateTangents();
+            break;
+        }
+    }
+    mesh->optimize();
     return mesh;
 }
 
-std::unique_ptr<Mesh> 
-TriMesh::from_bezier(const BezierSurface &bezier) {
+/// \brief Patch to tessellate, either a BezierSurface or one 
+/// patch of the contiguous control points in a BezierPatchSet.
+struct BezierPatchView {
+    unsigned int n_us, n_vs;
+    const glm::vec3 *ctrl_pts;
+    const float *weights;
+};
 
-    std::vector<Vertex> vertex;
-    std::vector<unsigned int> indices;
+static BezierPatchView view_of(const BezierSurface &bezier) {
+    return {bezier.n_us, bezier.n_vs, bezier.ctrl_pts_.data(),
+            bezier.weights_.empty() ? nullptr : bezier.weights_.data()};
+}
+
+/* Bezier patch is tessellated into a (3 * n_us) x (3 * n_vs) grid. */
+static unsigned int bezier_grid_vertices(const BezierPatchView &bezier) {
+    return (bezier.n_us * 3) * (bezier.n_vs * 3);
+}
+
+static unsigned int bezier_grid_indices(const BezierPatchView &bezier) {
+    return (bezier.n_us * 3 - 1) * (bezier.n_vs * 3 - 1) * 2 * 3;
+}
 
+/// \brief Write the tessellated grid of one patch into preallocated
+/// buffers, indices are shifted by base_vertex.
+static void tessellate_bezier(const BezierPatchView &bezier, Vertex *vertex, 
+                              unsigned int *indices, unsigned int base_vertex) {
     unsigned int u_mesh = bezier.n_us * 3;
     unsigned int v_mesh = bezier.n_vs * 3;
     float du = 1.0 / (u_mesh - 1);
     float dv = 1.0 / (v_mesh - 1);
 
-    // vertex.resize(u_mesh * v_mesh);
-    // indices.resize(u_mesh * v_mesh * 2 * 3);
-    Vertex vert;
     for (int i = 0; i < u_mesh; ++i) {
         float u = du * i;
         for (int j = 0; j < v_mesh; ++j) {
             float v = dv * j;
-            glm::vec3 position = bezier.getPoint(u, v);
-            vert.position_ = position;
-            vertex.push_back(vert);
+            vertex[i * v_mesh + j].position_ = BezierSurface::evaluate(
+                bezier.n_us, bezier.n_vs, bezier.ctrl_pts, bezier.weights, u, v);
         }
     } 
 
     for (int i = 0; i < u_mesh - 1; ++i) {
         for (int j = 0; j < v_mesh - 1; ++j) {
-            unsigned int dudv_index = i * v_mesh + j;
-            indices.push_back(dudv_index);
-            indices.push_back(dudv_index + 1);
-            indices.push_back(dudv_index + v_mesh);
-
-            indices.push_back(dudv_index + 1);
-            indices.push_back(dudv_index + v_mesh);
-            indices.push_back(dudv_index + v_mesh + 1);
+            unsigned int dudv_index = base_vertex + i * v_mesh + j;
+            unsigned int *tri = indices + (i * (v_mesh - 1) + j) * 6;
+            tri[0] = dudv_index;
+            tri[1] = dudv_index + 1;
+            tri[2] = dudv_index + v_mesh;
+
+            tri[3] = dudv_index + 1;
+            tri[4] = dudv_index + v_mesh;
+            tri[5] = dudv_index + v_mesh + 1;
         }
     }
+}
+
+std::unique_ptr<Mesh> 
+TriMesh::from_bezier(const BezierSurface &bezier) {
+    auto patch = view_of(bezier);
 
+    std::vector<Vertex> vertex(bezier_grid_vertices(patch));
+    std::vector<unsigned int> indices(bezier_grid_indices(patch));
+
+    tessellate_bezier(patch, vertex.data(), indices.data(), 0);
+    generate_normals(vertex, indices.data(), indices.size());
+
+    auto mesh = std::make_unique<TriMesh>(std::move(vertex), std::move(indices));
+    mesh->optimize();
+    return mesh;
+}
+
+static std::unique_ptr<TriMesh> tessellate_bezier_batch(const std::vector<BezierPatchView> &patches) {
+    const int n_patches = patches.size();
+    /* Exclusive prefix sum of the size of each patch,
+     * so every patch knows where to write before tessellation.
+     */
+    std::vector<unsigned int> vertex_offsets(n_patches + 1, 0);
+    std::vector<unsigned int> offsets(n_patches + 1, 0);
+    for (int k = 0; k < n_patches; ++k) {
+        vertex_offsets[k + 1] = vertex_offsets[k] + bezier_grid_vertices(patches[k]);
+        offsets[k + 1] = offsets[k] + bezier_grid_indices(patches[k]);
+    }
+
+    std::vector<Vertex> vertex(vertex_offsets[n_patches]);
+    std::vector<unsigned int> indices(offsets[n_patches]);
+
+    /* Patches differ in degree, balance them dynamically. */
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int k = 0; k < n_patches; ++k) {
+        tessellate_bezier(patches[k], vertex.data() + vertex_offsets[k],
+                          indices.data() + offsets[k], vertex_offsets[k]);
+    }
+    /* Patches own their vertices, smooth shading splits nothing. */
+    generate_normals(vertex, indices.data(), indices.size());
 
     auto mesh = std::make_unique<TriMesh>(std::move(vertex), std::move(indices));
+    mesh->counts_.resize(n_patches);
+    for (int k = 0; k < n_patches; ++k)
+        mesh->counts_[k] = offsets[k + 1] - offsets[k];
+    offsets.pop_back();
+    mesh->offsets_ = std::move(offsets);
+    mesh->optimize();
     return mesh;
 }
 
+std::unique_ptr<Mesh> 
+TriMesh::from_bezier_patches(const std::vector<BezierSurface> &patches) {
+    std::vector<BezierPatchView> views;
+    views.reserve(patches.size());
+    for (const auto &patch : patches)
+        views.push_back(view_of(patch));
+    return tessellate_bezier_batch(views);
+}
+
+std::unique_ptr<Mesh> 
+TriMesh::from_bezier_patches(const BezierPatchSet &patches) {
+    std::vector<BezierPatchView> views(patches.size());
+    for (size_t k = 0; k < patches.size(); ++k) {
+        const auto &record = patches.patch(k);
+        views[k] = {record.n_us, record.n_vs, patches.ctrl_pts(k), nullptr};
+    }
+    return tessellate_bezier_batch(views);
+}
+
+std::unique_ptr<Mesh> 
+TriMesh::from_nurbs(const NURBSSurface &nurbs) {
+    return from_bezier_patches(nurbs.toBezierPatches());
+}
+
+/* File layout of saveCompressed, all fields little-endian uint32 or
+ * float, strings as their length then their bytes:
+ * magic, version, n_vertices, n_indices, n_sub_meshes,
+ * offsets_ and counts_ of the sub-meshes,
+ * n_materials, each as name, Ka, Kd, Ks, Ns, Ni, d and the image and
+ * directory path of every texture map,
+ * sub_mesh_materials_ (n_sub_meshes of them if n_materials > 0),
+ * n_tangents (0 or n_vertices),
+ * size of the vertex, index and tangent streams, the streams.
+ * Version 1 lacked materials and tangents.
+ */
+static constexpr uint32_t compressed_magic = 0x4d434743; // "CGCM"
+static constexpr uint32_t compressed_version = 2;
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t value) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &value, 4);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+static void put_floats(std::vector<uint8_t> &out, const float *values, size_t n) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(values);
+    out.insert(out.end(), bytes, bytes + 4 * n);
+}
+
+static void put_string(std::vector<uint8_t> &out, const std::string &value) {
+    put_u32(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+void TriMesh::saveCompressed(const std::string &filename) const {
+    CHECK(materials_.empty() || sub_mesh_materials_.size() == offsets_.size()) << "Sub-meshes without a material";
+    CHECK(tangents_.empty() || tangents_.size() == global_vertices_.size()) << "Tangents do not match the vertices";
+    auto vertex_stream = encode_vertex_buffer(global_vertices_.data(), global_vertices_.size(), sizeof(Vertex));
+    auto index_stream = encode_index_buffer(global_indices_.data(), global_indices_.size());
+    std::vector<uint8_t> tangent_stream;
+    if (!tangents_.empty())
+        tangent_stream = encode_vertex_buffer(tangents_.data(), tangents_.size(), sizeof(glm::vec4));
+
+    std::vector<uint8_t> header;
+    for (uint32_t value : {compressed_magic, compressed_version, uint32_t(global_vertices_.size()),
+                           uint32_t(global_indices_.size()), uint32_t(offsets_.size())})
+        put_u32(header, value);
+    for (unsigned int offset : offsets_) put_u32(header, offset);
+    for (unsigned int count : counts_) put_u32(header, count);
+    put_u32(header, materials_.size());
+    for (const MTLMaterial &material : materials_) {
+        put_string(header, material.name_);
+        put_floats(header, &material.Ka_.x, 3);
+        put_floats(header, &material.Kd_.x, 3);
+        put_floats(header, &material.Ks_.x, 3);
+        for (float value : {material.Ns_, material.Ni_, material.d})
+            put_floats(header, &value, 1);
+        for (const MTLTexMap &map : material.tex_map_) {
+            put_string(header, map.image_path_);
+            put_string(header, map.mtl_dir_path);
+        }
+    }
+    if (!materials_.empty())
+        for (int material_id : sub_mesh_materials_) put_u32(header, uint32_t(material_id));
+    put_u32(header, tangents_.size());
+    put_u32(header, vertex_stream.size());
+    put_u32(header, index_stream.size());
+    put_u32(header, tangent_stream.size());
+
+    std::ofstream out(filename, std::ios::binary);
+    CHECK(out) << "Failed to open " << filename;
+    for (const auto *part : {&header, &vertex_stream, &index_stream, &tangent_stream})
+        out.write(reinterpret_cast<const char *>(part->data()), part->size());
+    CHECK(out) << "Failed to write " << filename;
+    LOG(INFO) << "Compressed " << global_vertices_.size() * sizeof(Vertex) + global_indices_.size() * 4
+              << " bytes of mesh into " << vertex_stream.size() + index_stream.size();
+}
+
+std::unique_ptr<Mesh>
+TriMesh::from_compressed(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    CHECK(in) << "Failed to open " << filename;
+    std::vector<uint8_t> file(in.tellg());
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(file.data()), file.size());
+    CHECK(in) << "Failed to read " << filename;
+
+    size_t cursor = 0;
+    auto next_bytes = [&](size_t n) {
+        CHECK_LE(n, file.size() - cursor) << "Truncated " << filename;
+        const uint8_t *bytes = file.data() + cursor;
+        cursor += n;
+        return bytes;
+    };
+    auto next = [&]() {
+        uint32_t value;
+        std::memcpy(&value, next_bytes(4), 4);
+        return value;
+    };
+    auto next_floats = [&](float *values, size_t n) { std::memcpy(values, next_bytes(4 * n), 4 * n); };
+    auto next_string = [&]() {
+        const uint32_t length = next();
+        const uint8_t *bytes = next_bytes(length);
+        return std::string(bytes, bytes + length);
+    };
+    CHECK_EQ(next(), compressed_magic) << filename << " is not a compressed mesh";
+    const uint32_t version = next();
+    CHECK_EQ(version, compressed_version) << filename << " has version " << version << ", only version "
+                                          << compressed_version << " is read, save it again";
+    const uint32_t n_vertices = next(), n_indices = next(), n_sub_meshes = next();
+    CHECK_LE(n_sub_meshes, (file.size() - cursor) / 8) << "Truncated " << filename;
+    std::vector<unsigned int> offsets(n_sub_meshes), counts(n_sub_meshes);
+    for (auto &offset : offsets) offset = next();
+    for (auto &count : counts) count = next();
+    for (uint32_t k = 0; k < n_sub_meshes; ++k)
+        CHECK(offsets[k] <= n_indices && counts[k] <= n_indices - offsets[k]) << "Corrupt " << filename;
+
+    const uint32_t n_materials = next();
+    std::vector<MTLMaterial> materials;
+    for (uint32_t m = 0; m < n_materials; ++m) {
+        MTLMaterial material;
+        material.name_ = next_string();
+        next_floats(&material.Ka_.x, 3);
+        next_floats(&material.Kd_.x, 3);
+        next_floats(&material.Ks_.x, 3);
+        next_floats(&material.Ns_, 1);
+        next_floats(&material.Ni_, 1);
+        next_floats(&material.d, 1);
+        for (MTLTexMap &map : material.tex_map_) {
+            map.image_path_ = next_string();
+            map.mtl_dir_path = next_string();
+        }
+        materials.push_back(std::move(material));
+    }
+    std::vector<int> sub_mesh_materials;
+    if (n_materials > 0) {
+        sub_mesh_materials.resize(n_sub_meshes);
+        for (auto &material_id : sub_mesh_materials) {
+            material_id = int(next());
+            CHECK(material_id >= -1 && material_id < int(n_materials)) << "Corrupt " << filename;
+        }
+    }
+    const uint32_t n_tangents = next();
+    CHECK(n_tangents == 0 || n_tangents == n_vertices) << "Corrupt " << filename;
+
+    const uint32_t vertex_size = next(), index_size = next(), tangent_size = next();
+    CHECK_EQ(cursor + size_t(vertex_size) + index_size + tangent_size, file.size()) << "Corrupt " << filename;
+    /* Counts come from the file, bound them by the streams before allocating. */
+    CHECK_GE(vertex_size, min_vertex_buffer_size(n_vertices, sizeof(Vertex))) << "Corrupt " << filename;
+    CHECK_GE(index_size, min_index_buffer_size(n_indices)) << "Corrupt " << filename;
+    if (n_tangents > 0)
+        CHECK_GE(tangent_size, min_vertex_buffer_size(n_tangents, sizeof(glm::vec4))) << "Corrupt " << filename;
+
+    std::vector<Vertex> vertices(n_vertices);
+    std::vector<unsigned int> indices(n_indices);
+    decode_vertex_buffer(file.data() + cursor, vertex_size, vertices.data(), n_vertices, sizeof(Vertex));
+    decode_index_buffer(file.data() + cursor + vertex_size, index_size, indices.data(), n_indices, n_vertices);
+
+    auto mesh = std::make_unique<TriMesh>(std::move(vertices), std::move(indices));
+    mesh->offsets_ = std::move(offsets);
+    mesh->counts_ = std::move(counts);
+    mesh->materials_ = std::move(materials);
+    mesh->sub_mesh_materials_ = std::move(sub_mesh_materials);
+    if (n_tangents > 0) {
+        mesh->tangents_.resize(n_tangents);
+        decode_vertex_buffer(file.data() + cursor + vertex_size + index_size, tangent_size, mesh->tangents_.data(),
+                             n_tangents, sizeof(glm::vec4));
+    }
+    return mesh;
+}
+
+void TriMesh::computeBounds() {
+    const long n_vertices = global_vertices_.size();
+    const Vertex *vertex = global_vertices_.data();
+    AABB bounds;
+#pragma omp parallel if (n_vertices > 65536)
+    {
+        AABB local;
+#pragma omp for schedule(static) nowait
+        for (long i = 0; i < n_vertices; ++i)
+            local.expand(vertex[i].position_);
+#pragma omp critical
+        bounds.expand(local);
+    }
+
+    /* Centered at the box, looser than the minimal sphere
+     * by a few percent but one pass and parallel.
+     */
+    const glm::vec3 center = bounds.center();
+    float radius2 = 0.0f;
+#pragma omp parallel for schedule(static) reduction(max : radius2) if (n_vertices > 65536)
+    for (long i = 0; i < n_vertices; ++i) {
+        glm::vec3 d = vertex[i].position_ - center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+
+    bounds_ = bounds;
+    bounding_sphere_.center_ = center;
+    bounding_sphere_.radius_ = bounds.empty() ? -1.0f : std::sqrt(radius2);
+}
+
 void TriMesh::initGL() {
     LOG(INFO) << "TriMesh Init: ";
     LOG(INFO) << "Totol Vertex: " << global_vertices_.size();
@@ -96,21 +501,58 @@ void TriMesh::initGL() {
     //     std::cout << glm::to_string(vert.position_) << std::endl;
     // }
     LOG(INFO) << "Total Indices:" << global_indices_.size(); 
+    if (!offsets_.empty())
+        LOG(INFO) << "Total Sub-mesh: " << offsets_.size();
+
+    /* load the color and normal map of every material once */
+    textures_.assign(materials_.size(), nullptr);
+    normal_maps_.assign(materials_.size(), nullptr);
+    for (size_t m = 0; m < materials_.size(); ++m) {
+        const MTLTexMap &color = materials_[m].tex_map_[int(MTLTexMapType::Color)];
+        if (color.isValid()) {
+            textures_[m] = std::make_shared<Texture>();
+            textures_[m]->LoadTexture(Loader::getFileFromPath(color.image_path_, color.mtl_dir_path));
+        }
+        const MTLTexMap &normal = materials_[m].tex_map_[int(MTLTexMapType::Normal)];
+        if (normal.isValid() && !tangents_.empty()) {
+            normal_maps_[m] = std::make_shared<Texture>();
+            normal_maps_[m]->LoadTexture(Loader::getFileFromPath(normal.image_path_, normal.mtl_dir_path));
+        }
+    }
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
     glBindVertexArray(VAO); 
-    /* copy vertex data */
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, global_vertices_.size() * sizeof(Vertex), 
-                global_vertices_.data(), GL_STATIC_DRAW);
     /* copy index data */
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, global_indices_.size() * sizeof(unsigned int),
                 global_indices_.data(), GL_STATIC_DRAW);
 
+    if (!tangents_.empty()) {
+        /* Tangents in a buffer of their own, after the instance attributes. */
+        glGenBuffers(1, &tangent_VBO_);
+        glBindBuffer(GL_ARRAY_BUFFER, tangent_VBO_);
+        glBufferData(GL_ARRAY_BUFFER, tangents_.size() * sizeof(glm::vec4), tangents_.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(14);
+        glVertexAttribPointer(14, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void *)0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (!vertex_format_.isFull()) {
+        /* copy packed vertex data */
+        std::vector<uint8_t> packed = vertex_format_.encode(global_vertices_, bounds_);
+        glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+        vertex_format_.setAttributes();
+        LOG(INFO) << "Vertex Bytes: " << vertex_format_.stride() << " of " << sizeof(Vertex);
+        glBindVertexArray(0);
+        return;
+    }
+    /* copy vertex data */
+    glBufferData(GL_ARRAY_BUFFER, global_vertices_.size() * sizeof(Vertex), 
+                global_vertices_.data(), GL_STATIC_DRAW);
+
     /* set vertex position data */
     glEnableVertexAttribArray(0); 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
@@ -127,13 +569,143 @@ void TriMesh::initGL() {
 
 void TriMesh::render() {
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, global_indices_.size(), GL_UNSIGNED_INT, 0);
+    if (shader_ != nullptr) drawMaterials(*shader_);
+    else draw();
     glBindVertexArray(0);
 }
 
+void TriMesh::draw() {
+    glDrawElements(GL_TRIANGLES, global_indices_.size(), GL_UNSIGNED_INT, 0);
+}
+
+void TriMesh::drawRanges(const std::vector<IndexRange> &ranges) {
+    if (ranges.empty()) return;
+    std::vector<GLsizei> counts(ranges.size());
+    std::vector<const void *> offsets(ranges.size());
+    for (size_t k = 0; k < ranges.size(); ++k) {
+        counts[k] = ranges[k].count;
+        offsets[k] = (const void *)(size_t(ranges[k].first_index) * sizeof(unsigned int));
+    }
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), ranges.size());
+}
+
+void TriMesh::drawMaterials(GLShader &shader) {
+    if (materials_.empty()) {
+        draw();
+        return;
+    }
+    CHECK_EQ(sub_mesh_materials_.size(), offsets_.size()) << "Sub-meshes without a material";
+    /* Sub-meshes of a material are adjacent, draw each run as one range.
+     * Every uniform is set for every range, so nothing is left over from
+     * the previous one, and faces before any usemtl take the MTL defaults.
+     */
+    const MTLMaterial none;
+    const size_t n_sub_meshes = offsets_.size();
+    for (size_t k = 0; k < n_sub_meshes; ) {
+        const int material_id = sub_mesh_materials_[k];
+        const unsigned int first_index = offsets_[k];
+        unsigned int count = 0;
+        for (; k < n_sub_meshes && sub_mesh_materials_[k] == material_id; ++k)
+            count += counts_[k];
+        const MTLMaterial &material = material_id >= 0 ? materials_[material_id] : none;
+        const Texture *color = material_id >= 0 ? textures_[material_id].get() : nullptr;
+        const Texture *normal = material_id >= 0 ? normal_maps_[material_id].get() : nullptr;
+        shader.updateUniformFloat3("material.Ka", material.Ka_);
+        shader.updateUniformFloat3("material.Kd", material.Kd_);
+        shader.updateUniformFloat3("material.Ks", material.Ks_);
+        shader.updateUniformFloat("material.highlight_decay", material.Ns_);
+        /* Programs without the maps, as frag.glsl, ignore the rest and
+         * shade by Ka and Kd. shader/bling-phong/normal_map_frag.glsl
+         * samples the color on unit 0 and the normal map on unit 1.
+         */
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, normal != nullptr ? normal->texture_id_ : 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, color != nullptr ? color->texture_id_ : 0);
+        shader.updateUniformInt("material.Kd_map", 0);
+        shader.updateUniformInt("material.normal_map", 1);
+        shader.updateUniformInt("material.use_Kd_map", color != nullptr);
+        shader.updateUniformInt("material.use_normal_map", normal != nullptr);
+        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT,
+                       (const void *)(size_t(first_index) * sizeof(unsigned int)));
+    }
+}
+
+void TriMesh::updateUniforms(GLShader &shader) const {
+    if (vertex_format_.isFull()) return;
+    if (vertex_format_.position_16_) {
+        shader.updateUniformFloat3("position_offset", bounds_.min_);
+        shader.updateUniformFloat3("position_scale", bounds_.extent());
+    } else {
+        shader.updateUniformFloat3("position_offset", glm::vec3(0.0f));
+        shader.updateUniformFloat3("position_scale", glm::vec3(1.0f));
+    }
+    shader.updateUniformInt("normal_encoding", vertex_format_.normalEncoding());
+}
+
 void TriMesh::finishGL() {
+    textures_.clear();
+    normal_maps_.clear();
+    if (tangent_VBO_ != 0) {
+        glDeleteBuffers(1, &tangent_VBO_);
+        tangent_VBO_ = 0;
+    }
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteVertexArrays(1, &VAO);
 }
 
+
+void TriMesh::optimize(unsigned int cache_size, bool log_stats) {
+    const size_t n_vertices = global_vertices_.size();
+    VertexCacheStats before;
+    if (log_stats)
+        before = analyze_vertex_cache(global_indices_.data(), global_indices_.size(), n_vertices, cache_size);
+
+    /* Triangles only move inside their sub-mesh. A sub-mesh is optimized
+     * on the window of vertices it uses, so the per vertex scratch of
+     * many small patches stays small and they run in parallel.
+     */
+    const bool whole = offsets_.empty();
+    const long n_ranges = whole ? 1 : offsets_.size();
+#pragma omp parallel for schedule(dynamic, 1) if (n_ranges > 1)
+    for (long r = 0; r < n_ranges; ++r) {
+        unsigned int *indices = global_indices_.data() + (whole ? 0 : offsets_[r]);
+        const size_t n_indices = whole ? global_indices_.size() : counts_[r];
+        if (n_indices == 0) continue;
+        const auto range = std::minmax_element(indices, indices + n_indices);
+        const unsigned int base = *range.first, window = *range.second - base + 1;
+        for (size_t i = 0; i < n_indices; ++i)
+            indices[i] -= base;
+        std::vector<unsigned int> clusters;
+        optimize_vertex_cache(indices, n_indices, window, cache_size, &clusters);
+        optimize_overdraw(indices, n_indices, global_vertices_.data() + base, window, clusters, cache_size);
+        for (size_t i = 0; i < n_indices; ++i)
+            indices[i] += base;
+    }
+    std::vector<unsigned int> remap;
+    optimize_vertex_fetch(global_vertices_, global_indices_.data(), global_indices_.size(),
+                          tangents_.empty() ? nullptr : &remap);
+    /* Vertices moved, tangents follow them. */
+    if (!tangents_.empty()) {
+        std::vector<glm::vec4> tangents(tangents_.size());
+        for (size_t v = 0; v < remap.size(); ++v)
+            tangents[remap[v]] = tangents_[v];
+        tangents_ = std::move(tangents);
+    }
+
+    if (log_stats) {
+        const auto after = analyze_vertex_cache(global_indices_.data(), global_indices_.size(),
+                                                n_vertices, cache_size);
+        LOG(INFO) << "Vertex cache of " << before.n_triangles << " triangles, ACMR "
+                  << before.acmr() << " -> " << after.acmr() << ", ATVR "
+                  << before.atvr() << " -> " << after.atvr();
+    }
+}
+
+void TriMesh::generateTangents() {
+    const size_t n_split = generate_tangents(global_vertices_, global_indices_.data(),
+                                             global_indices_.size(), tangents_);
+    LOG(INFO) << "Tangents of " << global_vertices_.size() << " vertices, "
+              << n_split << " split at mirrored uv";
+}
@@ -0,0 +1,242 @@
+#include "cgcl/mesh/VertexFormat.h"
+#include "cgcl/mesh/TriMesh.h"
+#include "cgcl/utils/logging.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace cgcl;
+
+
+unsigned int VertexFormat::uvOffset() const {
+    unsigned int offset = normalOffset();
+    switch (normal_) {
+    case Normal::Float: return offset + 12;
+    case Normal::Oct16: return offset + 4;
+    case Normal::Oct8: return position_16_ ? offset : offset + 4;
+    }
+    return offset;
+}
+
+int VertexFormat::normalEncoding() const {
+    if (normal_ == Normal::Float) return 0;
+    if (normal_ == Normal::Oct8 && position_16_) return 2;
+    return 1;
+}
+
+glm::vec2 cgcl::oct_encode(const glm::vec3 &n) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 == 0.0f) return glm::vec2(0.0f);
+    float x = n.x / l1, y = n.y / l1;
+    if (n.z < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    return glm::vec2(x, y);
+}
+
+glm::vec3 cgcl::oct_decode(const glm::vec2 &e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+uint16_t cgcl::float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffffu;
+    if (exponent >= 31) {
+        /* Overflow to infinity, NaN stays NaN. */
+        bool nan = ((bits >> 23) & 0xff) == 0xff && mantissa != 0;
+        return sign | 0x7c00u | (nan ? 0x200u : 0u);
+    }
+    if (exponent <= 0) {
+        /* Subnormal or zero, round to nearest. */
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000u;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u))) half++;
+        return sign | half;
+    }
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fffu;
+    /* Round to nearest even, a carry into the exponent is still right. */
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) half++;
+    return sign | half;
+}
+
+float cgcl::half_to_float(uint16_t half) {
+    const uint32_t sign = uint32_t(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1fu;
+    const uint32_t mantissa = half & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0) {
+        float value = std::ldexp(float(mantissa), -24);
+        return sign ? -value : value;
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline uint16_t unorm16(float v) {
+    return uint16_t(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f);
+}
+
+static inline int16_t snorm16(float v) {
+    return int16_t(std::lround(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f));
+}
+
+static inline int8_t snorm8(float v) {
+    return int8_t(std::lround(std::min(std::max(v, -1.0f), 1.0f) * 127.0f));
+}
+
+static inline uint8_t unorm8(float v) {
+    return uint8_t(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+std::vector<uint8_t> VertexFormat::encode(const std::vector<Vertex> &vertices, const AABB &bounds) const {
+    const long n_vertices = vertices.size();
+    const unsigned int stride_bytes = stride();
+    std::vector<uint8_t> data(size_t(n_vertices) * stride_bytes, 0);
+    const glm::vec3 extent = bounds.empty() ? glm::vec3(0.0f) : bounds.extent();
+    const glm::vec3 inv_extent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                               extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                               extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+    const unsigned int normal_offset = normalOffset(), uv_offset = uvOffset();
+
+    /* The format tests are loop invariant, compilers unswitch them. */
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < n_vertices; ++i) {
+        uint8_t *out = data.data() + size_t(i) * stride_bytes;
+        const Vertex &vertex = vertices[i];
+        if (position_16_) {
+            uint16_t p[4] = {unorm16((vertex.position_.x - bounds.min_.x) * inv_extent.x),
+                             unorm16((vertex.position_.y - bounds.min_.y) * inv_extent.y),
+                             unorm16((vertex.position_.z - bounds.min_.z) * inv_extent.z), 0};
+            std::memcpy(out, p, sizeof(p));
+        } else {
+            std::memcpy(out, &vertex.position_, sizeof(glm::vec3));
+        }
+
+        uint8_t *normal = out + normal_offset;
+        if (normal_ == Normal::Float) {
+            std::memcpy(normal, &vertex.normal_, sizeof(glm::vec3));
+        } else {
+            glm::vec2 e = oct_encode(vertex.normal_);
+            if (normal_ == Normal::Oct16) {
+                int16_t n[2] = {snorm16(e.x), snorm16(e.y)};
+                std::memcpy(normal, n, sizeof(n));
+            } else if (position_16_) {
+                /* Two bytes in the 4th position component. */
+                uint8_t n[2] = {unorm8(e.x * 0.5f + 0.5f), unorm8(e.y * 0.5f + 0.5f)};
+                std::memcpy(out + 6, n, sizeof(n));
+            } else {
+                int8_t n[2] = {snorm8(e.x), snorm8(e.y)};
+                std::memcpy(normal, n, sizeof(n));
+            }
+        }
+
+        uint8_t *uv = out + uv_offset;
+        if (uv_half_) {
+            uint16_t t[2] = {float_to_half(vertex.texture_coords_.x), float_to_half(vertex.texture_coords_.y)};
+            std::memcpy(uv, t, sizeof(t));
+        } else {
+            std::memcpy(uv, &vertex.texture_coords_, sizeof(glm::vec2));
+        }
+    }
+    return data;
+}
+
+Vertex VertexFormat::decode(const uint8_t *data, size_t i, const AABB &bounds) const {
+    const uint8_t *in = data + i * stride();
+    Vertex vertex;
+    uint16_t p[4] = {0, 0, 0, 0};
+    if (position_16_) {
+        std::memcpy(p, in, sizeof(p));
+        glm::vec3 unit(p[0] / 65535.0f, p[1] / 65535.0f, p[2] / 65535.0f);
+        vertex.position_ = bounds.min_ + bounds.extent() * unit;
+    } else {
+        std::memcpy(&vertex.position_, in, sizeof(glm::vec3));
+    }
+
+    const uint8_t *normal = in + normalOffset();
+    if (normal_ == Normal::Float) {
+        std::memcpy(&vertex.normal_, normal, sizeof(glm::vec3));
+    } else if (normal_ == Normal::Oct16) {
+        int16_t n[2];
+        std::memcpy(n, normal, sizeof(n));
+        vertex.normal_ = oct_decode(glm::vec2(std::max(n[0] / 32767.0f, -1.0f), std::max(n[1] / 32767.0f, -1.0f)));
+    } else if (position_16_) {
+        uint8_t n[2];
+        std::memcpy(n, in + 6, sizeof(n));
+        vertex.normal_ = oct_decode(glm::vec2(n[0] / 255.0f * 2.0f - 1.0f, n[1] / 255.0f * 2.0f - 1.0f));
+    } else {
+        int8_t n[2];
+        std::memcpy(n, normal, sizeof(n));
+        vertex.normal_ = oct_decode(glm::vec2(std::max(n[0] / 127.0f, -1.0f), std::max(n[1] / 127.0f, -1.0f)));
+    }
+
+    const uint8_t *uv = in + uvOffset();
+    if (uv_half_) {
+        uint16_t t[2];
+        std::memcpy(t, uv, sizeof(t));
+        vertex.texture_coords_ = glm::vec2(half_to_float(t[0]), half_to_float(t[1]));
+    } else {
+        std::memcpy(&vertex.texture_coords_, uv, sizeof(glm::vec2));
+    }
+    return vertex;
+}
+
+void VertexFormat::setAttributes() const {
+    const GLsizei stride_bytes = stride();
+    glEnableVertexAttribArray(0);
+    if (position_16_)
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride_bytes, (void *)0);
+    else
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride_bytes, (void *)0);
+
+    const size_t normal_offset = normalOffset();
+    switch (normal_) {
+    case Normal::Float:
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride_bytes, (void *)normal_offset);
+        break;
+    case Normal::Oct16:
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride_bytes, (void *)normal_offset);
+        break;
+    case Normal::Oct8:
+        if (position_16_) {
+            /* Read from the position w by the shader. */
+            glDisableVertexAttribArray(1);
+        } else {
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_BYTE, GL_TRUE, stride_bytes, (void *)normal_offset);
+        }
+        break;
+    }
+
+    glEnableVertexAttribArray(2);
+    const size_t uv_offset = uvOffset();
+    if (uv_half_)
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride_bytes, (void *)uv_offset);
+    else
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride_bytes, (void *)uv_offset);
+}
@@ -4,6 +4,7 @@
 #include "glad/glad.h"
 
 #include <iostream>
+#include <vector>
 
 using namespace cgcl;
 
@@ -11,51 +12,58 @@ GLShader::~GLShader() {
     glDeleteProgram(render_id_);
 }
 
+static unsigned int compile_stage(GLenum type, const char *type_name, const std::string &src) {
+    GLint success;
+    GLchar infoLog[1024];
+    const char *code = src.c_str();
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+        std::cerr << "ERROR::SHADER_COMPILATION_ERROR of type: " << type_name << "\n" << infoLog << "\n";
+    }
+    return shader;
+}
+
+static unsigned int link_program(const std::vector<unsigned int> &shaders) {
+    GLint success;
+    GLchar infoLog[1024];
+    unsigned int program = glCreateProgram();
+    for (auto shader : shaders)
+        glAttachShader(program, shader);
+    glLinkProgram(program);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(program, 1024, NULL, infoLog);
+        std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: link program" << "\n" << infoLog << "\n";
+    }
+    // delete the shaders as they're linked into our program now and no longer necessery
+    for (auto shader : shaders)
+        glDeleteShader(shader);
+    return program;
+}
+
 GLShader::GLShader(const std::string &vertex_src, const std::string &frag_src) {
-        GLint success;
-        GLchar infoLog[1024];
-        const char *vertex_code = vertex_src.c_str();
-        const char *frag_code = frag_src.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vertex_code, NULL);
-        glCompileShader(vertex);
-
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(vertex, 1024, NULL, infoLog);
-            std::cerr << "ERROR::SHADER_COMPILATION_ERROR of type: vertex " << "\n" << infoLog << "\n";
-        }
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &frag_code, NULL);
-        glCompileShader(fragment);
-
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(fragment, 1024, NULL, infoLog);
-            std::cerr << "ERROR::SHADER_COMPILATION_ERROR of type: fragment " << "\n" << infoLog << "\n";
-        }
-        // shader Program
-
-        render_id_ = glCreateProgram();
-        glAttachShader(render_id_, vertex);
-        glAttachShader(render_id_, fragment);
-        glLinkProgram(render_id_);
-
-        glGetProgramiv(render_id_, GL_LINK_STATUS, &success);
-        if (!success)
-        {
-            glGetProgramInfoLog(render_id_, 1024, NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: link program" << "\n" << infoLog << "\n";
-        }
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+    render_id_ = link_program({
+        compile_stage(GL_VERTEX_SHADER, "vertex", vertex_src),
+        compile_stage(GL_FRAGMENT_SHADER, "fragment", frag_src)
+    });
+}
+
+GLShader::GLShader(const std::string &vertex_src, const std::string &tess_ctrl_src,
+                   const std::string &tess_eval_src, const std::string &frag_src) {
+    render_id_ = link_program({
+        compile_stage(GL_VERTEX_SHADER, "vertex", vertex_src),
+        compile_stage(GL_TESS_CONTROL_SHADER, "tessellation control", tess_ctrl_src),
+        compile_stage(GL_TESS_EVALUATION_SHADER, "tessellation evaluation", tess_eval_src),
+        compile_stage(GL_FRAGMENT_SHADER, "fragment", frag_src)
+    });
 }
 
 void GLShader::Bind() const {
@@ -66,38 +74,52 @@ void GLShader::UnBind() const {
     glUseProgram(render_id_);
 }
 
-void GLShader::updateUniformInt(const std::string &name, const int value) {
+int GLShader::uniformLocation(const std::string &name) {
+    auto it = uniform_locations_.find(name);
+    if (it != uniform_locations_.end())
+        return it->second;
     GLint location = glGetUniformLocation(render_id_, name.c_str());
+    uniform_locations_.emplace(name, location);
+    return location;
+}
+
+void GLShader::updateUniformInt(const std::string &name, const int value) {
+    GLint location = uniformLocation(name);
     glUniform1i(location, value);
 }
 
 void GLShader::updateUniformFloat(const std::string &name, const float value) {
-    GLint location = glGetUniformLocation(render_id_, name.c_str());
+    GLint location = uniformLocation(name);
     glUniform1f(location, value);
 }
 
+void GLShader::updateUniformFloat2(const std::string &name, const glm::vec2 &vec) {
+    GLint location = uniformLocation(name);
+    glUniform2f(location, vec.x, vec.y);
+}
+
 void GLShader::updateUniformFloat3(const std::string &name, const glm::vec3 &vec) {
-    GLint location = glGetUniformLocation(render_id_, name.c_str());
+    GLint location = uniformLocation(name);
     glUniform3f(location, vec.x, vec.y, vec.z);
 }
 
 void GLShader::updateUniformFloat3v(const std::string &name, unsigned count, const float *value) {
-    GLint location = glGetUniformLocation(render_id_, name.c_str());
+    GLint location = uniformLocation(name);
     glUniform3fv(location, count, value);
 }
 
 void GLShader::updateUniformFloat4(const std::string &name, const glm::vec4 &vec) {
-    GLint location = glGetUniformLocation(render_id_, name.c_str());
+    GLint location = uniformLocation(name);
     glUniform4f(location, vec.x, vec.y, vec.z, vec.w);
 }
 
 void GLShader::updateUniformMat3(const std::string &name, const glm::mat3 &mat) {
-    GLint location = glGetUniformLocation(render_id_, name.c_str());
+    GLint location = uniformLocation(name);
     glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 void GLShader::updateUniformMat4(const std::string &name, const glm::mat4 &mat) {
-    GLint location = glGetUniformLocation(render_id_, name.c_str());
+    GLint location = uniformLocation(name);
     glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
@@ -0,0 +1,189 @@
+#include "cgcl/render/ImageIO.h"
+#include "cgcl/utils/logging.h"
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+using namespace cgcl;
+
+
+void cgcl::write_ppm(const std::string &filename, const Framebuffer &image) {
+    std::ofstream out(filename, std::ios::binary);
+    CHECK(out) << "Failed to open " << filename;
+    out << "P6\n" << image.width_ << " " << image.height_ << "\n255\n";
+    std::vector<uint8_t> rgb(size_t(image.width_) * image.height_ * 3);
+    for (size_t i = 0; i < image.color_.size(); ++i)
+        for (int c = 0; c < 3; ++c)
+            rgb[3 * i + c] = uint8_t(image.color_[i] >> (8 * c));
+    out.write(reinterpret_cast<const char *>(rgb.data()), rgb.size());
+}
+
+static uint32_t crc32(const uint8_t *data, size_t n, uint32_t crc = 0) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put_u32_be(std::vector<uint8_t> &out, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back(uint8_t(v >> shift));
+}
+
+static void put_chunk(std::vector<uint8_t> &png, const char type[4], const std::vector<uint8_t> &data) {
+    put_u32_be(png, data.size());
+    const size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    put_u32_be(png, crc32(&png[start], png.size() - start));
+}
+
+void cgcl::write_png(const std::string &filename, const Framebuffer &image) {
+    const size_t w = image.width_, h = image.height_, stride = 3 * w;
+    /* Rows unfiltered, each prefixed by filter type 0. */
+    std::vector<uint8_t> raw((stride + 1) * h);
+    for (size_t y = 0; y < h; ++y) {
+        uint8_t *row = &raw[y * (stride + 1)];
+        row[0] = 0;
+        for (size_t x = 0; x < w; ++x)
+            for (int c = 0; c < 3; ++c)
+                row[1 + 3 * x + c] = uint8_t(image.color_[y * w + x] >> (8 * c));
+    }
+
+    /* zlib stream: header, stored deflate blocks of at most 65535 bytes,
+     * Adler-32 of the raw data.
+     */
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    size_t begin = 0;
+    do {
+        const size_t length = std::min<size_t>(65535, raw.size() - begin);
+        const bool last = begin + length == raw.size();
+        zlib.insert(zlib.end(), {uint8_t(last), uint8_t(length), uint8_t(length >> 8),
+                                 uint8_t(~length), uint8_t(~length >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + begin, raw.begin() + begin + length);
+        begin += length;
+    } while (begin < raw.size());
+    uint32_t s1 = 1, s2 = 0;
+    for (uint8_t byte : raw) {
+        s1 = (s1 + byte) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    put_u32_be(zlib, s2 << 16 | s1);
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    std::vector<uint8_t> header;
+    put_u32_be(header, w);
+    put_u32_be(header, h);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bits RGB, deflate, adaptive filters, no interlace.
+    put_chunk(png, "IHDR", header);
+    put_chunk(png, "IDAT", zlib);
+    put_chunk(png, "IEND", {});
+
+    std::ofstream out(filename, std::ios::binary);
+    CHECK(out) << "Failed to open " << filename;
+    out.write(reinterpret_cast<const char *>(png.data()), png.size());
+}
+
+void cgcl::write_image(const std::string &filename, const Framebuffer &image) {
+    const size_t dot = filename.rfind('.');
+    const std::string extension = dot == std::string::npos ? "" : filename.substr(dot + 1);
+    if (extension == "png") write_png(filename, image);
+    else if (extension == "ppm") write_ppm(filename, image);
+    else LOG(FATAL) << "Unknown image format of " << filename;
+}
+
+Framebuffer cgcl::read_image(const std::string &filename) {
+    int w, h, n_channels;
+    stbi_set_flip_vertically_on_load(false);
+    unsigned char *data = stbi_load(filename.c_str(), &w, &h, &n_channels, 4);
+    CHECK(data != nullptr) << "Failed to read " << filename << ": " << stbi_failure_reason();
+    Framebuffer image(w, h);
+    for (size_t i = 0; i < image.color_.size(); ++i)
+        image.color_[i] = uint32_t(data[4 * i]) | uint32_t(data[4 * i + 1]) << 8 |
+                          uint32_t(data[4 * i + 2]) << 16 | uint32_t(data[4 * i + 3]) << 24;
+    stbi_image_free(data);
+    return image;
+}
+
+/// \brief CIELAB of every pixel, sRGB with a D65 white.
+static std::vector<glm::vec3> to_lab(const Framebuffer &image) {
+    static const std::vector<float> linear = [] {
+        std::vector<float> table(256);
+        for (int i = 0; i < 256; ++i) {
+            const float c = i / 255.0f;
+            table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+    auto f = [](float t) { return t > 0.008856452f ? std::cbrt(t) : t / 0.12841855f + 4.0f / 29.0f; };
+    std::vector<glm::vec3> lab(image.color_.size());
+    const long n = lab.size();
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; ++i) {
+        const uint32_t c = image.color_[i];
+        const float r = linear[c & 0xff], g = linear[(c >> 8) & 0xff], b = linear[(c >> 16) & 0xff];
+        const float fx = f((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+        const float fy = f(0.2126f * r + 0.7152f * g + 0.0722f * b);
+        const float fz = f((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+        lab[i] = glm::vec3(116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz));
+    }
+    return lab;
+}
+
+ImageDifference cgcl::compare_images(const Framebuffer &image, const Framebuffer &reference, float threshold,
+                                     Framebuffer *difference) {
+    ImageDifference result;
+    if (image.width_ != reference.width_ || image.height_ != reference.height_) {
+        result.n_pixels = result.n_different = std::max(image.color_.size(), reference.color_.size());
+        result.max_delta_e = result.mean_delta_e = 100.0f;
+        LOG(WARNING) << "Image of " << image.width_ << "x" << image.height_ << " against a reference of "
+                     << reference.width_ << "x" << reference.height_;
+        return result;
+    }
+    const int w = image.width_, h = image.height_;
+    const std::vector<glm::vec3> lab = to_lab(image), reference_lab = to_lab(reference);
+    if (difference != nullptr) *difference = Framebuffer(w, h);
+
+    size_t n_different = 0;
+    float max_delta_e = 0.0f;
+    double sum_delta_e = 0.0;
+#pragma omp parallel for schedule(static) reduction(+ : n_different, sum_delta_e) reduction(max : max_delta_e)
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const glm::vec3 &color = lab[size_t(y) * w + x];
+            float delta_e = glm::length(color - reference_lab[size_t(y) * w + x]);
+            for (int ny = std::max(0, y - 1); ny <= std::min(h - 1, y + 1); ++ny)
+                for (int nx = std::max(0, x - 1); nx <= std::min(w - 1, x + 1); ++nx)
+                    delta_e = std::min(delta_e, glm::length(color - reference_lab[size_t(ny) * w + nx]));
+            const bool different = delta_e > threshold;
+            n_different += different;
+            sum_delta_e += delta_e;
+            max_delta_e = std::max(max_delta_e, delta_e);
+            if (difference != nullptr) {
+                const uint32_t gray = uint32_t(reference_lab[size_t(y) * w + x].x * 1.275f);
+                difference->color_[size_t(y) * w + x] =
+                    different ? 0xff0000ffu : gray | gray << 8 | gray << 16 | 0xffu << 24;
+            }
+        }
+    }
+    result.n_pixels = size_t(w) * h;
+    result.n_different = n_different;
+    result.max_delta_e = max_delta_e;
+    result.mean_delta_e = result.n_pixels ? float(sum_delta_e / result.n_pixels) : 0.0f;
+    return result;
+}
@@ -0,0 +1,350 @@
+#include "cgcl/render/PathTracer.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace cgcl;
+
+
+static constexpr float pi = 3.14159265358979f;
+/* Bounces before Russian roulette may end a path. */
+static constexpr int roulette_depth = 3;
+
+/// \brief PCG hash, one step of the PCG generator with an output permutation.
+static inline uint32_t pcg_hash(uint32_t x) {
+    const uint32_t state = x * 747796405u + 2891336453u;
+    const uint32_t word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+    return (word >> 22) ^ word;
+}
+
+/// \brief Random sequence of one pixel and sample.
+struct Random {
+    uint32_t state;
+
+    Random(uint32_t pixel, uint32_t sample) : state(pcg_hash(pixel ^ pcg_hash(sample + 0x9e3779b9u))) {}
+    /// \brief Uniform in [0, 1).
+    float next() {
+        state = pcg_hash(state);
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+struct PathTracer::Tile {
+    int x0, y0, x1, y1;
+};
+
+struct PathTracer::Path {
+    Ray ray;
+    glm::vec3 throughput = glm::vec3(1.0f);
+    glm::vec3 radiance = glm::vec3(0.0f);
+    Random rng;
+    int depth = 0;
+
+    Path() : rng(0, 0) {}
+    Path(uint32_t pixel, uint32_t sample) : rng(pixel, sample) {}
+};
+
+static inline float max_component(const glm::vec3 &v) {
+    return std::max(v.x, std::max(v.y, v.z));
+}
+
+/// \brief Direction around axis with the given cosine to it.
+static glm::vec3 around(const glm::vec3 &axis, float cos_theta, float phi) {
+    /* Orthonormal basis of Duff et al., without branches on the axis. */
+    const float sign = axis.z >= 0.0f ? 1.0f : -1.0f;
+    const float a = -1.0f / (sign + axis.z), b = axis.x * axis.y * a;
+    const glm::vec3 tangent(1.0f + sign * axis.x * axis.x * a, sign * b, -sign * axis.x);
+    const glm::vec3 bitangent(b, sign + axis.y * axis.y * a, -axis.y);
+    const float sin_theta = std::sqrt(std::max(0.0f, 1.0f - cos_theta * cos_theta));
+    return glm::normalize(sin_theta * (std::cos(phi) * tangent + std::sin(phi) * bitangent) + cos_theta * axis);
+}
+
+static uint32_t pack_color(const glm::vec3 &color) {
+    const glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return uint32_t(c.x) | uint32_t(c.y) << 8 | uint32_t(c.z) << 16 | 0xffu << 24;
+}
+
+PathTracer::PathTracer(int width, int height)
+    : framebuffer_(width, height), accumulation_(size_t(width) * height, glm::vec3(0.0f)) {
+    CHECK(width > 0 && height > 0) << "Empty image";
+}
+
+void PathTracer::setScene(const TriMesh &mesh) {
+    mesh_ = &mesh;
+    bvh_ = BVH::from_mesh(mesh);
+    bvh_->buildWide();
+    const glm::vec3 extent = bvh_->bounds().extent();
+    epsilon_ = std::max(1e-4f * max_component(extent), 1e-6f);
+
+    /* Faces without a material take the MTL defaults at 0, then one entry
+     * per material of the mesh, as the rasterizer does.
+     */
+    materials_.assign(1, MTLMaterial());
+    triangle_materials_.assign(mesh.global_indices_.size() / 3, 0);
+    if (!mesh.materials_.empty() && mesh.sub_mesh_materials_.size() == mesh.offsets_.size()) {
+        materials_.insert(materials_.end(), mesh.materials_.begin(), mesh.materials_.end());
+        for (size_t s = 0; s < mesh.offsets_.size(); ++s)
+            std::fill_n(triangle_materials_.begin() + mesh.offsets_[s] / 3, mesh.counts_[s] / 3,
+                        uint32_t(1 + mesh.sub_mesh_materials_[s]));
+    }
+    reset();
+}
+
+void PathTracer::setCamera(const glm::mat4 &view, const glm::mat4 &projection) {
+    inverse_view_projection_ = glm::inverse(projection * view);
+    reset();
+}
+
+void PathTracer::setLight(const PointLight &light) {
+    light_ = light;
+    reset();
+}
+
+void PathTracer::setEnvironment(const glm::vec3 &radiance) {
+    environment_ = radiance;
+    reset();
+}
+
+void PathTracer::reset() {
+    std::fill(accumulation_.begin(), accumulation_.end(), glm::vec3(0.0f));
+    n_samples_ = 0;
+}
+
+/// \brief Ray through the point (x, y) of the image, in pixels from
+/// the top left, between the near and far planes as the preview clips.
+Ray PathTracer::cameraRay(float x, float y) const {
+    const float ndc_x = 2.0f * x / framebuffer_.width_ - 1.0f;
+    const float ndc_y = 1.0f - 2.0f * y / framebuffer_.height_;
+    const glm::vec4 near = inverse_view_projection_ * glm::vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+    const glm::vec4 far = inverse_view_projection_ * glm::vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+    const glm::vec3 origin = glm::vec3(near) / near.w;
+    const glm::vec3 to_far = glm::vec3(far) / far.w - origin;
+    Ray ray;
+    ray.origin_ = origin;
+    ray.direction_ = glm::normalize(to_far);
+    ray.t_max_ = glm::length(to_far);
+    return ray;
+}
+
+bool PathTracer::scatter(Path &path, const RayHit &hit, Ray &shadow, glm::vec3 &direct) const {
+    const MTLMaterial &material = materials_[triangle_materials_[hit.triangle_]];
+    const unsigned int *corners = &mesh_->global_indices_[3 * size_t(hit.triangle_)];
+    const Vertex &a = mesh_->global_vertices_[corners[0]];
+    const Vertex &b = mesh_->global_vertices_[corners[1]];
+    const Vertex &c = mesh_->global_vertices_[corners[2]];
+    const glm::vec3 wo = -path.ray.direction_;
+    const glm::vec3 p = path.ray.origin_ + hit.t_ * path.ray.direction_;
+
+    /* Both faces are lit, normals are turned toward the viewer. */
+    glm::vec3 geometric = glm::normalize(glm::cross(b.position_ - a.position_, c.position_ - a.position_));
+    const bool front = glm::dot(geometric, wo) >= 0.0f;
+    if (!front) geometric = -geometric;
+    glm::vec3 n = (1.0f - hit.u_ - hit.v_) * a.normal_ + hit.u_ * b.normal_ + hit.v_ * c.normal_;
+    const float length = glm::length(n);
+    n = length > 0.0f ? n / length : geometric;
+    if (glm::dot(n, geometric) < 0.0f) n = -n;
+    ++path.depth;
+
+    Ray next;
+    if (material.d < 1.0f && path.rng.next() >= material.d) {
+        /* Through the surface: refracted by Ni entering from the front,
+         * or reflected by Schlick's Fresnel and total internal reflection.
+         */
+        const float eta = front ? 1.0f / material.Ni_ : material.Ni_;
+        const float cos_i = std::min(glm::dot(n, wo), 1.0f);
+        const float k = 1.0f - eta * eta * (1.0f - cos_i * cos_i);
+        const float f0 = (1.0f - material.Ni_) * (1.0f - material.Ni_) / ((1.0f + material.Ni_) * (1.0f + material.Ni_));
+        const float fresnel = f0 + (1.0f - f0) * std::pow(1.0f - cos_i, 5.0f);
+        if (k < 0.0f || path.rng.next() < fresnel) {
+            next.origin_ = p + epsilon_ * geometric;
+            next.direction_ = glm::normalize(2.0f * cos_i * n - wo);
+        } else {
+            next.origin_ = p - epsilon_ * geometric;
+            next.direction_ = glm::normalize(-eta * wo + (eta * cos_i - std::sqrt(k)) * n);
+        }
+    } else {
+        /* Direct light as frag.glsl shades it, if the light is in front. */
+        path.radiance += path.throughput * material.Ka_ * light_.Ia_;
+        glm::vec3 l = light_.pos_ - p;
+        const float distance = glm::length(l);
+        l /= distance;
+        if (glm::dot(geometric, l) > 0.0f) {
+            const glm::vec3 h = glm::normalize(l + wo);
+            const float diffuse = std::max(glm::dot(n, l), 0.0f);
+            const float specular = std::pow(std::max(glm::dot(n, h), 0.0f), material.Ns_);
+            direct = path.throughput * (material.Kd_ * light_.Id_ * diffuse + material.Ks_ * light_.Is_ * specular);
+            shadow.origin_ = p + epsilon_ * geometric;
+            shadow.direction_ = l;
+            shadow.t_max_ = distance - epsilon_;
+        }
+
+        /* Bounce by one lobe, chosen by the weights of Kd and Ks. */
+        const float kd = max_component(material.Kd_), ks = max_component(material.Ks_);
+        if (kd + ks <= 0.0f) return false;
+        const float p_specular = ks / (kd + ks);
+        const float u1 = path.rng.next(), u2 = path.rng.next(), u3 = path.rng.next();
+        if (u1 < p_specular) {
+            /* Phong lobe of exponent Ns around the mirror direction. */
+            const glm::vec3 mirror = 2.0f * glm::dot(n, wo) * n - wo;
+            next.direction_ = around(mirror, std::pow(u2, 1.0f / (material.Ns_ + 1.0f)), 2.0f * pi * u3);
+            path.throughput *= material.Ks_ / p_specular;
+        } else {
+            /* Cosine weighted, the cosine and 1 / pi cancel the pdf. */
+            next.direction_ = around(n, std::sqrt(1.0f - u2), 2.0f * pi * u3);
+            path.throughput *= material.Kd_ / (1.0f - p_specular);
+        }
+        if (glm::dot(next.direction_, geometric) <= 0.0f) return false;
+        next.origin_ = p + epsilon_ * geometric;
+    }
+    path.ray = next;
+
+    if (path.depth >= max_depth) return false;
+    if (path.depth >= roulette_depth) {
+        const float survive = std::min(max_component(path.throughput), 0.95f);
+        if (path.rng.next() >= survive) return false;
+        path.throughput /= survive;
+    }
+    return true;
+}
+
+void PathTracer::renderTile(const Tile &tile, unsigned int first_sample, unsigned int n_samples,
+                            PathTracerStats &stats) {
+    constexpr int n = RayPacket::size;
+    constexpr int packet_width = 4, packet_height = n / packet_width;
+    const int width = framebuffer_.width_;
+    for (unsigned int sample = first_sample; sample < first_sample + n_samples; ++sample) {
+        for (int y0 = tile.y0; y0 < tile.y1; y0 += packet_height) {
+            for (int x0 = tile.x0; x0 < tile.x1; x0 += packet_width) {
+                /* Camera rays of 4x2 pixels in one packet. */
+                Path paths[n];
+                uint32_t pixels[n];
+                bool inside[n], alive[n];
+                RayPacket packet{};
+                for (int k = 0; k < n; ++k) {
+                    const int x = x0 + k % packet_width, y = y0 + k / packet_width;
+                    inside[k] = alive[k] = x < tile.x1 && y < tile.y1;
+                    if (!inside[k]) {
+                        packet.disable(k);
+                        continue;
+                    }
+                    pixels[k] = uint32_t(y) * width + x;
+                    paths[k] = Path(pixels[k], sample);
+                    const float jitter_x = paths[k].rng.next(), jitter_y = paths[k].rng.next();
+                    paths[k].ray = cameraRay(x + jitter_x, y + jitter_y);
+                    packet.set(k, paths[k].ray);
+                    ++stats.n_camera_rays;
+                }
+                RayHit hits[n];
+                bvh_->intersect(packet, hits);
+
+                /* Their shadow rays toward the light in one packet. */
+                RayPacket shadows{};
+                glm::vec3 direct[n];
+                bool traced = false;
+                for (int k = 0; k < n; ++k) {
+                    direct[k] = glm::vec3(0.0f);
+                    shadows.disable(k);
+                    if (!alive[k]) continue;
+                    if (!hits[k].hit()) {
+                        paths[k].radiance += environment_;
+                        alive[k] = false;
+                        continue;
+                    }
+                    Ray shadow;
+                    alive[k] = scatter(paths[k], hits[k], shadow, direct[k]);
+                    if (max_component(direct[k]) > 0.0f) {
+                        shadows.set(k, shadow);
+                        traced = true;
+                        ++stats.n_shadow_rays;
+                    }
+                }
+                bool occluded[n] = {};
+                if (traced) bvh_->occluded(shadows, occluded);
+
+                for (int k = 0; k < n; ++k) {
+                    if (max_component(direct[k]) > 0.0f && !occluded[k])
+                        paths[k].radiance += direct[k];
+                    /* Bounces diverge, they go one by one. */
+                    Path &path = paths[k];
+                    while (alive[k]) {
+                        RayHit hit;
+                        ++stats.n_bounce_rays;
+                        if (!bvh_->intersectWide(path.ray, hit)) {
+                            path.radiance += path.throughput * environment_;
+                            break;
+                        }
+                        Ray shadow;
+                        glm::vec3 light(0.0f);
+                        alive[k] = scatter(path, hit, shadow, light);
+                        if (max_component(light) > 0.0f) {
+                            ++stats.n_shadow_rays;
+                            if (!bvh_->occluded(shadow)) path.radiance += light;
+                        }
+                    }
+                    /* A NaN or infinity would stay in the pixel for good. */
+                    if (inside[k] && std::isfinite(path.radiance.x + path.radiance.y + path.radiance.z))
+                        accumulation_[pixels[k]] += path.radiance;
+                }
+            }
+        }
+    }
+}
+
+const PathTracerStats &PathTracer::render(unsigned int n_samples) {
+    CHECK(bvh_ != nullptr) << "Call setScene() before render()";
+    const auto start = std::chrono::steady_clock::now();
+    const int width = framebuffer_.width_, height = framebuffer_.height_;
+    const int tiles_x = (width + tile_size - 1) / tile_size, tiles_y = (height + tile_size - 1) / tile_size;
+    const long n_tiles = long(tiles_x) * tiles_y;
+
+    /* Tiles are small and many, so threads stay busy to the end. */
+    size_t n_camera_rays = 0, n_bounce_rays = 0, n_shadow_rays = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : n_camera_rays, n_bounce_rays, n_shadow_rays)
+    for (long t = 0; t < n_tiles; ++t) {
+        Tile tile;
+        tile.x0 = int(t % tiles_x) * tile_size;
+        tile.y0 = int(t / tiles_x) * tile_size;
+        tile.x1 = std::min(tile.x0 + tile_size, width);
+        tile.y1 = std::min(tile.y0 + tile_size, height);
+        PathTracerStats local;
+        renderTile(tile, n_samples_, n_samples, local);
+        n_camera_rays += local.n_camera_rays;
+        n_bounce_rays += local.n_bounce_rays;
+        n_shadow_rays += local.n_shadow_rays;
+    }
+    n_samples_ += n_samples;
+
+    const long n_pixels = accumulation_.size();
+    const float scale = n_samples_ > 0 ? 1.0f / n_samples_ : 0.0f;
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < n_pixels; ++i)
+        framebuffer_.color_[i] = pack_color(accumulation_[i] * scale);
+
+    stats_ = PathTracerStats();
+    stats_.n_samples = n_samples_;
+    stats_.n_camera_rays = n_camera_rays;
+    stats_.n_bounce_rays = n_bounce_rays;
+    stats_.n_shadow_rays = n_shadow_rays;
+    stats_.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats_;
+}
+
+const PathTracerStats &PathTracer::renderFor(double budget_ms) {
+    const auto start = std::chrono::steady_clock::now();
+    PathTracerStats total;
+    double elapsed_ms = 0.0, pass_ms = 0.0;
+    do {
+        const PathTracerStats &pass = render(1);
+        total.n_camera_rays += pass.n_camera_rays;
+        total.n_bounce_rays += pass.n_bounce_rays;
+        total.n_shadow_rays += pass.n_shadow_rays;
+        pass_ms = pass.ms;
+        elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed_ms + pass_ms <= budget_ms);
+    total.n_samples = n_samples_;
+    total.ms = elapsed_ms;
+    stats_ = total;
+    return stats_;
+}
@@ -0,0 +1,131 @@
+#include "cgcl/render/RenderQueue.h"
+#include "cgcl/utils/logging.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+using namespace cgcl;
+
+
+static constexpr int layer_bits = 4, program_bits = 12, texture_bits = 16;
+static constexpr int material_bits = 16, vertex_array_bits = 16;
+
+uint64_t RenderQueue::makeKey(unsigned int layer, unsigned int program, unsigned int texture,
+                              unsigned int material, unsigned int vertex_array) {
+    CHECK_LT(layer, 1u << layer_bits) << "Layer out of range";
+    CHECK_LT(program, 1u << program_bits) << "Too many programs in a frame";
+    CHECK_LT(texture, 1u << texture_bits) << "Too many textures in a frame";
+    CHECK_LT(material, 1u << material_bits) << "Too many materials in a frame";
+    CHECK_LT(vertex_array, 1u << vertex_array_bits) << "Too many vertex arrays in a frame";
+    uint64_t key = layer;
+    key = (key << program_bits) | program;
+    key = (key << texture_bits) | texture;
+    key = (key << material_bits) | material;
+    key = (key << vertex_array_bits) | vertex_array;
+    return key;
+}
+
+/// \brief Dense id of a GL name or material in the frame, 0 for none.
+template <typename T>
+static unsigned int frame_id(std::unordered_map<T, unsigned int> &ids, T name) {
+    if (!name) return 0;
+    return ids.emplace(name, ids.size() + 1).first->second;
+}
+
+void RenderQueue::setCamera(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &view_pos) {
+    view_ = view;
+    projection_ = projection;
+    view_pos_ = view_pos;
+}
+
+void RenderQueue::submit(GLShader *shader, Mesh *mesh, PhongMaterial *material, const glm::mat4 &model,
+                         const Texture *texture, unsigned int layer) {
+    const unsigned int texture_name = texture == nullptr ? 0 : texture->texture_id_;
+    uint64_t key = makeKey(layer, frame_id(program_ids_, shader->id()), frame_id(texture_ids_, texture_name),
+                           frame_id(material_ids_, static_cast<const PhongMaterial *>(material)),
+                           frame_id(vertex_array_ids_, mesh->vertexArray()));
+    order_.emplace_back(key, uint32_t(packets_.size()));
+    packets_.push_back({key, shader, mesh, material, texture, model});
+}
+
+const RenderStats &RenderQueue::flush() {
+    /* Sort the 16-byte (key, index) pairs, not the packets. */
+    std::sort(order_.begin(), order_.end());
+
+    stats_ = RenderStats();
+    GLShader *shader = nullptr;
+    const Texture *texture = nullptr;
+    bool texture_known = false;
+    const PhongMaterial *material = nullptr;
+    unsigned int vertex_array = 0;
+    bool vertex_array_known = false;
+    std::vector<const GLShader *> camera_set;
+
+    for (const auto &entry : order_) {
+        DrawPacket &packet = packets_[entry.second];
+        if (packet.shader != shader) {
+            shader = packet.shader;
+            shader->Bind();
+            stats_.program_changes++;
+            /* Uniforms belong to a program, set the material again. */
+            material = nullptr;
+            if (std::find(camera_set.begin(), camera_set.end(), shader) == camera_set.end()) {
+                shader->updateUniformMat4("view", view_);
+                shader->updateUniformMat4("projection", projection_);
+                shader->updateUniformFloat3("view_pos", view_pos_);
+                camera_set.push_back(shader);
+            }
+        }
+        if (!texture_known || packet.texture != texture) {
+            texture = packet.texture;
+            texture_known = true;
+            if (texture != nullptr) {
+                texture->BindTexture();
+            } else {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+            stats_.texture_changes++;
+        }
+        if (packet.material != nullptr && packet.material != material) {
+            material = packet.material;
+            material->updateBareMaterial(*shader);
+            stats_.material_changes++;
+        }
+        shader->updateUniformMat4("model", packet.model);
+        packet.mesh->updateUniforms(*shader);
+
+        const unsigned int mesh_vertex_array = packet.mesh->vertexArray();
+        if (mesh_vertex_array == 0) {
+            /* The mesh binds its own state in render(). */
+            packet.mesh->render();
+            vertex_array_known = false;
+        } else {
+            if (!vertex_array_known || mesh_vertex_array != vertex_array) {
+                vertex_array = mesh_vertex_array;
+                vertex_array_known = true;
+                glBindVertexArray(vertex_array);
+                stats_.vertex_array_changes++;
+            }
+            if (packet.material != nullptr) {
+                packet.mesh->draw();
+            } else {
+                /* The mesh sets its own materials, forget the current one. */
+                packet.mesh->drawMaterials(*shader);
+                material = nullptr;
+                texture_known = false;
+            }
+        }
+        stats_.draw_calls++;
+    }
+    glBindVertexArray(0);
+
+    packets_.clear();
+    order_.clear();
+    program_ids_.clear();
+    texture_ids_.clear();
+    material_ids_.clear();
+    vertex_array_ids_.clear();
+    return stats_;
+}
@@ -0,0 +1,557 @@
+#include "cgcl/render/SoftwareRasterizer.h"
+#include "cgcl/utils/logging.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+
+using namespace cgcl;
+
+
+/* Half width of the clipper's guard band in pixels. Snapped coordinates
+ * stay within 2^18 subpixels, so edge function steps over a block fit
+ * in int32 and their constant terms in int64.
+ */
+static constexpr float guard_band = 8192.0f;
+static constexpr int subpixel = 1 << SoftwareRasterizer::subpixel_bits;
+static constexpr int tile_size = SoftwareRasterizer::tile_size;
+static constexpr int block_size = SoftwareRasterizer::block_size;
+static constexpr int tile_blocks = tile_size / block_size;
+static constexpr uint32_t no_triangle = UINT32_MAX;
+static constexpr size_t setup_chunk = 4096;
+/* A triangle id is (chunk << chunk_bits | index in chunk), a chunk of
+ * setup_chunk triangles clips into at most 7 times as many.
+ */
+static constexpr int chunk_bits = 15;
+static_assert(7 * setup_chunk <= (size_t(1) << chunk_bits), "Clipped chunk overflows its ids");
+
+static_assert(block_size == 8, "A block row is one 8-wide SIMD vector");
+static_assert(tile_size % block_size == 0, "Tiles are made of whole blocks");
+
+/// \brief Vertex in clip space with the inputs of frag.glsl.
+struct ClipVertex {
+    glm::vec4 clip;
+    glm::vec3 position; // world space.
+    glm::vec3 normal;
+};
+
+/// \brief Vertex projected to the viewport, snapped to subpixels.
+struct ScreenVertex {
+    int32_t x, y;
+    float z; // window depth.
+    float inv_w;
+};
+
+/// \brief Triangle snapped to the subpixel grid, with a positive area
+/// after setup. Edge k is opposite to corner k, its function
+///     E_k = a[k] X + b[k] Y + c[k]
+/// at subpixel X, Y is 0 on the edge, positive inside and proportional
+/// to the barycentric coordinate of corner k.
+struct cgcl::RasterTriangle {
+    int32_t a[3], b[3];
+    int64_t c[3];
+    uint8_t top_left; // bit k set if edge k is a top or left edge.
+    double z[3];      // depth z[0] + z[1] x + z[2] y at the center of pixel (x, y).
+    float min_z;
+    int32_t min_x, min_y, max_x, max_y; // pixels that may be covered, inclusive.
+    float inv_w[3];
+    glm::vec3 position[3];
+    glm::vec3 normal[3];
+    uint32_t material;
+
+    /// \brief E_k at the center of pixel (x, y).
+    int64_t edge(int k, int x, int y) const {
+        return int64_t(a[k]) * (x * subpixel + subpixel / 2) + int64_t(b[k]) * (y * subpixel + subpixel / 2) + c[k];
+    }
+    /// \brief E_k minus one on edges that are not top or left, so that
+    /// a pixel is covered iff all biased edges are >= 0.
+    int64_t biasedEdge(int k, int x, int y) const { return edge(k, x, y) - ((top_left >> k & 1) ^ 1); }
+};
+
+static int64_t floor_div(int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+/* Clip planes, a vertex is inside when the distance is >= 0. */
+enum ClipPlane { Left, Right, Bottom, Top, Near, Far, n_clip_planes };
+
+static float plane_distance(const glm::vec4 &c, int plane, const glm::vec2 &guard) {
+    switch (plane) {
+    case Left: return c.x + guard.x * c.w;
+    case Right: return guard.x * c.w - c.x;
+    case Bottom: return c.y + guard.y * c.w;
+    case Top: return guard.y * c.w - c.y;
+    case Near: return c.z + c.w;
+    default: return c.w - c.z;
+    }
+}
+
+static unsigned int outcode(const glm::vec4 &c, const glm::vec2 &guard) {
+    unsigned int code = 0;
+    for (int plane = 0; plane < n_clip_planes; ++plane)
+        code |= unsigned(plane_distance(c, plane, guard) < 0.0f) << plane;
+    return code;
+}
+
+static ClipVertex lerp(const ClipVertex &p, const ClipVertex &q, float t) {
+    return {p.clip + (q.clip - p.clip) * t, p.position + (q.position - p.position) * t,
+            p.normal + (q.normal - p.normal) * t};
+}
+
+/// \brief Sutherland-Hodgman clipping of a convex polygon against the
+/// planes in the mask, in place. Attributes are interpolated linearly
+/// in clip space, which is perspective correct.
+/// \return the number of vertices left, at most n + number of planes.
+static int clip_polygon(ClipVertex *polygon, int n, unsigned int planes, const glm::vec2 &guard) {
+    ClipVertex clipped[3 + n_clip_planes];
+    for (int plane = 0; plane < n_clip_planes && n > 0; ++plane) {
+        if (!(planes >> plane & 1)) continue;
+        int m = 0;
+        for (int i = 0; i < n; ++i) {
+            const ClipVertex &p = polygon[i], &q = polygon[(i + 1) % n];
+            const float dp = plane_distance(p.clip, plane, guard), dq = plane_distance(q.clip, plane, guard);
+            if (dp >= 0.0f) clipped[m++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f)) clipped[m++] = lerp(p, q, dp / (dp - dq));
+        }
+        std::copy(clipped, clipped + m, polygon);
+        n = m;
+    }
+    return n;
+}
+
+/// \brief Round half away from zero, without a call to lround.
+static int32_t snap(float v) { return int32_t(v + (v >= 0.0f ? 0.5f : -0.5f)); }
+
+/// \brief Viewport transform of a vertex inside the guard band.
+static ScreenVertex project(const glm::vec4 &clip, int width, int height) {
+    const float inv_w = 1.0f / clip.w;
+    const glm::vec3 ndc = glm::vec3(clip) * inv_w;
+    return {snap((ndc.x * 0.5f + 0.5f) * (width * subpixel)), snap((0.5f - ndc.y * 0.5f) * (height * subpixel)),
+            ndc.z * 0.5f + 0.5f, inv_w};
+}
+
+/// \brief Set up a triangle inside the guard band.
+/// \return false if it covers no pixel center of the viewport.
+static bool setup_triangle(const ClipVertex *v[3], const ScreenVertex *s[3], int width, int height,
+                           uint32_t material, RasterTriangle &tri) {
+    const int32_t x[3] = {s[0]->x, s[1]->x, s[2]->x}, y[3] = {s[0]->y, s[1]->y, s[2]->y};
+    const float z[3] = {s[0]->z, s[1]->z, s[2]->z};
+    int64_t area = int64_t(x[1] - x[0]) * (y[2] - y[0]) - int64_t(y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0) return false;
+    /* Both faces are drawn, turn back faces around. */
+    int order[3] = {0, 1, 2};
+    if (area < 0) {
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+
+    const int32_t min_x = std::min({x[0], x[1], x[2]}), max_x = std::max({x[0], x[1], x[2]});
+    const int32_t min_y = std::min({y[0], y[1], y[2]}), max_y = std::max({y[0], y[1], y[2]});
+    /* Pixels whose center is inside the bounding box. */
+    tri.min_x = std::max<int64_t>(0, -floor_div(subpixel / 2 - min_x, subpixel));
+    tri.min_y = std::max<int64_t>(0, -floor_div(subpixel / 2 - min_y, subpixel));
+    tri.max_x = std::min<int64_t>(width - 1, floor_div(max_x - subpixel / 2, subpixel));
+    tri.max_y = std::min<int64_t>(height - 1, floor_div(max_y - subpixel / 2, subpixel));
+    if (tri.min_x > tri.max_x || tri.min_y > tri.max_y) return false;
+
+    tri.top_left = 0;
+    double z_x = 0.0, z_y = 0.0, z_0 = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        const int i = order[k], p = order[(k + 1) % 3], q = order[(k + 2) % 3];
+        const int32_t dx = x[q] - x[p], dy = y[q] - y[p];
+        tri.a[k] = -dy;
+        tri.b[k] = dx;
+        tri.c[k] = int64_t(dy) * x[p] - int64_t(dx) * y[p];
+        /* Rows grow downwards: left edges go up, top edges go right. */
+        if (dy < 0 || (dy == 0 && dx > 0)) tri.top_left |= 1 << k;
+        z_x += double(z[i]) * tri.a[k];
+        z_y += double(z[i]) * tri.b[k];
+        z_0 += double(z[i]) * (double(tri.a[k] + tri.b[k]) * (subpixel / 2) + double(tri.c[k]));
+        tri.inv_w[k] = s[i]->inv_w;
+        tri.position[k] = v[i]->position;
+        tri.normal[k] = v[i]->normal;
+    }
+    tri.z[0] = z_0 / double(area);
+    tri.z[1] = z_x * subpixel / double(area);
+    tri.z[2] = z_y * subpixel / double(area);
+    tri.min_z = std::min({z[0], z[1], z[2]});
+    tri.material = material;
+    return true;
+}
+
+/// \brief Whether an edge of tri is negative at the centers of all
+/// pixels of the w x h rectangle from pixel (x, y).
+static bool rejects(const RasterTriangle &tri, int x, int y, int w, int h) {
+    for (int k = 0; k < 3; ++k) {
+        const int64_t e = tri.biasedEdge(k, x, y);
+        const int64_t step_x = int64_t(tri.a[k]) * subpixel * (w - 1);
+        const int64_t step_y = int64_t(tri.b[k]) * subpixel * (h - 1);
+        if (e + std::max<int64_t>(0, step_x) + std::max<int64_t>(0, step_y) < 0) return true;
+    }
+    return false;
+}
+
+/// \brief Depth and nearest triangle of the pixels of one tile, and the
+/// farthest depth of each block for the hierarchical Z test.
+struct TileBuffers {
+    alignas(32) float depth[tile_size * tile_size];
+    alignas(32) uint32_t ids[tile_size * tile_size];
+    float max_depth[tile_blocks * tile_blocks];
+
+    void clear() {
+        std::fill(std::begin(depth), std::end(depth), 1.0f);
+        std::fill(std::begin(ids), std::end(ids), no_triangle);
+        std::fill(std::begin(max_depth), std::end(max_depth), 1.0f);
+    }
+};
+
+/// \brief Depth test and write 8 pixels of a row, lanes past n_lanes are
+/// outside the viewport. e holds the biased edge functions at the first
+/// pixel and step their increment per pixel.
+/// \return the number of pixels written.
+static int raster_row(const int32_t e[3], const int32_t step[3], float z, float z_step, int n_lanes,
+                      float *depth, uint32_t *ids, uint32_t id) {
+#ifdef __AVX2__
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i inside = _mm256_cmpgt_epi32(_mm256_set1_epi32(n_lanes), lane);
+    for (int k = 0; k < 3; ++k) {
+        const __m256i ek = _mm256_add_epi32(_mm256_set1_epi32(e[k]),
+                                            _mm256_mullo_epi32(lane, _mm256_set1_epi32(step[k])));
+        inside = _mm256_andnot_si256(_mm256_srai_epi32(ek, 31), inside);
+    }
+    const __m256 zs = _mm256_add_ps(_mm256_set1_ps(z), _mm256_mul_ps(_mm256_cvtepi32_ps(lane), _mm256_set1_ps(z_step)));
+    const __m256 old_depth = _mm256_load_ps(depth);
+    const __m256 pass = _mm256_and_ps(_mm256_cmp_ps(zs, old_depth, _CMP_LT_OQ), _mm256_castsi256_ps(inside));
+    const int mask = _mm256_movemask_ps(pass);
+    if (mask == 0) return 0;
+    _mm256_store_ps(depth, _mm256_blendv_ps(old_depth, zs, pass));
+    const __m256 old_ids = _mm256_load_ps(reinterpret_cast<const float *>(ids));
+    _mm256_store_ps(reinterpret_cast<float *>(ids),
+                    _mm256_blendv_ps(old_ids, _mm256_castsi256_ps(_mm256_set1_epi32(int32_t(id))), pass));
+    return __builtin_popcount(mask);
+#else
+    int written = 0;
+#pragma omp simd reduction(+ : written)
+    for (int i = 0; i < block_size; ++i) {
+        const int32_t coverage = (e[0] + i * step[0]) | (e[1] + i * step[1]) | (e[2] + i * step[2]);
+        const float zi = z + float(i) * z_step;
+        const bool pass = i < n_lanes && coverage >= 0 && zi < depth[i];
+        depth[i] = pass ? zi : depth[i];
+        ids[i] = pass ? id : ids[i];
+        written += pass;
+    }
+    return written;
+#endif
+}
+
+/// \brief Rasterize the part of a triangle inside the tile at pixel
+/// (tile_x, tile_y), block by block.
+static void raster_triangle(const RasterTriangle &tri, uint32_t id, int tile_x, int tile_y, int width,
+                            int height, TileBuffers &tile, size_t &n_occluded, size_t &n_fragments) {
+    const int bx0 = (std::max(tri.min_x, tile_x) - tile_x) / block_size;
+    const int by0 = (std::max(tri.min_y, tile_y) - tile_y) / block_size;
+    const int bx1 = (std::min(tri.max_x, tile_x + tile_size - 1) - tile_x) / block_size;
+    const int by1 = (std::min(tri.max_y, tile_y + tile_size - 1) - tile_y) / block_size;
+    for (int by = by0; by <= by1; ++by) {
+        for (int bx = bx0; bx <= bx1; ++bx) {
+            float &block_max_depth = tile.max_depth[by * tile_blocks + bx];
+            if (tri.min_z >= block_max_depth) {
+                n_occluded++;
+                continue;
+            }
+            const int x = tile_x + bx * block_size, y = tile_y + by * block_size;
+            /* Edges positive over the whole block are left out, the
+             * others are small enough here for int32.
+             */
+            int32_t e[3], step_x[3], step_y[3];
+            bool rejected = false;
+            for (int k = 0; k < 3 && !rejected; ++k) {
+                const int64_t ek = tri.biasedEdge(k, x, y);
+                const int64_t sx = int64_t(tri.a[k]) * subpixel, sy = int64_t(tri.b[k]) * subpixel;
+                const int64_t span_min = std::min<int64_t>(0, sx) + std::min<int64_t>(0, sy);
+                const int64_t span_max = std::max<int64_t>(0, sx) + std::max<int64_t>(0, sy);
+                if (ek + span_max * (block_size - 1) < 0) {
+                    rejected = true;
+                } else if (ek + span_min * (block_size - 1) >= 0) {
+                    e[k] = step_x[k] = step_y[k] = 0;
+                } else {
+                    e[k] = int32_t(ek);
+                    step_x[k] = int32_t(sx);
+                    step_y[k] = int32_t(sy);
+                }
+            }
+            if (rejected) continue;
+
+            /* Rows outside the bounding box are not covered, small
+             * triangles span only one or two of them.
+             */
+            const int n_lanes = std::min(block_size, width - x);
+            const int first_row = std::max(0, tri.min_y - y), end_row = std::min(block_size, tri.max_y - y + 1);
+            for (int k = 0; k < 3; ++k)
+                e[k] += first_row * step_y[k];
+            const float z_step = float(tri.z[1]);
+            float *depth = tile.depth + (y - tile_y) * tile_size + (x - tile_x);
+            uint32_t *ids = tile.ids + (y - tile_y) * tile_size + (x - tile_x);
+            int written = 0;
+            for (int row = first_row; row < end_row; ++row) {
+                const float z = float(tri.z[0] + tri.z[1] * x + tri.z[2] * (y + row));
+                written += raster_row(e, step_x, z, z_step, n_lanes, depth + row * tile_size,
+                                      ids + row * tile_size, id);
+                for (int k = 0; k < 3; ++k)
+                    e[k] += step_y[k];
+            }
+            if (written == 0) continue;
+            n_fragments += written;
+            float max_depth = 0.0f;
+            for (int row = 0; row < block_size; ++row)
+                for (int i = 0; i < block_size; ++i)
+                    max_depth = std::max(max_depth, depth[row * tile_size + i]);
+            block_max_depth = max_depth;
+        }
+    }
+}
+
+/// \brief Bling-Phong lighting of frag.glsl at the center of pixel (x, y),
+/// attributes interpolated with perspective correction.
+static glm::vec3 shade(const RasterTriangle &tri, int x, int y, const PhongMaterial &material,
+                       const PointLight &light, const glm::vec3 &view_pos) {
+    float weights[3], sum = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        weights[k] = float(tri.edge(k, x, y)) * tri.inv_w[k];
+        sum += weights[k];
+    }
+    const float inv_sum = 1.0f / sum;
+    glm::vec3 position(0.0f), normal(0.0f);
+    for (int k = 0; k < 3; ++k) {
+        const float w = weights[k] * inv_sum;
+        position += w * tri.position[k];
+        normal += w * tri.normal[k];
+    }
+
+    const glm::vec3 La = material.Ka_ * light.Ia_;
+    const float length = glm::length(normal);
+    if (!(length > 0.0f)) return La;
+    normal /= length;
+    const glm::vec3 light_dir = glm::normalize(light.pos_ - position);
+    const float diff_coef = std::max(glm::dot(normal, light_dir), 0.0f);
+    const glm::vec3 Ld = diff_coef * material.Kd_ * light.Id_;
+    const glm::vec3 view_dir = glm::normalize(view_pos - position);
+    const glm::vec3 half_vec = glm::normalize(light_dir + view_dir);
+    const float spec_coef = std::pow(std::max(glm::dot(half_vec, normal), 0.0f), material.decay_);
+    const glm::vec3 Ls = spec_coef * material.Ks_ * light.Is_;
+    return La + Ld + Ls;
+}
+
+static uint32_t pack_color(const glm::vec3 &color) {
+    const glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return uint32_t(c.x) | uint32_t(c.y) << 8 | uint32_t(c.z) << 16 | 0xffu << 24;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height) : framebuffer_(width, height) {
+    CHECK(width > 0 && height > 0) << "Empty viewport";
+    CHECK(width <= 4096 && height <= 4096) << "Viewport larger than the guard band allows";
+}
+
+SoftwareRasterizer::~SoftwareRasterizer() = default;
+
+void SoftwareRasterizer::setCamera(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &view_pos) {
+    view_ = view;
+    projection_ = projection;
+    view_pos_ = view_pos;
+}
+
+void SoftwareRasterizer::submit(const TriMesh &mesh, const glm::mat4 &model, const PhongMaterial *material) {
+    const bool own_materials = material == nullptr && !mesh.materials_.empty() &&
+                               mesh.sub_mesh_materials_.size() == mesh.offsets_.size();
+    draws_.push_back({&mesh, model, uint32_t(materials_.size()), own_materials});
+    if (material != nullptr) {
+        materials_.push_back(*material);
+        return;
+    }
+    /* Faces without a material take the MTL defaults, then one entry per
+     * material of the mesh.
+     */
+    const MTLMaterial none;
+    materials_.emplace_back(none.Ka_, none.Kd_, none.Ks_, none.Ns_);
+    if (!own_materials) return;
+    for (const auto &m : mesh.materials_)
+        materials_.emplace_back(m.Ka_, m.Kd_, m.Ks_, m.Ns_);
+}
+
+void SoftwareRasterizer::submit(const InstancedTriMesh &mesh) {
+    for (const auto &instance : mesh.instances_) {
+        draws_.push_back({&mesh, instance.model_, uint32_t(materials_.size()), false});
+        materials_.emplace_back(instance.Ka_, instance.Kd_, instance.Ks_, instance.decay_);
+    }
+}
+
+const RasterStats &SoftwareRasterizer::flush() {
+    const int width = framebuffer_.width_, height = framebuffer_.height_;
+    const glm::vec2 guard(2.0f * guard_band / width, 2.0f * guard_band / height);
+    const glm::mat4 view_projection = projection_ * view_;
+    stats_ = RasterStats();
+
+    /* Pass 1: transform and project every vertex once, then clip and set
+     * up chunks of setup_chunk triangles, each into its own array of
+     * triangle_chunks_. Arrays keep their memory from frame to frame.
+     */
+    size_t n_chunks = 0;
+    std::vector<ClipVertex> vertices;
+    std::vector<ScreenVertex> projected;
+    std::vector<unsigned int> outcodes;
+    std::vector<uint32_t> triangle_materials;
+    for (const Draw &draw : draws_) {
+        const TriMesh &mesh = *draw.mesh;
+        const glm::mat4 mvp = view_projection * draw.model;
+        const glm::mat3 normal_matrix = glm::mat3(glm::transpose(glm::inverse(draw.model)));
+        const long n_vertices = mesh.global_vertices_.size();
+        vertices.resize(n_vertices);
+        projected.resize(n_vertices);
+        outcodes.resize(n_vertices);
+#pragma omp parallel for schedule(static) if (n_vertices > 4096)
+        for (long v = 0; v < n_vertices; ++v) {
+            const Vertex &vertex = mesh.global_vertices_[v];
+            const glm::vec4 p(vertex.position_, 1.0f);
+            vertices[v] = {mvp * p, glm::vec3(draw.model * p), normal_matrix * vertex.normal_};
+            outcodes[v] = outcode(vertices[v].clip, guard);
+            if (outcodes[v] == 0) projected[v] = project(vertices[v].clip, width, height);
+        }
+
+        const size_t n_triangles = mesh.global_indices_.size() / 3;
+        stats_.n_triangles += n_triangles;
+        if (draw.own_materials) {
+            triangle_materials.assign(n_triangles, draw.material);
+            for (size_t s = 0; s < mesh.offsets_.size(); ++s) {
+                const uint32_t material = draw.material + 1 + mesh.sub_mesh_materials_[s];
+                std::fill_n(triangle_materials.begin() + mesh.offsets_[s] / 3, mesh.counts_[s] / 3, material);
+            }
+        }
+
+        const long n_draw_chunks = (n_triangles + setup_chunk - 1) / setup_chunk;
+        CHECK_LE(n_chunks + n_draw_chunks, size_t(1) << (32 - chunk_bits)) << "Too many triangles";
+        if (triangle_chunks_.size() < n_chunks + n_draw_chunks) triangle_chunks_.resize(n_chunks + n_draw_chunks);
+        size_t n_clipped = 0, n_culled = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : n_clipped, n_culled)
+        for (long chunk = 0; chunk < n_draw_chunks; ++chunk) {
+            std::vector<RasterTriangle> &out = triangle_chunks_[n_chunks + chunk];
+            out.clear();
+            const size_t end = std::min(n_triangles, (chunk + 1) * setup_chunk);
+            for (size_t t = chunk * setup_chunk; t < end; ++t) {
+                const unsigned int *index = &mesh.global_indices_[3 * t];
+                const uint32_t material = draw.own_materials ? triangle_materials[t] : draw.material;
+                const ClipVertex *corners[3] = {&vertices[index[0]], &vertices[index[1]], &vertices[index[2]]};
+                const unsigned int codes[3] = {outcodes[index[0]], outcodes[index[1]], outcodes[index[2]]};
+                const size_t before = out.size();
+                if ((codes[0] | codes[1] | codes[2]) == 0) {
+                    const ScreenVertex *screen[3] = {&projected[index[0]], &projected[index[1]], &projected[index[2]]};
+                    out.emplace_back();
+                    if (!setup_triangle(corners, screen, width, height, material, out.back())) out.pop_back();
+                } else if ((codes[0] & codes[1] & codes[2]) == 0) {
+                    n_clipped++;
+                    ClipVertex polygon[3 + n_clip_planes] = {*corners[0], *corners[1], *corners[2]};
+                    const int n = clip_polygon(polygon, 3, codes[0] | codes[1] | codes[2], guard);
+                    ScreenVertex polygon_screen[3 + n_clip_planes];
+                    for (int i = 0; i < n; ++i)
+                        polygon_screen[i] = project(polygon[i].clip, width, height);
+                    for (int i = 1; i + 1 < n; ++i) {
+                        const ClipVertex *fan[3] = {&polygon[0], &polygon[i], &polygon[i + 1]};
+                        const ScreenVertex *screen[3] = {&polygon_screen[0], &polygon_screen[i], &polygon_screen[i + 1]};
+                        out.emplace_back();
+                        if (!setup_triangle(fan, screen, width, height, material, out.back())) out.pop_back();
+                    }
+                }
+                if (out.size() == before) n_culled++;
+            }
+        }
+        stats_.n_clipped += n_clipped;
+        stats_.n_culled += n_culled;
+        n_chunks += n_draw_chunks;
+    }
+    draws_.clear();
+    auto triangle = [&](uint32_t id) -> const RasterTriangle & {
+        return triangle_chunks_[id >> chunk_bits][id & ((1u << chunk_bits) - 1)];
+    };
+
+    /* Pass 2: counting sort of (triangle, tile) pairs into one bin per
+     * tile. Chunks are binned in groups and cells ordered by tile then
+     * group, so every bin lists its triangles in submission order.
+     */
+    const int tiles_x = (width + tile_size - 1) / tile_size, tiles_y = (height + tile_size - 1) / tile_size;
+    const long n_tiles = long(tiles_x) * tiles_y;
+    const long n_groups = std::max<size_t>(1, std::min<size_t>(256, n_chunks));
+    auto group_begin = [&](long group) { return n_chunks * group / n_groups; };
+    auto for_each_triangle = [&](long group, auto f) {
+        for (size_t chunk = group_begin(group); chunk < group_begin(group + 1); ++chunk)
+            for (size_t i = 0; i < triangle_chunks_[chunk].size(); ++i)
+                f(triangle_chunks_[chunk][i], uint32_t(chunk << chunk_bits | i));
+    };
+    auto for_each_tile = [&](const RasterTriangle &tri, auto f) {
+        for (int ty = tri.min_y / tile_size; ty <= tri.max_y / tile_size; ++ty)
+            for (int tx = tri.min_x / tile_size; tx <= tri.max_x / tile_size; ++tx) {
+                const int x = std::max(tri.min_x, tx * tile_size), y = std::max(tri.min_y, ty * tile_size);
+                const int w = std::min(tri.max_x, tx * tile_size + tile_size - 1) - x + 1;
+                const int h = std::min(tri.max_y, ty * tile_size + tile_size - 1) - y + 1;
+                if (!rejects(tri, x, y, w, h)) f(ty * tiles_x + tx);
+            }
+    };
+    std::vector<uint32_t> offsets(n_tiles * n_groups + 1, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (long group = 0; group < n_groups; ++group)
+        for_each_triangle(group, [&](const RasterTriangle &tri, uint32_t) {
+            for_each_tile(tri, [&](long tile) { offsets[tile * n_groups + group + 1]++; });
+        });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> bins(offsets.back());
+    {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (long group = 0; group < n_groups; ++group)
+            for_each_triangle(group, [&](const RasterTriangle &tri, uint32_t id) {
+                for_each_tile(tri, [&](long tile) { bins[cursor[tile * n_groups + group]++] = id; });
+            });
+    }
+    stats_.n_bin_entries = bins.size();
+
+    /* Pass 3: one tile per thread at a time, rasterize its bin, then
+     * shade the nearest triangle of every pixel.
+     */
+    const uint32_t clear_color = pack_color(clear_color_);
+    size_t n_occluded = 0, n_fragments = 0, n_shaded = 0;
+#pragma omp parallel reduction(+ : n_occluded, n_fragments, n_shaded)
+    {
+        std::unique_ptr<TileBuffers> tile(new TileBuffers);
+#pragma omp for schedule(dynamic, 1)
+        for (long t = 0; t < n_tiles; ++t) {
+            const int tile_x = (t % tiles_x) * tile_size, tile_y = (t / tiles_x) * tile_size;
+            tile->clear();
+            for (uint32_t i = offsets[t * n_groups]; i < offsets[(t + 1) * n_groups]; ++i)
+                raster_triangle(triangle(bins[i]), bins[i], tile_x, tile_y, width, height, *tile,
+                                n_occluded, n_fragments);
+
+            const int w = std::min(tile_size, width - tile_x), h = std::min(tile_size, height - tile_y);
+            for (int y = 0; y < h; ++y) {
+                const size_t row = size_t(tile_y + y) * width + tile_x;
+                for (int x = 0; x < w; ++x) {
+                    const uint32_t id = tile->ids[y * tile_size + x];
+                    framebuffer_.depth_[row + x] = tile->depth[y * tile_size + x];
+                    if (id == no_triangle) {
+                        framebuffer_.color_[row + x] = clear_color;
+                        continue;
+                    }
+                    const RasterTriangle &tri = triangle(id);
+                    framebuffer_.color_[row + x] =
+                        pack_color(shade(tri, tile_x + x, tile_y + y, materials_[tri.material], light_, view_pos_));
+                    n_shaded++;
+                }
+            }
+        }
+    }
+    stats_.n_blocks_occluded = n_occluded;
+    stats_.n_fragments = n_fragments;
+    stats_.n_pixels_shaded = n_shaded;
+    materials_.clear();
+    return stats_;
+}
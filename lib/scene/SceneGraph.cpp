@@ -0,0 +1,138 @@
+#include "cgcl/scene/SceneGraph.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+
+using namespace cgcl;
+
+
+void SceneGraph::reserve(size_t n_nodes) {
+    parents_.reserve(n_nodes);
+    slot_of_.reserve(n_nodes);
+    node_of_.reserve(n_nodes);
+    parent_slots_.reserve(n_nodes);
+    locals_.reserve(n_nodes);
+    worlds_.reserve(n_nodes);
+    dirty_.reserve(n_nodes);
+}
+
+SceneGraph::NodeId SceneGraph::addNode(NodeId parent, const glm::mat4 &local) {
+    CHECK(parent == no_parent || parent < size()) << "Parent " << parent << " does not exist";
+    CHECK_LT(size(), size_t(no_parent)) << "Too many scene nodes";
+    NodeId node = size();
+    parents_.push_back(parent);
+    slot_of_.push_back(locals_.size());
+    node_of_.push_back(node);
+    parent_slots_.push_back(parent == no_parent ? no_parent : slot_of_[parent]);
+    locals_.push_back(local);
+    worlds_.push_back(local);
+    dirty_.push_back(1);
+    levels_changed_ = true;
+    any_dirty_ = true;
+    return node;
+}
+
+void SceneGraph::setLocal(NodeId node, const glm::mat4 &local) {
+    uint32_t slot = slot_of_[node];
+    locals_[slot] = local;
+    dirty_[slot] = 1;
+    any_dirty_ = true;
+}
+
+void SceneGraph::setLocals(const glm::mat4 *locals) {
+    const long n_nodes = size();
+    const NodeId *node_of = node_of_.data();
+#pragma omp parallel for schedule(static)
+    for (long slot = 0; slot < n_nodes; ++slot)
+        locals_[slot] = locals[node_of[slot]];
+    std::fill(dirty_.begin(), dirty_.end(), 1);
+    any_dirty_ = n_nodes > 0;
+}
+
+/// \brief Lay the nodes out breadth first. Children are visited in the
+/// order of their parents, so every level is sorted by parent slot and
+/// reads the previous level front to back.
+void SceneGraph::rebuildLevels() {
+    const size_t n_nodes = size();
+    /* Children of each node in CSR form, ids ascending. */
+    std::vector<uint32_t> child_offsets(n_nodes + 2, 0);
+    for (NodeId node = 0; node < n_nodes; ++node)
+        child_offsets[(parents_[node] == no_parent ? 0 : parents_[node] + 1) + 1]++;
+    for (size_t k = 0; k <= n_nodes; ++k)
+        child_offsets[k + 1] += child_offsets[k];
+    /* Bucket 0 holds roots, bucket i + 1 holds children of node i. */
+    std::vector<NodeId> children(n_nodes);
+    std::vector<uint32_t> cursor(child_offsets.begin(), child_offsets.end() - 1);
+    for (NodeId node = 0; node < n_nodes; ++node)
+        children[cursor[parents_[node] == no_parent ? 0 : parents_[node] + 1]++] = node;
+
+    std::vector<NodeId> order(n_nodes);
+    size_t tail = std::copy(children.begin(), children.begin() + child_offsets[1], order.begin()) - order.begin();
+    level_offsets_.assign(1, 0);
+    for (size_t head = 0; head < tail; ) {
+        const size_t level_end = tail;
+        level_offsets_.push_back(level_end);
+        for (; head < level_end; ++head) {
+            NodeId node = order[head];
+            for (uint32_t k = child_offsets[node + 1]; k < child_offsets[node + 2]; ++k)
+                order[tail++] = children[k];
+        }
+    }
+
+    /* Move every array from the old layout to the new one. */
+    const std::vector<uint32_t> old_slot_of = slot_of_;
+    for (uint32_t slot = 0; slot < n_nodes; ++slot)
+        slot_of_[order[slot]] = slot;
+    std::vector<uint32_t> parent_slots(n_nodes);
+    std::vector<glm::mat4> locals(n_nodes), worlds(n_nodes);
+    std::vector<uint8_t> dirty(n_nodes);
+#pragma omp parallel for schedule(static)
+    for (long slot = 0; slot < long(n_nodes); ++slot) {
+        NodeId node = order[slot];
+        uint32_t old_slot = old_slot_of[node];
+        parent_slots[slot] = parents_[node] == no_parent ? no_parent : slot_of_[parents_[node]];
+        locals[slot] = locals_[old_slot];
+        worlds[slot] = worlds_[old_slot];
+        dirty[slot] = dirty_[old_slot];
+    }
+    node_of_ = std::move(order);
+    parent_slots_ = std::move(parent_slots);
+    locals_ = std::move(locals);
+    worlds_ = std::move(worlds);
+    dirty_ = std::move(dirty);
+    levels_changed_ = false;
+}
+
+void SceneGraph::updateWorld() {
+    if (!any_dirty_) return;
+    if (levels_changed_) rebuildLevels();
+
+    const uint32_t *parent_slots = parent_slots_.data();
+    const glm::mat4 *locals = locals_.data();
+    glm::mat4 *worlds = worlds_.data();
+    uint8_t *dirty = dirty_.data();
+
+    /* Roots have nothing to read, copy the dirty ones. */
+    const long n_roots = level_offsets_[1];
+#pragma omp parallel for schedule(static) if (n_roots > 4096)
+    for (long slot = 0; slot < n_roots; ++slot) {
+        if (dirty[slot]) worlds[slot] = locals[slot];
+    }
+
+    /* A node is dirty if itself or its parent is, the parent belongs to
+     * the previous level and is final by now.
+     */
+    for (size_t d = 1; d + 1 < level_offsets_.size(); ++d) {
+        const long begin = level_offsets_[d], end = level_offsets_[d + 1];
+#pragma omp parallel for schedule(static) if (end - begin > 4096)
+        for (long slot = begin; slot < end; ++slot) {
+            uint32_t parent = parent_slots[slot];
+            if (!(dirty[slot] | dirty[parent])) continue;
+            dirty[slot] = 1;
+            worlds[slot] = worlds[parent] * locals[slot];
+        }
+    }
+
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    any_dirty_ = false;
+}
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <vector>
+
 using namespace cgcl;
 
 void BezierSurface::init() {
@@ -18,10 +20,59 @@ void BezierSurface::render() {
 }
 
 glm::vec3 BezierSurface::getPoint(float u, float v) const {
+    return evaluate(n_us, n_vs, ctrl_pts_.data(), 
+                    weights_.empty() ? nullptr : weights_.data(), u, v);
+}
+
+glm::vec3 BezierSurface::evaluate(unsigned int n_us, unsigned int n_vs, const glm::vec3 *ctrl_pts,
+                                  const float *weights, float u, float v) {
     glm::vec3 p(0.0);
     // Bezier surface degree (n, m) is defined by (n+1, m+1) control points.
-    for (int i = 0; i < n_us; ++i)
-        for (int j = 0 ; j < n_vs; ++j) 
-            p += bernstein_poly(n_us - 1, i, u) * bernstein_poly(n_vs - 1, j, v) * ctrl_pts_[i * n_vs + j];
-    return p;
+    if (n_us == 4 && n_vs == 4 && weights == nullptr) {
+        float Bu[4], Bv[4];
+        bernstein_basis<3>(u, Bu);
+        bernstein_basis<3>(v, Bv);
+        for (int i = 0; i < 4; ++i) {
+            glm::vec3 row = Bv[0] * ctrl_pts[i * 4] + Bv[1] * ctrl_pts[i * 4 + 1]
+                          + Bv[2] * ctrl_pts[i * 4 + 2] + Bv[3] * ctrl_pts[i * 4 + 3];
+            p += Bu[i] * row;
+        }
+        return p;
+    }
+
+    /* Basis of each direction is computed once instead of per control point,
+     * high degree patches spill the basis to heap.
+     */
+    constexpr unsigned int max_order = binomial_table_degree + 1;
+    float stack_basis[2 * max_order];
+    std::vector<float> heap_basis;
+    float *Bu = stack_basis, *Bv = stack_basis + max_order;
+    if (n_us > max_order || n_vs > max_order) {
+        heap_basis.resize(n_us + n_vs);
+        Bu = heap_basis.data();
+        Bv = Bu + n_us;
+    }
+    bernstein_basis(n_us - 1, u, Bu);
+    bernstein_basis(n_vs - 1, v, Bv);
+
+    if (weights == nullptr) {
+        for (int i = 0; i < n_us; ++i) {
+            glm::vec3 row(0.0);
+            for (int j = 0 ; j < n_vs; ++j) 
+                row += Bv[j] * ctrl_pts[i * n_vs + j];
+            p += Bu[i] * row;
+        }
+        return p;
+    }
+
+    /* Rational surface is evaluated in homogeneous coordinate. */
+    float w = 0.0f;
+    for (int i = 0; i < n_us; ++i) {
+        for (int j = 0 ; j < n_vs; ++j) {
+            float bw = Bu[i] * Bv[j] * weights[i * n_vs + j];
+            p += bw * ctrl_pts[i * n_vs + j];
+            w += bw;
+        }
+    }
+    return p / w;
 }
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "cgcl/surface/BezierPatchSet.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cgcl;
+
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 is expected to be packed");
+static_assert(sizeof(BezierPatchRecord) == 12, "BezierPatchRecord is expected to be packed");
+static_assert(sizeof(BezierPatchFileHeader) == 24, "BezierPatchFileHeader is expected to be packed");
+
+BezierPatchSet::~BezierPatchSet() {
+    if (mapped_ != nullptr)
+        munmap(mapped_, mapped_size_);
+}
+
+static inline bool is_whitespace(char c) {
+    return c <= ' '; // treate ASCII control chars as white space.
+}
+
+static const char *skip_whitespace(const char *p, const char *end) {
+    while (p < end && is_whitespace(*p)) ++p;
+    return p;
+}
+
+static const char *parse_uint(const char *p, const char *end, uint32_t &dst) {
+    p = skip_whitespace(p, end);
+    const char *start = p;
+    uint64_t value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        value = value * 10 + (*p - '0');
+    CHECK(p != start) << "Expect integer at \"" << std::string(start, std::min<size_t>(end - start, 16)) << "\"";
+    CHECK_LE(value, UINT32_MAX) << "Integer out of range";
+    dst = value;
+    return p;
+}
+
+/// \brief Locale independent decimal float parser, [+-]digits[.digits][(e|E)[+-]digits].
+/// Mantissa is gathered in an integer and scaled once, which is exact
+/// for up to 19 significant digits and exponents within 10^22.
+static const char *parse_float(const char *p, const char *end, float &dst) {
+    static const double exact_pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    p = skip_whitespace(p, end);
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0, n_digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++n_digits) {
+        if (mantissa < 1000000000000000000ull) mantissa = mantissa * 10 + (*p - '0');
+        else exponent++;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++n_digits) {
+            if (mantissa < 1000000000000000000ull) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+    CHECK_GT(n_digits, 0) << "Expect float at \"" << std::string(start, std::min<size_t>(end - start, 16)) << "\"";
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool e_negative = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            e_negative = *e == '-';
+            ++e;
+        }
+        int e_value = 0;
+        const char *e_start = e;
+        for (; e < end && *e >= '0' && *e <= '9'; ++e)
+            if (e_value < 10000) e_value = e_value * 10 + (*e - '0');
+        if (e != e_start) {
+            exponent += e_negative ? -e_value : e_value;
+            p = e;
+        }
+    }
+    double value = double(mantissa);
+    if (exponent < 0)
+        value = exponent >= -22 ? value / exact_pow10[-exponent] : value * std::pow(10.0, exponent);
+    else if (exponent > 0)
+        value = exponent <= 22 ? value * exact_pow10[exponent] : value * std::pow(10.0, exponent);
+    dst = float(negative ? -value : value);
+    return p;
+}
+
+std::unique_ptr<BezierPatchSet> BezierPatchSet::from_file(const std::string &filename) {
+    char magic[4] = {0};
+    std::ifstream input_stream(filename, std::ios::binary);
+    CHECK(input_stream) << "Failed to open " << filename;
+    input_stream.read(magic, sizeof(magic));
+    if (input_stream.gcount() == sizeof(magic) && memcmp(magic, binary_magic, sizeof(magic)) == 0)
+        return from_binary(filename);
+    return from_text(filename);
+}
+
+std::unique_ptr<BezierPatchSet> BezierPatchSet::from_text(const std::string &filename) {
+    std::ifstream input_stream(filename, std::ios::binary | std::ios::ate);
+    CHECK(input_stream) << "Failed to open " << filename;
+    std::string input(size_t(input_stream.tellg()), '\0');
+    input_stream.seekg(0);
+    input_stream.read(input.data(), input.size());
+
+    const char *p = input.data(), *end = input.data() + input.size();
+    auto set = std::make_unique<BezierPatchSet>();
+    uint32_t n_patches;
+    p = parse_uint(p, end, n_patches);
+    /* A patch takes at least 5 numbers of 2 characters, a control point 3. */
+    CHECK_LE(n_patches, size_t(end - p) / 10) << filename << " is truncated";
+    set->owned_patches_.resize(n_patches);
+    /* Each coordinate takes at least 2 characters, so it is an upper bound. */
+    set->owned_ctrl_pts_.reserve(input.size() / 6);
+    for (uint32_t k = 0; k < n_patches; ++k) {
+        BezierPatchRecord &record = set->owned_patches_[k];
+        p = parse_uint(p, end, record.n_us);
+        p = parse_uint(p, end, record.n_vs);
+        CHECK(record.n_us > 0 && record.n_vs > 0) << "Patch " << k << " is empty in " << filename;
+        record.first = set->owned_ctrl_pts_.size();
+        const size_t n_ctrl_pts = size_t(record.n_us) * record.n_vs;
+        CHECK_LE(n_ctrl_pts, size_t(end - p) / 6) << filename << " is truncated";
+        for (size_t i = 0; i < n_ctrl_pts; ++i) {
+            glm::vec3 &pos = set->owned_ctrl_pts_.emplace_back();
+            p = parse_float(p, end, pos.x);
+            p = parse_float(p, end, pos.y);
+            p = parse_float(p, end, pos.z);
+        }
+    }
+
+    set->patches_ = set->owned_patches_.data();
+    set->ctrl_pts_ = set->owned_ctrl_pts_.data();
+    set->n_patches_ = set->owned_patches_.size();
+    set->n_ctrl_pts_ = set->owned_ctrl_pts_.size();
+    LOG(INFO) << "Read from: " << filename;
+    LOG(INFO) << "Total Patches: " << set->n_patches_;
+    LOG(INFO) << "Total Control Points: " << set->n_ctrl_pts_;
+    return set;
+}
+
+std::unique_ptr<BezierPatchSet> BezierPatchSet::from_binary(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << "Failed to open " << filename;
+    struct stat file_stat;
+    CHECK_EQ(fstat(fd, &file_stat), 0) << "Failed to stat " << filename;
+    const size_t file_size = file_stat.st_size;
+    CHECK_GE(file_size, sizeof(BezierPatchFileHeader)) << filename << " is truncated";
+
+    void *mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    CHECK(mapped != MAP_FAILED) << "Failed to map " << filename;
+
+    auto set = std::make_unique<BezierPatchSet>();
+    set->mapped_ = mapped;
+    set->mapped_size_ = file_size;
+
+    const char *base = static_cast<const char *>(mapped);
+    BezierPatchFileHeader header;
+    memcpy(&header, base, sizeof(header));
+    CHECK_EQ(memcmp(header.magic, binary_magic, sizeof(binary_magic)), 0) << filename << " is not a patch file";
+    CHECK_EQ(header.version, binary_version) << "Unsupported patch file version";
+    /* Counts come from the file, compare by division so they cannot overflow. */
+    const size_t patches_offset = sizeof(BezierPatchFileHeader);
+    CHECK_LE(header.n_patches, (file_size - patches_offset) / sizeof(BezierPatchRecord))
+        << filename << " is truncated";
+    const size_t ctrl_offset = patches_offset + header.n_patches * sizeof(BezierPatchRecord);
+    CHECK_LE(header.n_ctrl_pts, (file_size - ctrl_offset) / sizeof(glm::vec3)) << filename << " is truncated";
+
+    set->patches_ = reinterpret_cast<const BezierPatchRecord *>(base + patches_offset);
+    set->ctrl_pts_ = reinterpret_cast<const glm::vec3 *>(base + ctrl_offset);
+    set->n_patches_ = header.n_patches;
+    set->n_ctrl_pts_ = header.n_ctrl_pts;
+    for (size_t k = 0; k < set->n_patches_; ++k) {
+        const auto &record = set->patches_[k];
+        CHECK(record.n_us > 0 && record.n_vs > 0) << "Patch " << k << " is empty in " << filename;
+        CHECK_LE(size_t(record.first) + size_t(record.n_us) * record.n_vs, set->n_ctrl_pts_)
+            << "Patch " << k << " is out of range in " << filename;
+    }
+    return set;
+}
+
+void BezierPatchSet::save_binary(const std::string &filename) const {
+    std::ofstream output_stream(filename, std::ios::binary);
+    CHECK(output_stream) << "Failed to open " << filename;
+    BezierPatchFileHeader header;
+    memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.version = binary_version;
+    header.n_patches = n_patches_;
+    header.n_ctrl_pts = n_ctrl_pts_;
+    output_stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output_stream.write(reinterpret_cast<const char *>(patches_), n_patches_ * sizeof(BezierPatchRecord));
+    output_stream.write(reinterpret_cast<const char *>(ctrl_pts_), n_ctrl_pts_ * sizeof(glm::vec3));
+    CHECK(output_stream) << "Failed to write " << filename;
+}
+
+BezierSurface BezierPatchSet::toBezierSurface(size_t i) const {
+    const auto &record = patches_[i];
+    const glm::vec3 *first = ctrl_pts(i);
+    return BezierSurface(record.n_us, record.n_vs,
+                         std::vector<glm::vec3>(first, first + record.n_us * record.n_vs));
+}
+
+std::vector<BezierSurface> BezierPatchSet::toBezierSurfaces() const {
+    std::vector<BezierSurface> surfaces;
+    surfaces.reserve(n_patches_);
+    for (size_t i = 0; i < n_patches_; ++i)
+        surfaces.push_back(toBezierSurface(i));
+    return surfaces;
+}
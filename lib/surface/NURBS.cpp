@@ -0,0 +1,231 @@
+#include "cgcl/surface/NURBS.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+
+using namespace cgcl;
+
+
+NURBSSurface::NURBSSurface(unsigned int degree_u, unsigned int degree_v,
+                           const std::vector<float> &knots_u, const std::vector<float> &knots_v,
+                           const std::vector<glm::vec3> &ctrl_pts,
+                           const std::vector<float> &weights)
+    : degree_u(degree_u), degree_v(degree_v), knots_u_(knots_u), knots_v_(knots_v),
+      ctrl_pts_(ctrl_pts), weights_(weights)
+{
+    CHECK_LE(degree_u, max_degree) << "Unsupported NURBS degree";
+    CHECK_LE(degree_v, max_degree) << "Unsupported NURBS degree";
+    CHECK_GT(knots_u_.size(), 2 * degree_u + 1) << "Too few knots along u";
+    CHECK_GT(knots_v_.size(), 2 * degree_v + 1) << "Too few knots along v";
+    CHECK_EQ(ctrl_pts_.size(), n_us() * n_vs()) << "Control points do not match knot vectors";
+    CHECK(weights_.empty() || weights_.size() == ctrl_pts_.size()) << "Expect one weight per control point";
+    CHECK(std::is_sorted(knots_u_.begin(), knots_u_.end())) << "Knots along u are not sorted";
+    CHECK(std::is_sorted(knots_v_.begin(), knots_v_.end())) << "Knots along v are not sorted";
+}
+
+/// \brief Span index k, knots[k] <= t < knots[k + 1], with
+/// p <= k <= n, where n is the index of the last control point.
+/// Try the cached span and its successor before the binary search.
+static int find_span(const std::vector<float> &knots, int p, int n, float t, int hint) {
+    if (t >= knots[n + 1]) return n;
+    if (t <= knots[p]) return p;
+    if (hint >= p && hint <= n) {
+        if (knots[hint] <= t && t < knots[hint + 1]) return hint;
+        if (hint < n && knots[hint + 1] <= t && t < knots[hint + 2]) return hint + 1;
+    }
+    /* upper_bound finds the first knot greater than t. */
+    auto it = std::upper_bound(knots.begin() + p, knots.begin() + n + 1, t);
+    return int(it - knots.begin()) - 1;
+}
+
+/// \brief The p + 1 non-zero basis N[span - p .. span] at t by
+/// the triangular Cox-de Boor recurrence.
+static void basis_funs(const std::vector<float> &knots, int span, int p, float t, float *N) {
+    float left[NURBSSurface::max_degree + 1], right[NURBSSurface::max_degree + 1];
+    N[0] = 1.0f;
+    for (int j = 1; j <= p; ++j) {
+        left[j] = t - knots[span + 1 - j];
+        right[j] = knots[span + j] - t;
+        float saved = 0.0f;
+        for (int r = 0; r < j; ++r) {
+            float temp = N[r] / (right[r + 1] + left[j - r]);
+            N[r] = saved + right[r + 1] * temp;
+            saved = left[j - r] * temp;
+        }
+        N[j] = saved;
+    }
+}
+
+/// \brief Blend the (p + 1) x (q + 1) control points of one span pair.
+static glm::vec3 blend(const NURBSSurface &surface, int span_u, int span_v,
+                       const float *Nu, const float *Nv) {
+    const int p = surface.degree_u, q = surface.degree_v;
+    const int n_vs = surface.n_vs();
+    const int first_u = span_u - p, first_v = span_v - q;
+    glm::vec3 point(0.0f);
+    if (surface.weights_.empty()) {
+        for (int k = 0; k <= p; ++k) {
+            glm::vec3 row(0.0f);
+            const glm::vec3 *ctrl = &surface.ctrl_pts_[(first_u + k) * n_vs + first_v];
+            for (int l = 0; l <= q; ++l)
+                row += Nv[l] * ctrl[l];
+            point += Nu[k] * row;
+        }
+        return point;
+    }
+
+    float w = 0.0f;
+    for (int k = 0; k <= p; ++k) {
+        const int offset = (first_u + k) * n_vs + first_v;
+        const glm::vec3 *ctrl = &surface.ctrl_pts_[offset];
+        const float *weight = &surface.weights_[offset];
+        for (int l = 0; l <= q; ++l) {
+            float nw = Nu[k] * Nv[l] * weight[l];
+            point += nw * ctrl[l];
+            w += nw;
+        }
+    }
+    return point / w;
+}
+
+glm::vec3 NURBSSurface::getPoint(float u, float v) const {
+    KnotSpanCache cache;
+    return getPoint(u, v, cache);
+}
+
+glm::vec3 NURBSSurface::getPoint(float u, float v, KnotSpanCache &cache) const {
+    float Nu[max_degree + 1], Nv[max_degree + 1];
+    cache.span_u = find_span(knots_u_, degree_u, n_us() - 1, u, cache.span_u);
+    cache.span_v = find_span(knots_v_, degree_v, n_vs() - 1, v, cache.span_v);
+    basis_funs(knots_u_, cache.span_u, degree_u, u, Nu);
+    basis_funs(knots_v_, cache.span_v, degree_v, v, Nv);
+    return blend(*this, cache.span_u, cache.span_v, Nu, Nv);
+}
+
+void NURBSSurface::evaluateGrid(unsigned int nu, unsigned int nv, glm::vec3 *out) const {
+    CHECK_GT(nu, 1);
+    CHECK_GT(nv, 1);
+    const int p = degree_u, q = degree_v;
+    /* Spans and non-zero basis of every column and row. */
+    std::vector<int> spans_u(nu), spans_v(nv);
+    std::vector<float> basis_u(nu * (p + 1)), basis_v(nv * (q + 1));
+    int span = -1;
+    for (int i = 0; i < nu; ++i) {
+        float u = u_min() + (u_max() - u_min()) * i / (nu - 1);
+        span = spans_u[i] = find_span(knots_u_, p, n_us() - 1, u, span);
+        basis_funs(knots_u_, span, p, u, &basis_u[i * (p + 1)]);
+    }
+    span = -1;
+    for (int j = 0; j < nv; ++j) {
+        float v = v_min() + (v_max() - v_min()) * j / (nv - 1);
+        span = spans_v[j] = find_span(knots_v_, q, n_vs() - 1, v, span);
+        basis_funs(knots_v_, span, q, v, &basis_v[j * (q + 1)]);
+    }
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < int(nu); ++i) {
+        for (int j = 0; j < nv; ++j) {
+            out[i * nv + j] = blend(*this, spans_u[i], spans_v[j],
+                                    &basis_u[i * (p + 1)], &basis_v[j * (q + 1)]);
+        }
+    }
+}
+
+/// \brief Insert knot t once along u of a homogeneous grid (n_u x n_v, u major)
+/// by Boehm's algorithm, knots and grid are updated in place.
+static void insert_knot_u(std::vector<float> &knots, int p, std::vector<glm::vec4> &grid,
+                          int n_u, int n_v, float t) {
+    const int k = find_span(knots, p, n_u - 1, t, -1);
+    std::vector<glm::vec4> refined((n_u + 1) * n_v);
+    for (int i = 0; i <= n_u; ++i) {
+        glm::vec4 *dst = &refined[i * n_v];
+        if (i <= k - p) {
+            std::copy_n(&grid[i * n_v], n_v, dst);
+        } else if (i > k) {
+            std::copy_n(&grid[(i - 1) * n_v], n_v, dst);
+        } else {
+            float a = (t - knots[i]) / (knots[i + p] - knots[i]);
+            for (int j = 0; j < n_v; ++j)
+                dst[j] = a * grid[i * n_v + j] + (1.0f - a) * grid[(i - 1) * n_v + j];
+        }
+    }
+    knots.insert(knots.begin() + k + 1, t);
+    grid = std::move(refined);
+}
+
+/// \brief Raise every interior knot to multiplicity p, after that
+/// each span along u owns p + 1 consecutive rows of the grid.
+/// Return the number of spans.
+static int decompose_u(std::vector<float> &knots, int p, std::vector<glm::vec4> &grid,
+                       int &n_u, int n_v) {
+    int n_spans = 0;
+    for (int k = p; k < n_u; ) {
+        /* knots[k] < knots[k + 1] is a non-empty span. */
+        int next = k + 1;
+        if (knots[k] < knots[next]) n_spans++;
+        if (next >= n_u) break;
+        float t = knots[next];
+        int multiplicity = 0;
+        while (next + multiplicity < knots.size() && knots[next + multiplicity] == t)
+            multiplicity++;
+        CHECK_LE(multiplicity, p) << "Discontinuous knot " << t << " is not supported";
+        for (int r = multiplicity; r < p; ++r) {
+            insert_knot_u(knots, p, grid, n_u, n_v, t);
+            n_u++;
+        }
+        /* skip to the last copy of t. */
+        k = next + std::max(multiplicity, p) - 1;
+    }
+    return n_spans;
+}
+
+static std::vector<glm::vec4> transpose_grid(const std::vector<glm::vec4> &grid, int n_u, int n_v) {
+    std::vector<glm::vec4> transposed(grid.size());
+    for (int i = 0; i < n_u; ++i)
+        for (int j = 0; j < n_v; ++j)
+            transposed[j * n_u + i] = grid[i * n_v + j];
+    return transposed;
+}
+
+std::vector<BezierSurface> NURBSSurface::toBezierPatches() const {
+    const int p = degree_u, q = degree_v;
+    int n_u = n_us(), n_v = n_vs();
+    for (int i = 0; i <= p; ++i)
+        CHECK_EQ(knots_u_[i], knots_u_[p]) << "Expect clamped knots along u";
+    for (int j = 0; j <= q; ++j)
+        CHECK_EQ(knots_v_[j], knots_v_[q]) << "Expect clamped knots along v";
+
+    /* Work in homogeneous coordinate, so rational patches are exact. */
+    std::vector<glm::vec4> grid(n_u * n_v);
+    for (int i = 0; i < n_u * n_v; ++i) {
+        float w = weights_.empty() ? 1.0f : weights_[i];
+        grid[i] = glm::vec4(ctrl_pts_[i] * w, w);
+    }
+
+    std::vector<float> knots_u = knots_u_, knots_v = knots_v_;
+    int spans_u = decompose_u(knots_u, p, grid, n_u, n_v);
+    grid = transpose_grid(grid, n_u, n_v);
+    int spans_v = decompose_u(knots_v, q, grid, n_v, n_u);
+    grid = transpose_grid(grid, n_v, n_u);
+
+    std::vector<BezierSurface> patches;
+    patches.reserve(spans_u * spans_v);
+    for (int a = 0; a < spans_u; ++a) {
+        for (int b = 0; b < spans_v; ++b) {
+            std::vector<glm::vec3> ctrl_pts((p + 1) * (q + 1));
+            std::vector<float> weights((p + 1) * (q + 1));
+            for (int k = 0; k <= p; ++k) {
+                for (int l = 0; l <= q; ++l) {
+                    const glm::vec4 &pw = grid[(a * p + k) * n_v + (b * q + l)];
+                    ctrl_pts[k * (q + 1) + l] = glm::vec3(pw) / pw.w;
+                    weights[k * (q + 1) + l] = pw.w;
+                }
+            }
+            if (weights_.empty())
+                patches.emplace_back(p + 1, q + 1, ctrl_pts);
+            else
+                patches.emplace_back(p + 1, q + 1, ctrl_pts, weights);
+        }
+    }
+    return patches;
+}
@@ -58,10 +58,15 @@ static size_t tryParseInt(const std::string &input, size_t index, int &dst) {
 }
 
 
+/// \brief Rest of the line without trailing white space, the last line
+/// may have no line break.
 static size_t tryParseString(const std::string &input, size_t index, std::string &name) {
     size_t name_end = input.find('\n', index);
-    CHECK_NE(name_end, std::string::npos) << "Expect name";
-    name = input.substr(index, name_end-index);
+    if (name_end == std::string::npos) name_end = input.size();
+    size_t end = name_end;
+    while (end > index && is_whitespace(input[end - 1])) --end;
+    CHECK_GT(end, index) << "Expect name at " << index;
+    name = input.substr(index, end - index);
     return name_end;
 }
 
@@ -96,8 +101,18 @@ void OBJParser::parse(std::vector<std::unique_ptr<Geometry>> &geometry, GlobalVe
     std::getline(input_stream, input_, '\0');
 
     bool state_smooth = false;
-    bool state_material_index = -1;
+    /* usemtl stays in effect across objects, until the next usemtl. */
+    std::string state_material;
+    int state_material_index = -1;
     Geometry *curr_geom = nullptr;
+    /* Faces before any object name go to an unnamed geometry. */
+    auto current_geometry = [&]() {
+        if (curr_geom == nullptr) {
+            geometry.emplace_back(std::make_unique<Geometry>());
+            curr_geom = geometry.back().get();
+        }
+        return curr_geom;
+    };
     n_line_ = 1;
     for (;index_ < input_.size(); ) {
         n_line_ += skipWhiteSpace(input_, index_);
@@ -114,7 +129,7 @@ void OBJParser::parse(std::vector<std::unique_ptr<Geometry>> &geometry, GlobalVe
         }
         else if (input_[index_] == 'f') {
             if (expectKeyword(input_, index_, "f")) {
-                geom_add_polygon(curr_geom, global_vertices, state_smooth);
+                geom_add_polygon(current_geometry(), global_vertices, state_smooth, state_material_index);
             }
         }
         else if (input_[index_] == 'o') {
@@ -123,6 +138,7 @@ void OBJParser::parse(std::vector<std::unique_ptr<Geometry>> &geometry, GlobalVe
                 geometry.emplace_back(std::make_unique<Geometry>());
                 curr_geom = geometry.back().get();
                 geom_add_name(curr_geom);
+                state_material_index = state_material.empty() ? -1 : geom_use_material(curr_geom, state_material);
             }
         }
         else if (input_[index_] == 's') {
@@ -135,22 +151,19 @@ void OBJParser::parse(std::vector<std::unique_ptr<Geometry>> &geometry, GlobalVe
             index_ = tryParseString(input_, index_, mtl_library_name);
             LOG(INFO) << "Import MTL library: " << mtl_library_name;
             if (std::find(mtl_libraries_.begin(), mtl_libraries_.end(), mtl_library_name) 
-                != mtl_libraries_.end()) {
+                == mtl_libraries_.end()) {
                     mtl_libraries_.push_back(mtl_library_name);
             }
         }
         /* Material and library */
         else if (expectKeyword(input_, index_, "usemtl")) {
-            std::string material_name;
-            index_ = tryParseString(input_, index_, material_name);
-            LOG(INFO) << "Use MTL " << material_name << " : " << n_line_;
-            /* Try to insert a new material in current geometry */
-            int new_mtl_index = curr_geom->material_indices_.size();
-            if (!curr_geom->material_indices_.count(material_name)) {
-                curr_geom->material_indices_.insert_or_assign(material_name, new_mtl_index);
-                curr_geom->material_order_.push_back(material_name);
-            }
+            index_ = tryParseString(input_, index_, state_material);
+            LOG(INFO) << "Use MTL " << state_material << " : " << n_line_;
+            /* Faces from here on are bucketed to this material. */
+            state_material_index = geom_use_material(current_geometry(), state_material);
         }
+        else
+            skipComment();
     }
 
     LOG(INFO) << "Read from: " << filename_;
@@ -162,6 +175,17 @@ void OBJParser::parse(std::vector<std::unique_ptr<Geometry>> &geometry, GlobalVe
     LOG(INFO) << "Total Faces: " << total_faces;
 }
 
+int OBJParser::geom_use_material(Geometry *geom, const std::string &material_name) {
+    /* Try to insert a new material in current geometry */
+    auto it = geom->material_indices_.find(material_name);
+    if (it != geom->material_indices_.end())
+        return it->second;
+    int new_mtl_index = geom->material_order_.size();
+    geom->material_indices_.emplace(material_name, new_mtl_index);
+    geom->material_order_.push_back(material_name);
+    return new_mtl_index;
+}
+
 void OBJParser::geom_add_name(Geometry *geom) {
     size_t name_end = input_.find('\n', index_);
     if (name_end != std::string::npos) {
@@ -215,10 +239,11 @@ void OBJParser::geom_add_uv_vertex(GlobalVertices &global_vertices) {
 }
 
 void OBJParser::geom_add_polygon(Geometry *geom, GlobalVertices &global_vertices,
-                                 const bool shaded_smooth) 
+                                 const bool shaded_smooth, const int material_index) 
 {
     PolyElem curr_face;
     curr_face.shaded_smooth_ = shaded_smooth;
+    curr_face.material_index_ = material_index;
 
     const int orig_corners_size = geom->face_corners_.size();
     curr_face.start_index_ = orig_corners_size;
@@ -278,13 +303,29 @@ void OBJParser::geom_add_polygon(Geometry *geom, GlobalVertices &global_vertices
 }
 
 
-static MTLTexMapType mtl_parse_texture_type(const std::string &input, size_t index) {
+static MTLTexMapType mtl_parse_texture_type(const std::string &input, size_t &index) {
     if (expectKeyword(input, index, "map_Kd")) {
         return MTLTexMapType::Color;
     }
     if (expectKeyword(input, index, "map_Ks")) {
         return MTLTexMapType::Specular;
     }
+    if (expectKeyword(input, index, "map_Ns")) {
+        return MTLTexMapType::SpecularExponent;
+    }
+    if (expectKeyword(input, index, "map_Ke")) {
+        return MTLTexMapType::Emission;
+    }
+    if (expectKeyword(input, index, "map_d")) {
+        return MTLTexMapType::Alpha;
+    }
+    if (expectKeyword(input, index, "refl")) {
+        return MTLTexMapType::Reflection;
+    }
+    if (expectKeyword(input, index, "map_Bump") || expectKeyword(input, index, "bump") ||
+        expectKeyword(input, index, "norm")) {
+        return MTLTexMapType::Normal;
+    }
     return MTLTexMapType::Count;
 }
 
@@ -308,6 +349,8 @@ void MTLParser::parse(std::map<std::string, std::unique_ptr<MTLMaterial>> &globa
     MTLMaterial *material = nullptr;
     for (;index_ < input_.size(); ) {
         n_line_ += skipWhiteSpace(input_, index_);
+        if (index_ >= input_.size())
+            break;
         /* expect a new material */
         if (expectKeyword(input_, index_, "newmtl")) {
             index_ = tryParseString(input_, index_, mtl_name);
@@ -320,7 +363,11 @@ void MTLParser::parse(std::map<std::string, std::unique_ptr<MTLMaterial>> &globa
                 ).first->second.get();
             }
         }
-        else if (material != nullptr) {
+        else if (material == nullptr) {
+            /* comment or statement of a duplicated material */
+            skipLine();
+        }
+        else {
             if (expectKeyword(input_, index_, "Ka")) {
                 parse_floats(input_, index_, glm::value_ptr(material->Ka_), 3);
             }
@@ -330,6 +377,20 @@ void MTLParser::parse(std::map<std::string, std::unique_ptr<MTLMaterial>> &globa
             else if (expectKeyword(input_, index_, "Ks")) {
                 parse_floats(input_, index_, glm::value_ptr(material->Ks_), 3);
             }
+            else if (expectKeyword(input_, index_, "Ns")) {
+                index_ = tryParseFloat(input_, index_, material->Ns_);
+            }
+            else if (expectKeyword(input_, index_, "Ni")) {
+                index_ = tryParseFloat(input_, index_, material->Ni_);
+            }
+            else if (expectKeyword(input_, index_, "d")) {
+                index_ = tryParseFloat(input_, index_, material->d);
+            }
+            else if (input_[index_] == '#' || expectKeyword(input_, index_, "illum") ||
+                     expectKeyword(input_, index_, "Ke") || expectKeyword(input_, index_, "Tf")) {
+                /* comments and statements not used for rendering */
+                skipLine();
+            }
             else {
                 /* parsre texture image */
                 parseTextureMap(material);
@@ -339,11 +400,53 @@ void MTLParser::parse(std::map<std::string, std::unique_ptr<MTLMaterial>> &globa
 }
 
 
+/// \brief Skip spaces and tabs, not line breaks.
+static void skip_blanks(const std::string &input, size_t &index) {
+    while (index < input.size() && (input[index] == ' ' || input[index] == '\t')) ++index;
+}
+
+/// \brief Whether the token at index is a whole number, as the values of
+/// -o, -s, -t and -mm, and not a file name starting with digits.
+static bool is_number_token(const std::string &input, size_t index) {
+    if (index >= input.size()) return false;
+    char *end = nullptr;
+    strtof(input.data() + index, &end);
+    const size_t length = end - input.data() - index;
+    return length > 0 && (index + length == input.size() || is_whitespace(input[index + length]));
+}
+
+static void skip_token(const std::string &input, size_t &index) {
+    while (index < input.size() && !is_whitespace(input[index])) ++index;
+}
+
 void MTLParser::parseTextureMap(MTLMaterial *material) {
     MTLTexMapType key = mtl_parse_texture_type(input_, index_);
-    CHECK_NE(key, MTLTexMapType::Count) << "Not Supported MTL texture map type: " << n_line_;
+    if (key == MTLTexMapType::Count) {
+        /* map_Ka, disp, Tr and other statements not used for rendering */
+        skipLine();
+        return;
+    }
+
+    /* Options as -bm 1.0 or -o u [v [w]] come before the file name, each
+     * takes one value and the position ones up to two more numbers.
+     */
+    skip_blanks(input_, index_);
+    while (index_ < input_.size() && input_[index_] == '-') {
+        skip_token(input_, index_);
+        skip_blanks(input_, index_);
+        skip_token(input_, index_);
+        skip_blanks(input_, index_);
+        while (is_number_token(input_, index_)) {
+            skip_token(input_, index_);
+            skip_blanks(input_, index_);
+        }
+    }
 
     MTLTexMap &tex_map = material->tex_map_[int(key)];
     tex_map.mtl_dir_path = mtl_dir_path_;
     index_ = tryParseString(input_, index_, tex_map.image_path_);
-}
\ No newline at end of file
+}
+
+void MTLParser::skipLine() {
+    for (; index_ < input_.size() && input_[index_] != '\n'; index_++);
+}
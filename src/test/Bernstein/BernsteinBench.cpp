@@ -0,0 +1,121 @@
+/// \file BernsteinBench.cpp
+/// \brief Microbenchmark of cubic Bernstein and de Casteljau evaluators
+/// in BasicFunction.h, against the runtime bernstein_poly.
+/// Build with CMAKE_BUILD_TYPE=Release for meaningful numbers.
+
+#include "cgcl/math/BasicFunction.h"
+#include "cgcl/utils/logging.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace cgcl;
+
+constexpr int n_params = 1 << 16;
+constexpr int n_rounds = 64;
+
+template <typename F>
+static double bench(const char *name, F &&eval, double base_ns = 0.0) {
+    auto start = std::chrono::steady_clock::now();
+    float sink = 0.0f;
+    for (int r = 0; r < n_rounds; ++r)
+        sink += eval();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count()
+              / (double(n_rounds) * n_params);
+    std::cout << name << ": " << ns << " ns/param (checksum " << sink << ")";
+    if (base_ns > 0.0)
+        std::cout << ", " << base_ns / ns << "x over bernstein_poly";
+    std::cout << std::endl;
+    return ns;
+}
+
+int main() {
+    std::vector<float> u(n_params);
+    for (int k = 0; k < n_params; ++k)
+        u[k] = float(k) / (n_params - 1);
+    const float P[4] = {0.5f, 2.0f, -1.0f, 3.0f};
+    std::vector<float> out(n_params);
+
+    /* Make sure every evaluator agrees with bernstein_poly first. */
+    for (int k = 0; k < n_params; k += 97) {
+        float ref = 0.0f;
+        for (int i = 0; i < 4; ++i)
+            ref += bernstein_poly(3, i, u[k]) * P[i];
+        float B[4];
+        bernstein_basis<3>(u[k], B);
+        float basis = B[0] * P[0] + B[1] * P[1] + B[2] * P[2] + B[3] * P[3];
+        CHECK(std::abs(basis - ref) < 1e-4f) << "bernstein_basis<3> mismatch at " << u[k];
+        CHECK(std::abs(de_casteljau<3>(P, u[k]) - ref) < 1e-4f) << "de_casteljau<3> mismatch at " << u[k];
+    }
+    for (int k = 0; k < n_params; k += 8 * 97) {
+        float B[4 * 8], curve[8];
+        bernstein_basis_batch<3, 8>(&u[k], B);
+        de_casteljau_batch<3, 8>(P, &u[k], curve);
+        for (int lane = 0; lane < 8; ++lane) {
+            const float ref = de_casteljau<3>(P, u[k + lane]);
+            float basis = B[lane] * P[0] + B[8 + lane] * P[1] + B[16 + lane] * P[2] + B[24 + lane] * P[3];
+            CHECK(std::abs(basis - ref) < 1e-4f) << "bernstein_basis_batch<3, 8> mismatch at " << u[k + lane];
+            CHECK(std::abs(curve[lane] - ref) < 1e-4f) << "de_casteljau_batch<3, 8> mismatch at " << u[k + lane];
+        }
+    }
+
+    double base = bench("bernstein_poly (runtime, powf)", [&]() {
+        for (int k = 0; k < n_params; ++k) {
+            float p = 0.0f;
+            for (int i = 0; i < 4; ++i)
+                p += bernstein_poly(3, i, u[k]) * P[i];
+            out[k] = p;
+        }
+        return out[n_params / 3];
+    });
+
+    bench("bernstein_basis (runtime degree)", [&]() {
+        for (int k = 0; k < n_params; ++k) {
+            float B[4];
+            bernstein_basis(3, u[k], B);
+            out[k] = B[0] * P[0] + B[1] * P[1] + B[2] * P[2] + B[3] * P[3];
+        }
+        return out[n_params / 3];
+    }, base);
+
+    bench("bernstein_basis<3>", [&]() {
+        for (int k = 0; k < n_params; ++k) {
+            float B[4];
+            bernstein_basis<3>(u[k], B);
+            out[k] = B[0] * P[0] + B[1] * P[1] + B[2] * P[2] + B[3] * P[3];
+        }
+        return out[n_params / 3];
+    }, base);
+
+    bench("de_casteljau<3>", [&]() {
+        for (int k = 0; k < n_params; ++k)
+            out[k] = de_casteljau<3>(P, u[k]);
+        return out[n_params / 3];
+    }, base);
+
+    bench("bernstein_basis_batch<3, 8>", [&]() {
+        float B[4 * 8];
+        for (int k = 0; k < n_params; k += 8) {
+            bernstein_basis_batch<3, 8>(&u[k], B);
+            for (int lane = 0; lane < 8; ++lane)
+                out[k + lane] = B[lane] * P[0] + B[8 + lane] * P[1]
+                              + B[16 + lane] * P[2] + B[24 + lane] * P[3];
+        }
+        return out[n_params / 3];
+    }, base);
+
+    bench("de_casteljau_batch<3, 8>", [&]() {
+        for (int k = 0; k < n_params; k += 8)
+            de_casteljau_batch<3, 8>(P, &u[k], &out[k]);
+        return out[n_params / 3];
+    }, base);
+
+    bench("de_casteljau_batch<3, 16>", [&]() {
+        for (int k = 0; k < n_params; k += 16)
+            de_casteljau_batch<3, 16>(P, &u[k], &out[k]);
+        return out[n_params / 3];
+    }, base);
+    return 0;
+}
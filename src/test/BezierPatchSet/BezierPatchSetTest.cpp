@@ -0,0 +1,124 @@
+/// \file BezierPatchSetTest.cpp
+/// \brief Round trip a patch set through the text format, save_binary
+/// and from_binary, then check that malformed files are rejected
+/// instead of read out of bounds.
+/// usage: BezierPatchSetTest
+
+#include "cgcl/surface/BezierPatchSet.h"
+#include "cgcl/utils/logging.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace cgcl;
+
+static void write_file(const std::string &filename, const std::string &content) {
+    std::ofstream out(filename, std::ios::binary);
+    CHECK(out) << "Failed to open " << filename;
+    out.write(content.data(), content.size());
+}
+
+static void expect_same(const BezierPatchSet &a, const BezierPatchSet &b) {
+    CHECK_EQ(a.size(), b.size());
+    CHECK_EQ(a.total_ctrl_pts(), b.total_ctrl_pts());
+    for (size_t k = 0; k < a.size(); ++k) {
+        CHECK_EQ(a.patch(k).n_us, b.patch(k).n_us);
+        CHECK_EQ(a.patch(k).n_vs, b.patch(k).n_vs);
+        CHECK_EQ(a.patch(k).first, b.patch(k).first);
+        for (size_t i = 0; i < size_t(a.patch(k).n_us) * a.patch(k).n_vs; ++i)
+            CHECK(a.ctrl_pts(k)[i] == b.ctrl_pts(k)[i]) << "Patch " << k << " point " << i << " differs";
+    }
+}
+
+/// \brief Whether loading filename aborts, tried in a child process
+/// since a failed CHECK ends the program.
+static bool load_aborts(const std::string &filename) {
+    const pid_t pid = fork();
+    CHECK_GE(pid, 0) << "Failed to fork";
+    if (pid == 0) {
+        std::freopen("/dev/null", "w", stderr);
+        BezierPatchSet::from_file(filename);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status);
+}
+
+static std::string binary_file(const BezierPatchFileHeader &header, const std::vector<BezierPatchRecord> &records,
+                               size_t n_ctrl_pts) {
+    std::string content(reinterpret_cast<const char *>(&header), sizeof(header));
+    content.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(BezierPatchRecord));
+    content.append(n_ctrl_pts * sizeof(glm::vec3), '\0');
+    return content;
+}
+
+int main() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string text = (dir / "cgcl_patches.txt").string(), binary = (dir / "cgcl_patches.bin").string(),
+                      bad = (dir / "cgcl_patches_bad").string();
+
+    /* Values exact in float, so the text parser must give them back bit for bit. */
+    write_file(text, "2\n"
+                     "3 2\n"
+                     "0 0 0  1 0 0.5  2 0 0\n"
+                     "0 1 -1.25  1 1 3e2  2 1 0.125\n"
+                     "2 2\n"
+                     "-1 -2 -3  4 5 6  7 8 9  10 11 12");
+    auto from_text = BezierPatchSet::from_file(text);
+    CHECK_EQ(from_text->size(), 2u);
+    CHECK_EQ(from_text->total_ctrl_pts(), 10u);
+    CHECK(from_text->ctrl_pts(0)[4] == glm::vec3(1.0f, 1.0f, 300.0f));
+    CHECK(from_text->ctrl_pts(1)[0] == glm::vec3(-1.0f, -2.0f, -3.0f));
+    CHECK_EQ(from_text->patch(1).first, 6u);
+
+    from_text->save_binary(binary);
+    auto from_binary = BezierPatchSet::from_binary(binary);
+    expect_same(*from_text, *from_binary);
+    expect_same(*from_text, *BezierPatchSet::from_file(binary));
+    std::cout << "round trip of " << from_binary->size() << " patches, " << from_binary->total_ctrl_pts()
+              << " control points" << std::endl;
+
+    /* Malformed text. */
+    const char *bad_texts[] = {
+        "1\n0 3\n0 0 0 1 1 1 2 2 2\n",         // empty patch.
+        "4000000000\n1 1\n0 0 0\n",            // more patches than the input holds.
+        "1\n60000 60000\n0 0 0\n",             // more points than the input holds.
+        "2\n1 1\n0 0 0\n",                      // truncated.
+    };
+    for (const char *content : bad_texts) {
+        write_file(bad, content);
+        CHECK(load_aborts(bad)) << "Accepted text \"" << content << "\"";
+    }
+
+    /* Malformed binary. */
+    BezierPatchFileHeader header;
+    std::memcpy(header.magic, BezierPatchSet::binary_magic, sizeof(header.magic));
+    header.version = BezierPatchSet::binary_version;
+    header.n_patches = 1;
+    header.n_ctrl_pts = 4;
+    write_file(bad, binary_file(header, {{2, 2, 0}}, 4));
+    CHECK(!load_aborts(bad)) << "Rejected a valid binary file";
+    write_file(bad, binary_file(header, {{0, 2, 0}}, 4));
+    CHECK(load_aborts(bad)) << "Accepted an empty patch";
+    write_file(bad, binary_file(header, {{2, 2, 1}}, 4));
+    CHECK(load_aborts(bad)) << "Accepted a patch out of range";
+    write_file(bad, binary_file(header, {{2, 2, 0}}, 3));
+    CHECK(load_aborts(bad)) << "Accepted truncated control points";
+    header.n_patches = UINT64_MAX / sizeof(BezierPatchRecord) + 2;
+    write_file(bad, binary_file(header, {{2, 2, 0}}, 4));
+    CHECK(load_aborts(bad)) << "Accepted an overflowing patch count";
+    std::cout << "malformed files rejected" << std::endl;
+
+    for (const std::string &filename : {text, binary, bad})
+        std::remove(filename.c_str());
+    return 0;
+}
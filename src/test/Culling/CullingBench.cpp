@@ -0,0 +1,68 @@
+/// \file CullingBench.cpp
+/// \brief Frustum culling of 1M bounding spheres, one by one against
+/// the batched Frustum::cull, which must agree.
+/// Build with CMAKE_BUILD_TYPE=Release and CGCL_ENABLE_AVX2=ON for
+/// meaningful numbers.
+
+#include "cgcl/math/Frustum.h"
+#include "cgcl/utils/logging.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace cgcl;
+
+template <typename F>
+static double bench(const char *name, size_t n, F &&cull, int n_runs = 10) {
+    double best = 1e30;
+    for (int k = 0; k < n_runs; ++k) {
+        auto start = std::chrono::steady_clock::now();
+        cull();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::cout << name << ": " << best << " ms, " << n / best / 1e3 << " Mspheres/s" << std::endl;
+    return best;
+}
+
+int main() {
+    const size_t n_spheres = 1 << 20;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(-500.0f, 500.0f), radius(0.1f, 5.0f);
+    std::vector<BoundingSphere> spheres(n_spheres);
+    BoundingSphereSoA soa;
+    for (auto &sphere : spheres) {
+        sphere.center_ = glm::vec3(coord(rng), coord(rng), coord(rng));
+        sphere.radius_ = radius(rng);
+        soa.push_back(sphere);
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 300.0f);
+    Frustum frustum = Frustum::from_matrix(projection * view);
+
+    std::vector<uint8_t> one_by_one(n_spheres), batched(n_spheres);
+    size_t n_visible = 0, n_batched = 0;
+    bench("one by one", n_spheres, [&]() {
+        n_visible = 0;
+        for (size_t i = 0; i < n_spheres; ++i)
+            n_visible += one_by_one[i] = frustum.intersects(spheres[i]);
+    });
+    bench("Frustum::cull", n_spheres, [&]() {
+        n_batched = frustum.cull(soa, batched.data());
+    });
+
+    size_t mismatch = 0;
+    for (size_t i = 0; i < n_spheres; ++i)
+        mismatch += one_by_one[i] != batched[i];
+    std::cout << n_visible << " of " << n_spheres << " visible, "
+              << mismatch << " mismatch" << std::endl;
+    /* Contracted multiply-adds may round differently on the boundary. */
+    CHECK_LE(mismatch, n_spheres / 100000);
+    CHECK_EQ(n_batched, size_t(std::count(batched.begin(), batched.end(), 1)));
+    return 0;
+}
@@ -0,0 +1,149 @@
+/// \file GoldenTest.cpp
+/// \brief Render procedural scenes headless on the CPU and compare them
+/// against reference images in assets/golden. A scene fails if more
+/// than a small fraction of its pixels differ perceptibly, then its
+/// image and a difference image are written to the working directory.
+/// A scene taking longer than the budget also fails, to catch
+/// performance regressions of the rasterizer.
+/// Only the SoftwareRasterizer is covered, nothing here runs the OpenGL
+/// path, whose shaders are checked by hand in SolarSystem.
+/// usage: GoldenTest [--update] [--budget-ms ms]
+///   --update    rewrite the reference images instead of comparing.
+///   --budget-ms fastest of 3 renders of any scene, unlimited by default.
+
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/mesh/Subdivision.h"
+#include "cgcl/render/ImageIO.h"
+#include "cgcl/render/SoftwareRasterizer.h"
+#include "cgcl/surface/Bezier.h"
+#include "cgcl/utils/Loader.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace cgcl;
+
+static const int width = 320, height = 240;
+/* Pixels allowed to differ by more than a just noticeable difference. */
+static const float max_different_fraction = 0.002f;
+
+struct GoldenScene {
+    std::string name;
+    std::function<void(SoftwareRasterizer &)> submit;
+};
+
+static void set_camera(SoftwareRasterizer &rasterizer, const glm::vec3 &eye, const glm::vec3 &center) {
+    rasterizer.setCamera(glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)),
+                         glm::perspective(glm::radians(45.0f), float(width) / height, 0.1f, 100.0f), eye);
+}
+
+int main(int argc, char *argv[]) {
+    bool update = false;
+    double budget_ms = 0.0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--update") == 0) update = true;
+        else if (std::strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) budget_ms = std::atof(argv[++i]);
+    }
+
+    /* Meshes of the scenes, alive until the scenes are flushed. */
+    auto ico = SphereGeometry::ico_sphere(24);
+    TriMesh sphere(ico.vertices_, ico.indices_);
+
+    std::vector<glm::vec3> wave;
+    for (int j = 0; j < 4; ++j)
+        for (int i = 0; i < 4; ++i)
+            wave.emplace_back(i - 1.5f, 0.8f * std::sin(1.7f * i + 0.9f * j), j - 1.5f);
+    auto bezier = TriMesh::from_bezier(BezierSurface(4, 4, wave));
+
+    std::vector<glm::vec3> cube;
+    for (int i = 0; i < 8; ++i)
+        cube.emplace_back(float(i & 1) - 0.5f, float((i >> 1) & 1) - 0.5f, float((i >> 2) & 1) - 0.5f);
+    const std::vector<unsigned int> quads = {0, 2, 3, 1,  4, 5, 7, 6,  0, 1, 5, 4,
+                                             2, 6, 7, 3,  0, 4, 6, 2,  1, 3, 7, 5};
+    auto subdivided = Subdivision::build(std::vector<unsigned int>(6, 4), quads, cube.size(), 4).toMesh(cube);
+
+    const glm::vec3 normal(0.0f, 1.0f, 0.0f);
+    TriMesh ground({{glm::vec3(-50.0f, 0.0f, -50.0f), normal, glm::vec2(0.0f)},
+                    {glm::vec3(50.0f, 0.0f, -50.0f), normal, glm::vec2(0.0f)},
+                    {glm::vec3(50.0f, 0.0f, 50.0f), normal, glm::vec2(0.0f)},
+                    {glm::vec3(-50.0f, 0.0f, 50.0f), normal, glm::vec2(0.0f)}},
+                   {0, 1, 2, 0, 2, 3});
+
+    std::vector<PhongMaterial> materials;
+    for (int i = 0; i < 16; ++i)
+        materials.emplace_back(glm::vec3(0.2f + 0.05f * i, 0.9f - 0.05f * i, 0.3f + 0.4f * (i & 1)));
+
+    const std::vector<GoldenScene> scenes = {
+        {"spheres", [&](SoftwareRasterizer &rasterizer) {
+             set_camera(rasterizer, glm::vec3(0.0f, 1.0f, 9.0f), glm::vec3(0.0f));
+             for (int i = 0; i < 16; ++i) {
+                 const glm::vec3 center(2.0f * (i % 4) - 3.0f, 1.6f * (i / 4) - 2.4f, -0.7f * (i % 3));
+                 rasterizer.submit(sphere, glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(0.8f)),
+                                   &materials[i]);
+             }
+         }},
+        {"bezier", [&](SoftwareRasterizer &rasterizer) {
+             set_camera(rasterizer, glm::vec3(0.0f, 3.5f, 4.5f), glm::vec3(0.0f));
+             rasterizer.submit(static_cast<TriMesh &>(*bezier), glm::mat4(1.0f), &materials[3]);
+         }},
+        {"subdivision", [&](SoftwareRasterizer &rasterizer) {
+             set_camera(rasterizer, glm::vec3(1.2f, 1.0f, 1.6f), glm::vec3(0.0f));
+             rasterizer.submit(*subdivided, glm::mat4(1.0f), &materials[10]);
+         }},
+        /* The ground passes behind the eye and beyond the guard band, the
+         * nearest sphere crosses the near plane.
+         */
+        {"near_clip", [&](SoftwareRasterizer &rasterizer) {
+             set_camera(rasterizer, glm::vec3(0.0f, 1.0f, 3.0f), glm::vec3(0.0f, 0.5f, -5.0f));
+             rasterizer.submit(ground, glm::mat4(1.0f), &materials[6]);
+             const glm::mat4 near = glm::translate(glm::mat4(1.0f), glm::vec3(-0.25f, 0.85f, 2.75f));
+             rasterizer.submit(sphere, glm::scale(near, glm::vec3(0.3f)), &materials[12]);
+             for (int i = 1; i < 4; ++i)
+                 rasterizer.submit(sphere, glm::translate(glm::mat4(1.0f), glm::vec3(1.5f * i - 1.5f, 0.8f, 1.0f - 3.0f * i)),
+                                   &materials[12 + i]);
+         }},
+    };
+
+    int n_failed = 0;
+    SoftwareRasterizer rasterizer(width, height);
+    for (const auto &scene : scenes) {
+        double ms = 0.0;
+        for (int run = 0; run < 3; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            scene.submit(rasterizer);
+            rasterizer.flush();
+            const double run_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ms = run == 0 ? run_ms : std::min(ms, run_ms);
+        }
+        const std::string golden = Loader::getAssetPath("golden/" + scene.name + ".png");
+        if (update) {
+            write_png(golden, rasterizer.framebuffer_);
+            std::cout << scene.name << ": " << ms << " ms, written to " << golden << std::endl;
+            continue;
+        }
+
+        Framebuffer difference;
+        const ImageDifference result = compare_images(rasterizer.framebuffer_, read_image(golden), 2.3f, &difference);
+        const bool same = result.differentFraction() <= max_different_fraction;
+        const bool in_budget = budget_ms <= 0.0 || ms <= budget_ms;
+        std::cout << scene.name << ": " << ms << " ms, " << result.n_different << " of " << result.n_pixels
+                  << " pixels differ, max Delta E " << result.max_delta_e << ", mean " << result.mean_delta_e
+                  << (same ? "" : ", DIFFERENT") << (in_budget ? "" : ", OVER BUDGET") << std::endl;
+        if (!same) {
+            write_png(scene.name + "_actual.png", rasterizer.framebuffer_);
+            write_png(scene.name + "_diff.png", difference);
+        }
+        n_failed += !same || !in_budget;
+    }
+    if (n_failed > 0) std::cout << n_failed << " of " << scenes.size() << " scenes failed" << std::endl;
+    return n_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+/// \file HalfEdgeBench.cpp
+/// \brief Build half-edges of a cube sphere and check them against a
+/// map of edges, then the border and non-manifold edges of small cases.
+/// usage: HalfEdgeBench [n_segments], 12 * n_segments^2 triangles.
+/// --check runs the checks alone on a small mesh.
+
+#include "cgcl/mesh/HalfEdge.h"
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/utils/logging.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace cgcl;
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned n_segments = check ? 32 : argc > 1 ? std::atoi(argv[1]) : 512;
+    auto sphere = SphereGeometry::cube_sphere(n_segments);
+    const auto &indices = sphere.indices_;
+    std::cout << sphere.n_triangles() << " triangles, " << sphere.vertices_.size() << " vertices" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    auto mesh = HalfEdgeMesh::build(indices.data(), indices.size(), sphere.vertices_.size());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "built in " << ms << " ms, " << sphere.n_triangles() / ms / 1e3 << " Mtriangles/s, "
+              << mesh.n_border_edges_ << " border edges, " << mesh.n_non_manifold_edges_
+              << " non-manifold" << std::endl;
+
+    /* Reference: directed edges in a map. */
+    std::map<std::pair<unsigned, unsigned>, int32_t> directed;
+    for (size_t h = 0; h < indices.size(); ++h)
+        directed[{indices[h], indices[HalfEdgeMesh::next(h)]}] = h;
+    size_t n_border = 0;
+    for (size_t h = 0; h < indices.size(); ++h) {
+        auto it = directed.find({indices[HalfEdgeMesh::next(h)], indices[h]});
+        const int32_t twin = it == directed.end() ? HalfEdgeMesh::border : it->second;
+        CHECK_EQ(mesh.twins_[h], twin) << "Wrong twin of " << h;
+        n_border += twin == HalfEdgeMesh::border;
+    }
+    CHECK_EQ(mesh.n_border_edges_, n_border);
+    CHECK(mesh.isManifold());
+
+    /* Walking around every vertex visits all the half-edges leaving it. */
+    std::vector<unsigned> degree(sphere.vertices_.size(), 0), walked(sphere.vertices_.size(), 0);
+    for (unsigned v : indices)
+        degree[v]++;
+    for (size_t v = 0; v < degree.size(); ++v) {
+        mesh.forEachOutgoing(v, [&](int32_t h) {
+            CHECK_EQ(indices[h], v);
+            walked[v]++;
+        });
+        CHECK_EQ(walked[v], degree[v]) << "Fan of vertex " << v;
+    }
+
+    /* A fan of three triangles on one edge is non-manifold, the
+     * other edges of the fan are borders.
+     */
+    std::vector<unsigned int> fin = {0, 1, 2, 1, 0, 3, 0, 1, 4};
+    auto fins = HalfEdgeMesh::build(fin.data(), fin.size(), 5);
+    CHECK_EQ(fins.n_non_manifold_edges_, 1u);
+    CHECK_EQ(fins.n_border_edges_, 6u);
+    CHECK(!fins.isManifold());
+    CHECK(fins.isBorderVertex(2));
+    std::cout << "border and non-manifold edges found as expected" << std::endl;
+}
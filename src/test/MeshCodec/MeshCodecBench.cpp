@@ -0,0 +1,102 @@
+/// \file MeshCodecBench.cpp
+/// \brief Compress the buffers of an optimized ico sphere, full and
+/// quantized, report ratio and decode speed, check the round trip is
+/// exact, also through a file.
+/// Build with CGCL_ENABLE_AVX2=ON for the SIMD index decoder.
+/// usage: MeshCodecBench [n_segments], the sphere has 20 * n_segments^2 triangles.
+/// --check runs the checks alone on a small sphere.
+
+#include "cgcl/mesh/MeshCodec.h"
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/mesh/VertexFormat.h"
+#include "cgcl/utils/logging.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace cgcl;
+
+/// \brief Best of a few runs in ms.
+template <typename F>
+static double best_ms(F &&f, int n_runs = 5) {
+    double best = 1e30;
+    for (int k = 0; k < n_runs; ++k) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static void report(const char *name, size_t raw, size_t compressed, double decode_ms) {
+    std::cout << name << ": " << raw << " -> " << compressed << " bytes, " << float(raw) / compressed
+              << "x, decoded at " << raw / decode_ms / 1e6 << " GB/s" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned n_segments = check ? 16 : argc > 1 ? std::atoi(argv[1]) : 320;
+    auto sphere = SphereGeometry::ico_sphere(n_segments);
+    TriMesh mesh(std::move(sphere.vertices_), std::move(sphere.indices_));
+    mesh.optimize();
+    const auto &vertices = mesh.global_vertices_;
+    const auto &indices = mesh.global_indices_;
+
+    auto index_stream = encode_index_buffer(indices.data(), indices.size());
+    std::vector<unsigned int> decoded_indices(indices.size());
+    double ms = best_ms([&]() {
+        decode_index_buffer(index_stream.data(), index_stream.size(), decoded_indices.data(), indices.size(),
+                            vertices.size());
+    });
+    report("indices", indices.size() * 4, index_stream.size(), ms);
+    CHECK(decoded_indices == indices) << "Index round trip";
+
+    auto vertex_stream = encode_vertex_buffer(vertices.data(), vertices.size(), sizeof(Vertex));
+    std::vector<Vertex> decoded_vertices(vertices.size());
+    ms = best_ms([&]() {
+        decode_vertex_buffer(vertex_stream.data(), vertex_stream.size(), decoded_vertices.data(),
+                             vertices.size(), sizeof(Vertex));
+    });
+    report("float vertices", vertices.size() * sizeof(Vertex), vertex_stream.size(), ms);
+    CHECK_EQ(std::memcmp(decoded_vertices.data(), vertices.data(), vertices.size() * sizeof(Vertex)), 0)
+        << "Vertex round trip";
+
+    const VertexFormat format = VertexFormat::compact();
+    auto packed = format.encode(vertices, mesh.bounds_);
+    auto packed_stream = encode_vertex_buffer(packed.data(), vertices.size(), format.stride());
+    std::vector<uint8_t> decoded_packed(packed.size());
+    ms = best_ms([&]() {
+        decode_vertex_buffer(packed_stream.data(), packed_stream.size(), decoded_packed.data(),
+                             vertices.size(), format.stride());
+    });
+    report("compact vertices", packed.size(), packed_stream.size(), ms);
+    CHECK(decoded_packed == packed) << "Packed vertex round trip";
+
+    /* Through a file, with sub-mesh ranges, materials and tangents. */
+    mesh.offsets_ = {0, unsigned(indices.size() / 2 / 3 * 3)};
+    mesh.counts_ = {mesh.offsets_[1], unsigned(indices.size()) - mesh.offsets_[1]};
+    MTLMaterial material;
+    material.name_ = "textured";
+    material.Kd_ = glm::vec3(0.1f, 0.2f, 0.3f);
+    material.tex_map_[int(MTLTexMapType::Color)].image_path_ = "color.png";
+    mesh.materials_ = {material};
+    mesh.sub_mesh_materials_ = {-1, 0};
+    mesh.generateTangents();
+    const char *path = "MeshCodecBench.cgcm";
+    mesh.saveCompressed(path);
+    auto loaded = TriMesh::from_compressed(path);
+    const auto &reloaded = static_cast<const TriMesh &>(*loaded);
+    CHECK(reloaded.global_indices_ == indices && reloaded.offsets_ == mesh.offsets_ && reloaded.counts_ == mesh.counts_);
+    CHECK_EQ(std::memcmp(reloaded.global_vertices_.data(), vertices.data(), vertices.size() * sizeof(Vertex)), 0);
+    CHECK(reloaded.sub_mesh_materials_ == mesh.sub_mesh_materials_ && reloaded.tangents_ == mesh.tangents_);
+    CHECK_EQ(reloaded.materials_.size(), 1u);
+    CHECK(reloaded.materials_[0].name_ == "textured" && reloaded.materials_[0].Kd_ == material.Kd_ &&
+          reloaded.materials_[0].tex_map_[int(MTLTexMapType::Color)].image_path_ == "color.png");
+    std::remove(path);
+    std::cout << "file round trip exact" << std::endl;
+    return 0;
+}
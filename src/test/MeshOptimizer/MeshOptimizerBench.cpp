@@ -0,0 +1,85 @@
+/// \file MeshOptimizerBench.cpp
+/// \brief Optimize a uv sphere whose triangles were shuffled, as a
+/// stand-in for an OBJ in arbitrary face order, and check that the
+/// mesh still has the same triangles.
+/// usage: MeshOptimizerBench [n_longitude], about 2 * n_longitude^2 triangles.
+/// --check runs the checks alone on a small sphere.
+
+#include "cgcl/mesh/MeshOptimizer.h"
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/utils/logging.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace cgcl;
+
+using Triangle = std::array<float, 9>;
+
+/// \brief Triangles by positions, rotated to start at the smallest
+/// corner and sorted, to compare meshes whatever their order.
+static std::vector<Triangle> canonical(const TriMesh &mesh) {
+    std::vector<Triangle> triangles(mesh.global_indices_.size() / 3);
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        std::array<glm::vec3, 3> p;
+        for (int c = 0; c < 3; ++c)
+            p[c] = mesh.global_vertices_[mesh.global_indices_[3 * t + c]].position_;
+        auto less = [](const glm::vec3 &a, const glm::vec3 &b) {
+            return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+        };
+        int first = less(p[1], p[0]) ? 1 : 0;
+        if (less(p[2], p[first])) first = 2;
+        for (int c = 0; c < 3; ++c) {
+            const glm::vec3 &q = p[(first + c) % 3];
+            triangles[t][3 * c] = q.x;
+            triangles[t][3 * c + 1] = q.y;
+            triangles[t][3 * c + 2] = q.z;
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned n_longitude = check ? 64 : argc > 1 ? std::atoi(argv[1]) : 1024;
+    auto sphere = SphereGeometry::uv_sphere(n_longitude, n_longitude);
+    const size_t n_triangles = sphere.n_triangles();
+
+    std::vector<unsigned int> order(n_triangles);
+    for (size_t t = 0; t < n_triangles; ++t) order[t] = t;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    std::vector<unsigned int> shuffled(sphere.indices_.size());
+    for (size_t t = 0; t < n_triangles; ++t)
+        std::copy_n(&sphere.indices_[3 * order[t]], 3, &shuffled[3 * t]);
+
+    TriMesh mesh(std::move(sphere.vertices_), std::move(shuffled));
+    const auto reference = canonical(mesh);
+    const auto grid = analyze_vertex_cache(sphere.indices_.data(), sphere.indices_.size(),
+                                           mesh.global_vertices_.size());
+    std::cout << n_triangles << " triangles, grid order ACMR " << grid.acmr() << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    mesh.optimize();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const auto stats = analyze_vertex_cache(mesh.global_indices_.data(), mesh.global_indices_.size(),
+                                            mesh.global_vertices_.size());
+    std::cout << "optimized in " << ms << " ms, " << n_triangles / ms / 1e3 << " Mtriangles/s, ACMR "
+              << stats.acmr() << ", ATVR " << stats.atvr() << std::endl;
+
+    CHECK(canonical(mesh) == reference) << "Triangles changed";
+    CHECK_LT(stats.acmr(), grid.acmr());
+    /* First-use order, every index is at most one past the largest before. */
+    unsigned int next = 0;
+    for (unsigned int v : mesh.global_indices_) {
+        CHECK_LE(v, next);
+        next = std::max(next, v + 1);
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+/// \file MeshletBench.cpp
+/// \brief Split an ico sphere into meshlets and cull them from a camera
+/// outside, checking the limits, that the build is deterministic and that
+/// no front facing triangle is culled.
+/// usage: MeshletBench [n_segments], the sphere has 20 * n_segments^2 triangles.
+/// --check runs the checks alone on a small sphere.
+
+#include "cgcl/mesh/Meshlet.h"
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/utils/logging.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace cgcl;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned n_segments = check ? 64 : argc > 1 ? std::atoi(argv[1]) : 320;
+    auto sphere = SphereGeometry::ico_sphere(n_segments);
+    TriMesh mesh(std::move(sphere.vertices_), std::move(sphere.indices_));
+    mesh.optimize();
+    const size_t n_triangles = mesh.global_indices_.size() / 3;
+
+    auto start = std::chrono::steady_clock::now();
+    MeshletSet meshlets = MeshletSet::build(mesh);
+    double build_ms = elapsed_ms(start);
+    std::cout << n_triangles << " triangles into " << meshlets.size() << " meshlets in " << build_ms
+              << " ms, " << float(n_triangles) / meshlets.size() << " triangles and "
+              << float(meshlets.vertices_.size()) / meshlets.size() << " vertices per meshlet" << std::endl;
+
+    size_t covered = 0;
+    for (const auto &meshlet : meshlets.meshlets_) {
+        CHECK_LE(meshlet.vertex_count, MeshletSet::max_vertices);
+        CHECK_LE(meshlet.triangle_count, MeshletSet::max_triangles);
+        CHECK_EQ(meshlet.triangle_offset, covered);
+        for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+            for (int c = 0; c < 3; ++c) {
+                uint8_t local = meshlets.triangles_[3 * (meshlet.triangle_offset + t) + c];
+                CHECK_LT(local, meshlet.vertex_count);
+                CHECK_EQ(meshlets.vertices_[meshlet.vertex_offset + local],
+                         mesh.global_indices_[3 * (meshlet.triangle_offset + t) + c]);
+            }
+        }
+        covered += meshlet.triangle_count;
+    }
+    CHECK_EQ(covered, n_triangles);
+
+#ifdef _OPENMP
+    /* Same meshlets on one thread. */
+    const int n_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    MeshletSet serial = MeshletSet::build(mesh);
+    omp_set_num_threads(n_threads);
+    CHECK(serial.vertices_ == meshlets.vertices_ && serial.triangles_ == meshlets.triangles_)
+        << "Build depends on threads";
+#endif
+
+    /* Sphere of radius 2 at (1, 0, 0), seen from 6 units away. */
+    const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)), glm::vec3(2.0f));
+    const glm::vec3 eye(1.0f, 1.0f, 6.0f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    std::vector<IndexRange> ranges;
+    size_t n_visible = 0;
+    start = std::chrono::steady_clock::now();
+    const int n_runs = 10;
+    for (int k = 0; k < n_runs; ++k)
+        n_visible = meshlets.cull(projection * view, model, eye, ranges);
+    double cull_ms = elapsed_ms(start) / n_runs;
+    std::cout << "culled in " << cull_ms << " ms: " << n_visible << " of " << n_triangles
+              << " triangles in " << ranges.size() << " ranges" << std::endl;
+
+    /* Every front facing triangle must be drawn. */
+    std::vector<bool> drawn(n_triangles, false);
+    size_t n_drawn = 0;
+    for (const auto &range : ranges) {
+        for (uint32_t t = range.first_index / 3; t < (range.first_index + range.count) / 3; ++t)
+            drawn[t] = true;
+        n_drawn += range.count / 3;
+    }
+    CHECK_EQ(n_drawn, n_visible);
+    size_t n_front = 0, n_missed = 0;
+    for (size_t t = 0; t < n_triangles; ++t) {
+        glm::vec3 p[3];
+        for (int c = 0; c < 3; ++c)
+            p[c] = glm::vec3(model * glm::vec4(mesh.global_vertices_[mesh.global_indices_[3 * t + c]].position_, 1.0f));
+        if (glm::dot(eye - p[0], glm::cross(p[1] - p[0], p[2] - p[0])) <= 0.0f) continue;
+        n_front++;
+        n_missed += !drawn[t];
+    }
+    std::cout << n_front << " front facing, " << n_missed << " of them culled" << std::endl;
+    CHECK_EQ(n_missed, 0u);
+    CHECK_LT(n_visible, n_triangles * 3 / 4);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/// \file NURBSBench.cpp
+/// \brief Evaluation throughput of NURBSSurface against naive
+/// per-point Cox-de Boor, and check of its Bezier extraction.
+/// Build with CMAKE_BUILD_TYPE=Release for meaningful numbers.
+
+#include "cgcl/surface/NURBS.h"
+#include "cgcl/utils/logging.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace cgcl;
+
+/// \brief Textbook recursive Cox-de Boor basis N_{i,p}(t).
+static float cox_de_boor(const std::vector<float> &knots, int i, int p, float t, bool last) {
+    if (p == 0) {
+        if (knots[i] <= t && t < knots[i + 1]) return 1.0f;
+        /* close the domain on the right end. */
+        return (last && t == knots[i + 1] && knots[i] < knots[i + 1]) ? 1.0f : 0.0f;
+    }
+    float a = 0.0f, b = 0.0f;
+    if (knots[i + p] != knots[i])
+        a = (t - knots[i]) / (knots[i + p] - knots[i]) * cox_de_boor(knots, i, p - 1, t, last);
+    if (knots[i + p + 1] != knots[i + 1])
+        b = (knots[i + p + 1] - t) / (knots[i + p + 1] - knots[i + 1]) * cox_de_boor(knots, i + 1, p - 1, t, last);
+    return a + b;
+}
+
+/// \brief Sum over every control point, as written in the NURBS definition.
+static glm::vec3 naive_point(const NURBSSurface &s, float u, float v) {
+    glm::vec3 p(0.0f);
+    float w = 0.0f;
+    const bool last_u = u >= s.u_max(), last_v = v >= s.v_max();
+    for (int i = 0; i < s.n_us(); ++i) {
+        float Nu = cox_de_boor(s.knots_u_, i, s.degree_u, u, last_u);
+        if (Nu == 0.0f) continue;
+        for (int j = 0; j < s.n_vs(); ++j) {
+            float Nv = cox_de_boor(s.knots_v_, j, s.degree_v, v, last_v);
+            float nw = Nu * Nv * (s.weights_.empty() ? 1.0f : s.weights_[i * s.n_vs() + j]);
+            p += nw * s.ctrl_pts_[i * s.n_vs() + j];
+            w += nw;
+        }
+    }
+    return p / w;
+}
+
+static std::vector<float> clamped_knots(int n, int p, std::mt19937 &rng) {
+    /* n control points, random interior knots with a double knot inside. */
+    std::uniform_real_distribution<float> gap(0.5f, 1.5f);
+    std::vector<float> knots(p + 1, 0.0f);
+    float t = 0.0f;
+    for (int k = 0; k < n - p - 1; ++k) {
+        if (k != (n - p - 1) / 2) t += gap(rng);
+        knots.push_back(t);
+    }
+    t += gap(rng);
+    knots.insert(knots.end(), p + 1, t);
+    return knots;
+}
+
+template <typename F>
+static double bench(const char *name, size_t n_points, F &&eval, double base_ns = 0.0) {
+    auto start = std::chrono::steady_clock::now();
+    eval();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / n_points;
+    std::cout << name << ": " << ns << " ns/point, " << 1e3 / ns << " Mpoints/s";
+    if (base_ns > 0.0)
+        std::cout << ", " << base_ns / ns << "x over naive";
+    std::cout << std::endl;
+    return ns;
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(-10.0f, 10.0f), weight(0.5f, 2.0f);
+    const int p = 3, q = 3, n_u = 24, n_v = 20;
+    std::vector<glm::vec3> ctrl_pts(n_u * n_v);
+    std::vector<float> weights(n_u * n_v);
+    for (int k = 0; k < n_u * n_v; ++k) {
+        ctrl_pts[k] = glm::vec3(coord(rng), coord(rng), coord(rng));
+        weights[k] = weight(rng);
+    }
+    NURBSSurface surface(p, q, clamped_knots(n_u, p, rng), clamped_knots(n_v, q, rng),
+                         ctrl_pts, weights);
+
+    const unsigned int nu = 256, nv = 256;
+    auto param_u = [&](int i) { return surface.u_min() + (surface.u_max() - surface.u_min()) * i / (nu - 1); };
+    auto param_v = [&](int j) { return surface.v_min() + (surface.v_max() - surface.v_min()) * j / (nv - 1); };
+    std::vector<glm::vec3> naive(nu * nv), fast(nu * nv), cached(nu * nv), grid(nu * nv);
+
+    double base = bench("naive Cox-de Boor", nu * nv, [&]() {
+        for (int i = 0; i < nu; ++i)
+            for (int j = 0; j < nv; ++j)
+                naive[i * nv + j] = naive_point(surface, param_u(i), param_v(j));
+    });
+    bench("getPoint", nu * nv, [&]() {
+        for (int i = 0; i < nu; ++i)
+            for (int j = 0; j < nv; ++j)
+                fast[i * nv + j] = surface.getPoint(param_u(i), param_v(j));
+    }, base);
+    bench("getPoint with span cache", nu * nv, [&]() {
+        KnotSpanCache cache;
+        for (int i = 0; i < nu; ++i)
+            for (int j = 0; j < nv; ++j)
+                cached[i * nv + j] = surface.getPoint(param_u(i), param_v(j), cache);
+    }, base);
+    bench("evaluateGrid", nu * nv, [&]() {
+        surface.evaluateGrid(nu, nv, grid.data());
+    }, base);
+
+    float max_err = 0.0f;
+    for (int k = 0; k < nu * nv; ++k) {
+        max_err = std::max(max_err, glm::length(fast[k] - naive[k]));
+        max_err = std::max(max_err, glm::length(cached[k] - naive[k]));
+        max_err = std::max(max_err, glm::length(grid[k] - naive[k]));
+    }
+    std::cout << "max error against naive: " << max_err << std::endl;
+    CHECK_LT(max_err, 1e-3f);
+
+    /* Every extracted patch must reproduce the surface over its span. */
+    auto patches = surface.toBezierPatches();
+    std::vector<float> breaks_u, breaks_v;
+    for (float t : surface.knots_u_)
+        if (breaks_u.empty() || t > breaks_u.back()) breaks_u.push_back(t);
+    for (float t : surface.knots_v_)
+        if (breaks_v.empty() || t > breaks_v.back()) breaks_v.push_back(t);
+    const int spans_u = breaks_u.size() - 1, spans_v = breaks_v.size() - 1;
+    CHECK_EQ(patches.size(), spans_u * spans_v);
+
+    float max_patch_err = 0.0f;
+    std::uniform_real_distribution<float> local(0.0f, 1.0f);
+    for (int a = 0; a < spans_u; ++a) {
+        for (int b = 0; b < spans_v; ++b) {
+            for (int k = 0; k < 16; ++k) {
+                float s = local(rng), t = local(rng);
+                float u = breaks_u[a] + s * (breaks_u[a + 1] - breaks_u[a]);
+                float v = breaks_v[b] + t * (breaks_v[b + 1] - breaks_v[b]);
+                glm::vec3 diff = patches[a * spans_v + b].getPoint(s, t) - surface.getPoint(u, v);
+                max_patch_err = std::max(max_patch_err, glm::length(diff));
+            }
+        }
+    }
+    std::cout << patches.size() << " Bezier patches, max error " << max_patch_err << std::endl;
+    CHECK_LT(max_patch_err, 1e-3f);
+    return 0;
+}
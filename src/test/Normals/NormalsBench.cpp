@@ -0,0 +1,113 @@
+/// \file NormalsBench.cpp
+/// \brief Generate normals of an ico sphere and compare them with the
+/// exact ones, then check that the faces of a cube are split apart
+/// by the crease angle and by flat shading. Tangents of a uv sphere
+/// follow its longitude, and a mirrored uv seam splits its vertices.
+/// usage: NormalsBench [n_segments], 20 * n_segments^2 triangles.
+/// --check runs the checks alone on a small sphere.
+
+#include "cgcl/mesh/Normals.h"
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/utils/logging.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace cgcl;
+
+/// \brief Unit cube of 8 shared vertices, 12 outward triangles.
+static void unit_cube(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+    vertices.clear();
+    for (int i = 0; i < 8; ++i)
+        vertices.push_back({glm::vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1), glm::vec3(0.0f), glm::vec2(0.0f)});
+    indices = {0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,  0, 1, 4, 1, 5, 4,
+               2, 6, 3, 3, 6, 7,  0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5};
+}
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned n_segments = check ? 64 : argc > 1 ? std::atoi(argv[1]) : 512;
+    auto sphere = SphereGeometry::ico_sphere(n_segments);
+    const size_t n_triangles = sphere.n_triangles();
+    std::cout << n_triangles << " triangles" << std::endl;
+
+    for (auto weighting : {NormalWeighting::Area, NormalWeighting::Angle}) {
+        std::vector<Vertex> vertices = sphere.vertices_;
+        std::vector<unsigned int> indices = sphere.indices_;
+        auto start = std::chrono::steady_clock::now();
+        size_t added = generate_normals(vertices, indices.data(), indices.size(), nullptr,
+                                        3.14159265f, weighting);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        CHECK_EQ(added, 0u) << "Smooth sphere was split";
+
+        double max_error = 0.0;
+        for (const auto &v : vertices) {
+            const float cos_error = glm::dot(v.normal_, glm::normalize(v.position_));
+            max_error = std::max(max_error, std::acos(std::min(1.0, double(cos_error))));
+        }
+        std::cout << (weighting == NormalWeighting::Area ? "area" : "angle") << " weighted in "
+                  << ms << " ms, " << n_triangles / ms / 1e3 << " Mtriangles/s, max error "
+                  << max_error * 180.0 / M_PI << " degrees" << std::endl;
+        CHECK_LT(max_error, 0.01);
+    }
+
+    /* Crease at 60 degrees splits every corner of the cube by face. */
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    unit_cube(vertices, indices);
+    CHECK_EQ(generate_normals(vertices, indices.data(), indices.size(), nullptr, 1.0471976f), 16u);
+    for (size_t t = 0; t < indices.size() / 3; ++t) {
+        const glm::vec3 &p0 = vertices[indices[3 * t]].position_;
+        glm::vec3 face = glm::normalize(glm::cross(vertices[indices[3 * t + 1]].position_ - p0,
+                                                   vertices[indices[3 * t + 2]].position_ - p0));
+        for (int c = 0; c < 3; ++c)
+            CHECK_GT(glm::dot(vertices[indices[3 * t + c]].normal_, face), 0.9999f);
+    }
+
+    /* Without crease the cube is smooth, corners point along diagonals. */
+    unit_cube(vertices, indices);
+    CHECK_EQ(generate_normals(vertices, indices.data(), indices.size()), 0u);
+    CHECK_GT(glm::dot(vertices[7].normal_, glm::normalize(glm::vec3(1.0f))), 0.9999f);
+
+    /* Flat shading splits the same as the crease. */
+    unit_cube(vertices, indices);
+    std::vector<uint8_t> flat(indices.size() / 3, 0);
+    CHECK_EQ(generate_normals(vertices, indices.data(), indices.size(), flat.data()), 16u);
+    std::cout << "cube creases and flat shading split as expected" << std::endl;
+
+    /* u grows with longitude, along (z, 0, -x) away from the poles. */
+    auto uv_sphere = SphereGeometry::uv_sphere(2 * n_segments, n_segments);
+    std::vector<glm::vec4> tangents;
+    auto start = std::chrono::steady_clock::now();
+    CHECK_EQ(generate_tangents(uv_sphere.vertices_, uv_sphere.indices_.data(), uv_sphere.indices_.size(),
+                               tangents), 0u);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const float handedness = tangents[uv_sphere.indices_[0]].w;
+    for (size_t v = 0; v < tangents.size(); ++v) {
+        if (tangents[v].w == 0.0f) continue; // not used by any triangle.
+        const glm::vec3 &p = uv_sphere.vertices_[v].position_;
+        const glm::vec3 t(tangents[v]);
+        CHECK_LT(std::abs(glm::dot(t, uv_sphere.vertices_[v].normal_)), 1e-3f);
+        CHECK_EQ(tangents[v].w, handedness);
+        if (p.x * p.x + p.z * p.z > 0.01f)
+            CHECK_GT(glm::dot(t, glm::normalize(glm::vec3(p.z, 0.0f, -p.x))), 0.999f);
+    }
+    std::cout << "tangents of " << uv_sphere.n_triangles() << " triangles in " << ms << " ms, "
+              << uv_sphere.n_triangles() / ms / 1e3 << " Mtriangles/s" << std::endl;
+
+    /* Two triangles mirrored across their shared edge in uv. */
+    vertices = {{glm::vec3(0, 0, 0), glm::vec3(0, 0, 1), glm::vec2(0.5f, 0)},
+                {glm::vec3(0, 1, 0), glm::vec3(0, 0, 1), glm::vec2(0.5f, 1)},
+                {glm::vec3(1, 0, 0), glm::vec3(0, 0, 1), glm::vec2(1, 0)},
+                {glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec2(1, 0)}};
+    indices = {0, 2, 1, 0, 1, 3};
+    CHECK_EQ(generate_tangents(vertices, indices.data(), indices.size(), tangents), 2u);
+    CHECK_EQ(tangents[indices[0]].w, -tangents[indices[3]].w);
+    CHECK_GT(glm::dot(glm::vec3(tangents[indices[0]]), glm::vec3(1, 0, 0)), 0.999f);
+    CHECK_GT(glm::dot(glm::vec3(tangents[indices[3]]), glm::vec3(-1, 0, 0)), 0.999f);
+    std::cout << "mirrored uv seam split as expected" << std::endl;
+}
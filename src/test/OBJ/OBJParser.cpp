@@ -10,4 +10,11 @@ int main(int argc, char **argv) {
     importer.parse(geom, verteces);
 
     CHECK_EQ(geom[0]->geometry_name_, "car");
-}
\ No newline at end of file
+    /* every face is bucketed to a material of its geometry, or none */
+    for (const auto &g : geom) {
+        for (const auto &face : g->face_elements_) {
+            CHECK_GE(face.material_index_, -1);
+            CHECK_LT(face.material_index_, int(g->material_order_.size()));
+        }
+    }
+}
@@ -0,0 +1,174 @@
+/// \file PathTracerBench.cpp
+/// \brief Path trace a closed box with diffuse walls, a glossy and a
+/// glass sphere, or an OBJ scene, within a time budget and report rays
+/// per second. Before that, check that samples accumulated one at a time
+/// give the image of all at once, and that the noise falls with samples.
+/// usage: PathTracerBench [width] [height] [budget_ms] [--output image.png] [model.obj]
+/// --check runs the checks on a small image and a short budget.
+
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/render/ImageIO.h"
+#include "cgcl/render/PathTracer.h"
+#include "cgcl/utils/logging.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace cgcl;
+
+/// \brief Append a quad as one sub-mesh of the given material.
+static void add_quad(TriMesh &mesh, const glm::vec3 &corner, const glm::vec3 &u, const glm::vec3 &v, int material) {
+    const glm::vec3 normal = glm::normalize(glm::cross(u, v));
+    const unsigned int first = mesh.global_vertices_.size();
+    for (const glm::vec3 &p : {corner, corner + u, corner + u + v, corner + v})
+        mesh.global_vertices_.push_back({p, normal, glm::vec2(0.0f)});
+    mesh.offsets_.push_back(mesh.global_indices_.size());
+    mesh.counts_.push_back(6);
+    mesh.sub_mesh_materials_.push_back(material);
+    for (unsigned int k : {0, 1, 2, 0, 2, 3})
+        mesh.global_indices_.push_back(first + k);
+}
+
+static void add_sphere(TriMesh &mesh, const SphereGeometry &sphere, const glm::vec3 &center, float radius, int material) {
+    const unsigned int first = mesh.global_vertices_.size();
+    for (const Vertex &vertex : sphere.vertices_)
+        mesh.global_vertices_.push_back({center + radius * vertex.position_, vertex.normal_, vertex.texture_coords_});
+    mesh.offsets_.push_back(mesh.global_indices_.size());
+    mesh.counts_.push_back(sphere.indices_.size());
+    mesh.sub_mesh_materials_.push_back(material);
+    for (unsigned int index : sphere.indices_)
+        mesh.global_indices_.push_back(first + index);
+}
+
+/// \brief Box [-1, 1]^3 open toward +z, a glossy sphere and a glass one.
+static std::unique_ptr<TriMesh> box_scene() {
+    std::unique_ptr<TriMesh> mesh(new TriMesh(std::vector<Vertex>(), std::vector<unsigned int>()));
+    MTLMaterial white, red, green, glossy, glass;
+    white.Kd_ = glm::vec3(0.75f);
+    red.Kd_ = glm::vec3(0.75f, 0.2f, 0.2f);
+    green.Kd_ = glm::vec3(0.2f, 0.75f, 0.2f);
+    glossy.Kd_ = glm::vec3(0.1f, 0.1f, 0.4f);
+    glossy.Ks_ = glm::vec3(0.7f);
+    glossy.Ns_ = 200.0f;
+    glass.Kd_ = glm::vec3(0.0f);
+    glass.Ks_ = glm::vec3(0.1f);
+    glass.Ns_ = 500.0f;
+    glass.Ni_ = 1.5f;
+    glass.d = 0.0f;
+    mesh->materials_ = {white, red, green, glossy, glass};
+
+    add_quad(*mesh, glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -2.0f), 0);
+    add_quad(*mesh, glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 2.0f), 0);
+    add_quad(*mesh, glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 2.0f, 0.0f), 0);
+    add_quad(*mesh, glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 2.0f, 0.0f), 1);
+    add_quad(*mesh, glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 2.0f, 0.0f), 2);
+    const SphereGeometry sphere = SphereGeometry::ico_sphere(16);
+    add_sphere(*mesh, sphere, glm::vec3(-0.45f, -0.6f, -0.3f), 0.4f, 3);
+    add_sphere(*mesh, sphere, glm::vec3(0.45f, -0.6f, 0.3f), 0.4f, 4);
+    mesh->computeBounds();
+    return mesh;
+}
+
+/// \brief Mean squared difference of two images in [0, 1]^3.
+static float mean_squared_error(const Framebuffer &a, const Framebuffer &b) {
+    double sum = 0.0;
+    for (int y = 0; y < a.height_; ++y)
+        for (int x = 0; x < a.width_; ++x) {
+            const glm::vec3 d = a.color(x, y) - b.color(x, y);
+            sum += glm::dot(d, d);
+        }
+    return sum / (double(a.width_) * a.height_);
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> positional;
+    std::string output;
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+        else if (std::strcmp(argv[i], "--check") == 0) check = true;
+        else positional.push_back(argv[i]);
+    }
+    const int width = check ? 64 : positional.size() > 0 ? std::atoi(positional[0].c_str()) : 640;
+    const int height = check ? 48 : positional.size() > 1 ? std::atoi(positional[1].c_str()) : 480;
+    const double budget_ms = check ? 100.0 : positional.size() > 2 ? std::atof(positional[2].c_str()) : 10000.0;
+
+    std::unique_ptr<TriMesh> box;
+    std::unique_ptr<Mesh> model;
+    const TriMesh *scene = nullptr;
+    glm::vec3 eye(0.0f, 0.0f, 3.4f), center(0.0f);
+    PointLight light;
+    light.pos_ = glm::vec3(0.0f, 0.85f, 0.0f);
+    if (positional.size() > 3) {
+        model = TriMesh::from_obj(positional[3]);
+        scene = static_cast<const TriMesh *>(model.get());
+        center = scene->bounds_.center();
+        eye = center + glm::vec3(0.0f, 0.0f, 1.5f * glm::length(scene->bounds_.extent()));
+        light.pos_ = eye + glm::vec3(0.0f, 0.5f * glm::length(scene->bounds_.extent()), 0.0f);
+    } else {
+        box = box_scene();
+        scene = box.get();
+    }
+    const glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    auto projection = [&](int w, int h) {
+        return glm::perspective(glm::radians(45.0f), float(w) / h, 0.1f, 100.0f);
+    };
+    const glm::vec3 environment(0.1f);
+
+    /* Progressive: one sample at a time gives the image of all at once. */
+    {
+        const int w = check ? 32 : 64, h = check ? 24 : 48;
+        const unsigned int n_reference = check ? 128 : 256;
+        PathTracer tracer(w, h);
+        tracer.setScene(*scene);
+        tracer.setCamera(view, projection(w, h));
+        tracer.setLight(light);
+        tracer.setEnvironment(environment);
+        tracer.render(4);
+        const std::vector<uint32_t> batch = tracer.framebuffer_.color_;
+        tracer.reset();
+        for (int k = 0; k < 4; ++k)
+            tracer.render(1);
+        CHECK_EQ(tracer.n_samples(), 4u);
+        CHECK(batch == tracer.framebuffer_.color_) << "Accumulated samples differ from one batch";
+
+        /* Noise against a reference of many samples falls with samples. */
+        tracer.reset();
+        tracer.render(n_reference);
+        const Framebuffer reference = tracer.framebuffer_;
+        float errors[2];
+        for (int k = 0; k < 2; ++k) {
+            tracer.reset();
+            tracer.render(k == 0 ? 4 : 32);
+            errors[k] = mean_squared_error(tracer.framebuffer_, reference);
+        }
+        std::cout << "mean squared error against " << n_reference << " samples: " << errors[0] << " at 4, " << errors[1]
+                  << " at 32" << std::endl;
+        CHECK_LT(errors[1], 0.5f * errors[0]);
+    }
+
+    int n_threads = 0;
+#pragma omp parallel reduction(+ : n_threads)
+    n_threads += 1;
+
+    PathTracer tracer(width, height);
+    tracer.setScene(*scene);
+    tracer.setCamera(view, projection(width, height));
+    tracer.setLight(light);
+    tracer.setEnvironment(environment);
+    const PathTracerStats &stats = tracer.renderFor(budget_ms);
+    std::cout << width << "x" << height << ", " << scene->global_indices_.size() / 3 << " triangles, "
+              << n_threads << " threads: " << stats.n_samples << " samples per pixel in " << stats.ms << " ms"
+              << std::endl;
+    std::cout << stats.n_camera_rays << " camera, " << stats.n_bounce_rays << " bounce, " << stats.n_shadow_rays
+              << " shadow rays, " << stats.raysPerSecond() / 1e6 << " Mrays/s, "
+              << stats.raysPerSecond() / 1e6 / n_threads << " Mrays/s per thread" << std::endl;
+    CHECK_LE(stats.ms, budget_ms + stats.ms / stats.n_samples) << "Over budget by more than a pass";
+    if (!output.empty()) write_image(output, tracer.framebuffer_);
+    return 0;
+}
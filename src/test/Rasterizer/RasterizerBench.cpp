@@ -0,0 +1,141 @@
+/// \file RasterizerBench.cpp
+/// \brief Render a grid of ico spheres on the CPU and report the frame
+/// time. Before that, check that a square cut into a fan of triangles is
+/// covered exactly once per pixel, that a sphere is lit as frag.glsl
+/// does, and that the hierarchical Z test changes nothing in the image.
+/// usage: RasterizerBench [width] [height] [n_segments]
+/// --check runs the checks alone on a small frame.
+
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/render/SoftwareRasterizer.h"
+#include "cgcl/utils/logging.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace cgcl;
+
+/// \brief Triangles from an off-grid center to points along the border
+/// of the square [-0.5, 0.5]^2, each one nearer than the one before, so
+/// a pixel covered twice is written twice.
+static std::unique_ptr<TriMesh> square_fan() {
+    const glm::vec2 center(0.123f, -0.0456f);
+    std::vector<glm::vec2> border;
+    const float steps[] = {0.0f, 0.07f, 0.31f, 0.5f, 0.52f, 0.9f};
+    for (int side = 0; side < 4; ++side)
+        for (float s : steps) {
+            const float u = s - 0.5f;
+            const glm::vec2 p[4] = {{u, -0.5f}, {0.5f, u}, {-u, 0.5f}, {-0.5f, -u}};
+            border.push_back(p[side]);
+        }
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (size_t i = 0; i < border.size(); ++i) {
+        const float z = 0.5f - 0.01f * i;
+        for (const glm::vec2 &p : {center, border[i], border[(i + 1) % border.size()]}) {
+            indices.push_back(vertices.size());
+            vertices.push_back({glm::vec3(p, z), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f)});
+        }
+    }
+    return std::unique_ptr<TriMesh>(new TriMesh(std::move(vertices), std::move(indices)));
+}
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const int width = check ? 320 : argc > 1 ? std::atoi(argv[1]) : 1280;
+    const int height = check ? 240 : argc > 2 ? std::atoi(argv[2]) : 720;
+    const unsigned n_segments = check ? 16 : argc > 3 ? std::atoi(argv[3]) : 48;
+    CHECK(width % 4 == 0 && height % 4 == 0) << "The coverage check needs sizes divisible by 4";
+    const PhongMaterial material(glm::vec3(0.2f, 0.4f, 0.6f));
+
+    /* Coverage: the fan fills the middle half of the viewport exactly. */
+    {
+        SoftwareRasterizer rasterizer(width, height);
+        auto fan = square_fan();
+        rasterizer.submit(*fan, glm::mat4(1.0f), &material);
+        const RasterStats &stats = rasterizer.flush();
+        const size_t expected = size_t(width / 2) * (height / 2);
+        std::cout << "fan of " << stats.n_triangles << " triangles: " << stats.n_fragments << " fragments, "
+                  << stats.n_pixels_shaded << " pixels for " << expected << std::endl;
+        CHECK_EQ(stats.n_pixels_shaded, expected) << "Gaps between triangles";
+        CHECK_EQ(stats.n_fragments, expected) << "Pixels covered twice";
+    }
+
+    auto sphere = SphereGeometry::ico_sphere(n_segments);
+    TriMesh sphere_mesh(sphere.vertices_, sphere.indices_);
+
+    /* Lighting: orthographic view of a unit sphere with the light at the
+     * camera, the center pixel faces both.
+     */
+    {
+        SoftwareRasterizer rasterizer(256, 256);
+        PointLight light;
+        rasterizer.setLight(light);
+        rasterizer.setCamera(glm::lookAt(light.pos_, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+                             glm::ortho(-2.0f, 2.0f, -2.0f, 2.0f, 0.1f, 10.0f), light.pos_);
+        rasterizer.setClearColor(glm::vec3(0.1f));
+        rasterizer.submit(sphere_mesh, glm::mat4(1.0f), &material);
+        rasterizer.flush();
+        const glm::vec3 expected = material.Ka_ * light.Ia_ + material.Kd_ * light.Id_ + material.Ks_ * light.Is_;
+        const glm::vec3 center = rasterizer.framebuffer_.color(128, 128);
+        std::cout << "sphere center (" << center.x << ", " << center.y << ", " << center.z << "), expected ("
+                  << expected.x << ", " << expected.y << ", " << expected.z << ")" << std::endl;
+        CHECK_LT(glm::length(center - expected), 3.0f / 255.0f);
+        CHECK_LT(glm::length(rasterizer.framebuffer_.color(2, 2) - glm::vec3(0.1f)), 1.0f / 255.0f);
+        CHECK_EQ(rasterizer.framebuffer_.depth_[0], 1.0f);
+        CHECK_LT(rasterizer.framebuffer_.depth_[128 * 256 + 128], 1.0f);
+    }
+
+    /* Scene: a grid of spheres behind a wall. */
+    const glm::vec3 eye(0.0f, 2.0f, 12.0f);
+    const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), float(width) / height, 0.1f, 100.0f);
+    std::vector<glm::mat4> models;
+    std::vector<PhongMaterial> materials;
+    for (int i = 0; i < 8; ++i)
+        for (int j = 0; j < 8; ++j) {
+            models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(2.2f * i - 7.7f, 2.2f * j - 7.7f, -4.0f)),
+                                        glm::vec3(0.9f)));
+            materials.emplace_back(glm::vec3(0.3f + 0.1f * i, 0.9f - 0.1f * j, 0.5f));
+        }
+    const glm::mat4 wall = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-4.0f, 0.0f, 4.0f)), glm::vec3(3.0f));
+    SoftwareRasterizer rasterizer(width, height);
+    rasterizer.setCamera(view, projection, eye);
+    auto render = [&](bool wall_first) {
+        if (wall_first) rasterizer.submit(sphere_mesh, wall, &material);
+        for (size_t i = 0; i < models.size(); ++i)
+            rasterizer.submit(sphere_mesh, models[i], &materials[i]);
+        if (!wall_first) rasterizer.submit(sphere_mesh, wall, &material);
+        return rasterizer.flush();
+    };
+
+    /* Drawn front to back, the spheres behind the wall are skipped by
+     * blocks, drawn back to front nothing is, and the images agree.
+     */
+    const RasterStats front_to_back = render(true);
+    const std::vector<uint32_t> image = rasterizer.framebuffer_.color_;
+    const RasterStats back_to_front = render(false);
+    std::cout << front_to_back.n_blocks_occluded << " blocks occluded front to back, "
+              << back_to_front.n_blocks_occluded << " back to front" << std::endl;
+    CHECK_GT(front_to_back.n_blocks_occluded, back_to_front.n_blocks_occluded);
+    CHECK_LT(front_to_back.n_fragments, back_to_front.n_fragments);
+    CHECK(image == rasterizer.framebuffer_.color_) << "Hierarchical Z changed the image";
+
+    const int n_frames = check ? 1 : 10;
+    auto start = std::chrono::steady_clock::now();
+    RasterStats stats;
+    for (int frame = 0; frame < n_frames; ++frame)
+        stats = render(true);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / n_frames;
+    std::cout << width << "x" << height << ", " << stats.n_triangles << " triangles, " << stats.n_culled
+              << " culled, " << stats.n_bin_entries << " bin entries, " << stats.n_fragments << " fragments, "
+              << stats.n_pixels_shaded << " pixels shaded" << std::endl;
+    std::cout << ms << " ms per frame, " << stats.n_triangles / ms / 1e3 << " Mtriangles/s, "
+              << double(width) * height / ms / 1e3 << " Mpixels/s" << std::endl;
+    return 0;
+}
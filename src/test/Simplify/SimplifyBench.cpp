@@ -0,0 +1,135 @@
+/// \file SimplifyBench.cpp
+/// \brief Build the LOD chain of a uv sphere, whose seam column and
+/// poles have duplicated vertices, and check that every level stays
+/// closed: no crack opens along the seam. Then check that a uv cut
+/// ending inside a grid does not tear at its tip.
+/// usage: SimplifyBench [n_longitude], about 2 * n_longitude^2 triangles.
+/// --check runs the checks alone on a small sphere.
+
+#include "cgcl/mesh/MeshOptimizer.h"
+#include "cgcl/mesh/Simplify.h"
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/utils/logging.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <vector>
+
+using namespace cgcl;
+
+/// \brief Edges used by one triangle only, with vertices
+/// welded by position.
+static size_t open_edges(const TriMesh &mesh) {
+    using Point = std::tuple<float, float, float>;
+    std::map<std::pair<Point, Point>, int> edges;
+    auto point = [&](unsigned int v) {
+        const glm::vec3 &p = mesh.global_vertices_[v].position_;
+        return Point(p.x, p.y, p.z);
+    };
+    for (size_t i = 0; i < mesh.global_indices_.size(); i += 3) {
+        for (int c = 0; c < 3; ++c) {
+            Point a = point(mesh.global_indices_[i + c]), b = point(mesh.global_indices_[i + (c + 1) % 3]);
+            edges[std::minmax(a, b)]++;
+        }
+    }
+    return std::count_if(edges.begin(), edges.end(), [](const auto &e) { return e.second == 1; });
+}
+
+/// \brief Grid of n x n quads around the origin, with uv (angle, radius)
+/// around it. The uv cut runs from the origin along -x, the vertices
+/// there are duplicated with angle pi above and -pi below.
+static void cut_grid(int n, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) {
+    std::map<std::tuple<int, int, bool>, unsigned int> ids;
+    auto vertex = [&](int i, int j, bool above) {
+        const glm::vec3 p(i - n / 2, j - n / 2, 0.0f);
+        const bool cut = p.y == 0.0f && p.x < 0.0f;
+        auto [it, added] = ids.emplace(std::make_tuple(i, j, cut && above), vertices.size());
+        if (!added) return it->second;
+        const float angle = cut ? (above ? M_PI : -M_PI) : (p == glm::vec3(0.0f) ? 0.0f : std::atan2(p.y, p.x));
+        vertices.push_back({p, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(angle, glm::length(p))});
+        return it->second;
+    };
+    for (int j = 0; j < n; ++j)
+        for (int i = 0; i < n; ++i) {
+            const bool above = j >= n / 2;
+            const unsigned a = vertex(i, j, above), b = vertex(i + 1, j, above), c = vertex(i + 1, j + 1, above),
+                           d = vertex(i, j + 1, above);
+            indices.insert(indices.end(), {a, b, c, a, c, d});
+        }
+}
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned n_longitude = check ? 48 : argc > 1 ? std::atoi(argv[1]) : 256;
+    auto sphere = SphereGeometry::uv_sphere(n_longitude, n_longitude);
+    TriMesh mesh(std::move(sphere.vertices_), std::move(sphere.indices_));
+    mesh.optimize();
+
+    auto start = std::chrono::steady_clock::now();
+    LODChain chain = LODChain::build(mesh);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "LOD chain of " << mesh.global_indices_.size() / 3 << " triangles built in "
+              << ms << " ms" << std::endl;
+
+    size_t base_transformed = 0;
+    for (size_t k = 0; k < chain.size(); ++k) {
+        const TriMesh &level = *chain.levels_[k];
+        auto stats = analyze_vertex_cache(level.global_indices_.data(), level.global_indices_.size(),
+                                          level.global_vertices_.size());
+        if (k == 0) base_transformed = stats.n_transformed;
+        size_t n_open = open_edges(level);
+        std::cout << "level " << k << ": " << stats.n_triangles << " triangles, "
+                  << stats.n_transformed << " vertices transformed ("
+                  << float(base_transformed) / stats.n_transformed << "x fewer), error "
+                  << chain.errors_[k] << ", " << n_open << " open edges" << std::endl;
+        CHECK_EQ(n_open, 0u) << "Level " << k << " is not closed";
+        if (k > 0) CHECK_GE(chain.errors_[k], chain.errors_[k - 1]);
+    }
+    CHECK_GE(chain.size(), 5u);
+    const TriMesh &coarsest = *chain.levels_.back();
+    auto coarsest_stats = analyze_vertex_cache(coarsest.global_indices_.data(), coarsest.global_indices_.size(),
+                                               coarsest.global_vertices_.size());
+    CHECK_LE(coarsest_stats.n_transformed * 10, base_transformed);
+
+    /* A unit sphere seen from farther and farther away. */
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+    unsigned int previous = 0;
+    for (float distance : {2.0f, 10.0f, 50.0f, 200.0f, 800.0f}) {
+        unsigned int level = chain.select(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, distance), projection, 600.0f);
+        std::cout << "distance " << distance << ": level " << level << std::endl;
+        CHECK_GE(level, previous);
+        previous = level;
+    }
+    CHECK_EQ(previous, chain.size() - 1);
+
+    /* Corners of a triangle other than the tip span less than pi of angle
+     * around it, a triangle torn across the cut takes both copies and
+     * spans more. Simplified this far, the tip is the next to go.
+     */
+    std::vector<Vertex> grid;
+    std::vector<unsigned int> grid_indices;
+    cut_grid(8, grid, grid_indices);
+    simplify(grid, grid_indices, 3 * 4);
+    float max_span = 0.0f;
+    for (size_t i = 0; i < grid_indices.size(); i += 3) {
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (int c = 0; c < 3; ++c) {
+            const Vertex &v = grid[grid_indices[i + c]];
+            if (v.position_ == glm::vec3(0.0f)) continue;
+            lo = std::min(lo, v.texture_coords_.x);
+            hi = std::max(hi, v.texture_coords_.x);
+        }
+        max_span = std::max(max_span, hi - lo);
+    }
+    std::cout << "uv cut grid simplified to " << grid_indices.size() / 3 << " triangles, widest angle "
+              << max_span << std::endl;
+    CHECK_LT(max_span, float(M_PI)) << "The cut tore at its tip";
+    return 0;
+}
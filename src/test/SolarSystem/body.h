@@ -4,16 +4,15 @@
 #include <glm/fwd.hpp>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
+#include <memory>
 #include <vector>
 
+#include "cgcl/mesh/InstancedTriMesh.h"
+
 /// \file body.h
 /// \brief Body Class for star, planet and satellite.
-
-struct Vertex {
-    glm::vec3 pos_;
-    glm::vec3 normal_;
-    glm::vec2 tex_coord_;
-};
+/// All bodies are instances of one shared unit sphere,
+/// scaled and translated by their instance model matrix.
 
 class Body {
 public:
@@ -21,20 +20,20 @@ public:
     Body(const glm::vec3 &center, float radis, float speed, const glm::vec3 &color, bool reverse_norm = false,
          const glm::vec3 &orbit_center = glm::vec3(0.0f, 0.0f, 0.0f),
          const glm::vec3 &axis = glm::vec3(0.0f, 0.0f, 0.0f));
-    ~Body();
 public:
     const GLfloat *getColor() const;
-    float getAngle();
-    glm::mat4 update_model(glm::mat4 base_trans, float angle = 0.0f);
-    void bind_and_draw();
-    void unbind();
+    /// \brief Orbit transform at time, relative to the parent body,
+    /// a satellite node is a child of its planet node in the scene graph.
+    glm::mat4 orbit_transform(float time) const;
+    /// \brief Model matrix of the shared unit sphere instance.
+    glm::mat4 instance_model(const glm::mat4 &orbit) const;
+    /// \brief Unit sphere shared by all bodies, resolution is the number
+    /// of latitude and longitude segments.
+    static std::unique_ptr<cgcl::InstancedTriMesh> build_sphere(unsigned int resolution = N);
 #ifndef NDEBUG
     void debug(glm::mat4 transform);
 #endif
 
-protected:
-    void InitBufferData();
-    void InitGLObjects();
 private:
     glm::vec3 color_;
     glm::vec3 center_;
@@ -43,14 +42,10 @@ private:
     glm::vec3 orbit_center_;
     glm::vec3 axis_;
 
-    unsigned int VAO, VBO, EBO;
     static const unsigned int N = 64; // latitude and longitude split.
-    unsigned int n_vertex_;
-    unsigned int n_triangles_;
+    bool reverse_norm_ = false;
     bool need_orbit_ = false;
     bool need_rotation_ = false;
-    std::vector<Vertex> vertex_;
-    std::vector<unsigned int> indices_;
 };
 
-#endif // BODY_H_
\ No newline at end of file
+#endif // BODY_H_
@@ -8,13 +8,28 @@
 
 #include "cgcl/surface/WavefrontOBJ.h"
 #include "cgcl/mesh/Mesh.h"
+#include "cgcl/mesh/TriMesh.h"
+#include "cgcl/mesh/InstancedTriMesh.h"
+#include "cgcl/mesh/MeshPool.h"
+#include "cgcl/mesh/Simplify.h"
+#include "cgcl/mesh/BezierPatchMesh.h"
 #include "cgcl/surface/Bezier.h"
+#include "cgcl/surface/BezierPatchSet.h"
 #include "cgcl/utils/Loader.h"
 #include "cgcl/platform/OpenGL/GLShader.h"
 #include "cgcl/mesh/PhongMaterial.h"
+#include "cgcl/scene/SceneGraph.h"
+#include "cgcl/render/RenderQueue.h"
+#include "cgcl/render/SoftwareRasterizer.h"
+#include "cgcl/render/ImageIO.h"
+#include "cgcl/math/Frustum.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <math.h>
 
 #include "body.h"
@@ -82,7 +97,91 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
     g = glm::normalize(front);
 }
 
-int main() {
+/// \brief Bodies, their scene graph and the materials of everything
+/// drawn, shared by the window and the headless renderer.
+struct SolarSystemScene {
+    Body sun_{glm::vec3(0.0f, 0.0f, -10.0f), 10, 0, glm::vec3(1.0f, 0.5f,0.2f)};
+    Body earth_{glm::vec3(25.0, 0.0f, -10.0), 5, 1.0,glm::vec3(0.2f, 0.2f, 1.0f), false,
+                glm::vec3(0.0f, 0.0f, -10.0f),
+                glm::vec3(0.0f, 1.0f, 0.0f)};
+    Body venus_{glm::vec3(-5.0f, 15.0f, -10.0f), 3, 2.0, glm::vec3(1.0f, 0.84f, 0.5f), false,
+                glm::vec3(0.0f, 0.0f, -10.0f),
+                glm::vec3(sqrt(3) / 3 , sqrt(3) / 3, sqrt(3) / 3)};
+    Body moon_{glm::vec3(25.0, 0.0f, 0.0f), 1, 0.4, glm::vec3(0.5f, 0.5f, 0.5f), false,
+               glm::vec3(25.0f, 0.0f, -10.0f),
+               glm::vec3(1.0f, 0.0f, 0.0f)};
+    /* Sun, Earth, Venus and Moon. */
+    cgcl::PhongMaterial body_materials_[4] = {
+        cgcl::PhongMaterial(glm::vec3(1.0f, 0.5f,0.2f)),
+        cgcl::PhongMaterial(glm::vec3(0.2f, 0.2f, 1.0f)),
+        cgcl::PhongMaterial(glm::vec3(1.0f, 0.84f, 0.5f)),
+        cgcl::PhongMaterial(glm::vec3(0.5f, 0.5f, 0.5f))
+    };
+    cgcl::PhongMaterial car_material_{glm::vec3(1.0f, 0.0f, 0.0f)};
+    glm::mat4 car_model_ = glm::translate(glm::mat4(1.0f), glm::vec3(20.0f, 0.0f, 0.0f));
+    glm::mat4 bezier_car_model_ = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10.0f));
+
+    /* The Moon orbits the Earth, its orbit is given in the frame of Earth. */
+    cgcl::SceneGraph graph_;
+    cgcl::SceneGraph::NodeId sun_node_ = graph_.addNode();
+    cgcl::SceneGraph::NodeId earth_node_ = graph_.addNode();
+    cgcl::SceneGraph::NodeId venus_node_ = graph_.addNode();
+    cgcl::SceneGraph::NodeId moon_node_ = graph_.addNode(earth_node_);
+
+    /// \brief Instance model matrices of the bodies at time, in the
+    /// order of body_materials_.
+    void bodyModels(float time, glm::mat4 models[4]) {
+        graph_.setLocal(sun_node_, sun_.orbit_transform(time));
+        graph_.setLocal(earth_node_, earth_.orbit_transform(time));
+        graph_.setLocal(venus_node_, venus_.orbit_transform(time));
+        graph_.setLocal(moon_node_, moon_.orbit_transform(time));
+        graph_.updateWorld();
+        models[0] = sun_.instance_model(graph_.world(sun_node_));
+        models[1] = earth_.instance_model(graph_.world(earth_node_));
+        models[2] = venus_.instance_model(graph_.world(venus_node_));
+        models[3] = moon_.instance_model(graph_.world(moon_node_));
+    }
+};
+
+/// \brief Render the system at time on the CPU into an image file, for
+/// machines without a display or GPU. The Bezier car is tessellated on
+/// CPU and nothing is culled, the rasterizer rejects by tiles itself.
+int render_headless(const std::string &filename, float time, int image_width, int image_height) {
+    SolarSystemScene system;
+    auto sphere = Body::build_sphere();
+    auto mesh_ptr = cgcl::TriMesh::from_obj("car.obj");
+    auto car = cgcl::TriMesh::from_bezier_patches(*cgcl::BezierPatchSet::from_file("car.txt"));
+
+    glm::mat4 body_models[4];
+    system.bodyModels(time, body_models);
+    for (int i = 0; i < 4; ++i)
+        sphere->instances_.push_back(cgcl::InstanceData::make(body_models[i], system.body_materials_[i]));
+
+    cgcl::SoftwareRasterizer rasterizer(image_width, image_height);
+    rasterizer.setCamera(glm::lookAt(e, e+g, sky_vector),
+                         glm::perspective(glm::radians(45.0f), (float)image_width / (float)image_height,
+                                          0.1f, 100.0f),
+                         e);
+    rasterizer.submit(*sphere);
+    /* The OBJ car keeps the materials of its MTL library. */
+    rasterizer.submit(static_cast<cgcl::TriMesh &>(*mesh_ptr), system.car_model_, nullptr);
+    rasterizer.submit(static_cast<cgcl::TriMesh &>(*car), system.bezier_car_model_, &system.car_material_);
+    const cgcl::RasterStats &stats = rasterizer.flush();
+    std::cout << stats.n_triangles << " triangles, " << stats.n_pixels_shaded << " pixels shaded" << std::endl;
+    cgcl::write_image(filename, rasterizer.framebuffer_);
+    return 0;
+}
+
+/// usage: SolarSystem
+///        SolarSystem --headless image.png [time] [width height]
+int main(int argc, char *argv[]) {
+    if (argc > 2 && std::strcmp(argv[1], "--headless") == 0) {
+        const float time = argc > 3 ? std::atof(argv[3]) : 0.0f;
+        const int image_width = argc > 5 ? std::atoi(argv[4]) : 800;
+        const int image_height = argc > 5 ? std::atoi(argv[5]) : 600;
+        return render_headless(argv[2], time, image_width, image_height);
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -110,8 +209,9 @@ int main() {
 
     /* Load and Compile shaders */
 
+    /* The cars drawn alone upload packed vertices, decoded in the shader. */
     cgcl::GLShader program(
-        cgcl::Loader::readFromRelative("shader/bling-phong/vertex.glsl"),
+        cgcl::Loader::readFromRelative("shader/bling-phong/quantized_vertex.glsl"),
         cgcl::Loader::readFromRelative("shader/bling-phong/frag.glsl")
     );
 
@@ -119,18 +219,12 @@ int main() {
     // glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    Body Sun(glm::vec3(0.0f, 0.0f, -10.0f), 10, 0, glm::vec3(1.0f, 0.5f,0.2f));
-
-    Body Earth(glm::vec3(25.0, 0.0f, -10.0), 5, 1.0,glm::vec3(0.2f, 0.2f, 1.0f),
-                glm::vec3(0.0f, 0.0f, -10.0f),
-            glm::vec3(0.0f, 1.0f, 0.0f));
-    Body Venus(glm::vec3(-5.0f, 15.0f, -10.0f), 3, 2.0, glm::vec3(1.0f, 0.84f, 0.5f),
-                glm::vec3(0.0f, 0.0f, -10.0f),
-                glm::vec3(sqrt(3) / 3 , sqrt(3) / 3, sqrt(3) / 3));
+    cgcl::GLShader instanced_program(
+        cgcl::Loader::readFromRelative("shader/bling-phong/instanced_vertex.glsl"),
+        cgcl::Loader::readFromRelative("shader/bling-phong/instanced_frag.glsl")
+    );
 
-    Body Moon(glm::vec3(25.0, 0.0f, 0.0f), 1, 0.4, glm::vec3(0.5f, 0.5f, 0.5f),
-                glm::vec3(25.0f, 0.0f, -10.0f),
-            glm::vec3(1.0f, 0.0f, 0.0f));
+    SolarSystemScene system;
 
     /* Set up point light source */
     program.Bind();
@@ -138,35 +232,128 @@ int main() {
     program.updateUniformFloat3("light.Ia", glm::vec3(0.2f, 0.2f, 0.2f));
     program.updateUniformFloat3("light.Id", glm::vec3(0.5f, 0.5f, 0.5f)); 
     program.updateUniformFloat3("light.Is", glm::vec3(1.0f, 1.0f, 1.0f));
-    /* Set up body material */
-    cgcl::PhongMaterial sun_material(glm::vec3(1.0f, 0.5f,0.2f));
-    cgcl::PhongMaterial earth_material(glm::vec3(0.2f, 0.2f, 1.0f));
-    cgcl::PhongMaterial venus_material(glm::vec3(1.0f, 0.84f, 0.5f));
-    cgcl::PhongMaterial moon_material(glm::vec3(0.5f, 0.5f, 0.5f));
-    cgcl::PhongMaterial car_material(glm::vec3(1.0f, 0.0f, 0.0f));
+    instanced_program.Bind();
+    instanced_program.updateUniformFloat3("light.pos", glm::vec3(0.0f, 0.0f, 5.0f));
+    instanced_program.updateUniformFloat3("light.Ia", glm::vec3(0.2f, 0.2f, 0.2f));
+    instanced_program.updateUniformFloat3("light.Id", glm::vec3(0.5f, 0.5f, 0.5f)); 
+    instanced_program.updateUniformFloat3("light.Is", glm::vec3(1.0f, 1.0f, 1.0f));
+    cgcl::PhongMaterial &car_material = system.car_material_;
+
+    /* All bodies share one sphere, drawn in one instanced call. */
+    auto sphere = Body::build_sphere();
+    sphere->instances_.resize(4);
 
     auto mesh_ptr = cgcl::TriMesh::from_obj("car.obj");
-    mesh_ptr->initGL();
-
-    std::vector<std::unique_ptr<cgcl::TriMesh>> car;
-    FILE *file = fopen("car.txt", "r");
-    assert(file != nullptr);
-    unsigned int n_bezier, u, v;
-    fscanf(file, "%d", &n_bezier);
-    for (int k = 0; k < n_bezier; ++k) {
-        fscanf(file, "%d%d", &u, &v);
-        std::vector<glm::vec3> ctrl_pts;
-        glm::vec3 pos;
-        for (int i = 0; i < u; ++i) {
-            for (int j = 0; j < v; ++j) {
-                fscanf(file, "%f%f%f", &pos.x, &pos.y, &pos.z);
-                ctrl_pts.push_back(pos);
-            }
+    auto &obj_car = static_cast<cgcl::TriMesh &>(*mesh_ptr);
+
+    /* from_obj generates tangents when a material has a normal map. Such
+     * a car keeps full vertices and is drawn alone by the normal map program.
+     */
+    const bool car_normal_mapped = !obj_car.tangents_.empty();
+    std::unique_ptr<cgcl::GLShader> normal_map_program;
+    if (car_normal_mapped) {
+        normal_map_program = std::make_unique<cgcl::GLShader>(
+            cgcl::Loader::readFromRelative("shader/bling-phong/normal_map_vertex.glsl"),
+            cgcl::Loader::readFromRelative("shader/bling-phong/normal_map_frag.glsl")
+        );
+        normal_map_program->Bind();
+        normal_map_program->updateUniformFloat3("light.pos", glm::vec3(0.0f, 0.0f, 5.0f));
+        normal_map_program->updateUniformFloat3("light.Ia", glm::vec3(0.2f, 0.2f, 0.2f));
+        normal_map_program->updateUniformFloat3("light.Id", glm::vec3(0.5f, 0.5f, 0.5f)); 
+        normal_map_program->updateUniformFloat3("light.Is", glm::vec3(1.0f, 1.0f, 1.0f));
+    }
+
+    auto car_patch_set = cgcl::BezierPatchSet::from_file("car.txt");
+
+    /* Tessellate the patches on GPU when OpenGL 4.0 is available,
+     * patches too large for GL_PATCHES and older context fall back 
+     * to CPU tessellation, all into one mesh and one draw call.
+     */
+    std::unique_ptr<cgcl::GLShader> bezier_program;
+    std::unique_ptr<cgcl::BezierPatchMesh> gpu_car;
+    std::vector<cgcl::BezierSurface> cpu_patches;
+    if (GLAD_GL_VERSION_4_0) {
+        bezier_program = std::make_unique<cgcl::GLShader>(
+            cgcl::Loader::readFromRelative("shader/bezier/vertex.glsl"),
+            cgcl::Loader::readFromRelative("shader/bezier/tess_ctrl.glsl"),
+            cgcl::Loader::readFromRelative("shader/bezier/tess_eval.glsl"),
+            cgcl::Loader::readFromRelative("shader/bling-phong/frag.glsl")
+        );
+        gpu_car = cgcl::BezierPatchMesh::from_bezier_patches(car_patch_set->toBezierSurfaces(), &cpu_patches);
+        gpu_car->bindShader(bezier_program.get());
+        gpu_car->initGL();
+
+        bezier_program->Bind();
+        bezier_program->updateUniformFloat3("light.pos", glm::vec3(0.0f, 0.0f, 5.0f));
+        bezier_program->updateUniformFloat3("light.Ia", glm::vec3(0.2f, 0.2f, 0.2f));
+        bezier_program->updateUniformFloat3("light.Id", glm::vec3(0.5f, 0.5f, 0.5f)); 
+        bezier_program->updateUniformFloat3("light.Is", glm::vec3(1.0f, 1.0f, 1.0f));
+    }
+    auto car = gpu_car ? cgcl::TriMesh::from_bezier_patches(cpu_patches)
+                       : cgcl::TriMesh::from_bezier_patches(*car_patch_set);
+
+    /* With OpenGL 4.3, static meshes are packed into one pool and a frame
+     * of them is one multi-draw indirect call, otherwise each is drawn alone.
+     */
+    const bool use_mesh_pool = GLAD_GL_VERSION_4_3;
+    cgcl::MeshPool pool;
+    cgcl::LODChain sphere_lods;
+    unsigned int sphere_entry = 0, car_entry = 0, bezier_car_entry = 0;
+    unsigned int n_car_entries = 0, n_bezier_car_entries = 0;
+    /* Material of every entry of the OBJ car, faces without one take the
+     * MTL defaults, as drawMaterials() does.
+     */
+    std::vector<cgcl::PhongMaterial> car_entry_materials;
+    if (use_mesh_pool) {
+        const auto &bezier_car = static_cast<const cgcl::TriMesh &>(*car);
+        /* Levels of the sphere take consecutive entries from sphere_entry,
+         * each body picks its own by its size on screen.
+         */
+        sphere_lods = cgcl::LODChain::build(*sphere);
+        sphere_entry = pool.add(*sphere);
+        for (size_t k = 1; k < sphere_lods.size(); ++k)
+            pool.add(*sphere_lods.levels_[k]);
+        /* The pool has no textures, a normal mapped car is drawn alone. */
+        if (car_normal_mapped)
+            mesh_ptr->initGL();
+        else
+            car_entry = pool.add(obj_car);
+        bezier_car_entry = pool.add(bezier_car);
+        n_car_entries = car_normal_mapped ? 0 : bezier_car_entry - car_entry;
+        const bool own_materials = !obj_car.materials_.empty() &&
+                                   obj_car.sub_mesh_materials_.size() == obj_car.offsets_.size();
+        for (unsigned int k = 0; k < n_car_entries; ++k) {
+            const int id = own_materials ? obj_car.sub_mesh_materials_[k] : -1;
+            const cgcl::MTLMaterial &m = id < 0 ? cgcl::MTLMaterial() : obj_car.materials_[id];
+            car_entry_materials.emplace_back(m.Ka_, m.Kd_, m.Ks_, m.Ns_);
         }
-        auto mesh = cgcl::TriMesh::from_bezier(cgcl::BezierSurface{u, v, ctrl_pts});
-        mesh->initGL();
-        car.emplace_back(std::move(mesh));
+        n_bezier_car_entries = pool.n_entries() - bezier_car_entry;
+        pool.initGL();
+    } else {
+        sphere->initGL();
+        if (!car_normal_mapped)
+            obj_car.vertex_format_ = cgcl::VertexFormat::compact();
+        static_cast<cgcl::TriMesh &>(*car).vertex_format_ = cgcl::VertexFormat::compact();
+        mesh_ptr->initGL();
+        car->initGL();
+    }
+
+    /* Bezier patches lie in the convex hull of their control points,
+     * whether tessellated on CPU or GPU.
+     */
+    cgcl::AABB bezier_car_box;
+    for (size_t k = 0; k < car_patch_set->size(); ++k) {
+        const auto &record = car_patch_set->patch(k);
+        for (size_t i = 0; i < record.n_us * record.n_vs; ++i)
+            bezier_car_box.expand(car_patch_set->ctrl_pts(k)[i]);
     }
+    cgcl::BoundingSphere bezier_car_sphere;
+    bezier_car_sphere.center_ = bezier_car_box.center();
+    bezier_car_sphere.radius_ = 0.5f * glm::length(bezier_car_box.extent());
+
+    cgcl::RenderQueue queue;
+    cgcl::BoundingSphereSoA cull_spheres;
+    bool first_frame = true;
 
     glEnable(GL_DEPTH_TEST); // Z buffer depth test.
     // glEnable(GL_LIGHT0);
@@ -181,8 +368,6 @@ int main() {
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        program.Bind();
-        program.updateUniformFloat3("view_pos", e);
         // /* Global transform from world coord -> camera coord -> viewport */
         // /* This tansfrom will as a uniform attribute and utilize the parallelism of GPU */
 
@@ -195,63 +380,81 @@ int main() {
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), (GLfloat)width / (GLfloat)height, 
                                                 0.1f, 100.0f);
 
-        /* Set view and projection matrix */
-
-
-        program.updateUniformMat4("view", view);
-        program.updateUniformMat4("projection", projection);
-
-
-        glm::mat4 sun_model = Sun.update_model(glm::mat4(1.0f));
-        program.updateUniformMat4("model", sun_model);
-        sun_material.updateBareMaterial(program);
-        //program.updateUniformFloat3v("object_color", 1, Sun.getColor());
-        Sun.bind_and_draw();
-        Sun.unbind();
-
-        glm::mat4 earth_model =  Earth.update_model(glm::mat4(1.0f));
-        float angle = Earth.getAngle();
-        // std::cout << glm::to_string(model) << std::endl;
-        program.updateUniformMat4("model", earth_model);
-        earth_material.updateBareMaterial(program);
-        //program.updateUniformFloat3v("object_color", 1, Earth.getColor());
-        Earth.bind_and_draw();
-        Earth.unbind();
-
-        glm::mat4 venus_model =  Venus.update_model(glm::mat4(1.0f));
-        // std::cout << glm::to_string(model) << std::endl;
-        program.updateUniformMat4("model", venus_model);
-        venus_material.updateBareMaterial(program);
-        //program.updateUniformFloat3v("object_color", 1, Venus.getColor());
-        Venus.bind_and_draw();
-        Venus.unbind();
-
-        glm::mat4 moon_model =  Moon.update_model(earth_model, angle);
-        // std::cout << glm::to_string(model) << std::endl;
-        program.updateUniformMat4("model", moon_model);
-        moon_material.updateBareMaterial(program);
-        //program.updateUniformFloat3v("object_color", 1, Moon.getColor());
-        Moon.bind_and_draw();
-        Moon.unbind();
-
-
-        glm::mat4 car_model = glm::translate(glm::mat4(1.0f), glm::vec3(20.0f, 0.0f, 0.0f)) ;
-        car_material.updateBareMaterial(program);
-        program.updateUniformMat4("model", car_model);
-        //program.updateUniformFloat3("object_color", car_color);
-        mesh_ptr->render();
-
-        glm::mat4 bezier_car_model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10.0f)) ;
-        program.updateUniformMat4("model", bezier_car_model);
-        // program.updateUniformFloat3("object_color", bezier_car_color);
-        for (const auto &mesh : car) {
-            mesh->render();
+        /* Bodies: model matrices and materials go to the instance buffer. */
+        glm::mat4 body_models[4];
+        system.bodyModels(current_frame, body_models);
+        const glm::mat4 &car_model = system.car_model_;
+        const glm::mat4 &bezier_car_model = system.bezier_car_model_;
+
+        /* Cull against the view frustum: 4 bodies, the OBJ car, the Bezier car. */
+        cgcl::Frustum frustum = cgcl::Frustum::from_matrix(projection * view);
+        cull_spheres.clear();
+        for (const auto &model : body_models)
+            cull_spheres.push_back(sphere->bounding_sphere_.transform(model));
+        cull_spheres.push_back(obj_car.bounding_sphere_.transform(car_model));
+        cull_spheres.push_back(bezier_car_sphere.transform(bezier_car_model));
+        uint8_t visible[6];
+        frustum.cull(cull_spheres, visible);
+        std::vector<cgcl::InstanceData> body_instances;
+        std::vector<unsigned int> body_lods;
+        for (int i = 0; i < 4; ++i) {
+            if (!visible[i]) continue;
+            body_instances.push_back(cgcl::InstanceData::make(body_models[i], system.body_materials_[i]));
+            if (use_mesh_pool)
+                body_lods.push_back(sphere_lods.select(body_models[i], e, projection, height));
+        }
+        const bool car_visible = visible[4], bezier_car_visible = visible[5];
+
+        if (gpu_car) {
+            bezier_program->Bind();
+            gpu_car->updateTessellation(glm::vec2(width, height));
+        }
+
+        /* Submit every draw and let the queue order them by program,
+         * material and mesh.
+         */
+        queue.setCamera(view, projection, e);
+        if (use_mesh_pool) {
+            pool.clearDraws();
+            for (size_t i = 0; i < body_instances.size(); ++i)
+                pool.addDraw(sphere_entry + body_lods[i], body_instances[i]);
+            if (car_visible)
+                for (unsigned int k = 0; k < n_car_entries; ++k)
+                    pool.addDraw(car_entry + k, cgcl::InstanceData::make(car_model, car_entry_materials[k]));
+            if (bezier_car_visible)
+                pool.addDraw(bezier_car_entry, cgcl::InstanceData::make(bezier_car_model, car_material),
+                             n_bezier_car_entries);
+            pool.updateDraws();
+            queue.submit(&instanced_program, &pool, nullptr, glm::mat4(1.0f));
+        } else {
+            sphere->instances_ = body_instances;
+            sphere->updateInstances();
+            queue.submit(&instanced_program, sphere.get(), nullptr, glm::mat4(1.0f));
+            /* The OBJ car is drawn with the materials of its MTL library. */
+            if (car_visible && !car_normal_mapped)
+                queue.submit(&program, mesh_ptr.get(), nullptr, car_model);
+            if (bezier_car_visible)
+                queue.submit(&program, car.get(), &car_material, bezier_car_model);
+        }
+        if (car_visible && car_normal_mapped)
+            queue.submit(normal_map_program.get(), mesh_ptr.get(), nullptr, car_model);
+        if (gpu_car && bezier_car_visible)
+            queue.submit(bezier_program.get(), gpu_car.get(), &car_material, bezier_car_model);
+        const cgcl::RenderStats &stats = queue.flush();
+        if (first_frame) {
+            std::cout << "Draw calls: " << stats.draw_calls
+                      << ", state changes: " << stats.stateChanges() << std::endl;
+            first_frame = false;
         }
         glfwSwapBuffers(window);
         glfwPollEvents();    
     }
 
 
+    if (use_mesh_pool)
+        pool.finishGL();
+    else
+        sphere->finishGL();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
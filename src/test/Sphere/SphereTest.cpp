@@ -0,0 +1,74 @@
+/// \file SphereTest.cpp
+/// \brief Check the uv, ico and cube spheres: vertex and triangle
+/// counts, unit positions and normals, outward winding, and that
+/// they are closed once vertices are welded by position.
+/// usage: SphereTest
+
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/mesh/HalfEdge.h"
+#include "cgcl/utils/logging.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace cgcl;
+
+/// \brief Check one sphere, the generators duplicate vertices along
+/// seams and face edges, n_welded is the count once welded.
+static void check_sphere(const std::string &name, const SphereGeometry &sphere, size_t n_vertices,
+                         size_t n_triangles, size_t n_welded) {
+    CHECK_EQ(sphere.vertices_.size(), n_vertices) << name;
+    CHECK_EQ(sphere.n_triangles(), n_triangles) << name;
+    for (const Vertex &v : sphere.vertices_) {
+        CHECK_LT(std::abs(glm::length(v.position_) - 1.0f), 1e-5f) << name << " position off the sphere";
+        CHECK_LT(std::abs(glm::length(v.normal_) - 1.0f), 1e-5f) << name << " normal not unit";
+        CHECK_GT(glm::dot(v.normal_, v.position_), 0.9999f) << name << " normal not radial";
+    }
+
+    /* Weld by exact position, shared edges must come out bit-identical. */
+    std::map<std::tuple<float, float, float>, unsigned int> welded;
+    std::vector<unsigned int> indices(sphere.indices_.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const glm::vec3 &p = sphere.vertices_[sphere.indices_[i]].position_;
+        indices[i] = welded.emplace(std::make_tuple(p.x, p.y, p.z), unsigned(welded.size())).first->second;
+    }
+    CHECK_EQ(welded.size(), n_welded) << name << " has cracks";
+
+    size_t n_outward = 0;
+    for (size_t t = 0; t < n_triangles; ++t) {
+        const glm::vec3 &a = sphere.vertices_[sphere.indices_[3 * t]].position_;
+        const glm::vec3 &b = sphere.vertices_[sphere.indices_[3 * t + 1]].position_;
+        const glm::vec3 &c = sphere.vertices_[sphere.indices_[3 * t + 2]].position_;
+        CHECK(indices[3 * t] != indices[3 * t + 1] && indices[3 * t + 1] != indices[3 * t + 2] &&
+              indices[3 * t + 2] != indices[3 * t]) << name << " triangle " << t << " is degenerate";
+        n_outward += glm::dot(glm::cross(b - a, c - a), a + b + c) > 0.0f;
+    }
+    CHECK_EQ(n_outward, n_triangles) << name << " triangles wind inward";
+
+    const HalfEdgeMesh mesh = HalfEdgeMesh::build(indices.data(), indices.size(), welded.size());
+    CHECK(mesh.isClosed()) << name << ": " << mesh.n_border_edges_ << " border and "
+                           << mesh.n_non_manifold_edges_ << " non-manifold edges";
+    /* Closed, so every edge has two half-edges, V - E + F == 2 of a sphere. */
+    CHECK_EQ(long(n_welded) - long(indices.size() / 2) + long(n_triangles), 2) << name;
+    std::cout << name << ": " << n_vertices << " vertices, " << n_triangles << " triangles, closed" << std::endl;
+}
+
+int main() {
+    for (unsigned int n : {3u, 8u, 33u}) {
+        const unsigned int n_latitude = n / 2 + 2;
+        check_sphere("uv sphere " + std::to_string(n) + "x" + std::to_string(n_latitude),
+                     SphereGeometry::uv_sphere(n, n_latitude), size_t(n + 1) * (n_latitude + 1),
+                     size_t(n) * (2 * n_latitude - 2), size_t(n) * (n_latitude - 1) + 2);
+    }
+    for (unsigned int n : {1u, 2u, 7u, 16u})
+        check_sphere("ico sphere " + std::to_string(n), SphereGeometry::ico_sphere(n),
+                     20 * size_t(n + 1) * (n + 2) / 2, 20 * size_t(n) * n, 10 * size_t(n) * n + 2);
+    for (unsigned int n : {1u, 2u, 7u, 16u})
+        check_sphere("cube sphere " + std::to_string(n), SphereGeometry::cube_sphere(n),
+                     6 * size_t(n + 1) * (n + 1), 12 * size_t(n) * n, 6 * size_t(n) * n + 2);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/// \file SubdivisionBench.cpp
+/// \brief Subdivide a cube by Catmull-Clark and an icosahedron by Loop,
+/// check the stencils and the limit shapes, then time evaluating a
+/// deformed cage against subdividing again.
+/// usage: SubdivisionBench [levels]
+/// --check runs the checks alone on a small cube.
+
+#include "cgcl/mesh/Subdivision.h"
+#include "cgcl/utils/logging.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace cgcl;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// \brief Every row is an affine combination.
+static void check_stencils(const Subdivision &subdivision) {
+    for (const auto &table : subdivision.stencils_) {
+        for (size_t i = 0; i < table.size(); ++i) {
+            float sum = 0.0f;
+            for (uint32_t k = table.offsets_[i]; k < table.offsets_[i + 1]; ++k)
+                sum += table.weights_[k];
+            CHECK_LT(std::abs(sum - 1.0f), 1e-5f) << "Row " << i;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned levels = check ? 2 : argc > 1 ? std::atoi(argv[1]) : 5;
+
+    /* Cube of six quads, outward. */
+    std::vector<glm::vec3> cube;
+    for (int i = 0; i < 8; ++i)
+        cube.emplace_back(float(i & 1) - 0.5f, float((i >> 1) & 1) - 0.5f, float((i >> 2) & 1) - 0.5f);
+    const std::vector<unsigned int> quad_sizes(6, 4);
+    const std::vector<unsigned int> quads = {0, 2, 3, 1,  4, 5, 7, 6,  0, 1, 5, 4,
+                                             2, 6, 7, 3,  0, 4, 6, 2,  1, 3, 7, 5};
+    auto start = std::chrono::steady_clock::now();
+    auto cc = Subdivision::build(quad_sizes, quads, cube.size(), levels);
+    const double build_ms = elapsed_ms(start);
+    CHECK(cc.scheme_ == SubdivisionScheme::CatmullClark);
+    check_stencils(cc);
+    /* V - E + F = 2 on every level, F = 6 * 4^levels quads. */
+    const size_t n_quads = size_t(6) << (2 * levels);
+    CHECK_EQ(cc.indices_.size(), 6 * n_quads);
+    CHECK_EQ(cc.n_vertices(), n_quads + 2);
+
+    std::vector<glm::vec3> refined;
+    cc.evaluate(cube.data(), refined);
+    /* The limit of a cube stays inside it and outside its inscribed sphere. */
+    for (const auto &p : refined) {
+        CHECK_LE(std::max({std::abs(p.x), std::abs(p.y), std::abs(p.z)}), 0.5f);
+        CHECK_GE(glm::length(p), 0.25f);
+    }
+
+    /* Deform the cage and evaluate again, the topology stays. */
+    for (auto &p : cube)
+        p *= glm::vec3(2.0f, 1.0f, 1.0f);
+    start = std::chrono::steady_clock::now();
+    cc.evaluate(cube.data(), refined);
+    const double evaluate_ms = elapsed_ms(start);
+    std::cout << "Catmull-Clark, " << levels << " levels, " << n_quads << " quads: built in " << build_ms
+              << " ms, evaluated in " << evaluate_ms << " ms, " << build_ms / evaluate_ms
+              << "x cheaper" << std::endl;
+
+    /* Loop of an icosahedron approaches a sphere. */
+    const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    std::vector<glm::vec3> cage = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+                                   {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+                                   {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+    for (auto &p : cage)
+        p = glm::normalize(p);
+    const std::vector<unsigned int> ico = {0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+                                           1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+                                           3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+                                           4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1};
+    const std::vector<unsigned int> triangle_sizes(ico.size() / 3, 3);
+    start = std::chrono::steady_clock::now();
+    auto loop = Subdivision::build(triangle_sizes, ico, cage.size(), levels);
+    const double loop_build_ms = elapsed_ms(start);
+    CHECK(loop.scheme_ == SubdivisionScheme::Loop);
+    check_stencils(loop);
+    CHECK_EQ(loop.indices_.size(), ico.size() << (2 * levels));
+
+    start = std::chrono::steady_clock::now();
+    auto mesh = loop.toMesh(cage);
+    const double loop_evaluate_ms = elapsed_ms(start);
+    float min_radius = 1.0f, max_radius = 0.0f;
+    for (const auto &v : mesh->global_vertices_) {
+        min_radius = std::min(min_radius, glm::length(v.position_));
+        max_radius = std::max(max_radius, glm::length(v.position_));
+        CHECK_GT(glm::dot(v.normal_, glm::normalize(v.position_)), 0.99f);
+    }
+    std::cout << "Loop, " << mesh->global_indices_.size() / 3 << " triangles: built in " << loop_build_ms
+              << " ms, mesh in " << loop_evaluate_ms << " ms, radius " << min_radius << " ~ "
+              << max_radius << std::endl;
+    CHECK_GT(min_radius / max_radius, 0.9f);
+
+    loop.update(*mesh, cage);
+}
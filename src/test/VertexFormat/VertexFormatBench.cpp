@@ -0,0 +1,81 @@
+/// \file VertexFormatBench.cpp
+/// \brief Encode the vertices of a cube sphere in every packed format,
+/// report size and speed, and bound the error of decoding them back.
+/// usage: VertexFormatBench [n_segments], 6 * (n_segments + 1)^2 vertices.
+/// --check runs the checks alone on a small mesh.
+
+#include "cgcl/mesh/Sphere.h"
+#include "cgcl/mesh/VertexFormat.h"
+#include "cgcl/utils/logging.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace cgcl;
+
+int main(int argc, char *argv[]) {
+    /* Half floats round trip exactly, NaN aside. */
+    for (uint32_t h = 0; h < 0x10000u; ++h) {
+        float value = half_to_float(uint16_t(h));
+        if (std::isnan(value)) continue;
+        CHECK_EQ(float_to_half(value), h) << "half " << h;
+    }
+
+    const bool check = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+    const unsigned n_segments = check ? 32 : argc > 1 ? std::atoi(argv[1]) : 512;
+    auto sphere = SphereGeometry::cube_sphere(n_segments);
+    TriMesh mesh(std::move(sphere.vertices_), std::move(sphere.indices_));
+    const auto &vertices = mesh.global_vertices_;
+    const size_t n_vertices = vertices.size();
+    /* Off center and flattened, so the box is not the unit cube. */
+    for (auto &vertex : mesh.global_vertices_)
+        vertex.position_ = vertex.position_ * glm::vec3(3.0f, 1.0f, 0.5f) + glm::vec3(10.0f, -2.0f, 0.0f);
+    mesh.computeBounds();
+    const glm::vec3 extent = mesh.bounds_.extent();
+
+    struct Case {
+        const char *name;
+        VertexFormat format;
+        float max_normal_degrees;
+    };
+    VertexFormat float_oct8{false, VertexFormat::Normal::Oct8, false};
+    const Case cases[] = {
+        {"full", VertexFormat::full(), 0.0f},
+        {"compact", VertexFormat::compact(), 0.01f},
+        {"smallest", VertexFormat::smallest(), 1.0f},
+        {"float + oct8", float_oct8, 1.0f},
+    };
+    std::cout << n_vertices << " vertices" << std::endl;
+    for (const auto &c : cases) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> data = c.format.encode(vertices, mesh.bounds_);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        CHECK_EQ(data.size(), n_vertices * c.format.stride());
+
+        float position_error = 0.0f, normal_degrees = 0.0f, uv_error = 0.0f;
+        for (size_t i = 0; i < n_vertices; ++i) {
+            Vertex decoded = c.format.decode(data.data(), i, mesh.bounds_);
+            glm::vec3 d = glm::abs(decoded.position_ - vertices[i].position_) / extent;
+            position_error = std::max({position_error, d.x, d.y, d.z});
+            /* atan2 stays accurate for small angles, acos does not. */
+            glm::vec3 n = glm::normalize(vertices[i].normal_);
+            float angle = std::atan2(glm::length(glm::cross(decoded.normal_, n)), glm::dot(decoded.normal_, n));
+            normal_degrees = std::max(normal_degrees, float(angle * 180.0 / M_PI));
+            glm::vec2 e = glm::abs(decoded.texture_coords_ - vertices[i].texture_coords_);
+            uv_error = std::max({uv_error, e.x, e.y});
+        }
+        std::cout << c.name << ": " << c.format.stride() << " bytes, " << 32.0f / c.format.stride()
+                  << "x smaller, encoded in " << ms << " ms, position error " << position_error
+                  << " of the box, normal error " << normal_degrees << " deg, uv error " << uv_error << std::endl;
+        CHECK_LE(position_error, c.format.position_16_ ? 1.0f / 65535.0f : 0.0f);
+        CHECK_LE(normal_degrees, c.max_normal_degrees + 1e-3f);
+        CHECK_LE(uv_error, c.format.uv_half_ ? 1.0f / 2048.0f : 0.0f);
+    }
+    CHECK_EQ(VertexFormat::compact().stride(), 16u);
+    CHECK_EQ(VertexFormat::smallest().stride(), 12u);
+    return 0;
+}